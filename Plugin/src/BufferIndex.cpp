@@ -0,0 +1,21 @@
+#include "BufferIndex.h"
+
+namespace Utils
+{
+	BufferNameIndex::BufferNameIndex(std::span<RE::BufferDefinition* const> a_buffers)
+	{
+		buffers.reserve(a_buffers.size());
+		for (const auto buffer : a_buffers) {
+			if (buffer && buffer->bufferName) {
+				// If the same name is present more than once, the first one wins, as it did with the old linear search
+				buffers.try_emplace(buffer->bufferName, buffer);
+			}
+		}
+	}
+
+	RE::BufferDefinition* BufferNameIndex::Find(std::string_view a_bufferName) const
+	{
+		const auto it = buffers.find(a_bufferName);
+		return it != buffers.end() ? it->second : nullptr;
+	}
+}
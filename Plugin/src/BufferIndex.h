@@ -0,0 +1,21 @@
+#pragma once
+#include "RE/Buffers.h"
+
+namespace Utils
+{
+	// Maps buffer names to their definitions. The names are owned by the game and never change, so the index only needs to be built once.
+	class BufferNameIndex
+	{
+	public:
+		BufferNameIndex() = default;
+		explicit BufferNameIndex(std::span<RE::BufferDefinition* const> a_buffers);
+
+		// Returns nullptr if there's no buffer with that name
+		RE::BufferDefinition* Find(std::string_view a_bufferName) const;
+
+		size_t Size() const { return buffers.size(); }
+
+	private:
+		std::unordered_map<std::string_view, RE::BufferDefinition*> buffers;
+	};
+}
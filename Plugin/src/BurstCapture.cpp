@@ -0,0 +1,99 @@
+#include "BurstCapture.h"
+
+namespace Utils
+{
+	bool BurstCapture::Start(const BurstCaptureParams& a_params)
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		if (bActive) {
+			return false;
+		}
+
+		params = a_params;
+		params.frameCount = std::max(params.frameCount, 1u);
+		params.frameInterval = std::max(params.frameInterval, 1u);
+		params.ringSize = std::max(params.ringSize, 1u);
+
+		bActive = true;
+		framesSinceStart = 0;
+		nextIndex = 0;
+		inFlight.clear();
+		report = { .frameCount = params.frameCount };
+		return true;
+	}
+
+	bool BurstCapture::IsActive() const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		return bActive;
+	}
+
+	bool BurstCapture::IsCaptureDone() const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		return nextIndex >= params.frameCount;
+	}
+
+	std::optional<uint32_t> BurstCapture::OnFrame()
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		if (!bActive || nextIndex >= params.frameCount) {
+			return std::nullopt;
+		}
+
+		const bool bDue = framesSinceStart++ % params.frameInterval == 0;
+		if (!bDue) {
+			return std::nullopt;
+		}
+
+		const uint32_t index = nextIndex++;
+		if (inFlight.size() >= params.ringSize) {
+			report.droppedFrames.push_back(index);
+			return std::nullopt;
+		}
+		inFlight.push_back(index);
+		return index;
+	}
+
+	bool BurstCapture::IsNextFrameDue() const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		return bActive && nextIndex < params.frameCount && framesSinceStart % params.frameInterval == 0;
+	}
+
+	void BurstCapture::DropFrame(uint32_t a_index)
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		if (const auto it = std::ranges::find(inFlight, a_index); it != inFlight.end()) {
+			inFlight.erase(it);
+			// Frames are dropped on the frame they were due, so the list stays in order
+			report.droppedFrames.push_back(a_index);
+		}
+	}
+
+	void BurstCapture::OnFrameEncoded(uint32_t a_index)
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		if (const auto it = std::ranges::find(inFlight, a_index); it != inFlight.end()) {
+			inFlight.erase(it);
+			++report.capturedCount;
+		}
+	}
+
+	std::optional<BurstCaptureReport> BurstCapture::TakeReport()
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		if (!bActive || nextIndex < params.frameCount || !inFlight.empty()) {
+			return std::nullopt;
+		}
+
+		bActive = false;
+		return std::move(report);
+	}
+
+	size_t BurstCapture::GetInFlightCount() const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		return inFlight.size();
+	}
+}
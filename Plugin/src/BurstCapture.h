@@ -0,0 +1,56 @@
+#pragma once
+
+namespace Utils
+{
+	struct BurstCaptureParams
+	{
+		uint32_t frameCount = 1;     // How many frames the sequence has
+		uint32_t frameInterval = 1;  // A frame is captured every this many rendered frames
+		uint32_t ringSize = 4;       // How many captures can be in flight at once, from the GPU copy until they are encoded
+	};
+
+	struct BurstCaptureReport
+	{
+		uint32_t              frameCount = 0;
+		uint32_t              capturedCount = 0;
+		std::vector<uint32_t> droppedFrames;  // Indices in the sequence, in order
+	};
+
+	// Schedules the captures of a burst: which rendered frames to capture, and which to drop to keep the ring of in-flight captures from overflowing.
+	// A frame that is due while the ring is full is dropped instead of waited for, so the game never stalls and the frames after it keep their timing.
+	// Frames are numbered by their position in the sequence, so the dropped ones leave gaps.
+	// Driven by the render thread, except for "OnFrameEncoded()", which can be called from any thread.
+	class BurstCapture
+	{
+	public:
+		// Returns false if a burst is already running
+		bool Start(const BurstCaptureParams& a_params);
+		bool IsActive() const;
+		// Whether every frame of the sequence has been captured or dropped, the last captures might still be encoding
+		bool IsCaptureDone() const;
+
+		// Call once per rendered frame while active, the first one being the frame the burst was started on.
+		// Returns the index of the frame to capture, if one is due and there's room for it in the ring.
+		std::optional<uint32_t> OnFrame();
+		// Whether the next call to "OnFrame()" has a frame due (it might still be dropped if the ring is full), so it can be prepared for capture
+		bool IsNextFrameDue() const;
+		// The capture of a frame returned by "OnFrame()" couldn't be started (e.g. there was no memory for it)
+		void DropFrame(uint32_t a_index);
+		// The capture of a frame is done with and its slot in the ring can be reused
+		void OnFrameEncoded(uint32_t a_index);
+
+		// Returns the report and ends the burst, once every frame has been encoded or dropped
+		std::optional<BurstCaptureReport> TakeReport();
+
+		size_t GetInFlightCount() const;
+
+	private:
+		mutable std::mutex    mutex;
+		BurstCaptureParams    params;
+		bool                  bActive = false;
+		uint64_t              framesSinceStart = 0;
+		uint32_t              nextIndex = 0;  // Of the next frame of the sequence to be due
+		std::vector<uint32_t> inFlight;
+		BurstCaptureReport    report;
+	};
+}
@@ -0,0 +1,167 @@
+#include "ColorTransform.h"
+#include "CpuFeatures.h"
+#include "HalfFloat.h"
+#include "WorkerPool.h"
+
+#include <immintrin.h>
+
+namespace Utils
+{
+	namespace
+	{
+		void TransformRowScalar(uint16_t* a_pixels, size_t a_width, const ColorTransform& a_transform)
+		{
+			const float clampMax = a_transform.clampMax.value_or(0.f);
+			for (size_t x = 0; x < a_width; ++x) {
+				uint16_t* pixel = a_pixels + x * 4;
+				float color[3] = { HalfToFloat(pixel[0]), HalfToFloat(pixel[1]), HalfToFloat(pixel[2]) };
+
+				auto applyMatrix = [&color](const ColorMatrix& a_matrix) {
+					const float input[3] = { color[0], color[1], color[2] };
+					for (int row = 0; row < 3; ++row) {
+						color[row] = a_matrix.m[row][0] * input[0] + a_matrix.m[row][1] * input[1] + a_matrix.m[row][2] * input[2];
+					}
+				};
+
+				if (a_transform.preClampMatrix) {
+					applyMatrix(*a_transform.preClampMatrix);
+				}
+				if (a_transform.clampMax) {
+					for (float& channel : color) {
+						channel = std::clamp(channel, 0.f, clampMax);
+					}
+				}
+				if (a_transform.postClampMatrix) {
+					applyMatrix(*a_transform.postClampMatrix);
+				}
+
+				for (int i = 0; i < 3; ++i) {
+					pixel[i] = FloatToHalf(color[i]);
+				}
+				if (a_transform.bOpaqueAlpha) {
+					pixel[3] = 0x3C00;
+				}
+			}
+		}
+
+		// The columns of the matrix, repeated for both pixels in a register. The 4th lane is 0 so alpha is left out of the products.
+		struct MatrixColumnsAVX2
+		{
+			__m256 columns[3];
+		};
+
+		LUMA_TARGET_AVX2 MatrixColumnsAVX2 LoadMatrixColumnsAVX2(const ColorMatrix& a_matrix)
+		{
+			MatrixColumnsAVX2 result;
+			for (int column = 0; column < 3; ++column) {
+				const __m128 columnVector = _mm_setr_ps(a_matrix.m[0][column], a_matrix.m[1][column], a_matrix.m[2][column], 0.f);
+				result.columns[column] = _mm256_set_m128(columnVector, columnVector);
+			}
+			return result;
+		}
+
+		// Alpha ends up as 0, it's restored after
+		LUMA_TARGET_AVX2 __m256 ApplyMatrixAVX2(__m256 a_colors, const MatrixColumnsAVX2& a_matrix)
+		{
+			__m256 result = _mm256_mul_ps(_mm256_permute_ps(a_colors, 0x00), a_matrix.columns[0]);
+			result = _mm256_fmadd_ps(_mm256_permute_ps(a_colors, 0x55), a_matrix.columns[1], result);
+			return _mm256_fmadd_ps(_mm256_permute_ps(a_colors, 0xAA), a_matrix.columns[2], result);
+		}
+
+		// Two RGBA16F pixels per register
+		LUMA_TARGET_AVX2 void TransformRowAVX2(uint16_t* a_pixels, size_t a_width, const ColorTransform& a_transform)
+		{
+			const bool bPreClampMatrix = a_transform.preClampMatrix.has_value();
+			const bool bClamp = a_transform.clampMax.has_value();
+			const bool bPostClampMatrix = a_transform.postClampMatrix.has_value();
+			const bool bOpaqueAlpha = a_transform.bOpaqueAlpha;
+
+			const MatrixColumnsAVX2 preClampMatrix = bPreClampMatrix ? LoadMatrixColumnsAVX2(*a_transform.preClampMatrix) : MatrixColumnsAVX2{};
+			const MatrixColumnsAVX2 postClampMatrix = bPostClampMatrix ? LoadMatrixColumnsAVX2(*a_transform.postClampMatrix) : MatrixColumnsAVX2{};
+			const __m256 clampMin = _mm256_setzero_ps();
+			const __m256 clampMax = _mm256_set1_ps(a_transform.clampMax.value_or(0.f));
+			const __m256 one = _mm256_set1_ps(1.f);
+			constexpr int alphaMask = 0x88;  // The 4th lane of each pixel
+
+			const size_t vectorWidth = a_width & ~size_t(1);
+			for (size_t x = 0; x < vectorWidth; x += 2) {
+				uint16_t* pixels = a_pixels + x * 4;
+				const __m256 input = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)));
+				__m256 colors = input;
+
+				if (bPreClampMatrix) {
+					colors = ApplyMatrixAVX2(colors, preClampMatrix);
+				}
+				if (bClamp) {
+					colors = _mm256_min_ps(_mm256_max_ps(colors, clampMin), clampMax);
+				}
+				if (bPostClampMatrix) {
+					colors = ApplyMatrixAVX2(colors, postClampMatrix);
+				}
+				colors = _mm256_blend_ps(colors, bOpaqueAlpha ? one : input, alphaMask);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), _mm256_cvtps_ph(colors, _MM_FROUND_TO_NEAREST_INT));
+			}
+
+			if (vectorWidth != a_width) {
+				TransformRowScalar(a_pixels + vectorWidth * 4, a_width - vectorWidth, a_transform);
+			}
+		}
+	}
+
+	ColorTransform GetHDRScreenshotTransform(std::optional<float> a_peakBrightnessScRGB)
+	{
+		if (!a_peakBrightnessScRGB) {
+			return hdrScreenshotTransform;
+		}
+
+		return ColorTransform{
+			.preClampMatrix = BT709ToBT2020,
+			.clampMax = std::max(*a_peakBrightnessScRGB, 0.f),
+			.postClampMatrix = BT2020ToBT709
+		};
+	}
+
+	void TransformHalfImage(uint8_t* a_pixels, size_t a_width, size_t a_height, size_t a_rowPitch, const ColorTransform& a_transform, WorkerPool* a_workers, SceneStatistics* a_outStatistics)
+	{
+		const bool bTransform = !a_transform.IsNoOp();
+		if ((!bTransform && !a_outStatistics) || a_width == 0 || a_height == 0) {
+			return;
+		}
+
+		const auto transformRow = IsAVX2Supported() ? &TransformRowAVX2 : &TransformRowScalar;
+
+		// Each worker keeps its own statistics, they are merged once its rows are done
+		std::mutex mergeMutex;
+		auto       transformRows = [&](size_t a_begin, size_t a_end) {
+			SceneStatistics statistics{ .peakNits = a_outStatistics ? a_outStatistics->peakNits : 0.f };
+			for (size_t y = a_begin; y < a_end; ++y) {
+				uint8_t* row = a_pixels + y * a_rowPitch;
+				if (bTransform) {
+					transformRow(reinterpret_cast<uint16_t*>(row), a_width, a_transform);
+				}
+				if (a_outStatistics) {
+					AccumulateSceneStatistics(row, a_width, statistics);
+				}
+			}
+
+			if (a_outStatistics) {
+				std::lock_guard<std::mutex> lg(mergeMutex);
+				a_outStatistics->Merge(statistics);
+			}
+		};
+
+		if (a_workers) {
+			a_workers->ParallelFor(a_height, transformRows);
+		} else {
+			transformRows(0, a_height);
+		}
+	}
+
+	void ColorTransformStage::ProcessStrip(const ImageInfo& a_info, ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		if (a_info.format == DXGI_FORMAT_R16G16B16A16_FLOAT) {
+			TransformHalfImage(a_strip.pixels, a_info.width, a_strip.rowCount, a_strip.rowPitch, transform, a_workers, statistics);
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ImagePipeline.h"
+#include "SceneStatistics.h"
+
+namespace Utils
+{
+	class WorkerPool;
+
+	// Row major 3x3 matrix applied to column vectors (out = M * rgb)
+	struct ColorMatrix
+	{
+		float m[3][3];
+
+		constexpr ColorMatrix operator*(const ColorMatrix& a_rhs) const
+		{
+			ColorMatrix result{};
+			for (int row = 0; row < 3; ++row) {
+				for (int column = 0; column < 3; ++column) {
+					result.m[row][column] = m[row][0] * a_rhs.m[0][column] + m[row][1] * a_rhs.m[1][column] + m[row][2] * a_rhs.m[2][column];
+				}
+			}
+			return result;
+		}
+
+		constexpr bool IsIdentity(float a_tolerance = 1e-5f) const
+		{
+			for (int row = 0; row < 3; ++row) {
+				for (int column = 0; column < 3; ++column) {
+					const float difference = m[row][column] - (row == column ? 1.f : 0.f);
+					if (difference > a_tolerance || difference < -a_tolerance) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	};
+
+	inline constexpr ColorMatrix BT709ToBT2020 = { {
+		{ 0.62722527980804443359375f, 0.329476892948150634765625f, 0.04329781234264373779296875f },
+		{ 0.0690418779850006103515625f, 0.919605672359466552734375f, 0.011352437548339366912841796875f },
+		{ 0.01639117114245891571044921875f, 0.0880887508392333984375f, 0.89552009105682373046875f },
+	} };
+
+	inline constexpr ColorMatrix BT2020ToBT709 = { {
+		{ 1.6609637737274169921875f, -0.58811271190643310546875f, -0.072851054370403289794921875f },
+		{ -0.124477200210094451904296875f, 1.1328194141387939453125f, -0.00834227167069911956787109375f },
+		{ -0.0181571580469608306884765625f, -0.10066641867160797119140625f, 1.118823528289794921875f },
+	} };
+
+	// Multiplies the matrices in the order they are applied, returns nothing if they cancel out
+	constexpr std::optional<ColorMatrix> FoldColorMatrices(std::initializer_list<ColorMatrix> a_matrices)
+	{
+		ColorMatrix result = { { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } } };
+		for (const auto& matrix : a_matrices) {
+			result = matrix * result;
+		}
+		if (result.IsIdentity()) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	// Matrix -> clamp -> matrix -> opaque alpha, each step is optional. Adjacent matrices should be folded together when there's no clamp in between.
+	struct ColorTransform
+	{
+		std::optional<ColorMatrix> preClampMatrix;
+		std::optional<float>       clampMax;  // The minimum is 0
+		std::optional<ColorMatrix> postClampMatrix;
+		bool                       bOpaqueAlpha = true;
+
+		bool IsNoOp() const { return !preClampMatrix && !clampMax && !postClampMatrix && !bOpaqueAlpha; }
+	};
+
+	// BT.709 to BT.2020 and back is an identity, so without the clamp the whole chain folds down to just forcing the alpha to 1
+	inline constexpr ColorTransform hdrScreenshotTransform = { .preClampMatrix = FoldColorMatrices({ BT709ToBT2020, BT2020ToBT709 }) };
+	static_assert(!hdrScreenshotTransform.preClampMatrix);
+
+	// Optionally clamps the colors to the peak brightness (in BT.2020, like the copy shader does)
+	ColorTransform GetHDRScreenshotTransform(std::optional<float> a_peakBrightnessScRGB);
+
+	// Transforms an RGBA16F image in place. Uses AVX2 and F16C if the CPU supports them, and splits the rows between the workers, if any are passed in.
+	// The statistics of the transformed pixels are added to "a_outStatistics" if it's passed in, each row right after it's transformed, while it's still in the cache.
+	void TransformHalfImage(uint8_t* a_pixels, size_t a_width, size_t a_height, size_t a_rowPitch, const ColorTransform& a_transform, WorkerPool* a_workers = nullptr, SceneStatistics* a_outStatistics = nullptr);
+
+	// Runs the transform on each RGBA16F strip as it goes through a pipeline
+	class ColorTransformStage : public ImageStage
+	{
+	public:
+		explicit ColorTransformStage(const ColorTransform& a_transform, SceneStatistics* a_outStatistics = nullptr) :
+			transform(a_transform), statistics(a_outStatistics) {}
+
+		void ProcessStrip(const ImageInfo& a_info, ImageStrip& a_strip, WorkerPool* a_workers) override;
+
+	private:
+		ColorTransform   transform;
+		SceneStatistics* statistics;
+	};
+}
@@ -0,0 +1,92 @@
+#include "ConfigWatcher.h"
+
+namespace Settings
+{
+	ConfigWatcher::ConfigWatcher(std::filesystem::path a_path, ChangeFunction a_changeFunction, std::chrono::milliseconds a_pollInterval) :
+		path(std::move(a_path)), changeFunction(std::move(a_changeFunction)), pollInterval(a_pollInterval)
+	{
+		knownVersion = GetVersion();
+		thread = std::thread(&ConfigWatcher::Run, this);
+	}
+
+	ConfigWatcher::~ConfigWatcher()
+	{
+		// If "Stop()" wasn't called, the process is exiting and the thread was already terminated
+		if (thread.joinable()) {
+			thread.detach();
+		}
+	}
+
+	void ConfigWatcher::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			bStop = true;
+		}
+		condition.notify_one();
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	void ConfigWatcher::IgnoreCurrentVersion()
+	{
+		const auto version = GetVersion();
+		std::lock_guard<std::mutex> lg(mutex);
+		knownVersion = version;
+		ignoredVersion = version;
+	}
+
+	bool ConfigWatcher::IsCurrentVersionIgnored() const
+	{
+		const auto version = GetVersion();
+		std::lock_guard<std::mutex> lg(mutex);
+		return version && version == ignoredVersion;
+	}
+
+	std::optional<ConfigWatcher::Version> ConfigWatcher::GetVersion() const
+	{
+		std::error_code ec;
+		Version version;
+		version.lastWriteTime = std::filesystem::last_write_time(path, ec);
+		if (ec) {
+			return std::nullopt;
+		}
+		version.size = std::filesystem::file_size(path, ec);
+		if (ec) {
+			return std::nullopt;
+		}
+		return version;
+	}
+
+	void ConfigWatcher::Run()
+	{
+		std::optional<Version> pendingVersion;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!condition.wait_for(lock, pollInterval, [this] { return bStop; })) {
+			lock.unlock();
+			const auto version = GetVersion();
+			lock.lock();
+
+			// The file is missing or mid replacement, keep the last known version
+			if (!version || version == knownVersion) {
+				pendingVersion.reset();
+				continue;
+			}
+
+			// Wait for the same version to be seen twice in a row, so we don't read a file that is still being written
+			if (version != pendingVersion) {
+				pendingVersion = version;
+				continue;
+			}
+
+			knownVersion = version;
+			pendingVersion.reset();
+
+			lock.unlock();
+			changeFunction();
+			lock.lock();
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Settings
+{
+	// Polls a file for changes on a background thread, calling the change function (from that thread) once a modification has settled.
+	// Polling the file time and size is portable and cheap enough for a single file.
+	// "Stop()" needs to be called before the DLL is unloaded, the destructor can run under the loader lock, so it doesn't wait for the thread.
+	class ConfigWatcher
+	{
+	public:
+		using ChangeFunction = std::function<void()>;
+
+		ConfigWatcher(std::filesystem::path a_path, ChangeFunction a_changeFunction, std::chrono::milliseconds a_pollInterval);
+		~ConfigWatcher();
+
+		void Stop();
+
+		ConfigWatcher(const ConfigWatcher&) = delete;
+		ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+		// Needs to be called after we write the file ourselves, so the write isn't detected as an external change
+		void IgnoreCurrentVersion();
+		// Whether the file on disk is the one we last wrote ourselves
+		bool IsCurrentVersionIgnored() const;
+
+	private:
+		struct Version
+		{
+			std::filesystem::file_time_type lastWriteTime;
+			uintmax_t                       size = 0;
+
+			bool operator==(const Version&) const = default;
+		};
+
+		std::optional<Version> GetVersion() const;
+		void                   Run();
+
+		std::filesystem::path     path;
+		ChangeFunction            changeFunction;
+		std::chrono::milliseconds pollInterval;
+
+		mutable std::mutex      mutex;
+		std::condition_variable condition;
+		bool                    bStop = false;
+		std::optional<Version>  knownVersion;
+		std::optional<Version>  ignoredVersion;
+
+		std::thread thread;
+	};
+}
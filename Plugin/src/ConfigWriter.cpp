@@ -0,0 +1,93 @@
+#include "ConfigWriter.h"
+
+namespace Settings
+{
+	ConfigWriter::ConfigWriter(WriteFunction a_writeFunction, std::chrono::milliseconds a_debounce) :
+		writeFunction(std::move(a_writeFunction)), debounceMS(a_debounce.count())
+	{
+		thread = std::thread(&ConfigWriter::Run, this);
+	}
+
+	ConfigWriter::~ConfigWriter()
+	{
+		// If "Shutdown()" wasn't called, the process is exiting and the thread was already terminated
+		if (thread.joinable()) {
+			thread.detach();
+		}
+	}
+
+	void ConfigWriter::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lg(stopMutex);
+			bStop.store(true);
+		}
+		stopCondition.notify_one();
+		requestedGeneration.fetch_add(1);  // Wakes up the thread, this isn't a real request
+		requestedGeneration.notify_one();
+		if (thread.joinable()) {
+			thread.join();
+		}
+		requestedGeneration.fetch_sub(1);
+
+		Flush();
+	}
+
+	void ConfigWriter::RequestWrite() noexcept
+	{
+		// Sequentially consistent, so either "Shutdown()" sees this request or this sees it stopping
+		requestedGeneration.fetch_add(1);
+		if (bStop.load()) {
+			Flush();  // There's no thread to do it anymore
+			return;
+		}
+		requestedGeneration.notify_one();
+	}
+
+	void ConfigWriter::Flush()
+	{
+		const uint64_t generation = requestedGeneration.load(std::memory_order_acquire);
+		if (generation != writtenGeneration.load(std::memory_order_acquire)) {
+			Write(generation);
+		}
+	}
+
+	void ConfigWriter::Run()
+	{
+		while (!bStop.load()) {
+			uint64_t generation = requestedGeneration.load(std::memory_order_acquire);
+			if (generation == writtenGeneration.load(std::memory_order_acquire)) {
+				requestedGeneration.wait(generation, std::memory_order_acquire);
+				continue;
+			}
+
+			// Keep waiting until no new request came in for the whole debounce time (e.g. the user stopped dragging a slider)
+			while (!bStop.load()) {
+				{
+					std::unique_lock<std::mutex> lock(stopMutex);
+					stopCondition.wait_for(lock, std::chrono::milliseconds(debounceMS.load(std::memory_order_relaxed)), [this] { return bStop.load(); });
+				}
+				const uint64_t newGeneration = requestedGeneration.load(std::memory_order_acquire);
+				if (newGeneration == generation) {
+					break;
+				}
+				generation = newGeneration;
+			}
+
+			if (!bStop.load()) {
+				Write(generation);
+			}
+		}
+	}
+
+	void ConfigWriter::Write(uint64_t a_requestedGeneration)
+	{
+		std::lock_guard<std::mutex> lg(writeMutex);
+		// Anything requested before this point will be included in the write, requests made during it will trigger another one
+		if (a_requestedGeneration > writtenGeneration.load(std::memory_order_relaxed)) {
+			writtenGeneration.store(a_requestedGeneration, std::memory_order_release);
+		}
+		writeFunction();
+		writeCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Settings
+{
+	// Runs the config write function on a background thread, coalescing all the requests made within the debounce time into a single write.
+	// Requesting a write is cheap enough to be done on every slider drag frame.
+	// "Shutdown()" needs to be called before the DLL is unloaded, the destructor can run under the loader lock, so it doesn't wait for the thread nor write.
+	class ConfigWriter
+	{
+	public:
+		using WriteFunction = std::function<void()>;
+
+		ConfigWriter(WriteFunction a_writeFunction, std::chrono::milliseconds a_debounce);
+		~ConfigWriter();
+
+		ConfigWriter(const ConfigWriter&) = delete;
+		ConfigWriter& operator=(const ConfigWriter&) = delete;
+
+		void RequestWrite() noexcept;
+		// Synchronously writes any pending change
+		void Flush();
+		// Stops the background thread and writes any pending change. Writes requested after this are done synchronously.
+		void Shutdown();
+
+		void SetDebounce(std::chrono::milliseconds a_debounce) { debounceMS.store(a_debounce.count(), std::memory_order_relaxed); }
+
+		uint64_t GetWriteCount() const { return writeCount.load(std::memory_order_relaxed); }
+
+	private:
+		void Run();
+		void Write(uint64_t a_requestedGeneration);
+
+		WriteFunction           writeFunction;
+		std::atomic_int64_t     debounceMS;
+		std::atomic_uint64_t    requestedGeneration = 0;  // Bumped by every request
+		std::atomic_uint64_t    writtenGeneration = 0;
+		std::atomic_uint64_t    writeCount = 0;
+		std::atomic_bool        bStop = false;
+		std::mutex              writeMutex;
+		std::mutex              stopMutex;
+		std::condition_variable stopCondition;  // Cuts the debounce short when shutting down
+		std::thread             thread;
+	};
+}
@@ -0,0 +1,45 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#	include <intrin.h>
+#	include <immintrin.h>
+#endif
+
+namespace Utils
+{
+	namespace
+	{
+		bool DetectAVX2()
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			int cpuInfo[4];
+			__cpuid(cpuInfo, 0);
+			if (cpuInfo[0] < 7) {
+				return false;
+			}
+			__cpuid(cpuInfo, 1);
+			const bool bFMA = cpuInfo[2] & (1 << 12);
+			const bool bOSXSAVE = cpuInfo[2] & (1 << 27);
+			const bool bAVX = cpuInfo[2] & (1 << 28);
+			const bool bF16C = cpuInfo[2] & (1 << 29);
+			if (!bFMA || !bOSXSAVE || !bAVX || !bF16C) {
+				return false;
+			}
+			// The OS needs to save the YMM registers on context switches
+			if ((_xgetbv(0) & 0x6) != 0x6) {
+				return false;
+			}
+			__cpuidex(cpuInfo, 7, 0);
+			return cpuInfo[1] & (1 << 5);
+#else
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") && __builtin_cpu_supports("fma");
+#endif
+		}
+	}
+
+	bool IsAVX2Supported()
+	{
+		static const bool bAVX2 = DetectAVX2();
+		return bAVX2;
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Functions using AVX2 intrinsics need this on GCC and Clang. MSVC allows them anywhere, so the caller has to check "IsAVX2Supported()" either way.
+#if defined(_MSC_VER) && !defined(__clang__)
+#	define LUMA_TARGET_AVX2
+#else
+#	define LUMA_TARGET_AVX2 __attribute__((target("avx2,f16c,fma")))
+#endif
+
+namespace Utils
+{
+	// AVX2 along with FMA and F16C, which every AVX2 CPU has, and the OS saving the YMM registers. Cached after the first call.
+	bool IsAVX2Supported();
+}
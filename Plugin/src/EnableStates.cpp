@@ -0,0 +1,67 @@
+#include "EnableStates.h"
+
+namespace Settings
+{
+	namespace
+	{
+		constexpr auto enableRuleIndices = []() {
+			// Index into "enableRules" by setting ID offset, -1 for settings without a rule
+			std::array<int8_t, static_cast<size_t>(SettingID::kDevSetting05) - static_cast<size_t>(SettingID::kSTART) + 1> indices = {};
+			indices.fill(-1);
+			for (size_t i = 0; i < std::size(enableRules); ++i) {
+				indices[static_cast<size_t>(enableRules[i].id) - static_cast<size_t>(SettingID::kSTART)] = static_cast<int8_t>(i);
+			}
+			return indices;
+		}();
+
+		int32_t GetEnableRuleIndex(SettingID a_id)
+		{
+			const auto offset = static_cast<size_t>(a_id) - static_cast<size_t>(SettingID::kSTART);
+			return a_id >= SettingID::kSTART && offset < enableRuleIndices.size() ? enableRuleIndices[offset] : -1;
+		}
+	}
+
+	uint32_t GetChangedEnableInputs(const EnableInputs& a_lhs, const EnableInputs& a_rhs)
+	{
+		uint32_t changed = 0;
+		changed |= a_lhs.bHDRSupported != a_rhs.bHDRSupported ? kHDRSupported : 0;
+		changed |= a_lhs.bDisplayModeHDR != a_rhs.bDisplayModeHDR ? kDisplayModeHDR : 0;
+		changed |= a_lhs.bSDRForcedOnHDR != a_rhs.bSDRForcedOnHDR ? kSDRForcedOnHDR : 0;
+		changed |= a_lhs.bFSR3FrameGeneration != a_rhs.bFSR3FrameGeneration ? kFSR3FrameGeneration : 0;
+		changed |= a_lhs.toneMapperType != a_rhs.toneMapperType ? kToneMapperType : 0;
+		changed |= a_lhs.filmGrainType != a_rhs.filmGrainType ? kFilmGrainType : 0;
+		return changed;
+	}
+
+	std::span<const SettingID> EnableStateGraph::Update(const EnableInputs& a_inputs)
+	{
+		changed.clear();
+
+		const uint32_t changedInputs = bEvaluated ? GetChangedEnableInputs(inputs, a_inputs) : ~0u;
+		if (changedInputs == 0) {
+			return {};
+		}
+
+		inputs = a_inputs;
+		for (size_t i = 0; i < std::size(enableRules); ++i) {
+			const auto& rule = enableRules[i];
+			if ((rule.inputs & changedInputs) == 0) {
+				continue;
+			}
+			const bool bEnabled = rule.predicate(inputs);
+			if (!bEvaluated || states[i] != bEnabled) {
+				states[i] = bEnabled;
+				changed.push_back(rule.id);
+			}
+		}
+		bEvaluated = true;
+
+		return changed;
+	}
+
+	bool EnableStateGraph::IsEnabled(SettingID a_id) const
+	{
+		const auto index = GetEnableRuleIndex(a_id);
+		return index < 0 || states[index];
+	}
+}
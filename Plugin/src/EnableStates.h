@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SettingID.h"
+
+// FSR 3 FG uses its own shader to blend in the UI and at the moment we don't have code to override it (well, we do, but we can't inject buffers to scale the UI brightness dynamically)
+#define FSR_3_FG_SUPPORTS_UI_PAPER_WHITE 0
+
+namespace Settings
+{
+	// Everything the settings enable (or visibility) rules depend on
+	struct EnableInputs
+	{
+		bool    bHDRSupported = false;
+		bool    bDisplayModeHDR = false;
+		bool    bSDRForcedOnHDR = false;
+		bool    bFSR3FrameGeneration = false;
+		int32_t toneMapperType = 0;
+		int32_t filmGrainType = 0;
+
+		bool IsGameRenderingHDR() const { return bDisplayModeHDR && !bSDRForcedOnHDR; }
+		bool IsCustomToneMapper() const { return bDisplayModeHDR || toneMapperType > 0; }
+	};
+
+	enum EnableInput : uint32_t
+	{
+		kHDRSupported = 1 << 0,
+		kDisplayModeHDR = 1 << 1,
+		kSDRForcedOnHDR = 1 << 2,
+		kFSR3FrameGeneration = 1 << 3,
+		kToneMapperType = 1 << 4,
+		kFilmGrainType = 1 << 5,
+
+		kGameRenderingHDR = kDisplayModeHDR | kSDRForcedOnHDR,
+		kCustomToneMapper = kDisplayModeHDR | kToneMapperType,
+	};
+
+	// Returns the mask of "EnableInput"s that differ between the two
+	uint32_t GetChangedEnableInputs(const EnableInputs& a_lhs, const EnableInputs& a_rhs);
+
+	struct EnableRule
+	{
+		SettingID id;
+		uint32_t  inputs;  // The "EnableInput"s the predicate reads, it's only re-evaluated when one of them changes
+		bool      (*predicate)(const EnableInputs&);
+	};
+
+	// The single source of truth for when a setting is enabled, shared by the game settings menu and the ReShade overlay.
+	// Settings without a rule are always enabled.
+	inline constexpr EnableRule enableRules[] = {
+		{ SettingID::kDisplayMode, kHDRSupported | kSDRForcedOnHDR, [](const EnableInputs& a_inputs) { return a_inputs.bHDRSupported && !a_inputs.bSDRForcedOnHDR; } },
+		{ SettingID::kHDR_PeakBrightness, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR(); } },
+		{ SettingID::kHDR_GamePaperWhite, kDisplayModeHDR | kSDRForcedOnHDR, [](const EnableInputs& a_inputs) { return a_inputs.bDisplayModeHDR || a_inputs.bSDRForcedOnHDR; } },
+#if FSR_3_FG_SUPPORTS_UI_PAPER_WHITE
+		{ SettingID::kHDR_UIPaperWhite, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR(); } },
+#else
+		{ SettingID::kHDR_UIPaperWhite, kGameRenderingHDR | kFSR3FrameGeneration, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR() && !a_inputs.bFSR3FrameGeneration; } },
+#endif
+		{ SettingID::kSecondaryBrightness, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return !a_inputs.IsGameRenderingHDR(); } },
+		{ SettingID::kToneMapperHighlights, kCustomToneMapper, [](const EnableInputs& a_inputs) { return a_inputs.IsCustomToneMapper(); } },
+		{ SettingID::kToneMapperShadows, kCustomToneMapper, [](const EnableInputs& a_inputs) { return a_inputs.IsCustomToneMapper(); } },
+		{ SettingID::kHDR_ExtendGamut, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR(); } },
+		{ SettingID::kStrictLUTApplication, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR(); } },
+		{ SettingID::kHDR_AutoHDRVideos, kGameRenderingHDR, [](const EnableInputs& a_inputs) { return a_inputs.IsGameRenderingHDR(); } },
+		{ SettingID::kFilmGrainFPSLimit, kFilmGrainType, [](const EnableInputs& a_inputs) { return a_inputs.filmGrainType == 1; } },
+	};
+
+	// Evaluates "enableRules" incrementally: on every update only the rules that read a changed input are re-run.
+	// Each UI front end owns one, as it also tracks which states were last applied to that UI.
+	class EnableStateGraph
+	{
+	public:
+		// Returns the settings whose enable state changed since the last update (the first update returns all of them).
+		// The span is valid until the next update.
+		std::span<const SettingID> Update(const EnableInputs& a_inputs);
+		// Forces the next update to re-evaluate (and return) every rule, e.g. after the UI was rebuilt
+		void Invalidate() { bEvaluated = false; }
+
+		bool IsEnabled(SettingID a_id) const;
+
+	private:
+		std::array<bool, std::size(enableRules)> states = {};
+		EnableInputs                             inputs;
+		bool                                     bEvaluated = false;
+		std::vector<SettingID>                   changed;
+	};
+}
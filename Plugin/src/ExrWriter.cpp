@@ -0,0 +1,291 @@
+#include "ExrWriter.h"
+#include "WorkerPool.h"
+
+#include <zlib.h>
+
+namespace Utils
+{
+	namespace
+	{
+		size_t GetScanlinesPerBlock(ExrCompression a_compression)
+		{
+			return a_compression == ExrCompression::kZIP ? 16 : 1;
+		}
+
+		// EXR is little endian, like every platform we run on, but don't rely on it
+		template <class T>
+		void AppendLittleEndian(std::vector<uint8_t>& a_data, T a_value)
+		{
+			using Bits = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t, std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+			const Bits bits = std::bit_cast<Bits>(a_value);
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				a_data.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+			}
+		}
+
+		void AppendString(std::vector<uint8_t>& a_data, std::string_view a_string)
+		{
+			a_data.insert(a_data.end(), a_string.begin(), a_string.end());
+			a_data.push_back(0);
+		}
+
+		// Appends the attribute name, type and size, the value has to follow
+		void AppendAttributeHeader(std::vector<uint8_t>& a_data, std::string_view a_name, std::string_view a_type, uint32_t a_size)
+		{
+			AppendString(a_data, a_name);
+			AppendString(a_data, a_type);
+			AppendLittleEndian(a_data, a_size);
+		}
+
+		void AppendBox2i(std::vector<uint8_t>& a_data, std::string_view a_name, int32_t a_width, int32_t a_height)
+		{
+			AppendAttributeHeader(a_data, a_name, "box2i", 16);
+			AppendLittleEndian(a_data, int32_t(0));
+			AppendLittleEndian(a_data, int32_t(0));
+			AppendLittleEndian(a_data, a_width - 1);
+			AppendLittleEndian(a_data, a_height - 1);
+		}
+
+		// Channels have to be sorted by name, each of them is stored as a whole row of the block's scanlines
+		std::span<const std::pair<char, size_t>> GetChannels(bool a_bWriteAlpha)
+		{
+			static constexpr std::pair<char, size_t> channels[] = { { 'A', 3 }, { 'B', 2 }, { 'G', 1 }, { 'R', 0 } };
+			return a_bWriteAlpha ? std::span(channels) : std::span(channels).subspan(1);
+		}
+
+		void AppendHeader(std::vector<uint8_t>& a_data, size_t a_width, size_t a_height, const ExrWriteParams& a_params)
+		{
+			constexpr uint8_t magic[] = { 0x76, 0x2F, 0x31, 0x01 };
+			a_data.insert(a_data.end(), std::begin(magic), std::end(magic));
+			AppendLittleEndian(a_data, uint32_t(2));  // Version 2, single part scanline
+
+			const auto channels = GetChannels(a_params.bWriteAlpha);
+			AppendAttributeHeader(a_data, "channels", "chlist", static_cast<uint32_t>(channels.size() * 18 + 1));
+			for (const auto& [name, offset] : channels) {
+				a_data.push_back(static_cast<uint8_t>(name));
+				a_data.push_back(0);
+				AppendLittleEndian(a_data, int32_t(1));  // Half
+				a_data.insert(a_data.end(), { 0, 0, 0, 0 });  // Not perceptually linear, reserved
+				AppendLittleEndian(a_data, int32_t(1));  // Sampling
+				AppendLittleEndian(a_data, int32_t(1));
+			}
+			a_data.push_back(0);
+
+			AppendAttributeHeader(a_data, "compression", "compression", 1);
+			a_data.push_back(static_cast<uint8_t>(a_params.compression));
+
+			AppendBox2i(a_data, "dataWindow", static_cast<int32_t>(a_width), static_cast<int32_t>(a_height));
+			AppendBox2i(a_data, "displayWindow", static_cast<int32_t>(a_width), static_cast<int32_t>(a_height));
+
+			AppendAttributeHeader(a_data, "lineOrder", "lineOrder", 1);
+			a_data.push_back(0);  // Increasing Y
+
+			AppendAttributeHeader(a_data, "pixelAspectRatio", "float", 4);
+			AppendLittleEndian(a_data, 1.f);
+
+			AppendAttributeHeader(a_data, "screenWindowCenter", "v2f", 8);
+			AppendLittleEndian(a_data, 0.f);
+			AppendLittleEndian(a_data, 0.f);
+
+			AppendAttributeHeader(a_data, "screenWindowWidth", "float", 4);
+			AppendLittleEndian(a_data, 1.f);
+
+			if (a_params.chromaticities) {
+				const auto& chromaticities = *a_params.chromaticities;
+				AppendAttributeHeader(a_data, "chromaticities", "chromaticities", 32);
+				for (const float* coordinates : { chromaticities.red, chromaticities.green, chromaticities.blue, chromaticities.white }) {
+					AppendLittleEndian(a_data, coordinates[0]);
+					AppendLittleEndian(a_data, coordinates[1]);
+				}
+			}
+
+			a_data.push_back(0);
+		}
+
+		// Splits the pixels in planar channel rows, the way EXR stores a block of scanlines
+		void ReadBlock(const ImageStrip& a_strip, size_t a_width, size_t a_firstRow, size_t a_endRow, bool a_bWriteAlpha, std::vector<uint8_t>& a_outData)
+		{
+			const auto channels = GetChannels(a_bWriteAlpha);
+			a_outData.resize((a_endRow - a_firstRow) * channels.size() * a_width * sizeof(uint16_t));
+
+			uint16_t* out = reinterpret_cast<uint16_t*>(a_outData.data());
+			for (size_t y = a_firstRow; y < a_endRow; ++y) {
+				const uint16_t* row = reinterpret_cast<const uint16_t*>(a_strip.GetRow(y));
+				for (const auto& [name, offset] : channels) {
+					for (size_t x = 0; x < a_width; ++x) {
+						*out++ = row[x * 4 + offset];
+					}
+				}
+			}
+		}
+
+		// The ZIP compression first separates the low and high bytes of the halfs and stores the deltas between them, which deflate handles much better
+		void PredictBlock(const std::vector<uint8_t>& a_data, std::vector<uint8_t>& a_outData)
+		{
+			a_outData.resize(a_data.size());
+			const size_t half = (a_data.size() + 1) / 2;
+			for (size_t i = 0; i < a_data.size(); ++i) {
+				a_outData[(i % 2 == 0) ? i / 2 : half + i / 2] = a_data[i];
+			}
+
+			uint8_t previous = a_outData.empty() ? 0 : a_outData[0];
+			for (size_t i = 1; i < a_outData.size(); ++i) {
+				const uint8_t current = a_outData[i];
+				a_outData[i] = static_cast<uint8_t>(current - previous + 128);
+				previous = current;
+			}
+		}
+
+		struct ExrBlock
+		{
+			std::vector<uint8_t> data;
+			bool                 bSuccess = false;
+		};
+
+		void EncodeBlock(const ImageStrip& a_strip, size_t a_width, const ExrWriteParams& a_params, size_t a_firstRow, size_t a_endRow, ExrBlock& a_outBlock)
+		{
+			std::vector<uint8_t> rawData;
+			ReadBlock(a_strip, a_width, a_firstRow, a_endRow, a_params.bWriteAlpha, rawData);
+
+			if (a_params.compression == ExrCompression::kNone) {
+				a_outBlock.data = std::move(rawData);
+				a_outBlock.bSuccess = true;
+				return;
+			}
+
+			std::vector<uint8_t> predictedData;
+			PredictBlock(rawData, predictedData);
+
+			uLongf compressedSize = compressBound(static_cast<uLong>(predictedData.size()));
+			a_outBlock.data.resize(compressedSize);
+			if (compress2(a_outBlock.data.data(), &compressedSize, predictedData.data(), static_cast<uLong>(predictedData.size()), a_params.compressionLevel) != Z_OK) {
+				return;
+			}
+			a_outBlock.data.resize(compressedSize);
+
+			// Readers take blocks that didn't get smaller as uncompressed
+			if (a_outBlock.data.size() >= rawData.size()) {
+				a_outBlock.data = std::move(rawData);
+			}
+			a_outBlock.bSuccess = true;
+		}
+	}
+
+	ExrStreamWriter::ExrStreamWriter(std::ostream& a_stream, const ExrWriteParams& a_params) :
+		stream(a_stream), params(a_params)
+	{}
+
+	size_t ExrStreamWriter::GetRowAlignment() const
+	{
+		return GetScanlinesPerBlock(params.compression);
+	}
+
+	bool ExrStreamWriter::Begin(const ImageInfo& a_info)
+	{
+		if (a_info.format != DXGI_FORMAT_R16G16B16A16_FLOAT || a_info.width == 0 || a_info.height == 0 || a_info.width > 0x7FFFFFFF || a_info.height > 0x7FFFFFFF) {
+			return false;
+		}
+
+		info = a_info;
+		const size_t scanlinesPerBlock = GetScanlinesPerBlock(params.compression);
+		blockCount = (info.height + scanlinesPerBlock - 1) / scanlinesPerBlock;
+		offsets.clear();
+		offsets.reserve(blockCount);
+
+		std::vector<uint8_t> data;
+		AppendHeader(data, info.width, info.height, params);
+		start = stream.tellp();
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		offsetTablePosition = stream.tellp();
+
+		// The offset table is only known once every block was written, reserve its space for now
+		const std::vector<char> offsetTable(blockCount * sizeof(uint64_t), 0);
+		stream.write(offsetTable.data(), static_cast<std::streamsize>(offsetTable.size()));
+		return stream.good();
+	}
+
+	bool ExrStreamWriter::WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		const size_t scanlinesPerBlock = GetScanlinesPerBlock(params.compression);
+		const size_t stripBlockCount = (a_strip.rowCount + scanlinesPerBlock - 1) / scanlinesPerBlock;
+		// The offset table only has room for the blocks of the image
+		if (offsets.size() + stripBlockCount > blockCount) {
+			return false;
+		}
+
+		std::vector<ExrBlock> blocks(stripBlockCount);
+		auto encodeBlocks = [&](size_t a_begin, size_t a_end) {
+			for (size_t i = a_begin; i < a_end; ++i) {
+				const size_t firstRow = a_strip.firstRow + i * scanlinesPerBlock;
+				EncodeBlock(a_strip, info.width, params, firstRow, std::min(firstRow + scanlinesPerBlock, a_strip.firstRow + a_strip.rowCount), blocks[i]);
+			}
+		};
+		if (a_workers) {
+			a_workers->ParallelFor(stripBlockCount, encodeBlocks);
+		} else {
+			encodeBlocks(0, stripBlockCount);
+		}
+
+		std::vector<uint8_t> data;
+		for (size_t i = 0; i < stripBlockCount; ++i) {
+			if (!blocks[i].bSuccess) {
+				return false;
+			}
+			offsets.push_back(static_cast<uint64_t>(stream.tellp() - start) + data.size());
+			AppendLittleEndian(data, static_cast<int32_t>(a_strip.firstRow + i * scanlinesPerBlock));
+			AppendLittleEndian(data, static_cast<int32_t>(blocks[i].data.size()));
+			data.insert(data.end(), blocks[i].data.begin(), blocks[i].data.end());
+		}
+
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return stream.good();
+	}
+
+	bool ExrStreamWriter::End()
+	{
+		if (offsets.size() != blockCount) {
+			return false;
+		}
+
+		std::vector<uint8_t> offsetTable;
+		for (const uint64_t offset : offsets) {
+			AppendLittleEndian(offsetTable, offset);
+		}
+
+		const auto end = stream.tellp();
+		stream.seekp(offsetTablePosition);
+		stream.write(reinterpret_cast<const char*>(offsetTable.data()), static_cast<std::streamsize>(offsetTable.size()));
+		stream.seekp(end);
+		stream.flush();
+		return stream.good();
+	}
+
+	bool EncodeExr(const ExrSourceImage& a_image, const ExrWriteParams& a_params, std::vector<uint8_t>& a_outData)
+	{
+		std::ostringstream stream(std::ios::binary);
+		if (!WriteExr(stream, a_image, a_params)) {
+			return false;
+		}
+		const std::string data = std::move(stream).str();
+		a_outData.assign(data.begin(), data.end());
+		return true;
+	}
+
+	bool WriteExr(std::ostream& a_stream, const ExrSourceImage& a_image, const ExrWriteParams& a_params)
+	{
+		if (!a_image.pixels) {
+			return false;
+		}
+
+		// There are no stages, so the pixels aren't modified
+		MemoryImageSource source({ a_image.width, a_image.height, DXGI_FORMAT_R16G16B16A16_FLOAT }, const_cast<uint8_t*>(a_image.pixels), a_image.rowPitch);
+		ExrStreamWriter   writer(a_stream, a_params);
+		return RunImagePipeline(source, {}, writer, { .rowsPerStrip = a_params.rowsPerStrip, .workers = a_params.workers });
+	}
+
+	bool WriteExr(const std::filesystem::path& a_path, const ExrSourceImage& a_image, const ExrWriteParams& a_params)
+	{
+		std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+		return file && WriteExr(file, a_image, a_params);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ImagePipeline.h"
+
+namespace Utils
+{
+	class WorkerPool;
+
+	// Values match the OpenEXR "compression" attribute
+	enum class ExrCompression : uint8_t
+	{
+		kNone = 0,
+		kZIPS = 2,  // zlib, one scanline per block
+		kZIP = 3    // zlib, 16 scanlines per block
+	};
+
+	// CIE xy coordinates of the primaries and white point
+	struct ExrChromaticities
+	{
+		float red[2];
+		float green[2];
+		float blue[2];
+		float white[2];
+	};
+
+	// scRGB, which is what the HDR swap chain holds
+	inline constexpr ExrChromaticities bt709Chromaticities = { { 0.64f, 0.33f }, { 0.30f, 0.60f }, { 0.15f, 0.06f }, { 0.3127f, 0.3290f } };
+
+	// RGBA16F pixels, read in place
+	struct ExrSourceImage
+	{
+		const uint8_t* pixels = nullptr;
+		size_t         width = 0;
+		size_t         height = 0;
+		size_t         rowPitch = 0;
+	};
+
+	struct ExrWriteParams
+	{
+		ExrCompression                   compression = ExrCompression::kZIP;
+		int                              compressionLevel = 4;  // zlib level, 1-9
+		bool                             bWriteAlpha = false;
+		std::optional<ExrChromaticities> chromaticities = bt709Chromaticities;
+		size_t                           rowsPerStrip = 256;  // Only used by "EncodeExr()" and "WriteExr()", which read the image through "RunImagePipeline()"
+		WorkerPool*                      workers = nullptr;   // Compresses the blocks on the calling thread only if null
+	};
+
+	// Writes a single part scanline EXR with half float channels. Every block of scanlines is compressed independently, so they are spread between the workers.
+	// Strips are written out as soon as they are compressed, and the offset table is filled in at the end, so the stream has to be seekable.
+	class ExrStreamWriter : public ImageSink
+	{
+	public:
+		ExrStreamWriter(std::ostream& a_stream, const ExrWriteParams& a_params);
+
+		size_t GetRowAlignment() const override;
+		bool   Begin(const ImageInfo& a_info) override;
+		bool   WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		bool   End() override;
+
+	private:
+		std::ostream&         stream;
+		ExrWriteParams        params;
+		ImageInfo             info;
+		std::streampos        start;
+		std::streampos        offsetTablePosition;
+		size_t                blockCount = 0;  // Of the whole image, the size of the offset table
+		std::vector<uint64_t> offsets;  // Of each block written so far, from the start of the file
+	};
+
+	bool EncodeExr(const ExrSourceImage& a_image, const ExrWriteParams& a_params, std::vector<uint8_t>& a_outData);
+	bool WriteExr(std::ostream& a_stream, const ExrSourceImage& a_image, const ExrWriteParams& a_params);
+	bool WriteExr(const std::filesystem::path& a_path, const ExrSourceImage& a_image, const ExrWriteParams& a_params);
+}
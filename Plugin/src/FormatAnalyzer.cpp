@@ -0,0 +1,174 @@
+#include "FormatAnalyzer.h"
+
+namespace Utils
+{
+	namespace
+	{
+		// Rounds to the nearest value representable by a float with a 5 bit exponent (bias 15) and the given mantissa bits, like float16/float11/float10.
+		// Out of range values are clamped to the largest finite value, as we only care about the error.
+		float QuantizeSmallFloat(float a_value, uint32_t a_mantissaBits, bool a_bSigned)
+		{
+			if (std::isnan(a_value)) {
+				return 0.f;
+			}
+			if (a_value < 0.f && !a_bSigned) {
+				return 0.f;
+			}
+
+			const float magnitude = std::abs(a_value);
+			const float maxValue = (2.f - std::ldexp(1.f, -static_cast<int>(a_mantissaBits))) * 32768.f;
+			if (magnitude >= maxValue) {
+				return std::copysign(maxValue, a_value);
+			}
+
+			constexpr int minNormalExponent = -14;
+			int exponent = std::max(static_cast<int>(std::floor(std::log2(magnitude))), minNormalExponent);
+			if (magnitude == 0.f) {
+				exponent = minNormalExponent;
+			}
+			const float step = std::ldexp(1.f, exponent - static_cast<int>(a_mantissaBits));
+			return std::copysign(std::nearbyint(magnitude / step) * step, a_value);
+		}
+
+		float QuantizeUNorm(float a_value, uint32_t a_bits)
+		{
+			const float maxValue = static_cast<float>((1u << a_bits) - 1u);
+			return std::nearbyint(std::clamp(std::isnan(a_value) ? 0.f : a_value, 0.f, 1.f) * maxValue) / maxValue;
+		}
+
+		// As described in the D3D functional spec
+		void QuantizeRGB9E5(const float (&a_color)[4], float (&a_outColor)[4])
+		{
+			constexpr int   mantissaBits = 9;
+			constexpr int   exponentBias = 15;
+			constexpr int   maxExponent = 31;
+			constexpr float maxValue = (511.f / 512.f) * 65536.f;
+
+			float clamped[3];
+			for (int i = 0; i < 3; ++i) {
+				clamped[i] = std::isnan(a_color[i]) ? 0.f : std::clamp(a_color[i], 0.f, maxValue);
+			}
+			const float maxChannel = std::max({ clamped[0], clamped[1], clamped[2] });
+
+			int sharedExponent = std::max(-exponentBias - 1, maxChannel > 0.f ? static_cast<int>(std::floor(std::log2(maxChannel))) : -exponentBias - 1) + 1 + exponentBias;
+			if (std::floor(maxChannel / std::ldexp(1.f, sharedExponent - exponentBias - mantissaBits) + 0.5f) == static_cast<float>(1 << mantissaBits)) {
+				++sharedExponent;
+			}
+			sharedExponent = std::min(sharedExponent, maxExponent);
+
+			const float step = std::ldexp(1.f, sharedExponent - exponentBias - mantissaBits);
+			for (int i = 0; i < 3; ++i) {
+				a_outColor[i] = std::floor(clamped[i] / step + 0.5f) * step;
+			}
+			a_outColor[3] = 1.f;
+		}
+	}
+
+	void GetColorRange(DXGI_FORMAT a_format, float& a_outMin, float& a_outMax)
+	{
+		switch (a_format) {
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			a_outMin = -65504.f;
+			a_outMax = 65504.f;
+			break;
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			a_outMin = 0.f;
+			a_outMax = 64512.f;  // Limited by the blue channel, which has one less mantissa bit
+			break;
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+			a_outMin = 0.f;
+			a_outMax = (511.f / 512.f) * 65536.f;
+			break;
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			a_outMin = 0.f;
+			a_outMax = 1.f;
+			break;
+		default:
+			a_outMin = std::numeric_limits<float>::lowest();
+			a_outMax = std::numeric_limits<float>::max();
+			break;
+		}
+	}
+
+	void QuantizeColor(DXGI_FORMAT a_format, const float (&a_color)[4], float (&a_outColor)[4])
+	{
+		switch (a_format) {
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			for (int i = 0; i < 4; ++i) {
+				a_outColor[i] = QuantizeSmallFloat(a_color[i], 10, true);
+			}
+			break;
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			a_outColor[0] = QuantizeSmallFloat(a_color[0], 6, false);
+			a_outColor[1] = QuantizeSmallFloat(a_color[1], 6, false);
+			a_outColor[2] = QuantizeSmallFloat(a_color[2], 5, false);
+			a_outColor[3] = 1.f;
+			break;
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+			QuantizeRGB9E5(a_color, a_outColor);
+			break;
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+			for (int i = 0; i < 3; ++i) {
+				a_outColor[i] = QuantizeUNorm(a_color[i], 10);
+			}
+			a_outColor[3] = QuantizeUNorm(a_color[3], 2);
+			break;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			for (int i = 0; i < 4; ++i) {
+				a_outColor[i] = QuantizeUNorm(a_color[i], 8);
+			}
+			break;
+		default:
+			std::copy(std::begin(a_color), std::end(a_color), std::begin(a_outColor));
+			break;
+		}
+	}
+
+	std::vector<FormatPrecisionReport> AnalyzeFormatPrecision(std::span<const float> a_rgbaPixels, std::span<const DXGI_FORMAT> a_formats, float a_relativeErrorFloor)
+	{
+		std::vector<FormatPrecisionReport> reports;
+		reports.reserve(a_formats.size());
+
+		const size_t pixelCount = a_rgbaPixels.size() / 4;
+		for (const auto format : a_formats) {
+			auto& report = reports.emplace_back();
+			report.format = format;
+
+			float minValue;
+			float maxValue;
+			GetColorRange(format, minValue, maxValue);
+
+			double   relativeErrorSum = 0.0;
+			uint64_t relativeErrorSamples = 0;
+			for (size_t pixel = 0; pixel < pixelCount; ++pixel) {
+				const float color[4] = { a_rgbaPixels[pixel * 4], a_rgbaPixels[pixel * 4 + 1], a_rgbaPixels[pixel * 4 + 2], a_rgbaPixels[pixel * 4 + 3] };
+				float quantizedColor[4];
+				QuantizeColor(format, color, quantizedColor);
+
+				for (int i = 0; i < 3; ++i) {
+					if (std::isnan(color[i])) {
+						continue;
+					}
+					const double absoluteError = std::abs(static_cast<double>(quantizedColor[i]) - color[i]);
+					report.maxAbsoluteError = std::max(report.maxAbsoluteError, absoluteError);
+					if (color[i] < minValue || color[i] > maxValue) {
+						++report.clippedSamples;
+					}
+					if (std::abs(color[i]) >= a_relativeErrorFloor) {
+						const double relativeError = absoluteError / std::abs(color[i]);
+						report.maxRelativeError = std::max(report.maxRelativeError, relativeError);
+						relativeErrorSum += relativeError;
+						++relativeErrorSamples;
+					}
+				}
+				if (color[3] != 1.f && quantizedColor[3] == 1.f) {
+					++report.lostAlphaSamples;
+				}
+			}
+			report.meanRelativeError = relativeErrorSamples > 0 ? relativeErrorSum / static_cast<double>(relativeErrorSamples) : 0.0;
+		}
+
+		return reports;
+	}
+}
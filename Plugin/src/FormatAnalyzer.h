@@ -0,0 +1,27 @@
+#pragma once
+
+#include <dxgiformat.h>
+
+namespace Utils
+{
+	// Round trips an RGBA color through the given format, the same way the GPU would store it.
+	// Formats that aren't supported are returned unchanged.
+	void QuantizeColor(DXGI_FORMAT a_format, const float (&a_color)[4], float (&a_outColor)[4]);
+
+	// The range of values the color channels of the format can represent
+	void GetColorRange(DXGI_FORMAT a_format, float& a_outMin, float& a_outMax);
+
+	struct FormatPrecisionReport
+	{
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		double      maxAbsoluteError = 0.0;
+		double      maxRelativeError = 0.0;
+		double      meanRelativeError = 0.0;
+		uint64_t    clippedSamples = 0;  // Color channels the format couldn't represent (e.g. negative or out of range values)
+		uint64_t    lostAlphaSamples = 0;  // Pixels whose alpha wasn't 1 on a format without alpha
+	};
+
+	// Quantizes RGBA float pixels through each format and measures the color error.
+	// Relative errors are only measured above "a_relativeErrorFloor", as near black values would dominate them otherwise.
+	std::vector<FormatPrecisionReport> AnalyzeFormatPrecision(std::span<const float> a_rgbaPixels, std::span<const DXGI_FORMAT> a_formats, float a_relativeErrorFloor = 1.f / 1024.f);
+}
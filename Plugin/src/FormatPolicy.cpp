@@ -0,0 +1,30 @@
+#include "FormatPolicy.h"
+
+namespace Utils
+{
+	BufferFormatRequirements GetBufferFormatRequirements(std::string_view a_bufferName)
+	{
+		for (const auto& policy : bufferFormatPolicies) {
+			if (policy.bufferName == a_bufferName) {
+				return policy.requirements;
+			}
+		}
+		return {};
+	}
+
+	const BufferFormatCandidate* ResolveBufferFormat(const BufferFormatRequirements& a_requirements, RE::BS_DXGI_FORMAT a_currentFormat)
+	{
+		const auto     current = std::ranges::find(bufferFormatCandidates, a_currentFormat, &BufferFormatCandidate::format);
+		const uint32_t currentMantissaBits = current != std::end(bufferFormatCandidates) ? current->mantissaBits : 0;
+
+		for (const auto& candidate : bufferFormatCandidates) {
+			if ((candidate.bAlpha || !a_requirements.bAlpha) &&
+				(candidate.bNegativeValues || !a_requirements.bNegativeValues) &&
+				(candidate.bRenderTarget || !a_requirements.bRenderTarget) &&
+				candidate.mantissaBits >= a_requirements.minMantissaBits) {
+				return candidate.mantissaBits > currentMantissaBits ? &candidate : nullptr;
+			}
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "RE/Buffers.h"
+
+namespace Utils
+{
+	// What a buffer needs to store without visible losses
+	struct BufferFormatRequirements
+	{
+		bool     bAlpha = true;
+		bool     bNegativeValues = true;  // e.g. scRGB colors outside of the BT.709 gamut
+		bool     bRenderTarget = true;
+		uint32_t minMantissaBits = 10;  // Per color channel, half floats have 10
+	};
+
+	struct BufferFormatCandidate
+	{
+		RE::BS_DXGI_FORMAT format;
+		DXGI_FORMAT        dxgiFormat;
+		uint32_t           bytesPerPixel;
+		bool               bAlpha;
+		bool               bNegativeValues;
+		bool               bRenderTarget;
+		uint32_t           mantissaBits;  // Of the least precise color channel
+	};
+
+	// Sorted from the cheapest to the most expensive
+	inline constexpr BufferFormatCandidate bufferFormatCandidates[] = {
+		{ RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R11G11B10_FLOAT, 4, false, false, true, 5 },
+		{ RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R9G9B9E5_SHAREDEXP, DXGI_FORMAT_R9G9B9E5_SHAREDEXP, 4, false, false, false, 9 },  // Can't be rendered to
+		{ RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT, 8, true, true, true, 10 },
+		{ RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT, 16, true, true, true, 23 },
+	};
+
+	struct BufferFormatPolicy
+	{
+		std::string_view         bufferName;
+		BufferFormatRequirements requirements;
+	};
+
+	// Buffers that aren't listed here have the default (full) requirements.
+	// "ImageSpaceBufferB10G11R11" and "ImageSpaceBufferE5B9G9R9" aren't listed, as their original packed formats already are the cheapest that would satisfy them,
+	// so they need RGBA16F anyway to get rid of their banding.
+	inline constexpr BufferFormatPolicy bufferFormatPolicies[] = {
+		// The half resolution copy of the scene that bloom is built from. It's blurred right after, so R11G11B10_FLOAT is enough to stop it from clipping, at half the size of RGBA16F.
+		{ "ImageSpaceHalfResBuffer", { .bAlpha = false, .bNegativeValues = false, .minMantissaBits = 5 } },
+	};
+
+	BufferFormatRequirements GetBufferFormatRequirements(std::string_view a_bufferName);
+
+	// Returns the cheapest candidate that satisfies the requirements, or nullptr if none does or if it isn't more precise than the current format of the buffer
+	// (when that's a candidate too, other formats are assumed to be less precise)
+	const BufferFormatCandidate* ResolveBufferFormat(const BufferFormatRequirements& a_requirements, RE::BS_DXGI_FORMAT a_currentFormat);
+}
@@ -0,0 +1,366 @@
+#include "GainMap.h"
+#include "CpuFeatures.h"
+#include "HalfFloat.h"
+#include "SDRToneMapper.h"
+#include "WorkerPool.h"
+
+#include <immintrin.h>
+
+namespace Utils
+{
+	namespace
+	{
+		constexpr float luminanceWeights[3] = { 0.2126390039920806884765625f, 0.715168654918670654296875f, 0.072192318737506866455078125f };
+
+		constexpr float maxHalf = 65504.f;
+
+		// What viewers will decode the 8 bit base image with
+		const std::array<float, 256>& GetSRGBToLinearTable()
+		{
+			static const std::array<float, 256> table = []() {
+				std::array<float, 256> result;
+				for (size_t i = 0; i < result.size(); ++i) {
+					const float value = static_cast<float>(i) / 255.f;
+					result[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+				}
+				return result;
+			}();
+			return table;
+		}
+
+		struct GainRowParams
+		{
+			float hdrScale;  // To SDR white
+			float offsetSDR;
+			float offsetHDR;
+		};
+
+		// The log2 ratio between the HDR and SDR luminances of every pixel of a row
+		void ComputeGainsScalar(const uint16_t* a_hdrRow, const uint8_t* a_sdrRow, size_t a_width, const GainRowParams& a_params, float* a_outGains)
+		{
+			const auto& decode = GetSRGBToLinearTable();
+			for (size_t x = 0; x < a_width; ++x) {
+				float hdrLuminance = 0.f;
+				for (int channel = 0; channel < 3; ++channel) {
+					hdrLuminance += HalfToFloat(a_hdrRow[x * 4 + channel]) * luminanceWeights[channel];
+				}
+				// Also turns NaN into 0
+				hdrLuminance = hdrLuminance > 0.f ? std::min(hdrLuminance, maxHalf) * a_params.hdrScale : 0.f;
+
+				const uint8_t* sdrPixel = a_sdrRow + x * 4;
+				const float    sdrLuminance = decode[sdrPixel[0]] * luminanceWeights[0] + decode[sdrPixel[1]] * luminanceWeights[1] + decode[sdrPixel[2]] * luminanceWeights[2];
+
+				a_outGains[x] = std::log2((hdrLuminance + a_params.offsetHDR) / (sdrLuminance + a_params.offsetSDR));
+			}
+		}
+
+		// For positive normal values. log2(m) = 2 / ln(2) * atanh(z), with z = (m - 1) / (m + 1) in [0, 1/3] for the mantissa, the series is within 2e-5.
+		LUMA_TARGET_AVX2 __m256 Log2AVX2(__m256 a_value)
+		{
+			const __m256i bits = _mm256_castps_si256(a_value);
+			const __m256  exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+			const __m256  mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+			const __m256 one = _mm256_set1_ps(1.f);
+			const __m256 z = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+			const __m256 z2 = _mm256_mul_ps(z, z);
+			__m256       series = _mm256_fmadd_ps(z2, _mm256_set1_ps(1.f / 7.f), _mm256_set1_ps(1.f / 5.f));
+			series = _mm256_fmadd_ps(series, z2, _mm256_set1_ps(1.f / 3.f));
+			series = _mm256_fmadd_ps(series, z2, one);
+			return _mm256_fmadd_ps(_mm256_mul_ps(series, z), _mm256_set1_ps(2.f / std::numbers::ln2_v<float>), exponent);
+		}
+
+		// Eight pixels at once. The HDR luminances are summed within the registers, the SDR ones are gathered from the decode table.
+		LUMA_TARGET_AVX2 void ComputeGainsAVX2(const uint16_t* a_hdrRow, const uint8_t* a_sdrRow, size_t a_width, const GainRowParams& a_params, float* a_outGains)
+		{
+			const __m256  weights = _mm256_setr_ps(luminanceWeights[0], luminanceWeights[1], luminanceWeights[2], 0.f, luminanceWeights[0], luminanceWeights[1], luminanceWeights[2], 0.f);
+			const __m256  zero = _mm256_setzero_ps();
+			const __m256  maxLuminance = _mm256_set1_ps(maxHalf);
+			const __m256  hdrScale = _mm256_set1_ps(a_params.hdrScale);
+			const __m256  offsetSDR = _mm256_set1_ps(a_params.offsetSDR);
+			const __m256  offsetHDR = _mm256_set1_ps(a_params.offsetHDR);
+			const __m256i byteMask = _mm256_set1_epi32(0xFF);
+			const __m256i pixelOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);  // The sums come out as pixels 0, 2, 4, 6, 1, 3, 5, 7
+			const float*  decode = GetSRGBToLinearTable().data();
+
+			const size_t vectorWidth = a_width & ~size_t(7);
+			for (size_t x = 0; x < vectorWidth; x += 8) {
+				const __m128i* hdrPixels = reinterpret_cast<const __m128i*>(a_hdrRow + x * 4);
+				const __m256   products0 = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128(hdrPixels + 0)), weights);
+				const __m256   products1 = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128(hdrPixels + 1)), weights);
+				const __m256   products2 = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128(hdrPixels + 2)), weights);
+				const __m256   products3 = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128(hdrPixels + 3)), weights);
+				__m256         hdrLuminance = _mm256_hadd_ps(_mm256_hadd_ps(products0, products1), _mm256_hadd_ps(products2, products3));
+				hdrLuminance = _mm256_permutevar8x32_ps(hdrLuminance, pixelOrder);
+				// NaN becomes 0, as "max" returns the second operand then
+				hdrLuminance = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(maxLuminance, hdrLuminance), zero), hdrScale);
+
+				const __m256i sdrPixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_sdrRow + x * 4));
+				const __m256  red = _mm256_i32gather_ps(decode, _mm256_and_si256(sdrPixels, byteMask), 4);
+				const __m256  green = _mm256_i32gather_ps(decode, _mm256_and_si256(_mm256_srli_epi32(sdrPixels, 8), byteMask), 4);
+				const __m256  blue = _mm256_i32gather_ps(decode, _mm256_and_si256(_mm256_srli_epi32(sdrPixels, 16), byteMask), 4);
+				const __m256  sdrLuminance = _mm256_fmadd_ps(red, _mm256_set1_ps(luminanceWeights[0]), _mm256_fmadd_ps(green, _mm256_set1_ps(luminanceWeights[1]), _mm256_mul_ps(blue, _mm256_set1_ps(luminanceWeights[2]))));
+
+				const __m256 ratio = _mm256_div_ps(_mm256_add_ps(hdrLuminance, offsetHDR), _mm256_add_ps(sdrLuminance, offsetSDR));
+				_mm256_storeu_ps(a_outGains + x, Log2AVX2(ratio));
+			}
+
+			if (vectorWidth != a_width) {
+				ComputeGainsScalar(a_hdrRow + vectorWidth * 4, a_sdrRow + vectorWidth * 4, a_width - vectorWidth, a_params, a_outGains + vectorWidth);
+			}
+		}
+
+		void AppendBigEndian16(std::vector<uint8_t>& a_data, uint16_t a_value)
+		{
+			a_data.push_back(static_cast<uint8_t>(a_value >> 8));
+			a_data.push_back(static_cast<uint8_t>(a_value));
+		}
+
+		void AppendBigEndian32(std::vector<uint8_t>& a_data, uint32_t a_value)
+		{
+			AppendBigEndian16(a_data, static_cast<uint16_t>(a_value >> 16));
+			AppendBigEndian16(a_data, static_cast<uint16_t>(a_value));
+		}
+
+		// A JPEG marker segment. The length covers the identifier and the payload, and itself.
+		std::optional<std::vector<uint8_t>> MakeSegment(uint8_t a_marker, std::string_view a_identifier, std::span<const uint8_t> a_payload)
+		{
+			const size_t length = 2 + a_identifier.size() + 1 + a_payload.size();
+			if (length > 0xFFFF) {
+				return std::nullopt;
+			}
+
+			std::vector<uint8_t> segment = { 0xFF, a_marker };
+			AppendBigEndian16(segment, static_cast<uint16_t>(length));
+			segment.insert(segment.end(), a_identifier.begin(), a_identifier.end());
+			segment.push_back(0);
+			segment.insert(segment.end(), a_payload.begin(), a_payload.end());
+			return segment;
+		}
+
+		std::optional<std::vector<uint8_t>> MakeXmpSegment(const std::string& a_xmp)
+		{
+			return MakeSegment(0xE1, "http://ns.adobe.com/xap/1.0/", std::span(reinterpret_cast<const uint8_t*>(a_xmp.data()), a_xmp.size()));
+		}
+
+		std::string WrapXmp(const std::string& a_description)
+		{
+			return std::format(
+				"<x:xmpmeta xmlns:x=\"adobe:ns:meta/\">"
+				"<rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">{}</rdf:RDF>"
+				"</x:xmpmeta>",
+				a_description);
+		}
+
+		// After the start of image marker, and the JFIF segment that has to follow it if there is one. Zero if it isn't a JPEG.
+		size_t GetMetadataOffset(std::span<const uint8_t> a_jpeg)
+		{
+			if (a_jpeg.size() < 4 || a_jpeg[0] != 0xFF || a_jpeg[1] != 0xD8) {
+				return 0;
+			}
+			if (a_jpeg.size() >= 6 && a_jpeg[2] == 0xFF && a_jpeg[3] == 0xE0) {
+				return std::min(size_t(4) + ((size_t(a_jpeg[4]) << 8) | a_jpeg[5]), a_jpeg.size());
+			}
+			return 2;
+		}
+	}
+
+	GainMapSink::GainMapSink(const SDRToneMapper& a_toneMapper, const GainMapParams& a_params, ImageSink& a_baseImageSink) :
+		toneMapper(a_toneMapper), params(a_params), baseImageSink(a_baseImageSink)
+	{
+		params.scale = std::max(params.scale, size_t(1));
+		params.gamma = std::max(params.gamma, FLT_MIN);
+	}
+
+	bool GainMapSink::Begin(const ImageInfo& a_info)
+	{
+		if (a_info.format != DXGI_FORMAT_R16G16B16A16_FLOAT) {
+			return false;
+		}
+
+		width = a_info.width;
+		height = a_info.height;
+		mapWidth = (width + params.scale - 1) / params.scale;
+		mapHeight = (height + params.scale - 1) / params.scale;
+
+		gainSums.assign(mapWidth * mapHeight, 0.f);
+		gainMap.clear();
+		return baseImageSink.Begin({ width, height, DXGI_FORMAT_R8G8B8A8_UNORM });
+	}
+
+	void GainMapSink::ProcessGainMapRow(const ImageStrip& a_strip, size_t a_mapY, std::vector<float>& a_gains)
+	{
+		const GainRowParams rowParams = { 1.f / toneMapper.GetParams().paperWhite, params.offsetSDR, params.offsetHDR };
+		const auto          computeGains = IsAVX2Supported() ? &ComputeGainsAVX2 : &ComputeGainsScalar;
+
+		const size_t firstRow = a_mapY * params.scale;
+		const size_t endRow = std::min(firstRow + params.scale, a_strip.firstRow + a_strip.rowCount);
+		float*       sums = gainSums.data() + a_mapY * mapWidth;
+
+		for (size_t y = firstRow; y < endRow; ++y) {
+			const uint8_t* hdrRow = a_strip.GetRow(y);
+			uint8_t*       sdrRow = baseStrip.data() + (y - a_strip.firstRow) * width * 4;
+			toneMapper.ToneMapRow(hdrRow, width, sdrRow);
+			computeGains(reinterpret_cast<const uint16_t*>(hdrRow), sdrRow, width, rowParams, a_gains.data());
+
+			for (size_t mapX = 0; mapX < mapWidth; ++mapX) {
+				const size_t endX = std::min((mapX + 1) * params.scale, width);
+				for (size_t x = mapX * params.scale; x < endX; ++x) {
+					sums[mapX] += a_gains[x];
+				}
+			}
+		}
+	}
+
+	bool GainMapSink::WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		if (a_strip.firstRow % params.scale != 0 || a_strip.firstRow + a_strip.rowCount > height) {
+			return false;
+		}
+
+		const size_t firstMapRow = a_strip.firstRow / params.scale;
+		const size_t mapRowCount = (a_strip.rowCount + params.scale - 1) / params.scale;
+		baseStrip.resize(a_strip.rowCount * width * 4);
+
+		auto processRows = [&](size_t a_begin, size_t a_end) {
+			std::vector<float> gains(width);
+			for (size_t i = a_begin; i < a_end; ++i) {
+				ProcessGainMapRow(a_strip, firstMapRow + i, gains);
+			}
+		};
+
+		if (a_workers) {
+			a_workers->ParallelFor(mapRowCount, processRows);
+		} else {
+			processRows(0, mapRowCount);
+		}
+		return baseImageSink.WriteStrip({ baseStrip.data(), a_strip.firstRow, a_strip.rowCount, width * 4 }, a_workers);
+	}
+
+	bool GainMapSink::End()
+	{
+		// Averages, the pixels on the right and bottom edges can cover less of the image
+		float minGain = 0.f;
+		float maxGain = 0.f;
+		for (size_t mapY = 0; mapY < mapHeight; ++mapY) {
+			const size_t rowCount = std::min(params.scale, height - mapY * params.scale);
+			for (size_t mapX = 0; mapX < mapWidth; ++mapX) {
+				const size_t columnCount = std::min(params.scale, width - mapX * params.scale);
+				float&       gain = gainSums[mapY * mapWidth + mapX];
+				gain /= static_cast<float>(rowCount * columnCount);
+				minGain = std::min(minGain, gain);
+				maxGain = std::max(maxGain, gain);
+			}
+		}
+
+		metadata = {
+			.gainMapMin = minGain,
+			.gainMapMax = maxGain,
+			.gamma = params.gamma,
+			.offsetSDR = params.offsetSDR,
+			.offsetHDR = params.offsetHDR,
+			.hdrCapacityMin = 0.f,
+			.hdrCapacityMax = std::max(maxGain, 1.f / 256.f)  // Has to be above the min, even for an image without highlights
+		};
+
+		const float range = maxGain - minGain;
+		const float inverseRange = range > 0.f ? 1.f / range : 0.f;
+		const float gamma = params.gamma;
+		gainMap.resize(gainSums.size());
+		for (size_t i = 0; i < gainSums.size(); ++i) {
+			const float recovery = std::clamp((gainSums[i] - minGain) * inverseRange, 0.f, 1.f);
+			gainMap[i] = static_cast<uint8_t>(std::lround((gamma == 1.f ? recovery : std::pow(recovery, gamma)) * 255.f));
+		}
+
+		gainSums = {};
+		baseStrip = {};
+		return baseImageSink.End();
+	}
+
+	bool WriteGainMapJpeg(std::ostream& a_stream, std::span<const uint8_t> a_baseJpeg, std::span<const uint8_t> a_gainMapJpeg, const GainMapMetadata& a_metadata)
+	{
+		const size_t baseMetadataOffset = GetMetadataOffset(a_baseJpeg);
+		const size_t gainMapMetadataOffset = GetMetadataOffset(a_gainMapJpeg);
+		if (baseMetadataOffset == 0 || gainMapMetadataOffset == 0) {
+			return false;
+		}
+
+		const auto gainMapXmp = MakeXmpSegment(WrapXmp(std::format(
+			"<rdf:Description xmlns:hdrgm=\"http://ns.adobe.com/hdr-gain-map/1.0/\" hdrgm:Version=\"1.0\""
+			" hdrgm:GainMapMin=\"{}\" hdrgm:GainMapMax=\"{}\" hdrgm:Gamma=\"{}\" hdrgm:OffsetSDR=\"{}\" hdrgm:OffsetHDR=\"{}\""
+			" hdrgm:HDRCapacityMin=\"{}\" hdrgm:HDRCapacityMax=\"{}\" hdrgm:BaseRenditionIsHDR=\"False\"/>",
+			a_metadata.gainMapMin, a_metadata.gainMapMax, a_metadata.gamma, a_metadata.offsetSDR, a_metadata.offsetHDR, a_metadata.hdrCapacityMin, a_metadata.hdrCapacityMax)));
+		if (!gainMapXmp) {
+			return false;
+		}
+		const size_t gainMapSize = a_gainMapJpeg.size() + gainMapXmp->size();
+
+		// The container directory tells the size of the gain map, which is appended after the base image
+		const auto baseXmp = MakeXmpSegment(WrapXmp(std::format(
+			"<rdf:Description xmlns:Container=\"http://ns.google.com/photos/1.0/container/\" xmlns:Item=\"http://ns.google.com/photos/1.0/container/item/\""
+			" xmlns:hdrgm=\"http://ns.adobe.com/hdr-gain-map/1.0/\" hdrgm:Version=\"1.0\">"
+			"<Container:Directory><rdf:Seq>"
+			"<rdf:li rdf:parseType=\"Resource\"><Container:Item Item:Semantic=\"Primary\" Item:Mime=\"image/jpeg\"/></rdf:li>"
+			"<rdf:li rdf:parseType=\"Resource\"><Container:Item Item:Semantic=\"GainMap\" Item:Mime=\"image/jpeg\" Item:Length=\"{}\"/></rdf:li>"
+			"</rdf:Seq></Container:Directory>"
+			"</rdf:Description>",
+			gainMapSize)));
+		if (!baseXmp) {
+			return false;
+		}
+
+		// The MPF index (CIPA DC-007), a big endian TIFF IFD with the version, the image count and an entry for each image.
+		// Offsets are relative to the TIFF header, which follows the "MPF" identifier.
+		constexpr size_t mpfPayloadSize = 8 + 2 + 3 * 12 + 4 + 2 * 16;
+		constexpr size_t mpfSegmentSize = 4 + 4 + mpfPayloadSize;
+		const size_t     baseSize = a_baseJpeg.size() + baseXmp->size() + mpfSegmentSize;
+		const size_t     tiffHeaderOffset = baseMetadataOffset + baseXmp->size() + 4 + 4;
+		if (baseSize > UINT32_MAX || gainMapSize > UINT32_MAX) {
+			return false;
+		}
+
+		std::vector<uint8_t> mpf = { 'M', 'M', 0x00, 0x2A };
+		AppendBigEndian32(mpf, 8);  // First IFD
+		AppendBigEndian16(mpf, 3);
+		AppendBigEndian16(mpf, 0xB000);  // MPFVersion
+		AppendBigEndian16(mpf, 7);
+		AppendBigEndian32(mpf, 4);
+		mpf.insert(mpf.end(), { '0', '1', '0', '0' });
+		AppendBigEndian16(mpf, 0xB001);  // NumberOfImages
+		AppendBigEndian16(mpf, 4);
+		AppendBigEndian32(mpf, 1);
+		AppendBigEndian32(mpf, 2);
+		AppendBigEndian16(mpf, 0xB002);  // MPEntry
+		AppendBigEndian16(mpf, 7);
+		AppendBigEndian32(mpf, 2 * 16);
+		AppendBigEndian32(mpf, 8 + 2 + 3 * 12 + 4);
+		AppendBigEndian32(mpf, 0);  // No next IFD
+
+		AppendBigEndian32(mpf, 0x030000);  // Baseline primary image
+		AppendBigEndian32(mpf, static_cast<uint32_t>(baseSize));
+		AppendBigEndian32(mpf, 0);  // The primary image is always at 0
+		AppendBigEndian32(mpf, 0);
+		AppendBigEndian32(mpf, 0);
+		AppendBigEndian32(mpf, static_cast<uint32_t>(gainMapSize));
+		AppendBigEndian32(mpf, static_cast<uint32_t>(baseSize - tiffHeaderOffset));
+		AppendBigEndian32(mpf, 0);
+
+		const auto mpfSegment = MakeSegment(0xE2, "MPF", mpf);
+		if (!mpfSegment || mpfSegment->size() != mpfSegmentSize) {
+			return false;
+		}
+
+		auto write = [&a_stream](std::span<const uint8_t> a_data) {
+			a_stream.write(reinterpret_cast<const char*>(a_data.data()), static_cast<std::streamsize>(a_data.size()));
+		};
+
+		write(a_baseJpeg.first(baseMetadataOffset));
+		write(*baseXmp);
+		write(*mpfSegment);
+		write(a_baseJpeg.subspan(baseMetadataOffset));
+		write(a_gainMapJpeg.first(gainMapMetadataOffset));
+		write(*gainMapXmp);
+		write(a_gainMapJpeg.subspan(gainMapMetadataOffset));
+		return a_stream.good();
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ImagePipeline.h"
+
+namespace Utils
+{
+	class SDRToneMapper;
+	class WorkerPool;
+
+	struct GainMapParams
+	{
+		size_t scale = 4;               // The gain map is this many times smaller than the image on each axis
+		float  offsetSDR = 1.f / 64.f;  // Added to both luminances before taking their ratio, so black doesn't need an infinite gain
+		float  offsetHDR = 1.f / 64.f;
+		float  gamma = 1.f;             // Of the encoded gain map
+	};
+
+	// The "hdrgm" XMP metadata of the Adobe gain map and Ultra HDR specifications (the same model as ISO 21496-1). Boosts are log2.
+	struct GainMapMetadata
+	{
+		float gainMapMin = 0.f;
+		float gainMapMax = 0.f;
+		float gamma = 1.f;
+		float offsetSDR = 0.f;
+		float offsetHDR = 0.f;
+		float hdrCapacityMin = 0.f;
+		float hdrCapacityMax = 0.f;
+	};
+
+	// Tone maps RGBA16F (scRGB) strips to an SDR base image, and computes a single channel gain map that restores the HDR luminance from it:
+	// HDR = (SDR + offsetSDR) * 2^gain - offsetHDR, in linear, relative to SDR white.
+	// The SDR side is the 8 bit base image as viewers will decode it (sRGB), so the rounding and the gamma 2.2 encode are corrected by the map too.
+	// The log2 gains are averaged over each gain map pixel as the rows are tone mapped, the full resolution gains are never stored.
+	// Neither is the base image: each strip of it is passed on to another sink (e.g. the SDR PNG and the base JPEG) once it's tone mapped.
+	class GainMapSink : public ImageSink
+	{
+	public:
+		// The base image is RGBA8, gamma 2.2 encoded, like the SDR screenshot
+		GainMapSink(const SDRToneMapper& a_toneMapper, const GainMapParams& a_params, ImageSink& a_baseImageSink);
+
+		// Every gain map row is computed from whole strips, so they can be split between the workers
+		size_t GetRowAlignment() const override { return std::lcm(params.scale, std::max(baseImageSink.GetRowAlignment(), size_t(1))); }
+		bool   Begin(const ImageInfo& a_info) override;
+		bool   WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		// Quantizes the gain map, once the whole range of the gains is known
+		bool   End() override;
+
+		// 8 bit, single channel
+		const std::vector<uint8_t>& GetGainMap() const { return gainMap; }
+		size_t                      GetGainMapWidth() const { return mapWidth; }
+		size_t                      GetGainMapHeight() const { return mapHeight; }
+		const GainMapMetadata&      GetMetadata() const { return metadata; }
+
+	private:
+		void ProcessGainMapRow(const ImageStrip& a_strip, size_t a_mapY, std::vector<float>& a_gains);
+
+		const SDRToneMapper& toneMapper;
+		GainMapParams        params;
+		ImageSink&           baseImageSink;
+		size_t               width = 0;
+		size_t               height = 0;
+		size_t               mapWidth = 0;
+		size_t               mapHeight = 0;
+
+		std::vector<uint8_t> baseStrip;  // The base image of the current strip
+		std::vector<float>   gainSums;   // Of the log2 gains of the pixels of each gain map pixel
+		std::vector<uint8_t> gainMap;
+		GainMapMetadata      metadata;
+	};
+
+	// Writes an Ultra HDR JPEG: the base image with the XMP gain map directory and an MPF index, followed by the gain map JPEG with its "hdrgm" XMP metadata.
+	// Viewers without gain map support show the base image.
+	bool WriteGainMapJpeg(std::ostream& a_stream, std::span<const uint8_t> a_baseJpeg, std::span<const uint8_t> a_gainMapJpeg, const GainMapMetadata& a_metadata);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+namespace Utils
+{
+	// Portable conversions, for when F16C isn't available or for the few values left over by the vectorized loops
+
+	inline float HalfToFloat(uint16_t a_half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(a_half & 0x8000) << 16;
+		const uint32_t exponent = (a_half >> 10) & 0x1F;
+		const uint32_t mantissa = a_half & 0x3FF;
+
+		if (exponent == 0) {
+			// Zero or denormal, which are exactly representable as normal floats
+			const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+			return std::bit_cast<float>(std::bit_cast<uint32_t>(magnitude) | sign);
+		}
+		if (exponent == 0x1F) {
+			return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+		}
+		return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+
+	// Rounds to nearest even, like F16C does
+	inline uint16_t FloatToHalf(float a_value)
+	{
+		const uint32_t bits = std::bit_cast<uint32_t>(a_value);
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+		if (magnitude >= 0x7F800000) {
+			return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+		}
+		if (magnitude >= 0x477FF000) {  // Rounds past 65504
+			return sign | 0x7C00;
+		}
+		if (magnitude < 0x38800000) {
+			// Denormal, the FPU does the rounding for us
+			const float denormal = std::bit_cast<float>(magnitude) * 16777216.f;
+			return sign | static_cast<uint16_t>(std::nearbyint(denormal));
+		}
+		const uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+		return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+	}
+}
@@ -2,68 +2,60 @@
 
 #include "Hooks.h"
 #include "Offsets.h"
+#include "Statistics.h"
+#include "Techniques.h"
 #include "Utils.h"
 
 namespace Hooks
 {
-    RE::BufferDefinition* Patches::GetBufferFromString(std::string_view a_bufferName)
+	// The game settings menu entries of our settings, cached by ID so refreshing their enable states doesn't scan the whole list for each of them.
+	// The cache is rebuilt whenever the list storage changes (e.g. the menu was rebuilt or more settings were added after ours).
+	struct SettingsMenuHandles
 	{
-		const auto& bufferArray = *Offsets::bufferArray;
-		for (const auto& bufferDefinition : bufferArray) {
-		    if (bufferDefinition->bufferName == a_bufferName) {
-                return bufferDefinition;
-            }
-		}
+		const RE::SettingsDataModel*                        model = nullptr;
+		const void*                                         itemsData = nullptr;
+		size_t                                              itemsSize = 0;
+		std::array<RE::SubSettingsList::GeneralSetting*, static_cast<size_t>(Settings::SettingID::kDevSetting05) - static_cast<size_t>(Settings::SettingID::kSTART)> handles = {};
+	};
 
-		return nullptr;
-	}
+	static SettingsMenuHandles        settingsMenuHandles;
+	static Settings::EnableStateGraph settingsMenuEnableStates;
 
-    void Hooks::ToggleEnableHDRSubSettings(RE::SettingsDataModel* a_model, bool a_bDisplayModeHDREnable, bool a_bGameRenderingHDREnable, bool a_bSDRForcedOnHDR, RE::FrameGenerationTech a_frameGenerationTech)
+    RE::SubSettingsList::GeneralSetting* Hooks::FindSettingHandle(RE::SettingsDataModel* a_model, Settings::SettingID a_id)
     {
-		if (const auto peakBrightnessSetting = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kHDR_PeakBrightness))) {
-			peakBrightnessSetting->m_Enabled.SetValue(a_bGameRenderingHDREnable);
-		}
-
-		if (const auto gamePaperWhiteSetting = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kHDR_GamePaperWhite))) {
-			gamePaperWhiteSetting->m_Enabled.SetValue(a_bDisplayModeHDREnable || a_bSDRForcedOnHDR);
-		}
-
-		if (const auto uiPaperWhiteSetting = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kHDR_UIPaperWhite))) {
-			bool bUIPaperWhiteEnabled = a_bGameRenderingHDREnable;
-#if !FSR_3_FG_SUPPORTS_UI_PAPER_WHITE
-			bUIPaperWhiteEnabled = bUIPaperWhiteEnabled && a_frameGenerationTech != RE::FrameGenerationTech::kFSR3;
-#endif
-			uiPaperWhiteSetting->m_Enabled.SetValue(bUIPaperWhiteEnabled);
-		}
-
-		if (const auto extendGamut = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kHDR_ExtendGamut))) {
-			extendGamut->m_Enabled.SetValue(a_bGameRenderingHDREnable);
-		}
-
-		if (const auto autoHDRVideos = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kHDR_AutoHDRVideos))) {
-			autoHDRVideos->m_Enabled.SetValue(a_bGameRenderingHDREnable);
-		}
-
-		if (const auto secondaryBrightnessSetting = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kSecondaryBrightness))) {
-			secondaryBrightnessSetting->m_Enabled.SetValue(!a_bGameRenderingHDREnable);
+		const auto offset = static_cast<size_t>(a_id) - static_cast<size_t>(Settings::SettingID::kSTART) - 1;
+		if (a_id <= Settings::SettingID::kSTART || offset >= settingsMenuHandles.handles.size()) {
+			return a_model->FindSettingById(static_cast<int>(a_id));
+		}
+
+		const auto items = a_model->m_SubSettingsMap.GetData().m_Settings.Items();
+		if (settingsMenuHandles.model != a_model || settingsMenuHandles.itemsData != items.data() || settingsMenuHandles.itemsSize != items.size()) {
+			settingsMenuHandles.model = a_model;
+			settingsMenuHandles.itemsData = items.data();
+			settingsMenuHandles.itemsSize = items.size();
+			settingsMenuHandles.handles.fill(nullptr);
+			for (auto& item : items) {
+				auto& setting = item.m_ShuttleMap.GetData();
+				const auto id = static_cast<size_t>(setting.m_ID.m_Value);
+				const auto itemOffset = id - static_cast<size_t>(Settings::SettingID::kSTART) - 1;
+				if (id > static_cast<size_t>(Settings::SettingID::kSTART) && itemOffset < settingsMenuHandles.handles.size() && !settingsMenuHandles.handles[itemOffset]) {
+					settingsMenuHandles.handles[itemOffset] = &setting;
+				}
+			}
 		}
 
-		if (const auto strictLUTApplicationSetting = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kStrictLUTApplication))) {
-			strictLUTApplicationSetting->m_Enabled.SetValue(a_bGameRenderingHDREnable);
-		}
+		return settingsMenuHandles.handles[offset];
     }
 
-	void Hooks::CheckCustomToneMapperSettings(RE::SettingsDataModel* a_model, bool a_bIsCustomToneMapper)
-	{
-		if (const auto toneMapperHighlights = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kToneMapperHighlights)))
-		{
-			toneMapperHighlights->m_Enabled.SetValue(a_bIsCustomToneMapper);
-		}
-		if (const auto toneMapperShadows = a_model->FindSettingById(static_cast<int>(Settings::SettingID::kToneMapperShadows)))
-		{
-			toneMapperShadows->m_Enabled.SetValue(a_bIsCustomToneMapper);
+    void Hooks::RefreshSettingsEnableStates(RE::SettingsDataModel* a_model, std::optional<RE::FrameGenerationTech> a_frameGenerationTech)
+    {
+		const auto settings = Settings::Main::GetSingleton();
+		for (const auto id : settingsMenuEnableStates.Update(settings->GetEnableInputs(a_frameGenerationTech))) {
+			if (const auto setting = FindSettingHandle(a_model, id)) {
+				setting->m_Enabled.SetValue(settingsMenuEnableStates.IsEnabled(id));
+			}
 		}
-	}
+    }
 
     void Hooks::CreateCheckboxSetting(RE::ArrayNestedUIValue<RE::SubSettingsList::GeneralSetting, 0>* a_settingList, Settings::Checkbox& a_setting, bool a_bEnabled)
     {
@@ -75,7 +67,7 @@ namespace Hooks
 		s.m_Type.SetValue(RE::SubSettingsList::GeneralSetting::Type::Checkbox);
 		s.m_Category.SetValue(RE::SubSettingsList::GeneralSetting::Category::Display);
 		s.m_Enabled.SetValue(a_bEnabled);
-		s.m_CheckBoxData.m_ShuttleMap.GetData().m_Value.SetValue(a_setting.value.get_data());
+		s.m_CheckBoxData.m_ShuttleMap.GetData().m_Value.SetValue(a_setting.Get());
 		a_settingList->AddItem(s);
     }
 
@@ -137,37 +129,37 @@ namespace Hooks
 		// We don't expose "DevSetting*" or "EnforceUserDisplayMode" or "ForceSDROnHDR" or "kHDRScreenshots*" to the game settings, they'd just confuse users.
 		// Here we write down the number of settings we didn't add to the UI, to make sure "Settings::SettingID::kEND" has the right value.
 		// Note: this is pretty unnecessary, as the separator works anyway.
-		constexpr int unusedSettings = 4;
-
-		CreateStepperSetting(a_settingList, settings->DisplayMode, settings->IsHDRSupported() && !settings->IsSDRForcedOnHDR());
-		CreateStepperSetting(a_settingList, settings->PeakBrightness, settings->IsGameRenderingSetToHDR());
-		CreateStepperSetting(a_settingList, settings->GamePaperWhite, settings->IsDisplayModeSetToHDR() || settings->IsSDRForcedOnHDR());
-#if FSR_3_FG_SUPPORTS_UI_PAPER_WHITE
-		CreateStepperSetting(a_settingList, settings->UIPaperWhite, settings->IsGameRenderingSetToHDR());
-#else
-		CreateStepperSetting(a_settingList, settings->UIPaperWhite, settings->IsGameRenderingSetToHDR() && !settings->IsFSR3FGEnabled());
-#endif
-
-		CreateSliderSetting(a_settingList, settings->SecondaryBrightness, !settings->IsGameRenderingSetToHDR());
-
-		CreateStepperSetting(a_settingList, settings->ToneMapperType, true);
-		CreateSliderSetting(a_settingList, settings->Saturation, true); // Requires "CLAMP_INPUT_OUTPUT_TYPE" 1 in shaders (gamut mapping) if we are rendering to SDR
-		CreateSliderSetting(a_settingList, settings->Contrast, true); // Requires "CLAMP_INPUT_OUTPUT_TYPE" 1 in shaders (gamut mapping) if we are rendering to SDR
-		CreateSliderSetting(a_settingList, settings->Highlights, settings->IsCustomToneMapper());
-		CreateSliderSetting(a_settingList, settings->Shadows, settings->IsCustomToneMapper());
-		CreateSliderSetting(a_settingList, settings->ExtendGamut, settings->IsGameRenderingSetToHDR());
-		CreateSliderSetting(a_settingList, settings->Bloom, true);
-
-		CreateSliderSetting(a_settingList, settings->ColorGradingStrength, true);
-		CreateSliderSetting(a_settingList, settings->LUTCorrectionStrength, true);
-		CreateCheckboxSetting(a_settingList, settings->VanillaMenuLUTs, true);
-		CreateCheckboxSetting(a_settingList, settings->StrictLUTApplication, settings->IsGameRenderingSetToHDR());
-		CreateCheckboxSetting(a_settingList, settings->AutoHDRVideos, settings->IsGameRenderingSetToHDR());
-
-		CreateSliderSetting(a_settingList, settings->GammaCorrectionStrength, true);
-		CreateStepperSetting(a_settingList, settings->FilmGrainType, true);
-		CreateSliderSetting(a_settingList, settings->FilmGrainFPSLimit, settings->IsFilmGrainTypeImproved());
-		CreateCheckboxSetting(a_settingList, settings->PostSharpen, true);
+		constexpr int unusedSettings = 5;
+
+		// The list is built from scratch with the current enable states, later changes only update the entries that changed
+		settingsMenuEnableStates.Update(settings->GetEnableInputs());
+		auto IsEnabled = [](const Settings::Setting& a_setting) { return settingsMenuEnableStates.IsEnabled(a_setting.id); };
+
+		CreateStepperSetting(a_settingList, settings->DisplayMode, IsEnabled(settings->DisplayMode));
+		CreateStepperSetting(a_settingList, settings->PeakBrightness, IsEnabled(settings->PeakBrightness));
+		CreateStepperSetting(a_settingList, settings->GamePaperWhite, IsEnabled(settings->GamePaperWhite));
+		CreateStepperSetting(a_settingList, settings->UIPaperWhite, IsEnabled(settings->UIPaperWhite));
+
+		CreateSliderSetting(a_settingList, settings->SecondaryBrightness, IsEnabled(settings->SecondaryBrightness));
+
+		CreateStepperSetting(a_settingList, settings->ToneMapperType, IsEnabled(settings->ToneMapperType));
+		CreateSliderSetting(a_settingList, settings->Saturation, IsEnabled(settings->Saturation)); // Requires "CLAMP_INPUT_OUTPUT_TYPE" 1 in shaders (gamut mapping) if we are rendering to SDR
+		CreateSliderSetting(a_settingList, settings->Contrast, IsEnabled(settings->Contrast)); // Requires "CLAMP_INPUT_OUTPUT_TYPE" 1 in shaders (gamut mapping) if we are rendering to SDR
+		CreateSliderSetting(a_settingList, settings->Highlights, IsEnabled(settings->Highlights));
+		CreateSliderSetting(a_settingList, settings->Shadows, IsEnabled(settings->Shadows));
+		CreateSliderSetting(a_settingList, settings->ExtendGamut, IsEnabled(settings->ExtendGamut));
+		CreateSliderSetting(a_settingList, settings->Bloom, IsEnabled(settings->Bloom));
+
+		CreateSliderSetting(a_settingList, settings->ColorGradingStrength, IsEnabled(settings->ColorGradingStrength));
+		CreateSliderSetting(a_settingList, settings->LUTCorrectionStrength, IsEnabled(settings->LUTCorrectionStrength));
+		CreateCheckboxSetting(a_settingList, settings->VanillaMenuLUTs, IsEnabled(settings->VanillaMenuLUTs));
+		CreateCheckboxSetting(a_settingList, settings->StrictLUTApplication, IsEnabled(settings->StrictLUTApplication));
+		CreateCheckboxSetting(a_settingList, settings->AutoHDRVideos, IsEnabled(settings->AutoHDRVideos));
+
+		CreateSliderSetting(a_settingList, settings->GammaCorrectionStrength, IsEnabled(settings->GammaCorrectionStrength));
+		CreateStepperSetting(a_settingList, settings->FilmGrainType, IsEnabled(settings->FilmGrainType));
+		CreateSliderSetting(a_settingList, settings->FilmGrainFPSLimit, IsEnabled(settings->FilmGrainFPSLimit));
+		CreateCheckboxSetting(a_settingList, settings->PostSharpen, IsEnabled(settings->PostSharpen));
 
 		CreateSeparator(a_settingList, Settings::SettingID((int)Settings::SettingID::kEND - unusedSettings));
     }
@@ -177,18 +169,55 @@ namespace Hooks
 		std::string                                                                                   FileName;
 		std::function<void(ID3D12CommandQueue*, ID3D12Resource*, D3D12_RESOURCE_STATES, std::string)> Callback;
 		ID3D12Resource*                                                                               TextureCopy;
-		uint64_t                                                                                      CaptureFrameIndex;
+		std::optional<uint32_t>                                                                       BurstFrame;
 	};
 
-	static std::string                 screenshotName;
-	static std::vector<ScreenshotData> pendingScreenshots;
+	static std::string                                               screenshotName;
+	static std::unique_ptr<Utils::ReadbackScheduler<ScreenshotData>> pendingScreenshots;
+	constexpr size_t                                                 maxPendingScreenshots = 4;
+	// How long screenshot copies were waited on before the fence, it's still the minimum as the fence relies on the copies having been submitted the frame after
+	constexpr uint64_t                                               screenshotReadbackFrameDelay = 8;
+	// Recycles the capture textures, they are as big as the swapchain and creating them each time can hitch
+	static std::unique_ptr<Utils::TexturePool>                       captureTextures;
+	// A Photo Mode screenshot can capture a sequence of frames, the request is only set on the frames that are captured
+	static Utils::BurstCapture                                       burstCapture;
+	static std::string                                               burstName;
+	static decltype(ScreenshotData::Callback)                        burstCallback;
+	static bool                                                      bBurstHDRScreenshot = false;
+
+	void ReportBurstCapture()
+	{
+		const auto report = burstCapture.TakeReport();
+		if (!report) {
+			return;
+		}
+
+		INFO("Screenshot burst \"{}\" done, {} of {} frames captured", burstName, report->capturedCount, report->frameCount)
+		if (!report->droppedFrames.empty()) {
+			std::string droppedFrames;
+			for (const auto index : report->droppedFrames) {
+				droppedFrames.append(std::format("{}{}", droppedFrames.empty() ? "" : ", ", index + 1));
+			}
+			WARN("Screenshot burst \"{}\" dropped {} frames (the capture ring was full): {}", burstName, report->droppedFrames.size(), droppedFrames)
+		}
+	}
 
 	bool CheckForScreenshotRequest(ID3D12Device2* a_device, ID3D12CommandQueue* a_queue, ID3D12GraphicsCommandList* a_commandList, ID3D12Resource* a_sourceTexture)
 	{
-		static uint64_t currentFrameCounter = 0;
-		currentFrameCounter++;
+		if (!pendingScreenshots) {
+			std::unique_ptr<Utils::ReadbackCompletionSource> completionSource = Utils::FenceCompletionSource::Create(a_device, a_queue);
+			if (!completionSource) {
+				WARN("Failed to create the screenshots readback fence, falling back to waiting a fixed number of frames")
+				completionSource = std::make_unique<Utils::FrameCountCompletionSource>(screenshotReadbackFrameDelay);
+			}
+			pendingScreenshots = std::make_unique<Utils::ReadbackScheduler<ScreenshotData>>(std::move(completionSource), screenshotReadbackFrameDelay);
+		}
+		pendingScreenshots->OnFrame();
+		ReportBurstCapture();
 
 		decltype(ScreenshotData::Callback) screenshotCallback;
+		std::string                        fileName = screenshotName;
+		std::optional<uint32_t>            burstFrame;
 		bool                               screenshotEnqueued = false;
 		const auto                         settings = Settings::Main::GetSingleton();
 
@@ -198,31 +227,77 @@ namespace Hooks
 			screenshotCallback = &Utils::TakeSDRPhotoModeScreenshot;
 		}
 
+		// The config isn't validated on load, only on hot reload
+		auto getClamped = [](const Settings::ValueStepper& a_stepper) { return static_cast<uint32_t>(std::clamp(a_stepper.Get(), a_stepper.minValue, a_stepper.maxValue)); };
+
+		const auto burstFrames = getClamped(settings->ScreenshotBurstFrames);
+		if (screenshotCallback && !burstCapture.IsActive() && burstFrames > 1) {
+			burstCapture.Start({
+				.frameCount = burstFrames,
+				.frameInterval = getClamped(settings->ScreenshotBurstInterval),
+				.ringSize = getClamped(settings->ScreenshotBurstRingSize),
+			});
+			burstName = screenshotName;
+			burstCallback = screenshotCallback;
+			bBurstHDRScreenshot = settings->bRequestedHDRScreenshot;
+		}
+
+		if (burstCapture.IsActive() && !burstCapture.IsCaptureDone()) {
+			// The ring bounds the captures in flight, frames that are due while it's full are dropped
+			burstFrame = burstCapture.OnFrame();
+			screenshotCallback = burstFrame ? burstCallback : nullptr;
+			fileName = burstFrame ? std::format("{}_{:04d}", burstName, *burstFrame + 1) : std::string();
+
+			// The request changes how the frame is rendered (e.g. the peak brightness of HDR screenshots), so during a burst it's only set on the frames that are captured.
+			// It's kept if the next frame is due too, otherwise it's consumed now and set again on the frame before the next capture.
+			if (burstCapture.IsNextFrameDue()) {
+				if (!settings->bRequestedHDRScreenshot && !settings->bRequestedSDRScreenshot) {
+					(bBurstHDRScreenshot ? settings->bRequestedHDRScreenshot : settings->bRequestedSDRScreenshot).store(true);
+					settings->MarkShaderConstantsDirty();
+				}
+			} else {
+				screenshotEnqueued = settings->bRequestedHDRScreenshot || settings->bRequestedSDRScreenshot;
+			}
+		} else if (screenshotCallback && burstCapture.IsActive()) {
+			WARN("Skipping screenshot \"{}\", the burst \"{}\" is still being encoded", screenshotName, burstName)
+			screenshotCallback = nullptr;
+			screenshotEnqueued = true;  // Consume the request
+		}
+		// Each pending capture holds a full resolution copy of the frame, so drop requests that come in faster than they can be encoded
+		else if (screenshotCallback && pendingScreenshots->Size() >= maxPendingScreenshots) {
+			WARN("Skipping screenshot \"{}\", {} screenshots are still waiting to be encoded", screenshotName, pendingScreenshots->Size())
+			screenshotCallback = nullptr;
+			screenshotEnqueued = true;  // Consume the request
+		}
+
 		// Capture texture data on the GPU side initially
 		if (screenshotCallback) {
-			ID3D12Resource* texture = nullptr;
-			auto textureDesc = a_sourceTexture->GetDesc();
+			const auto sourceDesc = a_sourceTexture->GetDesc();
+			Utils::TextureKey textureKey = {
+				.width = sourceDesc.Width,
+				.height = sourceDesc.Height,
+				.format = sourceDesc.Format,
+				.sampleCount = sourceDesc.SampleDesc.Count,
+				.flags = sourceDesc.Flags,
+			};
 
-			if (textureDesc.Format == DXGI_FORMAT_R10G10B10A2_TYPELESS) {
-				textureDesc.Format = DXGI_FORMAT_R10G10B10A2_UNORM;
+			if (textureKey.format == DXGI_FORMAT_R10G10B10A2_TYPELESS) {
+				textureKey.format = DXGI_FORMAT_R10G10B10A2_UNORM;
 			}
-			else if (textureDesc.Format == DXGI_FORMAT_R16G16B16A16_TYPELESS) {
-				textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			else if (textureKey.format == DXGI_FORMAT_R16G16B16A16_TYPELESS) {
+				textureKey.format = DXGI_FORMAT_R16G16B16A16_FLOAT;
 			}
 
-			const D3D12_HEAP_PROPERTIES heapProperties = {
-				.Type = D3D12_HEAP_TYPE_DEFAULT,
-				.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-				.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-			};
+			if (!captureTextures) {
+				captureTextures = std::make_unique<Utils::TexturePool>(std::make_unique<Utils::TextureAllocator>(a_device), 0);
+			}
+			captureTextures->SetMaxBytes(static_cast<uint64_t>(getClamped(settings->ScreenshotTexturePoolMB)) << 20);
+
+			// Pooled textures come back in the copy destination state, the screenshot callbacks restore the state they were given
+			ID3D12Resource* texture = captureTextures->Acquire(textureKey);
+			if (texture) {
+				texture->AddRef();  // For the callback to release, the pool keeps its own reference
 
-			if (SUCCEEDED(a_device->CreateCommittedResource(
-					&heapProperties,
-					D3D12_HEAP_FLAG_NONE,
-					&textureDesc,
-					D3D12_RESOURCE_STATE_COPY_DEST,
-					nullptr,
-					IID_PPV_ARGS(&texture)))) {
 				// We're assuming the input is always a render target
 				D3D12_RESOURCE_BARRIER barrier = {};
 				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -238,28 +313,39 @@ namespace Hooks
 				a_commandList->ResourceBarrier(1, &barrier);
 			}
 
-			pendingScreenshots.emplace_back(ScreenshotData{
-				screenshotName,
-				screenshotCallback,
-				texture,
-				currentFrameCounter });
-
-			screenshotEnqueued = true;
-		}
-
-		// Allow eight frames to pass before attempting a CPU readback. Ideally a fence would be issued on the
-		// command queue, but that's not possible without a lot of reverse engineering work.
-		for (auto itr = pendingScreenshots.begin(); itr != pendingScreenshots.end();) {
-			if ((currentFrameCounter - itr->CaptureFrameIndex) >= 8) {
-				// Callback releases the texture
-				std::thread(itr->Callback, a_queue, itr->TextureCopy, D3D12_RESOURCE_STATE_COPY_DEST, itr->FileName).detach();
-
-				itr = pendingScreenshots.erase(itr);
+			if (burstFrame && !texture) {
+				burstCapture.DropFrame(*burstFrame);
 			} else {
-				itr++;
+				pendingScreenshots->Submit(ScreenshotData{
+					fileName,
+					screenshotCallback,
+					texture,
+					burstFrame });
 			}
+
+			screenshotEnqueued |= !burstFrame;
 		}
 
+		// Hand the captures to the workers as soon as the GPU is done copying them, in the order they were taken
+		pendingScreenshots->ProcessCompleted([&](const ScreenshotData& a_screenshot) {
+			// Callback releases the texture, then it goes back to the pool for the next screenshot
+			Utils::WorkerPool::Job job = [a_queue, screenshot = a_screenshot]() {
+				// The pool metrics only include a job once it has returned, so time this one here
+				const auto startTime = std::chrono::steady_clock::now();
+				screenshot.Callback(a_queue, screenshot.TextureCopy, D3D12_RESOURCE_STATE_COPY_DEST, screenshot.FileName);
+				const double encodeMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+				if (screenshot.TextureCopy) {
+					captureTextures->Release(screenshot.TextureCopy);
+				}
+				if (screenshot.BurstFrame) {
+					burstCapture.OnFrameEncoded(*screenshot.BurstFrame);
+				}
+				INFO("Screenshot \"{}\" encoded in {:.0f}ms ({} more queued)", screenshot.FileName, encodeMS, Utils::GetScreenshotWorkers().GetMetrics().queueDepth)
+			};
+			// Never stall the render thread, if the workers are busy, try again next frame (the texture copy stays alive until then, and keeps its burst ring slot)
+			return Utils::GetScreenshotWorkers().TrySubmit(job);
+		});
+
 		return screenshotEnqueued;
 	}
 
@@ -456,6 +542,7 @@ namespace Hooks
 			if (!settings->bRequestedHDRScreenshot.exchange(false)) {
 				settings->bRequestedSDRScreenshot.exchange(false);
 			}
+			settings->MarkShaderConstantsDirty();
 		}
 	}
 
@@ -464,94 +551,27 @@ namespace Hooks
 		const auto technique = *reinterpret_cast<uintptr_t*>(reinterpret_cast<uintptr_t>(a2) + 0x8);
 		const auto techniqueId = *reinterpret_cast<uint64_t*>(technique + 0x68);
 
-		auto uploadRootConstants = [&](const Settings::ShaderConstants& a_shaderConstants, uint32_t a_rootParameterIndex, bool a_bCompute) {
-			auto commandList = *reinterpret_cast<ID3D12GraphicsCommandList**>(reinterpret_cast<uintptr_t>(a_renderGraph) + 0x60);
-
-			if (!a_bCompute)
-				commandList->SetGraphicsRoot32BitConstants(a_rootParameterIndex, Settings::shaderConstantsCount, &a_shaderConstants, 0);
-			else
-				commandList->SetComputeRoot32BitConstants(a_rootParameterIndex, Settings::shaderConstantsCount, &a_shaderConstants, 0);
-		};
-
-		// Note: The following switch statement may be called several thousand times per frame. Additionally, it'll be called from multiple
-		// threads concurrently. The individual cases are called at most once or twice per frame. Keep the amount of code here fairly light.
+		// Note: This may be called several thousand times per frame. Additionally, it'll be called from multiple threads concurrently.
+		// The individual techniques are matched at most once or twice per frame. Keep the amount of code here fairly light.
 		//
-		// RootParameterIndex is the index of our custom RootConstants() entry in the root signature. It's taken from the corresponding
-		// RootSignature.hlsl file stored next to each technique hlsl file.
-		switch (techniqueId) {
-		case 0x1FE1A:
-		case 0xC01FE1A:
-		case 0xE01FE1A:
-		case 0x1001FE1A:
-		case 0x1C01FE1A:
-		case 0x1E01FE1A:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants, Settings::ShaderConstantsMode::kLUT);
-				uploadRootConstants(shaderConstants, 5, false);  // HDRComposite
-				break;
-			}
-
-		case 0x801FE57:
-		case 0x4001FE57:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 2, false);  // Copy
-				break;
-			}
-
-		case 0x1FE73:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 2, false);  // FilmGrain
-				break;
-			}
-
-		case 0x1FE86:
-		case 0x1FE87:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants, Settings::ShaderConstantsMode::kLUT);
-				uploadRootConstants(shaderConstants, 4, true);  // ColorGradingMerge / HDRColorGradingMerge
-				break;
-			}
-
-		case 0x1FE96:
-		case 0x201FE96:
-		case 0x401FE96:
-		case 0x601FE96:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 4, true);  // ContrastAdaptiveSharpening
-				break;
-			}
+		// The lookup is a compile time perfect hash over "Techniques::manifest", the miss path is a single multiply, shift and compare.
+		const auto techniqueInfo = Techniques::FindTechnique(techniqueId);
+		if (!techniqueInfo) [[likely]] {
+			return;
+		}
 
-		case 0x1FE9C:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 5, false);  // PostSharpen
-				break;
-			}
+		Settings::ShaderConstants shaderConstants;
+		Settings::Main::GetSingleton()->GetCachedShaderConstants(shaderConstants, techniqueInfo->shaderConstantsMode);
 
-		case 0x1FEAC:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 2, false);  // ScaleformComposite
-				break;
-			}
+#if ENABLE_HOOK_STATISTICS
+		Statistics::HookStatistics::GetSingleton()->GetThreadCounters().AddMatch(Techniques::GetTechniqueIndex(techniqueInfo), sizeof(Settings::ShaderConstants));
+#endif
 
-		case 0x1FEAD:
-			{
-				Settings::ShaderConstants shaderConstants;
-				Settings::Main::GetSingleton()->GetShaderConstants(shaderConstants);
-				uploadRootConstants(shaderConstants, 2, false);  // BinkMovie
-				break;
-			}
+		auto commandList = *reinterpret_cast<ID3D12GraphicsCommandList**>(reinterpret_cast<uintptr_t>(a_renderGraph) + 0x60);
+		if (!techniqueInfo->bCompute) {
+			commandList->SetGraphicsRoot32BitConstants(techniqueInfo->rootParameterIndex, Settings::shaderConstantsCount, &shaderConstants, 0);
+		} else {
+			commandList->SetComputeRoot32BitConstants(techniqueInfo->rootParameterIndex, Settings::shaderConstantsCount, &shaderConstants, 0);
 		}
     }
 
@@ -565,9 +585,31 @@ namespace Hooks
 
 		settings->RegisterReshadeOverlay();
 
+		if (!_WndProc && a_bgsSwapchainObject->hwnd) {
+			_WndProc = reinterpret_cast<WNDPROC>(SetWindowLongPtrW(a_bgsSwapchainObject->hwnd, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(Hook_WndProc)));
+		}
+
 		return _UnkFunc(a1, a_bgsSwapchainObject);
     }
 
+    LRESULT CALLBACK Hooks::Hook_WndProc(HWND a_hwnd, UINT a_message, WPARAM a_wParam, LPARAM a_lParam)
+    {
+		if (a_message == WM_DESTROY) {
+			Shutdown();
+		}
+		return CallWindowProcW(_WndProc, a_hwnd, a_message, a_wParam, a_lParam);
+    }
+
+    void Hooks::Shutdown()
+    {
+		static std::once_flag shutdown;
+		std::call_once(shutdown, []() {
+			INFO("Shutting down"sv)
+			Utils::ShutdownWorkerPools();
+			Settings::Main::GetSingleton()->Shutdown();
+		});
+    }
+
 	// Seemengly always called before the swapchain is created
     void Hooks::Hook_UnkFunc2(uint64_t a1, uint64_t a2)
 	{
@@ -587,10 +629,13 @@ namespace Hooks
 		if (*Offsets::uiFrameGenerationTech != RE::FrameGenerationTech::kFSR3) {
 			skippedScreenshot = false;
 			screenshotName = Utils::GetPhotoModeScreenshotName();
-			if (settings->IsDisplayModeSetToHDR() && *settings->HDRScreenshots.value) {
+			// The SDR screenshot is tone mapped from the HDR one on the CPU, so there's no need to render an SDR frame too (which would flicker)
+			if (settings->IsDisplayModeSetToHDR() && settings->HDRScreenshots.Get()) {
 				settings->bRequestedHDRScreenshot.store(true);
+			} else {
+				settings->bRequestedSDRScreenshot.store(true);
 			}
-			settings->bRequestedSDRScreenshot.store(true);
+			settings->MarkShaderConstantsDirty();
 		}
 
 		// hack to refresh the UI visibility after the snapshot
@@ -606,6 +651,11 @@ namespace Hooks
     {
 		_RecreateSwapchain(a1, a_bgsSwapChainObject, a_width, a_height, a5);
 
+		// The pooled capture textures have the old size (or format)
+		if (captureTextures) {
+			captureTextures->Clear();
+		}
+
 		const auto settings = Settings::Main::GetSingleton();
 		// Note: this might actually engage HDR on the display automatically on AMD GPUs
 		a_bgsSwapChainObject->swapChainInterface->SetColorSpace1(settings->GetDisplayModeColorSpaceType());
@@ -625,10 +675,10 @@ namespace Hooks
 		const auto settings = Settings::Main::GetSingleton();
 
 		auto HandleSetting = [&](Settings::Checkbox& a_setting) {
-			const auto prevValue = a_setting.value.get_data();
+			const auto prevValue = a_setting.Get();
 			const auto newValue = a_eventData.m_Value.Bool;
 			if (prevValue != newValue) {
-				*a_setting.value = newValue;
+				a_setting.Set(newValue);
 				settings->Save();
 				return true;
 			}
@@ -637,57 +687,38 @@ namespace Hooks
 
 		switch (a_eventData.m_SettingID) {
 		case static_cast<int>(Settings::SettingID::kForceSDROnHDR):
-			{
-				const bool wasDisplayModeHDR = settings->IsDisplayModeSetToHDR();
-				const bool wasSDRForcedOnHDR = settings->IsSDRForcedOnHDR();
-				const bool wasGameRenderingHDR = settings->IsGameRenderingSetToHDR();
-				if (HandleSetting(settings->ForceSDROnHDR)) {
-					const bool isDisplayModeHDR = settings->IsDisplayModeSetToHDR();
-					const bool isSDRForcedOnHDR = settings->IsSDRForcedOnHDR();
-					const bool isGameRenderingHDR = settings->IsGameRenderingSetToHDR();
-					// We probably don't need all these checks, but we are being extra sure
-					if (wasDisplayModeHDR != isDisplayModeHDR || wasSDRForcedOnHDR != isSDRForcedOnHDR || wasGameRenderingHDR != isGameRenderingHDR) {
-						ToggleEnableHDRSubSettings(a_eventData.m_Model, isDisplayModeHDR, isGameRenderingHDR, isSDRForcedOnHDR, *Offsets::uiFrameGenerationTech);
-						CheckCustomToneMapperSettings(a_eventData.m_Model, settings->IsCustomToneMapper());
-					}
-					if (const auto displayModeSetting = a_eventData.m_Model->FindSettingById(static_cast<int>(Settings::SettingID::kDisplayMode))) {
-						displayModeSetting->m_Enabled.SetValue(settings->IsHDRSupported() && !settings->IsSDRForcedOnHDR());
-					}
-					settings->OnDisplayModeChanged();
-				}
+			if (HandleSetting(settings->ForceSDROnHDR)) {
+				RefreshSettingsEnableStates(a_eventData.m_Model);
+				settings->OnDisplayModeChanged();
 			}
 			break;
-		case static_cast<int>(Settings::SettingID::kHDR_AutoHDRVideos):
-			HandleSetting(settings->AutoHDRVideos);
-			break;
-		case static_cast<int>(Settings::SettingID::kVanillaMenuLUTs):
-			HandleSetting(settings->VanillaMenuLUTs);
-			break;
-		case static_cast<int>(Settings::SettingID::kStrictLUTApplication):
-			HandleSetting(settings->StrictLUTApplication);
-			break;
-		case static_cast<int>(Settings::SettingID::kPostSharpen):
-			HandleSetting(settings->PostSharpen);
-		    break;
 		case static_cast<int>(Settings::SettingID::kFrameGeneration):
-			// The settings values haven't changed yet, so compare them for a change
-			const auto prevFramegenValue = *Offsets::uiFrameGenerationTech;
-			const auto isFramegenOn = a_eventData.m_Value.Bool;
-			RE::FrameGenerationTech newFramegenValue;
-			if (isFramegenOn) {
-				if (*Offsets::uiUpscalingTechnique == RE::UpscalingTechnique::kDLSS) {
-					newFramegenValue = RE::FrameGenerationTech::kDLSSG;
+			{
+				// The settings values haven't changed yet, so compare them for a change
+				const auto prevFramegenValue = *Offsets::uiFrameGenerationTech;
+				const auto isFramegenOn = a_eventData.m_Value.Bool;
+				RE::FrameGenerationTech newFramegenValue;
+				if (isFramegenOn) {
+					if (*Offsets::uiUpscalingTechnique == RE::UpscalingTechnique::kDLSS) {
+						newFramegenValue = RE::FrameGenerationTech::kDLSSG;
+					} else {
+						newFramegenValue = RE::FrameGenerationTech::kFSR3;
+					}
 				} else {
-					newFramegenValue = RE::FrameGenerationTech::kFSR3;
+					newFramegenValue = RE::FrameGenerationTech::kNone;
 				}
-			} else {
-				newFramegenValue = RE::FrameGenerationTech::kNone;
-			}
-			// If FG was off, the setting would have been guaranteed to be "RE::FrameGenerationTech::kNone".
-			if (prevFramegenValue != newFramegenValue) {
-				ToggleEnableHDRSubSettings(a_eventData.m_Model, settings->IsDisplayModeSetToHDR(), settings->IsGameRenderingSetToHDR(), settings->IsSDRForcedOnHDR(), newFramegenValue);
+				// If FG was off, the setting would have been guaranteed to be "RE::FrameGenerationTech::kNone".
+				if (prevFramegenValue != newFramegenValue) {
+					RefreshSettingsEnableStates(a_eventData.m_Model, newFramegenValue);
 
-				settings->RefreshSwapchainFormat(newFramegenValue);
+					settings->RefreshSwapchainFormat(newFramegenValue);
+				}
+			}
+			break;
+		default:
+			// Settings without side effects
+			if (const auto setting = settings->FindSetting<Settings::Checkbox>(static_cast<Settings::SettingID>(a_eventData.m_SettingID))) {
+				HandleSetting(*setting);
 			}
 			break;
 		}
@@ -700,10 +731,10 @@ namespace Hooks
 		const auto settings = Settings::Main::GetSingleton();
 
 		auto HandleSetting = [&](Settings::Stepper& a_setting) {
-			const auto prevValue = a_setting.value.get_data();
+			const auto prevValue = a_setting.Get();
 			const auto newValue = a_setting.GetValueFromStepper(a_eventData.m_Value.Int);
 			if (prevValue != newValue) {
-				*a_setting.value = newValue;
+				a_setting.Set(newValue);
 				settings->Save();
 				return true;
 			}
@@ -712,82 +743,64 @@ namespace Hooks
 
 		switch (a_eventData.m_SettingID) {
 		case static_cast<int>(Settings::SettingID::kDisplayMode):
-			{
-				const bool wasDisplayModeHDR = settings->IsDisplayModeSetToHDR();
-				const bool wasSDRForcedOnHDR = settings->IsSDRForcedOnHDR();
-				const bool wasGameRenderingHDR = settings->IsGameRenderingSetToHDR();
-				if (HandleSetting(settings->DisplayMode)) {
-					const bool isDisplayModeHDR = settings->IsDisplayModeSetToHDR();
-					const bool isSDRForcedOnHDR = settings->IsSDRForcedOnHDR();
-					const bool isGameRenderingHDR = settings->IsGameRenderingSetToHDR();
-					// We probably don't need all these checks, but we are being extra sure
-					if (wasDisplayModeHDR != isDisplayModeHDR || wasSDRForcedOnHDR != isSDRForcedOnHDR || wasGameRenderingHDR != isGameRenderingHDR) {
-						ToggleEnableHDRSubSettings(a_eventData.m_Model, isDisplayModeHDR, isGameRenderingHDR, isSDRForcedOnHDR, *Offsets::uiFrameGenerationTech);
-						CheckCustomToneMapperSettings(a_eventData.m_Model, settings->IsCustomToneMapper());
-					}
-					if (const auto displayModeSetting = a_eventData.m_Model->FindSettingById(static_cast<int>(Settings::SettingID::kDisplayMode))) {
-						displayModeSetting->m_Enabled.SetValue(settings->IsHDRSupported() && !settings->IsSDRForcedOnHDR());
-					}
-					settings->OnDisplayModeChanged();
-				}
+			if (HandleSetting(settings->DisplayMode)) {
+				RefreshSettingsEnableStates(a_eventData.m_Model);
+				settings->OnDisplayModeChanged();
 			}
 			break;
-		case static_cast<int>(Settings::SettingID::kHDR_PeakBrightness):
-			HandleSetting(settings->PeakBrightness);
-			break;
-		case static_cast<int>(Settings::SettingID::kHDR_GamePaperWhite):
-			HandleSetting(settings->GamePaperWhite);
-			break;
-		case static_cast<int>(Settings::SettingID::kHDR_UIPaperWhite):
-			HandleSetting(settings->UIPaperWhite);
-			break;
 		case static_cast<int>(Settings::SettingID::kToneMapperType):
-			HandleSetting(settings->ToneMapperType);
-			CheckCustomToneMapperSettings(a_eventData.m_Model, settings->IsCustomToneMapper());
+			if (HandleSetting(settings->ToneMapperType)) {
+				RefreshSettingsEnableStates(a_eventData.m_Model);
+			}
 			break;
 		case static_cast<int>(Settings::SettingID::kFilmGrainType):
-			HandleSetting(settings->FilmGrainType);
-			if (const auto filmGrainFPSLimit = a_eventData.m_Model->FindSettingById(static_cast<int>(Settings::SettingID::kFilmGrainFPSLimit))) {
-				filmGrainFPSLimit->m_Enabled.SetValue(settings->IsFilmGrainTypeImproved());
+			if (HandleSetting(settings->FilmGrainType)) {
+				RefreshSettingsEnableStates(a_eventData.m_Model);
 			}
 			break;
 		case static_cast<int>(Settings::SettingID::kUpscalingTechnique):
-			auto getUpscalingTechnique = [](int a_settingValue) {
-				switch (a_settingValue) {
-				case 0:  // off
-					return RE::UpscalingTechnique::kNone;
-				case 1:  // CAS
-					return RE::UpscalingTechnique::kCAS;
-				case 2:  // FSR3
-					return RE::UpscalingTechnique::kFSR3;
-				case 3:  // DLSS
-					return RE::UpscalingTechnique::kDLSS;
-				case 4:  // XESS
-					return RE::UpscalingTechnique::kXESS;
-				}
-			};
-			// The settings values haven't changed yet, so compare them for a change
-			const auto prevUpscalingTechnique = *Offsets::uiUpscalingTechnique;
-			const auto newUpscalingTechnique = getUpscalingTechnique(a_eventData.m_Value.Int);
-			// If FG was not engaged, it also won't engage automatically now, thus the swapchain format would have been the one selected by the user and there's no need to refresh it,
-			// and the same applies to the UI settings states toggle.
-			if (prevUpscalingTechnique != newUpscalingTechnique && *Offsets::uiFrameGenerationTech != RE::FrameGenerationTech::kNone) {
-				RE::FrameGenerationTech newFramegenValue;
-				if (newUpscalingTechnique == RE::UpscalingTechnique::kDLSS) {
-					newFramegenValue = RE::FrameGenerationTech::kDLSSG;
-				} else if (newUpscalingTechnique == RE::UpscalingTechnique::kFSR2 || newUpscalingTechnique == RE::UpscalingTechnique::kFSR3) {
-					newFramegenValue = RE::FrameGenerationTech::kFSR3;
-				} else {
-					newFramegenValue = RE::FrameGenerationTech::kNone;
-				}
+			{
+				auto getUpscalingTechnique = [](int a_settingValue) {
+					switch (a_settingValue) {
+					case 0:  // off
+						return RE::UpscalingTechnique::kNone;
+					case 1:  // CAS
+						return RE::UpscalingTechnique::kCAS;
+					case 2:  // FSR3
+						return RE::UpscalingTechnique::kFSR3;
+					case 3:  // DLSS
+						return RE::UpscalingTechnique::kDLSS;
+					case 4:  // XESS
+						return RE::UpscalingTechnique::kXESS;
+					}
+				};
+				// The settings values haven't changed yet, so compare them for a change
+				const auto prevUpscalingTechnique = *Offsets::uiUpscalingTechnique;
+				const auto newUpscalingTechnique = getUpscalingTechnique(a_eventData.m_Value.Int);
+				// If FG was not engaged, it also won't engage automatically now, thus the swapchain format would have been the one selected by the user and there's no need to refresh it,
+				// and the same applies to the UI settings states toggle.
+				if (prevUpscalingTechnique != newUpscalingTechnique && *Offsets::uiFrameGenerationTech != RE::FrameGenerationTech::kNone) {
+					RE::FrameGenerationTech newFramegenValue;
+					if (newUpscalingTechnique == RE::UpscalingTechnique::kDLSS) {
+						newFramegenValue = RE::FrameGenerationTech::kDLSSG;
+					} else if (newUpscalingTechnique == RE::UpscalingTechnique::kFSR2 || newUpscalingTechnique == RE::UpscalingTechnique::kFSR3) {
+						newFramegenValue = RE::FrameGenerationTech::kFSR3;
+					} else {
+						newFramegenValue = RE::FrameGenerationTech::kNone;
+					}
 
-#if !FSR_3_FG_SUPPORTS_UI_PAPER_WHITE
-				ToggleEnableHDRSubSettings(a_eventData.m_Model, settings->IsDisplayModeSetToHDR(), settings->IsGameRenderingSetToHDR(), settings->IsSDRForcedOnHDR(), newFramegenValue);
-#endif
+					RefreshSettingsEnableStates(a_eventData.m_Model, newFramegenValue);
 
-				settings->RefreshSwapchainFormat(newFramegenValue);
+					settings->RefreshSwapchainFormat(newFramegenValue);
+				}
 			}
 		    break;
+		default:
+			// Settings without side effects
+			if (const auto setting = settings->FindSetting<Settings::Stepper>(static_cast<Settings::SettingID>(a_eventData.m_SettingID))) {
+				HandleSetting(*setting);
+			}
+			break;
 		}
 
 		_SettingsDataModelStepperChanged(a_eventData);
@@ -798,11 +811,11 @@ namespace Hooks
 		const auto settings = Settings::Main::GetSingleton();
 
 		auto HandleSetting = [&](Settings::Slider& a_setting) {
-			const auto prevValue = a_setting.value.get_data();
+			const auto prevValue = a_setting.Get();
 			const auto newValue = a_setting.GetValueFromSlider(a_eventData.m_Value.Float);
 
 			if (prevValue != newValue) {
-				*a_setting.value = newValue;
+				a_setting.Set(newValue);
 				settings->Save();
 			}
 
@@ -830,39 +843,9 @@ namespace Hooks
 			}
 		};
 
-		switch (a_eventData.m_SettingID) {
-		case static_cast<int>(Settings::SettingID::kHDR_ExtendGamut):
-			HandleSetting(settings->ExtendGamut);
-			return true;
-		case static_cast<int>(Settings::SettingID::kSecondaryBrightness):
-			HandleSetting(settings->SecondaryBrightness);
-			return true;
-		case static_cast<int>(Settings::SettingID::kToneMapperSaturation):
-			HandleSetting(settings->Saturation);
-			return true;
-		case static_cast<int>(Settings::SettingID::kToneMapperContrast):
-			HandleSetting(settings->Contrast);
-			return true;
-		case static_cast<int>(Settings::SettingID::kToneMapperHighlights):
-			HandleSetting(settings->Highlights);
-			return true;
-		case static_cast<int>(Settings::SettingID::kToneMapperShadows):
-			HandleSetting(settings->Shadows);
-			return true;
-		case static_cast<int>(Settings::SettingID::kToneMapperBloom):
-			HandleSetting(settings->Bloom);
-			return true;
-		case static_cast<int>(Settings::SettingID::kColorGradingStrength):
-			HandleSetting(settings->ColorGradingStrength);
-			return true;
-		case static_cast<int>(Settings::SettingID::kLUTCorrectionStrength):
-			HandleSetting(settings->LUTCorrectionStrength);
-			return true;
-		case static_cast<int>(Settings::SettingID::kGammaCorrectionStrength):
-			HandleSetting(settings->GammaCorrectionStrength);
-			return true;
-		case static_cast<int>(Settings::SettingID::kFilmGrainFPSLimit):
-			HandleSetting(settings->FilmGrainFPSLimit);
+		// None of the sliders have side effects
+		if (const auto setting = settings->FindSetting<Settings::Slider>(static_cast<Settings::SettingID>(a_eventData.m_SettingID))) {
+			HandleSetting(*setting);
 			return true;
 		}
 
@@ -878,6 +861,10 @@ namespace Hooks
 
     bool Hooks::Hook_ApplyRenderPassRenderState1(void* a_arg1, void* a_arg2)
 	{
+#if ENABLE_HOOK_STATISTICS
+		Statistics::HookStatistics::GetSingleton()->GetThreadCounters().AddCall();
+#endif
+
 		const bool result = _ApplyRenderPassRenderState1(a_arg1, a_arg2);
 
 		if (result) {
@@ -889,6 +876,10 @@ namespace Hooks
 
     bool Hooks::Hook_ApplyRenderPassRenderState2(void* a_arg1, void* a_arg2)
     {
+#if ENABLE_HOOK_STATISTICS
+		Statistics::HookStatistics::GetSingleton()->GetThreadCounters().AddCall();
+#endif
+
 		const bool result = _ApplyRenderPassRenderState2(a_arg1, a_arg2);
 
 		if (result) {
@@ -904,19 +895,55 @@ namespace Hooks
 		_EndOfFrame(a1, a2, a3);
     }
 
+#if ENABLE_HOOK_STATISTICS
+	void Hooks::LogHookStatistics()
+	{
+		const auto hookStatistics = Statistics::HookStatistics::GetSingleton();
+		hookStatistics->Aggregate();
+
+		// Once every full history window
+		if (hookStatistics->GetAggregatedFrames() % Statistics::historySize != 0) {
+			return;
+		}
+
+		hookStatistics->ReadHistory([](const Statistics::History& a_history) {
+			const auto average = a_history.GetAverage();
+			const auto max = a_history.GetMax();
+
+			std::string logString = fmt::format("Render pass hook calls per frame (last {} frames): avg {}, max {}, Luma technique matches avg {}\n", a_history.GetCount(), average.calls, max.calls, average.GetTotalMatches());
+			logString.append("Technique, ID, Matches (avg), Matches (max), Upload bytes (avg)\n");
+			for (size_t i = 0; i < Techniques::manifestSize; ++i) {
+				logString.append(fmt::format("{}, {:#x}, {}, {}, {}\n", Techniques::manifest[i].name, Techniques::manifest[i].id, average.matches[i], max.matches[i], average.uploadBytes[i]));
+			}
+
+			INFO(logString)
+		});
+	}
+#endif
+
     void Hooks::Hook_PostEndOfFrame(void* a1)
     {
 		_PostEndOfFrame(a1);
 		Settings::Main::GetSingleton()->SetAtEndOfFrame(false);
 
+		// All the menu state queries done by Luma (including the ones from the render threads) read from this cache
+		Utils::UpdateMenuState();
+		Settings::Main::GetSingleton()->CheckShaderConstantsInputs();
+		Settings::Main::GetSingleton()->UpdatePresetHotkeys();
+
+#if ENABLE_HOOK_STATISTICS
+		LogHookStatistics();
+#endif
+
 		// Hack to refresh the HDR official game graphics settings menu settings when the main or pause menu is first opened,
 		// otherwise if moving the game between SDR and HDR screens, it could end up staying grayed out, or not graying out.
 		// Note that toggling between windowed and borderless also automatically refreshes this as it re-creates the swapchain.
 		static bool wasInPauseMenu = false;
-		if (!wasInPauseMenu && (Utils::IsInPauseMenu() || Utils::IsInMainMenu())) {
+		const bool isInPauseMenu = Utils::IsInPauseMenu() || Utils::IsInMainMenu();
+		if (!wasInPauseMenu && isInPauseMenu) {
 			Settings::Main::GetSingleton()->RefreshHDRDisplaySupportState();
 			wasInPauseMenu = true;
-		} else if (wasInPauseMenu && !(Utils::IsInPauseMenu() || Utils::IsInMainMenu())) {
+		} else if (wasInPauseMenu && !isInPauseMenu) {
 			wasInPauseMenu = false;
 		}
     }
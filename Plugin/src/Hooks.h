@@ -17,24 +17,47 @@ namespace Hooks
 			auto newFormat = settings->GetDisplayModeFormat();
 			Utils::SetBufferFormat(RE::Buffers::FrameBuffer, newFormat);
 
-			for (const auto& renderTargetName : settings->RenderTargetsToUpgrade.get_collection()) {
-				if (const auto buffer = GetBufferFromString(renderTargetName)) {
-					Utils::SetBufferFormat(buffer, RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+			auto GetUpgradeFormat = [&](std::string_view a_renderTargetName) {
+				if (settings->UseRenderTargetFormatPolicies.get_data()) {
+					// A buffer whose requirements its own format already satisfies still needs a real upgrade, for the fix it's listed for
+					const auto buffer = Utils::FindBuffer(a_renderTargetName);
+					const auto currentFormat = buffer ? buffer->format : RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_UNKNOWN_0;
+					if (const auto candidate = Utils::ResolveBufferFormat(Utils::GetBufferFormatRequirements(a_renderTargetName), currentFormat)) {
+						return candidate->format;
+					}
 				}
+				return RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT;
+			};
+
+			// The list order is the priority order, in case not all of them fit in the VRAM budget
+			std::vector<Utils::RenderTargetUpgradeRequest> upgradeRequests;
+			for (const auto& renderTargetName : settings->RenderTargetsToUpgrade.get_collection()) {
+				upgradeRequests.push_back({ renderTargetName, GetUpgradeFormat(renderTargetName) });
 			}
 			if (settings->UpgradeExtraRenderTargets.get_data()) {
 				for (const auto& renderTargetName : settings->ExtraRenderTargetsToUpgrade.get_collection()) {
-					if (const auto buffer = GetBufferFromString(renderTargetName)) {
-						Utils::SetBufferFormat(buffer, RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
-					}
+					upgradeRequests.push_back({ renderTargetName, GetUpgradeFormat(renderTargetName) });
 				}
 			}
 
-			Utils::LogBuffers();
-		}
+			// There's no swapchain yet, so estimate the costs at the primary monitor resolution
+			const Utils::RenderTargetUpgradePlanParams planParams{
+				.width = static_cast<uint32_t>(GetSystemMetrics(SM_CXSCREEN)),
+				.height = static_cast<uint32_t>(GetSystemMetrics(SM_CYSCREEN)),
+				.budgetBytes = static_cast<uint64_t>(std::max(static_cast<int64_t>(settings->RenderTargetsVRAMBudgetMB.get_data()), int64_t(0))) * 1024 * 1024,
+				.getBytesPerPixel = [](RE::BS_DXGI_FORMAT a_format) { return Utils::GetDXGIFormatBitsPerPixel(Offsets::GetDXGIFormat(a_format)) / 8; },
+			};
+			const auto upgradePlan = Utils::PlanRenderTargetUpgrades(upgradeRequests, Utils::GetBufferIndex(), planParams);
+			for (const auto& upgrade : upgradePlan.upgrades) {
+				if (upgrade.bSelected) {
+					Utils::SetBufferFormat(upgrade.buffer, upgrade.toFormat);
+				} else if (upgrade.buffer) {
+					INFO("{} - not upgraded, it doesn't fit in the VRAM budget", upgrade.name)
+				}
+			}
 
-	private:
-		static RE::BufferDefinition* GetBufferFromString(std::string_view a_bufferName);
+			Utils::LogBuffers(&upgradePlan);
+		}
 	};
 
 	class Hooks
@@ -93,8 +116,9 @@ namespace Hooks
 		}
 
 	private:
-		static void ToggleEnableHDRSubSettings(RE::SettingsDataModel* a_model, bool a_bDisplayModeHDREnable, bool a_bGameRenderingHDREnable, bool a_bSDRForcedOnHDR, RE::FrameGenerationTech a_frameGenerationTech);
-		static void CheckCustomToneMapperSettings(RE::SettingsDataModel* a_model, bool a_bIsCustomToneMapper);
+		static RE::SubSettingsList::GeneralSetting* FindSettingHandle(RE::SettingsDataModel* a_model, Settings::SettingID a_id);
+		// Applies the enable states that changed to the game settings menu, the frame generation tech can be passed in if it's about to change
+		static void RefreshSettingsEnableStates(RE::SettingsDataModel* a_model, std::optional<RE::FrameGenerationTech> a_frameGenerationTech = std::nullopt);
 		static void CreateCheckboxSetting(RE::ArrayNestedUIValue<RE::SubSettingsList::GeneralSetting, 0>* a_settingList, Settings::Checkbox& a_setting, bool a_bEnabled);
 		static void CreateStepperSetting(RE::ArrayNestedUIValue<RE::SubSettingsList::GeneralSetting, 0>* a_settingList, Settings::Stepper& a_setting, bool a_bEnabled);
 		static void CreateSliderSetting(RE::ArrayNestedUIValue<RE::SubSettingsList::GeneralSetting, 0>* a_settingList, Settings::Slider& a_setting, bool a_bEnabled);
@@ -102,6 +126,9 @@ namespace Hooks
 		static void CreateSettings(RE::ArrayNestedUIValue<RE::SubSettingsList::GeneralSetting, 0>* a_settingList);
 
 		static void UploadRootConstants(void* a1, void* a2);
+#if ENABLE_HOOK_STATISTICS
+		static void LogHookStatistics();
+#endif
 
 		static void HookedScaleformCompositeRenderPass(void* a1, void* a2, void* a_renderPassData);
 		static inline std::add_pointer_t<decltype(HookedScaleformCompositeRenderPass)> _ScaleformCompositeRenderPass;
@@ -110,6 +137,11 @@ namespace Hooks
 		static void Hook_UnkFunc(uintptr_t a1, RE::BGSSwapChainObject* a_bgsSwapchainObject);
 		static inline std::add_pointer_t<decltype(Hook_UnkFunc)> _UnkFunc;
 
+		// Subclasses the game window, its destruction is where we shut down on a normal exit (the static destructors run under the loader lock, where threads can't be joined)
+		static LRESULT CALLBACK Hook_WndProc(HWND a_hwnd, UINT a_message, WPARAM a_wParam, LPARAM a_lParam);
+		static inline WNDPROC _WndProc = nullptr;
+		static void Shutdown();
+
 		static void Hook_UnkFunc2(uint64_t a1, uint64_t a2);
 		static inline std::add_pointer_t<decltype(Hook_UnkFunc2)> _UnkFunc2;
 
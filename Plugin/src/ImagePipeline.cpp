@@ -0,0 +1,76 @@
+#include "ImagePipeline.h"
+
+namespace Utils
+{
+	bool MemoryImageSource::ReadStrip(size_t a_firstRow, size_t a_rowCount, ImageStrip& a_outStrip)
+	{
+		if (a_firstRow + a_rowCount > info.height) {
+			return false;
+		}
+
+		a_outStrip.pixels = pixels + a_firstRow * rowPitch;
+		a_outStrip.firstRow = a_firstRow;
+		a_outStrip.rowCount = a_rowCount;
+		a_outStrip.rowPitch = rowPitch;
+		return true;
+	}
+
+	size_t ImageTeeSink::GetRowAlignment() const
+	{
+		size_t alignment = 1;
+		for (auto sink : sinks) {
+			alignment = std::lcm(alignment, std::max(sink->GetRowAlignment(), size_t(1)));
+		}
+		return alignment;
+	}
+
+	bool ImageTeeSink::Begin(const ImageInfo& a_info)
+	{
+		return std::ranges::all_of(sinks, [&](auto a_sink) { return a_sink->Begin(a_info); });
+	}
+
+	bool ImageTeeSink::WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		return std::ranges::all_of(sinks, [&](auto a_sink) { return a_sink->WriteStrip(a_strip, a_workers); });
+	}
+
+	bool ImageTeeSink::End()
+	{
+		// Every sink gets to finish its file, even if another one failed
+		bool bResult = true;
+		for (auto sink : sinks) {
+			bResult &= sink->End();
+		}
+		return bResult;
+	}
+
+	bool RunImagePipeline(ImageSource& a_source, std::span<ImageStage* const> a_stages, ImageSink& a_sink, const ImagePipelineParams& a_params)
+	{
+		const ImageInfo info = a_source.GetInfo();
+		if (info.width == 0 || info.height == 0) {
+			return false;
+		}
+
+		const size_t alignment = std::max(a_sink.GetRowAlignment(), size_t(1));
+		const size_t rowsPerStrip = (std::max(a_params.rowsPerStrip, size_t(1)) + alignment - 1) / alignment * alignment;
+
+		if (!a_source.Begin(rowsPerStrip) || !a_sink.Begin(info)) {
+			return false;
+		}
+
+		for (size_t firstRow = 0; firstRow < info.height; firstRow += rowsPerStrip) {
+			ImageStrip strip;
+			if (!a_source.ReadStrip(firstRow, std::min(rowsPerStrip, info.height - firstRow), strip)) {
+				return false;
+			}
+			for (auto stage : a_stages) {
+				stage->ProcessStrip(info, strip, a_params.workers);
+			}
+			if (!a_sink.WriteStrip(strip, a_params.workers)) {
+				return false;
+			}
+		}
+
+		return a_sink.End();
+	}
+}
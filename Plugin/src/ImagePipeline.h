@@ -0,0 +1,102 @@
+#pragma once
+
+#include <dxgiformat.h>
+
+namespace Utils
+{
+	class WorkerPool;
+
+	struct ImageInfo
+	{
+		size_t      width = 0;
+		size_t      height = 0;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	};
+
+	// A band of full rows. The memory belongs to the source and is only valid until it reads the next strip.
+	struct ImageStrip
+	{
+		uint8_t* pixels = nullptr;
+		size_t   firstRow = 0;
+		size_t   rowCount = 0;
+		size_t   rowPitch = 0;
+
+		uint8_t* GetRow(size_t a_y) const { return pixels + (a_y - firstRow) * rowPitch; }
+	};
+
+	// Strips are read in order, from the top
+	class ImageSource
+	{
+	public:
+		virtual ~ImageSource() = default;
+
+		virtual ImageInfo GetInfo() const = 0;
+		// Called once before the first strip, so the source can start fetching ahead
+		virtual bool Begin([[maybe_unused]] size_t a_rowsPerStrip) { return true; }
+		virtual bool ReadStrip(size_t a_firstRow, size_t a_rowCount, ImageStrip& a_outStrip) = 0;
+	};
+
+	// Modifies the strips in place
+	class ImageStage
+	{
+	public:
+		virtual ~ImageStage() = default;
+
+		virtual void ProcessStrip(const ImageInfo& a_info, ImageStrip& a_strip, WorkerPool* a_workers) = 0;
+	};
+
+	class ImageSink
+	{
+	public:
+		virtual ~ImageSink() = default;
+
+		// Strips other than the last one will have a multiple of this many rows
+		virtual size_t GetRowAlignment() const { return 1; }
+
+		virtual bool Begin(const ImageInfo& a_info) = 0;
+		virtual bool WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) = 0;
+		virtual bool End() = 0;
+	};
+
+	// Reads strips straight out of pixels that are already in memory, without copying them
+	class MemoryImageSource : public ImageSource
+	{
+	public:
+		MemoryImageSource(const ImageInfo& a_info, uint8_t* a_pixels, size_t a_rowPitch) :
+			info(a_info), pixels(a_pixels), rowPitch(a_rowPitch) {}
+
+		ImageInfo GetInfo() const override { return info; }
+		bool      ReadStrip(size_t a_firstRow, size_t a_rowCount, ImageStrip& a_outStrip) override;
+
+	private:
+		ImageInfo info;
+		uint8_t*  pixels;
+		size_t    rowPitch;
+	};
+
+	// Writes the same strips to several sinks, so one read of the image can produce several files.
+	// The sinks get the strips in order, and must not modify them.
+	class ImageTeeSink : public ImageSink
+	{
+	public:
+		ImageTeeSink(std::initializer_list<ImageSink*> a_sinks) :
+			sinks(a_sinks) {}
+
+		size_t GetRowAlignment() const override;
+		bool   Begin(const ImageInfo& a_info) override;
+		bool   WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		bool   End() override;
+
+	private:
+		std::vector<ImageSink*> sinks;
+	};
+
+	struct ImagePipelineParams
+	{
+		size_t      rowsPerStrip = 64;  // Rounded up to the row alignment of the sink
+		WorkerPool* workers = nullptr;
+	};
+
+	// Moves the image from the source to the sink one strip at a time, so only a strip has to be in memory at once, instead of the whole image
+	bool RunImagePipeline(ImageSource& a_source, std::span<ImageStage* const> a_stages, ImageSink& a_sink, const ImagePipelineParams& a_params);
+}
@@ -0,0 +1,125 @@
+#include "JpegWriter.h"
+
+#include <DirectXTex.h>
+
+namespace Utils
+{
+	JpegStreamWriter::~JpegStreamWriter()
+	{
+		ReleaseEncoder();
+	}
+
+	void JpegStreamWriter::ReleaseEncoder()
+	{
+		if (frame) {
+			frame->Release();
+			frame = nullptr;
+		}
+		if (encoder) {
+			encoder->Release();
+			encoder = nullptr;
+		}
+		if (stream) {
+			stream->Release();
+			stream = nullptr;
+		}
+	}
+
+	bool JpegStreamWriter::Begin(const ImageInfo& a_info)
+	{
+		ReleaseEncoder();
+		data.clear();
+
+		const bool bGray = a_info.format == DXGI_FORMAT_R8_UNORM;
+		if (!bGray && a_info.format != DXGI_FORMAT_R8G8B8A8_UNORM && a_info.format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) {
+			return false;
+		}
+		info = a_info;
+
+		bool                iswic2 = false;
+		IWICImagingFactory* factory = DirectX::GetWICFactory(iswic2);
+		if (!factory || FAILED(CreateStreamOnHGlobal(nullptr, TRUE, &stream)) ||
+			FAILED(factory->CreateEncoder(GUID_ContainerFormatJpeg, nullptr, &encoder)) ||
+			FAILED(encoder->Initialize(stream, WICBitmapEncoderNoCache))) {
+			return false;
+		}
+
+		IPropertyBag2* properties = nullptr;
+		if (FAILED(encoder->CreateNewFrame(&frame, &properties))) {
+			return false;
+		}
+		PROPBAG2 option = {};
+		option.pstrName = const_cast<wchar_t*>(L"ImageQuality");
+		VARIANT value = {};
+		value.vt = VT_R4;
+		value.fltVal = params.quality;
+		std::ignore = properties->Write(1, &option, &value);
+		const HRESULT result = frame->Initialize(properties);
+		properties->Release();
+
+		const WICPixelFormatGUID stripFormat = bGray ? GUID_WICPixelFormat8bppGray : GUID_WICPixelFormat24bppBGR;
+		WICPixelFormatGUID       pixelFormat = stripFormat;
+		if (FAILED(result) || FAILED(frame->SetSize(static_cast<UINT>(info.width), static_cast<UINT>(info.height))) || FAILED(frame->SetPixelFormat(&pixelFormat))) {
+			return false;
+		}
+		// WIC changes it to the closest one the encoder supports, the strips would have to be converted to that
+		return pixelFormat == stripFormat;
+	}
+
+	bool JpegStreamWriter::WriteStrip(const ImageStrip& a_strip, [[maybe_unused]] WorkerPool* a_workers)
+	{
+		if (!frame) {
+			return false;
+		}
+
+		// Rows are appended to the frame, so each call continues where the last one stopped
+		if (info.format == DXGI_FORMAT_R8_UNORM) {
+			const UINT size = static_cast<UINT>(a_strip.rowPitch * (a_strip.rowCount - 1) + info.width);
+			return SUCCEEDED(frame->WritePixels(static_cast<UINT>(a_strip.rowCount), static_cast<UINT>(a_strip.rowPitch), size, a_strip.pixels));
+		}
+
+		const size_t rowSize = info.width * 3;
+		convertedStrip.resize(rowSize * a_strip.rowCount);
+		for (size_t y = 0; y < a_strip.rowCount; ++y) {
+			const uint8_t* row = a_strip.pixels + y * a_strip.rowPitch;
+			uint8_t*       outRow = convertedStrip.data() + y * rowSize;
+			for (size_t x = 0; x < info.width; ++x) {
+				outRow[x * 3 + 0] = row[x * 4 + 2];
+				outRow[x * 3 + 1] = row[x * 4 + 1];
+				outRow[x * 3 + 2] = row[x * 4 + 0];
+			}
+		}
+		return SUCCEEDED(frame->WritePixels(static_cast<UINT>(a_strip.rowCount), static_cast<UINT>(rowSize), static_cast<UINT>(convertedStrip.size()), convertedStrip.data()));
+	}
+
+	bool JpegStreamWriter::End()
+	{
+		convertedStrip = {};
+		if (!frame || FAILED(frame->Commit()) || FAILED(encoder->Commit())) {
+			ReleaseEncoder();
+			return false;
+		}
+
+		STATSTG                 stat = {};
+		constexpr LARGE_INTEGER start = {};
+		bool                    bSuccess = SUCCEEDED(stream->Stat(&stat, STATFLAG_NONAME)) && SUCCEEDED(stream->Seek(start, STREAM_SEEK_SET, nullptr));
+		if (bSuccess) {
+			data.resize(static_cast<size_t>(stat.cbSize.QuadPart));
+			ULONG readSize = 0;
+			bSuccess = SUCCEEDED(stream->Read(data.data(), static_cast<ULONG>(data.size()), &readSize)) && readSize == data.size();
+		}
+		ReleaseEncoder();
+		return bSuccess;
+	}
+
+	bool EncodeJpeg(const ImageInfo& a_info, uint8_t* a_pixels, size_t a_rowPitch, const JpegWriteParams& a_params, std::vector<uint8_t>& a_outData)
+	{
+		MemoryImageSource source(a_info, a_pixels, a_rowPitch);
+		JpegStreamWriter  writer(a_params);
+		if (!RunImagePipeline(source, {}, writer, { .rowsPerStrip = a_info.height })) {
+			return false;
+		}
+		a_outData = writer.GetData();
+		return true;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "ImagePipeline.h"
+
+#include <wincodec.h>
+
+namespace Utils
+{
+	struct JpegWriteParams
+	{
+		float quality = 0.95f;  // WIC "ImageQuality", 0-1
+	};
+
+	// Encodes RGBA8 strips (as RGB, the alpha is dropped) or R8 ones (as grayscale) with WIC as they come in, so the pixels are never in memory all at once.
+	// The file is written to memory, so metadata can be inserted into it after (see "WriteGainMapJpeg()"). It's much smaller than the pixels.
+	class JpegStreamWriter : public ImageSink
+	{
+	public:
+		explicit JpegStreamWriter(const JpegWriteParams& a_params) :
+			params(a_params) {}
+		~JpegStreamWriter() override;
+
+		JpegStreamWriter(const JpegStreamWriter&) = delete;
+		JpegStreamWriter& operator=(const JpegStreamWriter&) = delete;
+
+		bool Begin(const ImageInfo& a_info) override;
+		bool WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		bool End() override;
+
+		// The encoded file, once "End()" succeeded
+		const std::vector<uint8_t>& GetData() const { return data; }
+
+	private:
+		void ReleaseEncoder();
+
+		JpegWriteParams        params;
+		ImageInfo              info;
+		IStream*               stream = nullptr;
+		IWICBitmapEncoder*     encoder = nullptr;
+		IWICBitmapFrameEncode* frame = nullptr;
+		std::vector<uint8_t>   convertedStrip;  // BGR8, what the WIC JPEG encoder takes without converting
+		std::vector<uint8_t>   data;
+	};
+
+	// Encodes an image that's already in memory, e.g. a gain map
+	bool EncodeJpeg(const ImageInfo& a_info, uint8_t* a_pixels, size_t a_rowPitch, const JpegWriteParams& a_params, std::vector<uint8_t>& a_outData);
+}
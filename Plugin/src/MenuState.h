@@ -0,0 +1,74 @@
+#pragma once
+
+namespace MenuState
+{
+	// The menus that affect Luma's behaviour. The order needs to match the names in "Utils::GameMenuSource".
+	enum class Menu : uint32_t
+	{
+		kInventoryMenu,
+		kContainerMenu,
+		kBarterMenu,
+		kGalaxyStarMapMenu,
+		kSpaceshipEditorMenu,
+		kDataMenu,
+		kPauseMenu,
+		kMainMenu,
+
+		kCount
+	};
+	static_assert(static_cast<uint32_t>(Menu::kCount) <= 32);
+
+	constexpr uint32_t MenuBit(Menu a_menu) { return 1u << static_cast<uint32_t>(a_menu); }
+
+	// Where the open state of menus comes from. The game UI implements it, but anything else can (e.g. a fake UI).
+	class IMenuSource
+	{
+	public:
+		virtual ~IMenuSource() = default;
+		virtual bool IsMenuOpen(Menu a_menu) const = 0;
+	};
+
+	// Keeps the open state of all the menus we care about in a bitset, so that querying it from any thread is a single atomic load.
+	// It's meant to be updated once per frame, querying the UI directly is too slow to be done per draw.
+	class Tracker
+	{
+	public:
+		// Returns whether any menu state changed since the last update
+		bool Update(const IMenuSource& a_source)
+		{
+			uint32_t newOpenMenus = 0;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(Menu::kCount); ++i) {
+				if (a_source.IsMenuOpen(static_cast<Menu>(i))) {
+					newOpenMenus |= MenuBit(static_cast<Menu>(i));
+				}
+			}
+			return openMenus.exchange(newOpenMenus, std::memory_order_release) != newOpenMenus;
+		}
+
+		uint32_t GetOpenMenus() const { return openMenus.load(std::memory_order_acquire); }
+		bool     IsMenuOpen(Menu a_menu) const { return (GetOpenMenus() & MenuBit(a_menu)) != 0; }
+
+		bool ShouldCorrectLUTs() const { return ShouldCorrectLUTs(GetOpenMenus()); }
+		bool IsInPauseMenu() const { return IsMenuOpen(Menu::kPauseMenu); }
+		bool IsInMainMenu() const { return IsMenuOpen(Menu::kMainMenu); }
+
+		static constexpr bool ShouldCorrectLUTs(uint32_t a_openMenus)
+		{
+			// make sure we don't correct luts in inventory/container menus
+			if (a_openMenus & (MenuBit(Menu::kInventoryMenu) | MenuBit(Menu::kContainerMenu) | MenuBit(Menu::kBarterMenu))) {
+				return false;
+			}
+
+			// make sure we do correct luts in galaxy and spaceship/starship menus (they both look ok, or better, with correction), even though DataMenu is in the menu stack
+			if (a_openMenus & (MenuBit(Menu::kGalaxyStarMapMenu) | MenuBit(Menu::kSpaceshipEditorMenu))) {
+				return true;
+			}
+
+			// fallback to not correcting luts generally while data menu is in the stack
+			return (a_openMenus & MenuBit(Menu::kDataMenu)) == 0;
+		}
+
+	private:
+		std::atomic_uint32_t openMenus = 0;
+	};
+}
@@ -0,0 +1,483 @@
+#include "PngWriter.h"
+#include "WorkerPool.h"
+
+#include <zlib.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define PNG_WRITER_SSE2
+#endif
+
+namespace Utils
+{
+	namespace
+	{
+		constexpr size_t bytesPerPixel = 3;  // RGB8
+
+		enum PngFilter : uint8_t
+		{
+			kNone = 0,
+			kSub = 1,
+			kUp = 2,
+			kAverage = 3,
+			kPaeth = 4,
+
+			kCount
+		};
+
+		// Rows are stored after "bytesPerPixel" zeroes, so the left neighbour of the first pixel can be read like any other
+		class RowBuffer
+		{
+		public:
+			explicit RowBuffer(size_t a_rowSize) :
+				data(a_rowSize + bytesPerPixel, 0) {}
+
+			uint8_t*       Get() { return data.data() + bytesPerPixel; }
+			const uint8_t* Get() const { return data.data() + bytesPerPixel; }
+
+		private:
+			std::vector<uint8_t> data;
+		};
+
+		// Converts a source row to RGB8
+		void ReadRow(const uint8_t* a_source, size_t a_width, PngSourceLayout a_layout, uint8_t* a_outRow)
+		{
+			if (a_layout == PngSourceLayout::kRGB10A2) {
+				for (size_t x = 0; x < a_width; ++x) {
+					uint32_t packed;
+					std::memcpy(&packed, a_source + x * 4, sizeof(packed));
+					for (size_t channel = 0; channel < 3; ++channel) {
+						a_outRow[x * 3 + channel] = static_cast<uint8_t>((((packed >> (channel * 10)) & 0x3FF) * 255 + 511) / 1023);
+					}
+				}
+				return;
+			}
+
+			const bool bSwapRB = a_layout == PngSourceLayout::kBGRA8;
+			for (size_t x = 0; x < a_width; ++x) {
+				a_outRow[x * 3 + 0] = a_source[x * 4 + (bSwapRB ? 2 : 0)];
+				a_outRow[x * 3 + 1] = a_source[x * 4 + 1];
+				a_outRow[x * 3 + 2] = a_source[x * 4 + (bSwapRB ? 0 : 2)];
+			}
+		}
+
+		uint8_t PaethPredictor(int a_left, int a_up, int a_upLeft)
+		{
+			const int leftDistance = std::abs(a_up - a_upLeft);
+			const int upDistance = std::abs(a_left - a_upLeft);
+			const int upLeftDistance = std::abs(a_left + a_up - 2 * a_upLeft);
+			if (leftDistance <= upDistance && leftDistance <= upLeftDistance) {
+				return static_cast<uint8_t>(a_left);
+			}
+			return static_cast<uint8_t>(upDistance <= upLeftDistance ? a_up : a_upLeft);
+		}
+
+		// Filters the bytes from "a_begin" onwards without vectors, for the tail of the row or when SSE2 isn't there
+		void FilterRowScalar(PngFilter a_filter, const uint8_t* a_row, const uint8_t* a_previousRow, size_t a_begin, size_t a_end, uint8_t* a_outRow)
+		{
+			for (size_t i = a_begin; i < a_end; ++i) {
+				const int left = a_row[static_cast<ptrdiff_t>(i) - static_cast<ptrdiff_t>(bytesPerPixel)];
+				const int up = a_previousRow[i];
+				const int upLeft = a_previousRow[static_cast<ptrdiff_t>(i) - static_cast<ptrdiff_t>(bytesPerPixel)];
+				uint8_t   prediction = 0;
+				switch (a_filter) {
+				case kSub:
+					prediction = static_cast<uint8_t>(left);
+					break;
+				case kUp:
+					prediction = static_cast<uint8_t>(up);
+					break;
+				case kAverage:
+					prediction = static_cast<uint8_t>((left + up) >> 1);
+					break;
+				case kPaeth:
+					prediction = PaethPredictor(left, up, upLeft);
+					break;
+				default:
+					break;
+				}
+				a_outRow[i] = static_cast<uint8_t>(a_row[i] - prediction);
+			}
+		}
+
+#ifdef PNG_WRITER_SSE2
+		__m128i PaethPredictorSSE2(__m128i a_left, __m128i a_up, __m128i a_upLeft)
+		{
+			const __m128i leftDelta = _mm_sub_epi16(a_up, a_upLeft);
+			const __m128i upDelta = _mm_sub_epi16(a_left, a_upLeft);
+			const __m128i leftDistance = _mm_max_epi16(leftDelta, _mm_sub_epi16(_mm_setzero_si128(), leftDelta));
+			const __m128i upDistance = _mm_max_epi16(upDelta, _mm_sub_epi16(_mm_setzero_si128(), upDelta));
+			const __m128i upLeftDelta = _mm_add_epi16(leftDelta, upDelta);
+			const __m128i upLeftDistance = _mm_max_epi16(upLeftDelta, _mm_sub_epi16(_mm_setzero_si128(), upLeftDelta));
+
+			const __m128i bNotLeft = _mm_or_si128(_mm_cmpgt_epi16(leftDistance, upDistance), _mm_cmpgt_epi16(leftDistance, upLeftDistance));
+			const __m128i bUpLeft = _mm_cmpgt_epi16(upDistance, upLeftDistance);
+			const __m128i upOrUpLeft = _mm_or_si128(_mm_and_si128(bUpLeft, a_upLeft), _mm_andnot_si128(bUpLeft, a_up));
+			return _mm_or_si128(_mm_and_si128(bNotLeft, upOrUpLeft), _mm_andnot_si128(bNotLeft, a_left));
+		}
+
+		// Returns how many bytes were filtered, the rest is left to the scalar version
+		size_t FilterRowSSE2(PngFilter a_filter, const uint8_t* a_row, const uint8_t* a_previousRow, size_t a_rowSize, uint8_t* a_outRow)
+		{
+			const size_t vectorSize = a_rowSize & ~size_t(15);
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i one = _mm_set1_epi8(1);
+			for (size_t i = 0; i < vectorSize; i += 16) {
+				const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + i));
+				const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + i - bytesPerPixel));
+				const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_previousRow + i));
+				__m128i       prediction = zero;
+				switch (a_filter) {
+				case kSub:
+					prediction = left;
+					break;
+				case kUp:
+					prediction = up;
+					break;
+				case kAverage:
+					// "_mm_avg_epu8()" rounds up, PNG rounds down
+					prediction = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+					break;
+				case kPaeth:
+					{
+						const __m128i upLeft = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_previousRow + i - bytesPerPixel));
+						const __m128i low = PaethPredictorSSE2(_mm_unpacklo_epi8(left, zero), _mm_unpacklo_epi8(up, zero), _mm_unpacklo_epi8(upLeft, zero));
+						const __m128i high = PaethPredictorSSE2(_mm_unpackhi_epi8(left, zero), _mm_unpackhi_epi8(up, zero), _mm_unpackhi_epi8(upLeft, zero));
+						prediction = _mm_packus_epi16(low, high);
+						break;
+					}
+				default:
+					break;
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(a_outRow + i), _mm_sub_epi8(current, prediction));
+			}
+			return vectorSize;
+		}
+
+		// Sum of the filtered bytes read as signed, the usual heuristic for picking the filter
+		uint64_t GetFilteredRowCost(const uint8_t* a_filteredRow, size_t a_rowSize)
+		{
+			const size_t vectorSize = a_rowSize & ~size_t(15);
+			const __m128i zero = _mm_setzero_si128();
+			__m128i       sums = zero;
+			for (size_t i = 0; i < vectorSize; i += 16) {
+				const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_filteredRow + i));
+				const __m128i magnitudes = _mm_min_epu8(bytes, _mm_sub_epi8(zero, bytes));
+				sums = _mm_add_epi64(sums, _mm_sad_epu8(magnitudes, zero));
+			}
+			alignas(16) uint64_t laneSums[2];
+			_mm_store_si128(reinterpret_cast<__m128i*>(laneSums), sums);
+			uint64_t cost = laneSums[0] + laneSums[1];
+			for (size_t i = vectorSize; i < a_rowSize; ++i) {
+				cost += std::min<uint32_t>(a_filteredRow[i], 256 - a_filteredRow[i]);
+			}
+			return cost;
+		}
+#else
+		uint64_t GetFilteredRowCost(const uint8_t* a_filteredRow, size_t a_rowSize)
+		{
+			uint64_t cost = 0;
+			for (size_t i = 0; i < a_rowSize; ++i) {
+				cost += std::min<uint32_t>(a_filteredRow[i], 256 - a_filteredRow[i]);
+			}
+			return cost;
+		}
+#endif
+
+		void FilterRow(PngFilter a_filter, const uint8_t* a_row, const uint8_t* a_previousRow, size_t a_rowSize, uint8_t* a_outRow)
+		{
+			if (a_filter == kNone) {
+				std::memcpy(a_outRow, a_row, a_rowSize);
+				return;
+			}
+			size_t begin = 0;
+#ifdef PNG_WRITER_SSE2
+			begin = FilterRowSSE2(a_filter, a_row, a_previousRow, a_rowSize, a_outRow);
+#endif
+			FilterRowScalar(a_filter, a_row, a_previousRow, begin, a_rowSize, a_outRow);
+		}
+
+		struct CompressedBand
+		{
+			std::vector<uint8_t> data;
+			uLong                adler = 0;
+			size_t               uncompressedSize = 0;
+			bool                 bSuccess = false;
+		};
+
+		// Filters and deflates rows [a_firstRow, a_endRow) of the strip. "a_previousRow" is the RGB row above the strip, or null if it's at the top of the image.
+		// Rows above the band but inside of the strip are read from the strip.
+		void CompressBand(const ImageStrip& a_strip, size_t a_width, PngSourceLayout a_layout, const PngWriteParams& a_params, const uint8_t* a_previousRow, size_t a_firstRow, size_t a_endRow, CompressedBand& a_outBand)
+		{
+			const size_t rowSize = a_width * bytesPerPixel;
+			const size_t filteredRowSize = rowSize + 1;
+
+			RowBuffer previousRow(rowSize);
+			RowBuffer row(rowSize);
+			if (a_firstRow > a_strip.firstRow) {
+				ReadRow(a_strip.GetRow(a_firstRow - 1), a_width, a_layout, previousRow.Get());
+			} else if (a_previousRow) {
+				std::memcpy(previousRow.Get(), a_previousRow, rowSize);
+			}
+
+			std::vector<uint8_t> filtered((a_endRow - a_firstRow) * filteredRowSize);
+			std::vector<uint8_t> candidates[kCount];
+			for (auto& candidate : candidates) {
+				candidate.resize(rowSize);
+			}
+
+			for (size_t y = a_firstRow; y < a_endRow; ++y) {
+				ReadRow(a_strip.GetRow(y), a_width, a_layout, row.Get());
+				if (a_params.onRowRead) {
+					a_params.onRowRead(y, a_strip.GetRow(y));
+				}
+
+				PngFilter bestFilter = kNone;
+				uint64_t  bestCost = std::numeric_limits<uint64_t>::max();
+				for (uint8_t filter = kNone; filter < kCount; ++filter) {
+					FilterRow(static_cast<PngFilter>(filter), row.Get(), previousRow.Get(), rowSize, candidates[filter].data());
+					const uint64_t cost = GetFilteredRowCost(candidates[filter].data(), rowSize);
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestFilter = static_cast<PngFilter>(filter);
+					}
+				}
+
+				uint8_t* filteredRow = filtered.data() + (y - a_firstRow) * filteredRowSize;
+				filteredRow[0] = bestFilter;
+				std::memcpy(filteredRow + 1, candidates[bestFilter].data(), rowSize);
+
+				std::swap(row, previousRow);
+			}
+
+			z_stream stream{};
+			if (deflateInit2(&stream, a_params.compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+				return;
+			}
+
+			// The sync flush ends the band on a byte boundary with an empty stored block, so the next one can follow it directly
+			a_outBand.data.resize(deflateBound(&stream, static_cast<uLong>(filtered.size())) + 16);
+			stream.next_in = filtered.data();
+			stream.avail_in = static_cast<uInt>(filtered.size());
+			stream.next_out = a_outBand.data.data();
+			stream.avail_out = static_cast<uInt>(a_outBand.data.size());
+			const int result = deflate(&stream, Z_SYNC_FLUSH);
+			a_outBand.bSuccess = result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0;
+			a_outBand.data.resize(stream.total_out);
+			deflateEnd(&stream);
+
+			a_outBand.adler = adler32(adler32(0, Z_NULL, 0), filtered.data(), static_cast<uInt>(filtered.size()));
+			a_outBand.uncompressedSize = filtered.size();
+		}
+
+		// The final deflate block, with no data, as the bands can't know they are the last one
+		bool GetFinalDeflateBlock(int a_compressionLevel, std::vector<uint8_t>& a_outData)
+		{
+			z_stream stream{};
+			if (deflateInit2(&stream, a_compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+				return false;
+			}
+			a_outData.resize(16);
+			stream.next_out = a_outData.data();
+			stream.avail_out = static_cast<uInt>(a_outData.size());
+			const bool bSuccess = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+			a_outData.resize(stream.total_out);
+			deflateEnd(&stream);
+			return bSuccess;
+		}
+
+		DXGI_FORMAT GetDXGIFormat(PngSourceLayout a_layout)
+		{
+			switch (a_layout) {
+			case PngSourceLayout::kBGRA8:
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			case PngSourceLayout::kRGB10A2:
+				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			default:
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+		}
+
+		void AppendBigEndian(std::vector<uint8_t>& a_data, uint32_t a_value)
+		{
+			a_data.push_back(static_cast<uint8_t>(a_value >> 24));
+			a_data.push_back(static_cast<uint8_t>(a_value >> 16));
+			a_data.push_back(static_cast<uint8_t>(a_value >> 8));
+			a_data.push_back(static_cast<uint8_t>(a_value));
+		}
+
+		void AppendChunk(std::vector<uint8_t>& a_data, const char (&a_type)[5], std::initializer_list<std::span<const uint8_t>> a_parts)
+		{
+			size_t size = 0;
+			for (const auto& part : a_parts) {
+				size += part.size();
+			}
+			AppendBigEndian(a_data, static_cast<uint32_t>(size));
+
+			const size_t typeOffset = a_data.size();
+			a_data.insert(a_data.end(), a_type, a_type + 4);
+			for (const auto& part : a_parts) {
+				a_data.insert(a_data.end(), part.begin(), part.end());
+			}
+			AppendBigEndian(a_data, crc32(crc32(0, Z_NULL, 0), a_data.data() + typeOffset, static_cast<uInt>(a_data.size() - typeOffset)));
+		}
+	}
+
+	std::optional<PngSourceLayout> GetPngSourceLayout(DXGI_FORMAT a_format)
+	{
+		switch (a_format) {
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			return PngSourceLayout::kRGBA8;
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+			return PngSourceLayout::kBGRA8;
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+			return PngSourceLayout::kRGB10A2;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	PngStreamWriter::PngStreamWriter(std::ostream& a_stream, const PngWriteParams& a_params) :
+		stream(a_stream), params(a_params)
+	{}
+
+	bool PngStreamWriter::Begin(const ImageInfo& a_info)
+	{
+		const auto sourceLayout = GetPngSourceLayout(a_info.format);
+		if (!sourceLayout || a_info.width == 0 || a_info.height == 0 || a_info.width > 0x7FFFFFFF || a_info.height > 0x7FFFFFFF) {
+			return false;
+		}
+
+		info = a_info;
+		layout = *sourceLayout;
+		previousRow.clear();
+		adler = static_cast<uint32_t>(adler32(0, Z_NULL, 0));
+		bZlibHeaderWritten = false;
+
+		std::vector<uint8_t> data;
+		constexpr uint8_t    signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		data.insert(data.end(), std::begin(signature), std::end(signature));
+
+		std::vector<uint8_t> header;
+		AppendBigEndian(header, static_cast<uint32_t>(info.width));
+		AppendBigEndian(header, static_cast<uint32_t>(info.height));
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8 bit, RGB, deflate, adaptive filtering, not interlaced
+		AppendChunk(data, "IHDR", { header });
+
+		if (params.bSRGB) {
+			constexpr uint8_t perceptualIntent[] = { 0 };
+			AppendChunk(data, "sRGB", { perceptualIntent });
+		}
+
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return stream.good();
+	}
+
+	bool PngStreamWriter::WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		const size_t filteredRowSize = info.width * bytesPerPixel + 1;
+		const size_t threadCount = a_workers ? a_workers->GetThreadCount() + 1 : 1;
+		size_t       rowsPerBand = params.rowsPerBlock;
+		if (rowsPerBand == 0) {
+			// A couple of bands per thread so they even out, but not so small that starting each without a dictionary costs much
+			constexpr size_t minBandSize = 64 * 1024;
+			rowsPerBand = std::max((a_strip.rowCount + threadCount * 2 - 1) / (threadCount * 2), (minBandSize + filteredRowSize - 1) / filteredRowSize);
+		}
+		const size_t bandCount = (a_strip.rowCount + rowsPerBand - 1) / rowsPerBand;
+
+		std::vector<CompressedBand> bands(bandCount);
+		const uint8_t*              aboveStrip = previousRow.empty() ? nullptr : previousRow.data();
+		auto compressBands = [&](size_t a_begin, size_t a_end) {
+			for (size_t i = a_begin; i < a_end; ++i) {
+				const size_t firstRow = a_strip.firstRow + i * rowsPerBand;
+				const size_t endRow = std::min(firstRow + rowsPerBand, a_strip.firstRow + a_strip.rowCount);
+				CompressBand(a_strip, info.width, layout, params, aboveStrip, firstRow, endRow, bands[i]);
+			}
+		};
+		if (a_workers) {
+			a_workers->ParallelFor(bandCount, compressBands);
+		} else {
+			compressBands(0, bandCount);
+		}
+
+		// Every band goes in its own IDAT, the first one of the image also carries the zlib header
+		std::vector<uint8_t> data;
+		for (const auto& band : bands) {
+			if (!band.bSuccess) {
+				return false;
+			}
+			adler = static_cast<uint32_t>(adler32_combine(adler, band.adler, static_cast<z_off_t>(band.uncompressedSize)));
+
+			uint8_t                  zlibHeader[2];
+			std::span<const uint8_t> prefix;
+			if (!bZlibHeaderWritten) {
+				const int     level = params.compressionLevel;
+				const uint8_t compressionInfo = 0x78;  // Deflate with a 32KB window
+				uint8_t       flags = static_cast<uint8_t>((level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6);
+				zlibHeader[0] = compressionInfo;
+				zlibHeader[1] = static_cast<uint8_t>(flags + 31 - ((compressionInfo << 8) + flags) % 31);
+				prefix = zlibHeader;
+				bZlibHeaderWritten = true;
+			}
+			AppendChunk(data, "IDAT", { prefix, band.data });
+		}
+
+		// The next strip filters its first row against the last one of this strip
+		previousRow.resize(info.width * bytesPerPixel);
+		ReadRow(a_strip.GetRow(a_strip.firstRow + a_strip.rowCount - 1), info.width, layout, previousRow.data());
+
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return stream.good();
+	}
+
+	bool PngStreamWriter::End()
+	{
+		std::vector<uint8_t> finalBlock;
+		if (!bZlibHeaderWritten || !GetFinalDeflateBlock(params.compressionLevel, finalBlock)) {
+			return false;
+		}
+
+		std::vector<uint8_t> checksum;
+		AppendBigEndian(checksum, adler);
+
+		std::vector<uint8_t> data;
+		AppendChunk(data, "IDAT", { finalBlock, checksum });
+		AppendChunk(data, "IEND", {});
+
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		stream.flush();
+		return stream.good();
+	}
+
+	bool EncodePng(const PngSourceImage& a_image, const PngWriteParams& a_params, std::vector<uint8_t>& a_outData)
+	{
+		std::ostringstream stream(std::ios::binary);
+		if (!WritePng(stream, a_image, a_params)) {
+			return false;
+		}
+		const std::string data = std::move(stream).str();
+		a_outData.assign(data.begin(), data.end());
+		return true;
+	}
+
+	bool WritePng(std::ostream& a_stream, const PngSourceImage& a_image, const PngWriteParams& a_params)
+	{
+		if (!a_image.pixels) {
+			return false;
+		}
+
+		// There are no stages, so the pixels aren't modified
+		MemoryImageSource source({ a_image.width, a_image.height, GetDXGIFormat(a_image.layout) }, const_cast<uint8_t*>(a_image.pixels), a_image.rowPitch);
+		PngStreamWriter   writer(a_stream, a_params);
+		return RunImagePipeline(source, {}, writer, { .rowsPerStrip = a_params.rowsPerStrip, .workers = a_params.workers });
+	}
+
+	bool WritePng(const std::filesystem::path& a_path, const PngSourceImage& a_image, const PngWriteParams& a_params)
+	{
+		std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+		return file && WritePng(file, a_image, a_params);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ImagePipeline.h"
+
+namespace Utils
+{
+	class WorkerPool;
+
+	enum class PngSourceLayout
+	{
+		kRGBA8,
+		kBGRA8,
+		kRGB10A2  // Rounded to 8 bit
+	};
+
+	std::optional<PngSourceLayout> GetPngSourceLayout(DXGI_FORMAT a_format);
+
+	// 32 bit pixels, read in place. Alpha isn't written, as the back buffer doesn't have a meaningful one.
+	struct PngSourceImage
+	{
+		const uint8_t*  pixels = nullptr;
+		size_t          width = 0;
+		size_t          height = 0;
+		size_t          rowPitch = 0;
+		PngSourceLayout layout = PngSourceLayout::kRGBA8;
+	};
+
+	struct PngWriteParams
+	{
+		int         compressionLevel = 6;  // zlib level, 1-9
+		bool        bSRGB = true;          // Writes the sRGB chunk
+		size_t      rowsPerBlock = 0;      // Rows per band within a strip, 0 picks a size that leaves enough bands to spread between the workers
+		size_t      rowsPerStrip = 256;    // Only used by "EncodePng()" and "WritePng()", which read the image through "RunImagePipeline()"
+		WorkerPool* workers = nullptr;     // Compresses the bands on the calling thread only if null
+
+		// Called once for every source row, from the thread compressing it, so other passes over the image can share the read (e.g. the thumbnail)
+		std::function<void(size_t a_y, const uint8_t* a_row)> onRowRead;
+	};
+
+	// Filters and deflates bands of rows independently, then joins them into a single zlib stream, the way pigz does.
+	// Each band starts without the previous one as a dictionary, which costs a little compression for a lot of speed.
+	// Every strip is written out as soon as it's compressed, so neither the whole image nor the whole file have to be in memory.
+	class PngStreamWriter : public ImageSink
+	{
+	public:
+		PngStreamWriter(std::ostream& a_stream, const PngWriteParams& a_params);
+
+		bool Begin(const ImageInfo& a_info) override;
+		bool WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		bool End() override;
+
+	private:
+		std::ostream&        stream;
+		PngWriteParams       params;
+		ImageInfo            info;
+		PngSourceLayout      layout = PngSourceLayout::kRGBA8;
+		std::vector<uint8_t> previousRow;  // The last row of the previous strip, as RGB8
+		uint32_t             adler = 1;  // Of the filtered rows written so far
+		bool                 bZlibHeaderWritten = false;
+	};
+
+	bool EncodePng(const PngSourceImage& a_image, const PngWriteParams& a_params, std::vector<uint8_t>& a_outData);
+	bool WritePng(std::ostream& a_stream, const PngSourceImage& a_image, const PngWriteParams& a_params);
+	bool WritePng(const std::filesystem::path& a_path, const PngSourceImage& a_image, const PngWriteParams& a_params);
+}
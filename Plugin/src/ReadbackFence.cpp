@@ -0,0 +1,45 @@
+#include "ReadbackFence.h"
+
+namespace Utils
+{
+	FenceCompletionSource::FenceCompletionSource(ID3D12CommandQueue* a_queue, ID3D12Fence* a_fence) :
+		queue(a_queue), fence(a_fence)
+	{
+		queue->AddRef();
+	}
+
+	FenceCompletionSource::~FenceCompletionSource()
+	{
+		fence->Release();
+		queue->Release();
+	}
+
+	std::unique_ptr<FenceCompletionSource> FenceCompletionSource::Create(ID3D12Device* a_device, ID3D12CommandQueue* a_queue)
+	{
+		if (!a_device || !a_queue) {
+			return nullptr;
+		}
+
+		ID3D12Fence* fence = nullptr;
+		if (FAILED(a_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+			return nullptr;
+		}
+		return std::unique_ptr<FenceCompletionSource>(new FenceCompletionSource(a_queue, fence));
+	}
+
+	uint64_t FenceCompletionSource::Signal()
+	{
+		const uint64_t value = lastSignaledValue + 1;
+		if (FAILED(queue->Signal(fence, value))) {
+			// The value will never be reached, but the readback would never complete either. Waiting for everything submitted before is the best we can do.
+			return lastSignaledValue;
+		}
+		lastSignaledValue = value;
+		return value;
+	}
+
+	bool FenceCompletionSource::IsComplete(uint64_t a_token) const
+	{
+		return fence->GetCompletedValue() >= a_token;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "ReadbackScheduler.h"
+
+#include <d3d12.h>
+
+namespace Utils
+{
+	// Signals a fence on the command queue the readback copies are executed on
+	class FenceCompletionSource : public ReadbackCompletionSource
+	{
+	public:
+		~FenceCompletionSource() override;
+
+		// Returns nullptr if the fence couldn't be created
+		static std::unique_ptr<FenceCompletionSource> Create(ID3D12Device* a_device, ID3D12CommandQueue* a_queue);
+
+		uint64_t Signal() override;
+		bool IsComplete(uint64_t a_token) const override;
+
+	private:
+		FenceCompletionSource(ID3D12CommandQueue* a_queue, ID3D12Fence* a_fence);
+
+		ID3D12CommandQueue* queue;
+		ID3D12Fence*        fence;
+		uint64_t            lastSignaledValue = 0;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+namespace Utils
+{
+	// Tells when GPU work submitted up to a point has completed
+	class ReadbackCompletionSource
+	{
+	public:
+		virtual ~ReadbackCompletionSource() = default;
+
+		// Marks the work submitted so far, the returned token completes once the GPU is done with it
+		virtual uint64_t Signal() = 0;
+		virtual bool IsComplete(uint64_t a_token) const = 0;
+		// Called once per frame
+		virtual void OnFrame() {}
+	};
+
+	// Fallback for when there's no way to know when the GPU is done, assumes it is after a fixed number of frames
+	class FrameCountCompletionSource : public ReadbackCompletionSource
+	{
+	public:
+		explicit FrameCountCompletionSource(uint64_t a_frameDelay) :
+			frameDelay(a_frameDelay) {}
+
+		uint64_t Signal() override { return currentFrame + frameDelay; }
+		bool IsComplete(uint64_t a_token) const override { return currentFrame >= a_token; }
+		void OnFrame() override { ++currentFrame; }
+
+	private:
+		const uint64_t frameDelay;
+		uint64_t       currentFrame = 0;
+	};
+
+	// Holds GPU readbacks until the GPU has finished writing them, then hands them out in submission order.
+	// The work of a frame is signaled on the next frame, assuming the command list the copy was recorded in has been submitted by then.
+	// We don't control the game's submissions, so that can't be verified, "a_minFrameDelay" sets a number of frames a readback is held for anyway.
+	// Not thread safe, it's meant to be driven by the render thread.
+	template <typename T>
+	class ReadbackScheduler
+	{
+	public:
+		explicit ReadbackScheduler(std::unique_ptr<ReadbackCompletionSource> a_completionSource, uint64_t a_minFrameDelay = 0) :
+			completionSource(std::move(a_completionSource)), minFrameDelay(a_minFrameDelay) {}
+
+		void Submit(T a_readback)
+		{
+			readbacks.push_back({ std::move(a_readback), currentFrame, std::nullopt });
+		}
+
+		// Call once per frame, before processing
+		void OnFrame()
+		{
+			++currentFrame;
+			completionSource->OnFrame();
+			for (auto& readback : readbacks) {
+				if (!readback.token && readback.submitFrame < currentFrame) {
+					readback.token = completionSource->Signal();
+				}
+			}
+		}
+
+		// Calls "a_process" on the completed readbacks, in submission order, stopping at the first one that hasn't completed yet.
+		// "a_process" can return false to refuse a readback (e.g. if there's no room to handle it), it will stay queued and processing stops.
+		template <typename Func>
+		size_t ProcessCompleted(Func&& a_process)
+		{
+			size_t processed = 0;
+			while (!readbacks.empty()) {
+				auto& readback = readbacks.front();
+				if (!readback.token || currentFrame < readback.submitFrame + minFrameDelay || !completionSource->IsComplete(*readback.token) || !a_process(readback.readback)) {
+					break;
+				}
+				readbacks.pop_front();
+				++processed;
+			}
+			return processed;
+		}
+
+		size_t Size() const { return readbacks.size(); }
+
+	private:
+		struct PendingReadback
+		{
+			T                       readback;
+			uint64_t                submitFrame;
+			std::optional<uint64_t> token;
+		};
+
+		std::unique_ptr<ReadbackCompletionSource> completionSource;
+		const uint64_t                            minFrameDelay;
+		std::deque<PendingReadback>               readbacks;
+		uint64_t                                  currentFrame = 0;
+	};
+}
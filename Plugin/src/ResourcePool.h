@@ -0,0 +1,169 @@
+#pragma once
+
+namespace Utils
+{
+	// Creates and destroys the resources of a pool, "Key" describes a resource (e.g. its size and format)
+	template <typename Resource, typename Key>
+	class ResourceAllocator
+	{
+	public:
+		virtual ~ResourceAllocator() = default;
+
+		// Returns nullptr on failure
+		virtual Resource* Create(const Key& a_key) = 0;
+		virtual void      Destroy(Resource* a_resource) = 0;
+		// In bytes, of the memory a resource with this key takes
+		virtual uint64_t  GetSize(const Key& a_key) const = 0;
+	};
+
+	// Recycles resources with the same key, instead of creating a new one each time.
+	// "maxBytes" caps the memory the pool holds on to, not what is in use: resources are always created when asked for,
+	// but the least recently used free ones are destroyed to make room for them, and returned ones are destroyed while the pool is over the cap.
+	// Thread safe, resources can be returned from any thread. The pool must outlive the resources it handed out.
+	template <typename Resource, typename Key>
+	class ResourcePool
+	{
+	public:
+		ResourcePool(std::unique_ptr<ResourceAllocator<Resource, Key>> a_allocator, uint64_t a_maxBytes) :
+			allocator(std::move(a_allocator)), maxBytes(a_maxBytes) {}
+
+		~ResourcePool()
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			for (auto& entry : entries) {
+				allocator->Destroy(entry.resource);
+			}
+		}
+
+		ResourcePool(const ResourcePool&) = delete;
+		ResourcePool& operator=(const ResourcePool&) = delete;
+
+		// Reuses the most recently returned free resource with the same key, or creates one. Returns nullptr if it couldn't be created.
+		Resource* Acquire(const Key& a_key)
+		{
+			uint64_t size = 0;
+			{
+				std::lock_guard<std::mutex> lg(mutex);
+				Entry* reused = nullptr;
+				for (auto& entry : entries) {
+					if (!entry.bInUse && entry.key == a_key && (!reused || entry.lastUse > reused->lastUse)) {
+						reused = &entry;
+					}
+				}
+				if (reused) {
+					reused->bInUse = true;
+					++reuseCount;
+					return reused->resource;
+				}
+
+				size = allocator->GetSize(a_key);
+				while (totalBytes + size > maxBytes && EvictLeastRecentlyUsed()) {}
+			}
+
+			// Creating can take a while, don't hold up the threads returning resources
+			Resource* resource = allocator->Create(a_key);
+			if (!resource) {
+				return nullptr;
+			}
+
+			std::lock_guard<std::mutex> lg(mutex);
+			entries.push_back({ resource, a_key, size, generation, 0, true });
+			totalBytes += size;
+			++createCount;
+			return resource;
+		}
+
+		// Gives back a resource from "Acquire", once nothing uses it anymore
+		void Release(Resource* a_resource)
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			const auto it = std::ranges::find(entries, a_resource, &Entry::resource);
+			if (it == entries.end() || !it->bInUse) {
+				return;
+			}
+
+			if (it->generation != generation || totalBytes > maxBytes) {
+				Destroy(it);
+				return;
+			}
+			it->bInUse = false;
+			it->lastUse = ++useCounter;
+		}
+
+		// Destroys the free resources, and the ones in use once they are returned (e.g. after a resize made them useless)
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			++generation;
+			while (EvictLeastRecentlyUsed()) {}
+		}
+
+		// Destroys the least recently used free resources until the pool fits
+		void SetMaxBytes(uint64_t a_maxBytes)
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			maxBytes = a_maxBytes;
+			while (totalBytes > maxBytes && EvictLeastRecentlyUsed()) {}
+		}
+
+		struct Stats
+		{
+			size_t   resourceCount = 0;
+			size_t   freeCount = 0;
+			uint64_t totalBytes = 0;  // Including the resources in use
+			uint64_t createCount = 0;
+			uint64_t reuseCount = 0;
+		};
+
+		Stats GetStats() const
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			const auto freeCount = static_cast<size_t>(std::ranges::count(entries, false, &Entry::bInUse));
+			return { entries.size(), freeCount, totalBytes, createCount, reuseCount };
+		}
+
+	private:
+		struct Entry
+		{
+			Resource* resource;
+			Key       key;
+			uint64_t  size;
+			uint64_t  generation;
+			uint64_t  lastUse;
+			bool      bInUse;
+		};
+
+		void Destroy(typename std::vector<Entry>::iterator a_entry)
+		{
+			allocator->Destroy(a_entry->resource);
+			totalBytes -= a_entry->size;
+			entries.erase(a_entry);
+		}
+
+		// Returns false if there were no free resources
+		bool EvictLeastRecentlyUsed()
+		{
+			auto evicted = entries.end();
+			for (auto it = entries.begin(); it != entries.end(); ++it) {
+				if (!it->bInUse && (evicted == entries.end() || it->lastUse < evicted->lastUse)) {
+					evicted = it;
+				}
+			}
+			if (evicted == entries.end()) {
+				return false;
+			}
+			Destroy(evicted);
+			return true;
+		}
+
+		std::unique_ptr<ResourceAllocator<Resource, Key>> allocator;
+		mutable std::mutex                                mutex;
+		std::vector<Entry>                                entries;  // There are only ever a few
+		uint64_t                                          maxBytes;
+		uint64_t                                          totalBytes = 0;
+		uint64_t                                          generation = 0;
+		uint64_t                                          useCounter = 0;
+		uint64_t                                          createCount = 0;
+		uint64_t                                          reuseCount = 0;
+	};
+}
@@ -0,0 +1,178 @@
+#include "SDRToneMapper.h"
+#include "CpuFeatures.h"
+#include "HalfFloat.h"
+#include "WorkerPool.h"
+
+#include <immintrin.h>
+
+namespace Utils
+{
+	namespace
+	{
+		// "MinHighlightsColor" in the shaders, where Vanilla+ starts expanding the SDR highlights in HDR
+		const float minHighlightsColor = std::pow(2.f / 3.f, 2.2f);
+
+		constexpr float luminanceWeights[3] = { 0.2126390039920806884765625f, 0.715168654918670654296875f, 0.072192318737506866455078125f };
+
+		constexpr uint16_t positiveInfinityHalf = 0x7C00;
+		constexpr float    maxHalf = 65504.f;
+
+		uint8_t Encode(const std::vector<uint8_t>& a_encodeTable, float a_value)
+		{
+			// Also turns -0 into 0
+			const float value = a_value > 0.f ? a_value : 0.f;
+			return a_encodeTable[std::min(FloatToHalf(value), positiveInfinityHalf)];
+		}
+
+		// Colors beyond BT.709 are desaturated towards their luminance until they fit, which keeps their hue and brightness, like "SimpleGamutClip()" does
+		void ToneMapRowScalar(const uint16_t* a_row, size_t a_width, float a_scale, const std::vector<uint8_t>& a_encodeTable, uint8_t* a_outRow)
+		{
+			for (size_t x = 0; x < a_width; ++x) {
+				// NaN and infinity would spread to the other channels through the luminance
+				float color[3];
+				for (int channel = 0; channel < 3; ++channel) {
+					const float value = HalfToFloat(a_row[x * 4 + channel]);
+					color[channel] = std::isnan(value) ? 0.f : std::clamp(value, -maxHalf, maxHalf) * a_scale;
+				}
+
+				const float minChannel = std::min({ color[0], color[1], color[2] });
+				if (minChannel < 0.f) {
+					const float luminance = color[0] * luminanceWeights[0] + color[1] * luminanceWeights[1] + color[2] * luminanceWeights[2];
+					// Same as "luminance + (channel - luminance) * scale", but the smallest channel ends up at exactly 0, even with large values
+					const float scale = luminance > 0.f ? luminance / (luminance - minChannel) : 0.f;
+					for (float& channel : color) {
+						channel = (channel - minChannel) * scale;
+					}
+				}
+
+				for (int channel = 0; channel < 3; ++channel) {
+					a_outRow[x * 4 + channel] = Encode(a_encodeTable, color[channel]);
+				}
+				a_outRow[x * 4 + 3] = 255;
+			}
+		}
+
+		// Two pixels per register, the curve and the gamma are looked up from the halfs
+		LUMA_TARGET_AVX2 void ToneMapRowAVX2(const uint16_t* a_row, size_t a_width, float a_scale, const std::vector<uint8_t>& a_encodeTable, uint8_t* a_outRow)
+		{
+			const __m256 scale = _mm256_set1_ps(a_scale);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 maxValue = _mm256_set1_ps(maxHalf);
+			const __m256 minValue = _mm256_set1_ps(-maxHalf);
+			const __m256 redWeight = _mm256_set1_ps(luminanceWeights[0]);
+			const __m256 greenWeight = _mm256_set1_ps(luminanceWeights[1]);
+			const __m256 blueWeight = _mm256_set1_ps(luminanceWeights[2]);
+			const uint8_t* encodeTable = a_encodeTable.data();
+
+			const size_t vectorWidth = a_width & ~size_t(1);
+			alignas(16) uint16_t halfs[8];
+			for (size_t x = 0; x < vectorWidth; x += 2) {
+				__m256 colors = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + x * 4)));
+				colors = _mm256_andnot_ps(_mm256_cmp_ps(colors, colors, _CMP_UNORD_Q), colors);
+				colors = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(colors, minValue), maxValue), scale);
+				const __m256 red = _mm256_permute_ps(colors, 0x00);
+				const __m256 green = _mm256_permute_ps(colors, 0x55);
+				const __m256 blue = _mm256_permute_ps(colors, 0xAA);
+
+				const __m256 minChannel = _mm256_min_ps(red, _mm256_min_ps(green, blue));
+				const __m256 luminance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(red, redWeight), _mm256_mul_ps(green, greenWeight)), _mm256_mul_ps(blue, blueWeight));
+				const __m256 clipped = _mm256_mul_ps(_mm256_sub_ps(colors, minChannel), _mm256_div_ps(luminance, _mm256_sub_ps(luminance, minChannel)));
+				const __m256 bOutOfGamut = _mm256_cmp_ps(minChannel, zero, _CMP_LT_OQ);
+				const __m256 bNoLuminance = _mm256_cmp_ps(luminance, zero, _CMP_LE_OQ);
+
+				__m256 result = _mm256_blendv_ps(colors, clipped, bOutOfGamut);
+				result = _mm256_blendv_ps(result, zero, _mm256_and_ps(bOutOfGamut, bNoLuminance));
+				result = _mm256_max_ps(result, zero);  // Returns the second operand for -0
+
+				// Anything beyond the half range is infinity, which is in the table
+				_mm_store_si128(reinterpret_cast<__m128i*>(halfs), _mm256_cvtps_ph(result, _MM_FROUND_TO_NEAREST_INT));
+				uint8_t* out = a_outRow + x * 4;
+				out[0] = encodeTable[halfs[0]];
+				out[1] = encodeTable[halfs[1]];
+				out[2] = encodeTable[halfs[2]];
+				out[3] = 255;
+				out[4] = encodeTable[halfs[4]];
+				out[5] = encodeTable[halfs[5]];
+				out[6] = encodeTable[halfs[6]];
+				out[7] = 255;
+			}
+
+			if (vectorWidth != a_width) {
+				ToneMapRowScalar(a_row + vectorWidth * 4, a_width - vectorWidth, a_scale, a_encodeTable, a_outRow + vectorWidth * 4);
+			}
+		}
+	}
+
+	SDRToneMapper::SDRToneMapper(const SDRToneMapParams& a_params) :
+		params(a_params)
+	{
+		params.paperWhite = std::max(params.paperWhite, FLT_MIN);
+		maxValue = std::max(params.peakWhite / params.paperWhite, 0.f);
+
+		encodeTable.resize(positiveInfinityHalf + 1);
+		const float inverseGamma = 1.f / params.gamma;
+		for (uint16_t half = 0; half <= positiveInfinityHalf; ++half) {
+			const float value = ToneMapChannel(HalfToFloat(half));
+			encodeTable[half] = static_cast<uint8_t>(std::lround(std::pow(value, inverseGamma) * 255.f));
+		}
+	}
+
+	float SDRToneMapper::ToneMapChannel(float a_value) const
+	{
+		const float value = std::clamp(a_value, 0.f, maxValue);
+		// Nothing to compress, anything beyond SDR white clips
+		if (maxValue <= 1.f || value <= minHighlightsColor) {
+			return std::min(value, 1.f);
+		}
+
+		// "luminanceCompress()" from the shaders, with the peak mapped to exactly 1
+		const float compressedRange = 1.f - minHighlightsColor;
+		const float restoreRangeScale = 1.f / (1.f - std::exp(-(maxValue - minHighlightsColor) / compressedRange));
+		return std::min(minHighlightsColor + compressedRange * (1.f - std::exp(-(value - minHighlightsColor) / compressedRange)) * restoreRangeScale, 1.f);
+	}
+
+	void SDRToneMapper::ToneMapRow(const uint8_t* a_row, size_t a_width, uint8_t* a_outRow) const
+	{
+		const uint16_t* row = reinterpret_cast<const uint16_t*>(a_row);
+		const float     scale = 1.f / params.paperWhite;
+		if (IsAVX2Supported()) {
+			ToneMapRowAVX2(row, a_width, scale, encodeTable, a_outRow);
+		} else {
+			ToneMapRowScalar(row, a_width, scale, encodeTable, a_outRow);
+		}
+	}
+
+	void SDRToneMapper::ToneMapImage(const uint8_t* a_pixels, size_t a_rowPitch, size_t a_width, size_t a_height, uint8_t* a_outPixels, size_t a_outRowPitch, WorkerPool* a_workers) const
+	{
+		auto toneMapRows = [&](size_t a_begin, size_t a_end) {
+			for (size_t y = a_begin; y < a_end; ++y) {
+				ToneMapRow(a_pixels + y * a_rowPitch, a_width, a_outPixels + y * a_outRowPitch);
+			}
+		};
+
+		if (a_workers) {
+			a_workers->ParallelFor(a_height, toneMapRows);
+		} else {
+			toneMapRows(0, a_height);
+		}
+	}
+
+	bool SDRToneMapSink::Begin(const ImageInfo& a_info)
+	{
+		if (a_info.format != DXGI_FORMAT_R16G16B16A16_FLOAT) {
+			return false;
+		}
+
+		width = a_info.width;
+		return sink.Begin({ a_info.width, a_info.height, DXGI_FORMAT_R8G8B8A8_UNORM });
+	}
+
+	bool SDRToneMapSink::WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers)
+	{
+		const size_t rowPitch = width * 4;
+		pixels.resize(rowPitch * a_strip.rowCount);
+		toneMapper.ToneMapImage(a_strip.pixels, a_strip.rowPitch, width, a_strip.rowCount, pixels.data(), rowPitch, a_workers);
+
+		return sink.WriteStrip({ pixels.data(), a_strip.firstRow, a_strip.rowCount, rowPitch }, a_workers);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ImagePipeline.h"
+
+namespace Utils
+{
+	class WorkerPool;
+
+	struct SDRToneMapParams
+	{
+		float paperWhite = 203.f / 80.f;  // The scRGB value SDR white ended up at in HDR
+		float peakWhite = 10000.f / 80.f;  // The brightest scRGB value in the image, it's tone mapped to SDR white
+		float gamma = 2.2f;                // Of the SDR output, like the "SDR_USE_GAMMA_2_2" final shader pass
+	};
+
+	// Turns HDR (scRGB) screenshots into what the game would have rendered in SDR, so an SDR frame doesn't have to be rendered too.
+	// With Vanilla+, HDR is SDR scaled by the paper white up to the start of the highlights, and the highlights are expanded from there to the peak.
+	// This scales by the paper white back down and compresses the highlights back into SDR, by channel, like the vanilla tone mappers did.
+	// The gamma mismatch correction ("GammaCorrectionStrength") is already in the HDR colors, as it's applied in linear before the HDR upgrade.
+	class SDRToneMapper
+	{
+	public:
+		explicit SDRToneMapper(const SDRToneMapParams& a_params);
+
+		// RGBA16F to RGBA8, with an opaque alpha. Uses AVX2 and F16C if the CPU supports them.
+		void ToneMapRow(const uint8_t* a_row, size_t a_width, uint8_t* a_outRow) const;
+		// Splits the rows between the workers, if any are passed in
+		void ToneMapImage(const uint8_t* a_pixels, size_t a_rowPitch, size_t a_width, size_t a_height, uint8_t* a_outPixels, size_t a_outRowPitch, WorkerPool* a_workers = nullptr) const;
+
+		// The SDR value of a channel, after the colors were scaled by the paper white and brought within the BT.709 gamut
+		float ToneMapChannel(float a_value) const;
+
+		const SDRToneMapParams& GetParams() const { return params; }
+
+	private:
+		SDRToneMapParams params;
+		float            maxValue;  // The peak, relative to the paper white
+		// Encoded 8 bit output for every positive half float, as the curve and the gamma are applied by channel, and halfs are precise enough for 8 bit:
+		// channels are at most one step away from evaluating everything exactly, under a deltaE 2000 of 1.5 (see "SDRToneMapperTest")
+		std::vector<uint8_t> encodeTable;
+	};
+
+	// Tone maps RGBA16F strips to RGBA8 and passes them on to another sink
+	class SDRToneMapSink : public ImageSink
+	{
+	public:
+		SDRToneMapSink(const SDRToneMapper& a_toneMapper, ImageSink& a_sink) :
+			toneMapper(a_toneMapper), sink(a_sink) {}
+
+		size_t GetRowAlignment() const override { return sink.GetRowAlignment(); }
+		bool   Begin(const ImageInfo& a_info) override;
+		bool   WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override;
+		bool   End() override { return sink.End(); }
+
+	private:
+		const SDRToneMapper& toneMapper;
+		ImageSink&           sink;
+		size_t               width = 0;
+		std::vector<uint8_t> pixels;  // One strip
+	};
+}
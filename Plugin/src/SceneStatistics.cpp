@@ -0,0 +1,202 @@
+#include "SceneStatistics.h"
+#include "CpuFeatures.h"
+#include "HalfFloat.h"
+#include "WorkerPool.h"
+
+#include <immintrin.h>
+
+namespace Utils
+{
+	namespace
+	{
+		constexpr float luminanceWeights[3] = { 0.2126390039920806884765625f, 0.715168654918670654296875f, 0.072192318737506866455078125f };
+
+		constexpr float maxHalf = 65504.f;
+		constexpr float scRGBNits = 80.f;
+
+		// Float bits shifted right by this leave the exponent and the top 2 bits of the mantissa
+		constexpr int     binShift = 21;
+		constexpr int32_t firstBinKey = (127 + SceneStatistics::histogramMinLog2) * static_cast<int32_t>(SceneStatistics::binsPerStop);
+		static_assert(SceneStatistics::binsPerStop == 1 << (23 - binShift));
+
+		size_t GetBin(float a_luminance)
+		{
+			const int32_t key = static_cast<int32_t>(std::bit_cast<uint32_t>(a_luminance) >> binShift);
+			return static_cast<size_t>(std::clamp(key - firstBinKey + 1, 0, static_cast<int32_t>(SceneStatistics::binCount) - 1));
+		}
+
+		void AccumulateRowScalar(const uint16_t* a_row, size_t a_width, SceneStatistics& a_statistics)
+		{
+			double maxChannelSum = 0.0;
+			for (size_t x = 0; x < a_width; ++x) {
+				float color[3];
+				for (int channel = 0; channel < 3; ++channel) {
+					const float value = HalfToFloat(a_row[x * 4 + channel]);
+					color[channel] = std::isnan(value) ? 0.f : std::clamp(value, -maxHalf, maxHalf);
+				}
+
+				const float luminance = std::max(color[0] * luminanceWeights[0] + color[1] * luminanceWeights[1] + color[2] * luminanceWeights[2], 0.f) * scRGBNits;
+				const float maxChannel = std::max({ color[0], color[1], color[2], 0.f }) * scRGBNits;
+
+				a_statistics.luminanceHistogram[GetBin(luminance)]++;
+				a_statistics.maxCLL = std::max(a_statistics.maxCLL, maxChannel);
+				a_statistics.pixelsAbovePeak += maxChannel > a_statistics.peakNits;
+				maxChannelSum += maxChannel;
+			}
+			a_statistics.maxChannelSum += maxChannelSum;
+			a_statistics.pixelCount += a_width;
+		}
+
+		// Two pixels, with NaN as 0 and infinity as the largest half. Returns the weighted channels, every lane of a pixel in "a_outMaxChannel" gets its max channel.
+		LUMA_TARGET_AVX2 __m256 LoadPixelsAVX2(const uint16_t* a_pixels, __m256 a_weights, __m256& a_outMaxChannel)
+		{
+			__m256 colors = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a_pixels)));
+			colors = _mm256_andnot_ps(_mm256_cmp_ps(colors, colors, _CMP_UNORD_Q), colors);
+			colors = _mm256_min_ps(_mm256_max_ps(colors, _mm256_set1_ps(-maxHalf)), _mm256_set1_ps(maxHalf));
+			a_outMaxChannel = _mm256_max_ps(_mm256_max_ps(_mm256_permute_ps(colors, 0x00), _mm256_permute_ps(colors, 0x55)), _mm256_permute_ps(colors, 0xAA));
+			return _mm256_mul_ps(colors, a_weights);
+		}
+
+		// Eight pixels at once, two per register as they are loaded. The sums and the maxes of the channels come out in the order 0, 2, 4, 6, 1, 3, 5, 7, which doesn't matter here.
+		LUMA_TARGET_AVX2 void AccumulateRowAVX2(const uint16_t* a_row, size_t a_width, SceneStatistics& a_statistics)
+		{
+			const __m256  weights = _mm256_setr_ps(luminanceWeights[0], luminanceWeights[1], luminanceWeights[2], 0.f, luminanceWeights[0], luminanceWeights[1], luminanceWeights[2], 0.f);
+			const __m256  zero = _mm256_setzero_ps();
+			const __m256  nits = _mm256_set1_ps(scRGBNits);
+			const __m256  peak = _mm256_set1_ps(a_statistics.peakNits);
+			const __m256i binOffset = _mm256_set1_epi32(firstBinKey - 1);
+			const __m256i lastBin = _mm256_set1_epi32(static_cast<int32_t>(SceneStatistics::binCount) - 1);
+
+			__m256       maxChannels = zero;
+			__m256       maxChannelSums = zero;
+			uint64_t     pixelsAbovePeak = 0;
+			alignas(32) int32_t bins[8];
+
+			const size_t vectorWidth = a_width & ~size_t(7);
+			for (size_t x = 0; x < vectorWidth; x += 8) {
+				__m256       maxChannel0, maxChannel1, maxChannel2, maxChannel3;
+				const __m256 products0 = LoadPixelsAVX2(a_row + x * 4 + 0, weights, maxChannel0);
+				const __m256 products1 = LoadPixelsAVX2(a_row + x * 4 + 8, weights, maxChannel1);
+				const __m256 products2 = LoadPixelsAVX2(a_row + x * 4 + 16, weights, maxChannel2);
+				const __m256 products3 = LoadPixelsAVX2(a_row + x * 4 + 24, weights, maxChannel3);
+
+				const __m256 luminance = _mm256_mul_ps(_mm256_max_ps(_mm256_hadd_ps(_mm256_hadd_ps(products0, products1), _mm256_hadd_ps(products2, products3)), zero), nits);
+				// One lane of each pixel from each register
+				__m256 maxChannel = _mm256_blend_ps(_mm256_blend_ps(_mm256_blend_ps(maxChannel0, maxChannel1, 0x22), maxChannel2, 0x44), maxChannel3, 0x88);
+				maxChannel = _mm256_mul_ps(_mm256_max_ps(maxChannel, zero), nits);
+
+				maxChannels = _mm256_max_ps(maxChannels, maxChannel);
+				maxChannelSums = _mm256_add_ps(maxChannelSums, maxChannel);
+				pixelsAbovePeak += std::popcount(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(maxChannel, peak, _CMP_GT_OQ))));
+
+				const __m256i keys = _mm256_srli_epi32(_mm256_castps_si256(luminance), binShift);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(bins), _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(keys, binOffset), _mm256_setzero_si256()), lastBin));
+				for (int32_t bin : bins) {
+					a_statistics.luminanceHistogram[bin]++;
+				}
+			}
+
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, maxChannels);
+			a_statistics.maxCLL = std::max(a_statistics.maxCLL, *std::max_element(std::begin(lanes), std::end(lanes)));
+			_mm256_store_ps(lanes, maxChannelSums);
+			a_statistics.maxChannelSum += std::accumulate(std::begin(lanes), std::end(lanes), 0.0);
+			a_statistics.pixelsAbovePeak += pixelsAbovePeak;
+			a_statistics.pixelCount += vectorWidth;
+
+			if (vectorWidth != a_width) {
+				AccumulateRowScalar(a_row + vectorWidth * 4, a_width - vectorWidth, a_statistics);
+			}
+		}
+	}
+
+	float SceneStatistics::GetBinStart(size_t a_bin)
+	{
+		if (a_bin == 0) {
+			return 0.f;
+		}
+		const size_t step = a_bin - 1;
+		return std::ldexp(1.f + static_cast<float>(step % binsPerStop) / binsPerStop, histogramMinLog2 + static_cast<int>(step / binsPerStop));
+	}
+
+	float SceneStatistics::GetLuminancePercentile(float a_percentile) const
+	{
+		const double target = std::clamp(static_cast<double>(a_percentile), 0.0, 100.0) / 100.0 * static_cast<double>(pixelCount);
+		uint64_t     count = 0;
+		for (size_t bin = 0; bin < binCount; ++bin) {
+			count += luminanceHistogram[bin];
+			if (static_cast<double>(count) >= target && count > 0) {
+				return GetBinStart(bin);
+			}
+		}
+		return 0.f;
+	}
+
+	void SceneStatistics::Merge(const SceneStatistics& a_other)
+	{
+		for (size_t bin = 0; bin < binCount; ++bin) {
+			luminanceHistogram[bin] += a_other.luminanceHistogram[bin];
+		}
+		pixelCount += a_other.pixelCount;
+		pixelsAbovePeak += a_other.pixelsAbovePeak;
+		maxChannelSum += a_other.maxChannelSum;
+		maxCLL = std::max(maxCLL, a_other.maxCLL);
+	}
+
+	std::string SceneStatistics::ToJson() const
+	{
+		std::string bins;
+		for (size_t bin = 0; bin < binCount; ++bin) {
+			bins.append(std::format("{}{}", bin ? ", " : "", luminanceHistogram[bin]));
+		}
+
+		return std::format(
+			"{{\n"
+			"\t\"maxCLL\": {},\n"
+			"\t\"maxFALL\": {},\n"
+			"\t\"peakNits\": {},\n"
+			"\t\"pixelCount\": {},\n"
+			"\t\"pixelsAbovePeak\": {},\n"
+			"\t\"luminancePercentiles\": {{ \"50\": {}, \"90\": {}, \"99\": {}, \"99.9\": {} }},\n"
+			"\t\"luminanceHistogram\": {{\n"
+			"\t\t\"minLog2Nits\": {},\n"
+			"\t\t\"maxLog2Nits\": {},\n"
+			"\t\t\"binsPerStop\": {},\n"
+			"\t\t\"bins\": [ {} ]\n"
+			"\t}}\n"
+			"}}\n",
+			maxCLL, GetMaxFALL(), peakNits, pixelCount, pixelsAbovePeak,
+			GetLuminancePercentile(50.f), GetLuminancePercentile(90.f), GetLuminancePercentile(99.f), GetLuminancePercentile(99.9f),
+			histogramMinLog2, histogramMaxLog2, binsPerStop, bins);
+	}
+
+	void AccumulateSceneStatistics(const uint8_t* a_row, size_t a_width, SceneStatistics& a_statistics)
+	{
+		const uint16_t* row = reinterpret_cast<const uint16_t*>(a_row);
+		if (IsAVX2Supported()) {
+			AccumulateRowAVX2(row, a_width, a_statistics);
+		} else {
+			AccumulateRowScalar(row, a_width, a_statistics);
+		}
+	}
+
+	void AccumulateSceneStatistics(const uint8_t* a_pixels, size_t a_width, size_t a_height, size_t a_rowPitch, SceneStatistics& a_statistics, WorkerPool* a_workers)
+	{
+		std::mutex mergeMutex;
+		auto       accumulateRows = [&](size_t a_begin, size_t a_end) {
+			SceneStatistics statistics{ .peakNits = a_statistics.peakNits };
+			for (size_t y = a_begin; y < a_end; ++y) {
+				AccumulateSceneStatistics(a_pixels + y * a_rowPitch, a_width, statistics);
+			}
+
+			std::lock_guard<std::mutex> lg(mergeMutex);
+			a_statistics.Merge(statistics);
+		};
+
+		if (a_workers) {
+			a_workers->ParallelFor(a_height, accumulateRows);
+		} else {
+			accumulateRows(0, a_height);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Utils
+{
+	class WorkerPool;
+
+	// Light levels of an scRGB (RGBA16F) image, in nits (scRGB 1 is 80 nits).
+	// MaxCLL and MaxFALL are from the brightest channel of each pixel, like CTA-861.3, the histogram is of the luminance.
+	struct SceneStatistics
+	{
+		// The histogram bins are found from the bits of the float luminance (the exponent and the top 2 bits of the mantissa),
+		// so each stop is split in 4 bins that start at 1, 1.25, 1.5 and 1.75 times its start.
+		// The first bin has everything below the min (including black), the last one everything from the start of the max stop.
+		static constexpr int    histogramMinLog2 = -7;
+		static constexpr int    histogramMaxLog2 = 14;
+		static constexpr size_t binsPerStop = 4;
+		static constexpr size_t binCount = 1 + (histogramMaxLog2 - histogramMinLog2) * binsPerStop;
+
+		float peakNits = 10000.f;  // The threshold of "pixelsAbovePeak"
+
+		std::array<uint64_t, binCount> luminanceHistogram = {};
+		uint64_t                       pixelCount = 0;
+		uint64_t                       pixelsAbovePeak = 0;
+		double                         maxChannelSum = 0.0;
+		float                          maxCLL = 0.f;
+
+		float GetMaxFALL() const { return pixelCount ? static_cast<float>(maxChannelSum / static_cast<double>(pixelCount)) : 0.f; }
+		// The start of the bin the percentile falls in, 0 for the first bin
+		float GetLuminancePercentile(float a_percentile) const;
+		void  Merge(const SceneStatistics& a_other);
+
+		static float GetBinStart(size_t a_bin);
+
+		std::string ToJson() const;
+	};
+
+	// Adds a row of RGBA16F pixels. Uses AVX2 and F16C if the CPU supports them. NaN is counted as black, and infinity as the largest half.
+	void AccumulateSceneStatistics(const uint8_t* a_row, size_t a_width, SceneStatistics& a_statistics);
+	// Adds a whole image. Each worker adds its rows to its own statistics, which are merged at the end.
+	void AccumulateSceneStatistics(const uint8_t* a_pixels, size_t a_width, size_t a_height, size_t a_rowPitch, SceneStatistics& a_statistics, WorkerPool* a_workers = nullptr);
+}
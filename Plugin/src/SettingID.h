@@ -0,0 +1,62 @@
+#pragma once
+
+namespace Settings
+{
+    enum class SettingID : unsigned int
+    {
+		// Bethesda's settings (subject to change):
+		kUpscalingTechnique = 23,
+		kFrameGeneration = 25,
+
+		// Make sure our settings IDs are all after Bethesda's ones
+		kSTART = 600,
+
+		kDisplayMode,
+		kEnforceUserDisplayMode,
+		kForceSDROnHDR,
+		kHDR_PeakBrightness,
+		kHDR_GamePaperWhite,
+		kHDR_UIPaperWhite,
+		kHDR_ExtendGamut,
+		kHDR_AutoHDRVideos,
+
+		kSecondaryBrightness,
+
+		kToneMapperType,
+		kToneMapperSaturation,
+		kToneMapperContrast,
+		kToneMapperHighlights,
+		kToneMapperShadows,
+		kToneMapperBloom,
+
+		kColorGradingStrength,
+		kLUTCorrectionStrength,
+		kVanillaMenuLUTs,
+		kStrictLUTApplication,
+
+		kGammaCorrectionStrength,
+		kFilmGrainType,
+		kFilmGrainFPSLimit,
+		kPostSharpen,
+		kHDRScreenshots,
+		kHDRScreenshotsLossless,
+		kHDRScreenshotsFormat,
+		kDLSSFGToFSRFGMod,
+
+		kEND,
+
+		kDevSetting01,
+		kDevSetting02,
+		kDevSetting03,
+		kDevSetting04,
+		kDevSetting05,
+
+		// Only in the config, they aren't shown in the game's settings menu
+		kScreenshotTexturePoolMB,
+		kScreenshotBurstFrames,
+		kScreenshotBurstInterval,
+		kScreenshotBurstRingSize,
+
+		kLAST = kScreenshotBurstRingSize,
+    };
+}
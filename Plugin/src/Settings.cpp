@@ -1,12 +1,161 @@
 #include "Settings.h"
 
 #include "Hooks.h"
+#include "Statistics.h"
+#include "Techniques.h"
 #include "Utils.h"
 
 #define ICON_FK_UNDO reinterpret_cast<const char*>(u8"\uf0e2")
 
 namespace Settings
 {
+	std::optional<double> Preset::GetValue(SettingID a_id) const
+	{
+		const auto it = std::ranges::lower_bound(values, a_id, {}, &SettingValues::value_type::first);
+		if (it != values.end() && it->first == a_id) {
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	bool IsDisplayModeSetting(SettingID a_id)
+	{
+		return a_id == SettingID::kDisplayMode || a_id == SettingID::kForceSDROnHDR || a_id == SettingID::kEnforceUserDisplayMode;
+	}
+
+	std::optional<std::vector<Preset>> ParsePresets(std::string_view a_toml, std::span<Setting* const> a_settings)
+	{
+		toml::table table;
+		try {
+			table = toml::parse(a_toml);
+		} catch (const toml::parse_error& e) {
+			WARN("Failed to parse the presets: {}", e.description())
+			return std::nullopt;
+		}
+
+		std::vector<Preset> presets;
+		for (const auto& [name, node] : table) {
+			const auto presetTable = node.as_table();
+			if (!presetTable) {
+				WARN("Preset \"{}\" is not a table, skipping it", name.str())
+				continue;
+			}
+
+			Preset preset;
+			preset.name = name.str();
+			for (const auto& [key, value] : *presetTable) {
+				if (key.str() == "Hotkey") {
+					preset.hotkey = static_cast<uint32_t>(value.value_or<int64_t>(0));
+					continue;
+				}
+
+				const auto setting = std::ranges::find(a_settings, key.str(), &Setting::key);
+				if (setting == a_settings.end()) {
+					WARN("Preset \"{}\" has unknown setting \"{}\", skipping it", preset.name, key.str())
+					continue;
+				}
+				if (IsDisplayModeSetting((*setting)->id)) {
+					WARN("Preset \"{}\" can't change \"{}\", the display mode can only be changed from the settings, skipping it", preset.name, key.str())
+					continue;
+				}
+
+				std::optional<double> number;
+				if (const auto boolean = value.as_boolean()) {
+					number = boolean->get() ? 1.0 : 0.0;
+				} else {
+					number = value.value<double>();
+				}
+				if (!number || !(*setting)->IsValidValue(*number)) {
+					WARN("Preset \"{}\" has an invalid value for \"{}\", skipping it", preset.name, key.str())
+					continue;
+				}
+
+				preset.values.emplace_back((*setting)->id, *number);
+			}
+
+			std::ranges::sort(preset.values, {}, &SettingValues::value_type::first);
+			presets.push_back(std::move(preset));
+		}
+
+		return presets;
+	}
+
+	std::vector<PresetDifference> DiffPresets(const Preset& a_from, const Preset& a_to)
+	{
+		// Both value lists are sorted by ID, so this is a single merge pass
+		std::vector<PresetDifference> differences;
+		auto from = a_from.values.begin();
+		auto to = a_to.values.begin();
+		while (from != a_from.values.end() || to != a_to.values.end()) {
+			if (to == a_to.values.end() || (from != a_from.values.end() && from->first < to->first)) {
+				differences.push_back({ from->first, from->second, std::nullopt });
+				++from;
+			} else if (from == a_from.values.end() || to->first < from->first) {
+				differences.push_back({ to->first, std::nullopt, to->second });
+				++to;
+			} else {
+				if (from->second != to->second) {
+					differences.push_back({ from->first, from->second, to->second });
+				}
+				++from;
+				++to;
+			}
+		}
+		return differences;
+	}
+
+	std::optional<SettingValues> ParseConfigValues(std::string_view a_toml, std::span<Setting* const> a_settings)
+	{
+		toml::table table;
+		try {
+			table = toml::parse(a_toml);
+		} catch (const toml::parse_error& e) {
+			WARN("Failed to parse the config: {}", e.description())
+			return std::nullopt;
+		}
+
+		SettingValues values;
+		for (const auto setting : a_settings) {
+			const auto node = table[setting->section][setting->key];
+			if (!node) {
+				continue;
+			}
+
+			std::optional<double> number;
+			if (const auto boolean = node.as_boolean()) {
+				number = boolean->get() ? 1.0 : 0.0;
+			} else {
+				number = node.value<double>();
+			}
+			if (!number || !setting->IsValidValue(*number)) {
+				WARN("The config has an invalid value for \"{}\"", setting->key)
+				return std::nullopt;
+			}
+
+			values.emplace_back(setting->id, *number);
+		}
+
+		return values;
+	}
+
+	SettingValues DiffSettingValues(const SettingValues& a_values, std::span<Setting* const> a_settings, SettingValues& a_outDeferredValues)
+	{
+		SettingValues differences;
+		for (const auto& [id, value] : a_values) {
+			const auto setting = std::ranges::find(a_settings, id, &Setting::id);
+			if (setting == a_settings.end() || (*setting)->GetAsDouble() == value) {
+				continue;
+			}
+			if (IsDisplayModeSetting(id)) {
+				WARN("The change to \"{}\" in the config will take effect after restarting the game (or change it from the settings)", (*setting)->key)
+				a_outDeferredValues.emplace_back(id, value);
+				continue;
+			}
+			differences.emplace_back(id, value);
+		}
+		return differences;
+	}
+
 	std::string EnumStepper::GetStepperText(int32_t a_value) const
     {
 		if (optionNames.size() > a_value) {
@@ -23,12 +172,12 @@ namespace Settings
 
     float Slider::GetSliderPercentage() const
     {
-		return (value.get_data() - sliderMin) / (sliderMax - sliderMin);
+		return (Get() - sliderMin) / (sliderMax - sliderMin);
     }
 
     std::string Slider::GetSliderText() const
     {
-		return std::format("{:.0f}{}", value.get_data(), suffix);
+		return std::format("{:.0f}{}", Get(), suffix);
     }
 
     float Slider::GetValueFromSlider(float a_percentage) const
@@ -38,7 +187,28 @@ namespace Settings
 
     void Slider::SetValueFromSlider(float a_percentage)
     {
-        *value = GetValueFromSlider(a_percentage);
+        Set(GetValueFromSlider(a_percentage));
+    }
+
+    void ShaderConstantsSnapshot::Publish(const ShaderConstants& a_shaderConstants) noexcept
+    {
+		const uint32_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed);  // odd, readers will retry
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&shaderConstants, &a_shaderConstants, sizeof(ShaderConstants));
+		sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    void ShaderConstantsSnapshot::Read(ShaderConstants& a_outShaderConstants) const noexcept
+    {
+		uint32_t seqBefore;
+		uint32_t seqAfter;
+		do {
+			seqBefore = sequence.load(std::memory_order_acquire);
+			std::memcpy(&a_outShaderConstants, &shaderConstants, sizeof(ShaderConstants));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seqAfter = sequence.load(std::memory_order_relaxed);
+		} while ((seqBefore & 1) != 0 || seqBefore != seqAfter);
     }
 
     bool Main::InitCompatibility(RE::BGSSwapChainObject* a_swapChainObject)
@@ -84,15 +254,15 @@ namespace Settings
 			return false;
 		}
 
-		*DisplayMode.value = std::clamp((int32_t)DisplayMode.value.get_data(), 0, 2);  // Clamp to valid range
+		DisplayMode.Set(std::clamp((int32_t)DisplayMode.Get(), 0, 2));  // Clamp to valid range
 
 		const auto previousActualDisplayMode = GetActualDisplayMode();
 
 		// check if Nukem's dlss fg to fsr 3 fg is present
 		bIsDLSSFGToFSRFGPresent = isModuleLoaded(moduleNameDLSSGTOFSR3);
 
-		if (*DLSSFGToFSRFGMod.value != bIsDLSSFGToFSRFGPresent) {
-			*DLSSFGToFSRFGMod.value = bIsDLSSFGToFSRFGPresent;
+		if (DLSSFGToFSRFGMod.Get() != bIsDLSSFGToFSRFGPresent) {
+			DLSSFGToFSRFGMod.Set(bIsDLSSFGToFSRFGPresent);
 			Save();
 		}
 
@@ -111,6 +281,8 @@ namespace Settings
 			swapChainObject->format = newFormat;
 		}
 
+		MarkShaderConstantsDirty();
+
 		return true;
 	}
 
@@ -129,7 +301,7 @@ namespace Settings
 		
 		// change display mode setting if it's hdr and hdr is not supported
 		if (!bIsHDRSupported && IsGameRenderingSetToHDR()) {
-			*DisplayMode.value = 0;
+			DisplayMode.Set(0);
 			// No need to save, the user might have moved the game to an SDR display temporarily
 		}
 		
@@ -142,25 +314,34 @@ namespace Settings
 			if (Utils::GetHDRMaxLuminance(swapChainObject->swapChainInterface, detectedMaxLuminance)) {
 				detectedMaxLuminance = std::max(detectedMaxLuminance, 80.f); // HDR10 min would be 400 nits, but we let it go as low as 80 anyway
 				PeakBrightness.defaultValue = detectedMaxLuminance;
-				if (PeakBrightnessAutoDetected.get_data() == false) {
-					*PeakBrightnessAutoDetected = true;
-					*PeakBrightness.value = detectedMaxLuminance;
+				bool bFirstDetection = false;
+				{
+					std::lock_guard<std::mutex> lg(configMutex);
+					if (PeakBrightnessAutoDetected.get_data() == false) {
+						*PeakBrightnessAutoDetected = true;
+						bFirstDetection = true;
+					}
+				}
+				if (bFirstDetection) {
+					PeakBrightness.Set(detectedMaxLuminance);
 					Save();
 				}
 			}
 		}
+
+		MarkShaderConstantsDirty();
 	}
 
     bool Main::IsSDRForcedOnHDR(bool bAcknowledgeScreenshots) const
     {
 		// The game will tonemap to SDR if this is true
-		return ForceSDROnHDR.value.get_data() || (bAcknowledgeScreenshots && !bRequestedHDRScreenshot && bRequestedSDRScreenshot && IsDisplayModeSetToHDR());
+		return ForceSDROnHDR.Get() || (bAcknowledgeScreenshots && !bRequestedHDRScreenshot && bRequestedSDRScreenshot && IsDisplayModeSetToHDR());
     }
 
     bool Main::IsDisplayModeSetToHDR() const
     {
 		// Note: this should acknowledge how the display mode is changed by "GetActualDisplayMode()"
-		return DisplayMode.value.get_data() > 0;
+		return DisplayMode.Get() > 0;
     }
 	
     bool Main::IsGameRenderingSetToHDR(bool bAcknowledgeScreenshots) const
@@ -177,12 +358,24 @@ namespace Settings
 
 	bool Main::IsCustomToneMapper() const
 	{
-		return IsDisplayModeSetToHDR() || ToneMapperType.value.get_data() > 0;
+		return IsDisplayModeSetToHDR() || ToneMapperType.Get() > 0;
 	}
 
     bool Main::IsFilmGrainTypeImproved() const
 	{
-		return FilmGrainType.value.get_data() == 1;
+		return FilmGrainType.Get() == 1;
+	}
+
+	EnableInputs Main::GetEnableInputs(std::optional<RE::FrameGenerationTech> a_frameGenerationTech) const
+	{
+		return {
+			.bHDRSupported = IsHDRSupported(),
+			.bDisplayModeHDR = IsDisplayModeSetToHDR(),
+			.bSDRForcedOnHDR = IsSDRForcedOnHDR(),
+			.bFSR3FrameGeneration = a_frameGenerationTech.value_or(*Offsets::uiFrameGenerationTech) == RE::FrameGenerationTech::kFSR3,
+			.toneMapperType = ToneMapperType.Get(),
+			.filmGrainType = FilmGrainType.Get(),
+		};
 	}
 
     int32_t Main::GetActualDisplayMode(bool bAcknowledgeScreenshots, std::optional<RE::FrameGenerationTech> a_frameGenerationTech) const
@@ -192,11 +385,11 @@ namespace Settings
 		    return -1;
 		}
 
-		const auto value = std::clamp((int32_t)DisplayMode.value.get_data(), 0, 2); // Clamp to valid range
+		const auto value = std::clamp((int32_t)DisplayMode.Get(), 0, 2); // Clamp to valid range
 
 		RE::FrameGenerationTech frameGenerationTech = a_frameGenerationTech.has_value() ? a_frameGenerationTech.value() : *Offsets::uiFrameGenerationTech;
 
-		if (frameGenerationTech > RE::FrameGenerationTech::kNone && !EnforceUserDisplayMode.value.get_data()) {
+		if (frameGenerationTech > RE::FrameGenerationTech::kNone && !EnforceUserDisplayMode.Get()) {
 			// force scRGB HDR with fsr3 or dlssg if dlssg_to_fsr3 is present
 			if (value == 1 && (frameGenerationTech == RE::FrameGenerationTech::kFSR3 || (frameGenerationTech == RE::FrameGenerationTech::kDLSSG && bIsDLSSFGToFSRFGPresent))) {
 			    return 2;
@@ -249,6 +442,8 @@ namespace Settings
 
 		// toggle vsync to force a swapchain recreation (it will seemengly happen in one of the renderer threads, even if this is called by the main/game thread)
 		Offsets::ToggleVsync(reinterpret_cast<void*>(*Offsets::unkToggleVsyncArg1Ptr + 0x8), *Offsets::bEnableVsync);
+
+		MarkShaderConstantsDirty();
 	}
 
     void Main::OnDisplayModeChanged()
@@ -264,8 +459,14 @@ namespace Settings
 		RefreshSwapchainFormat();
 	}
 
-    void Main::GetShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode) const
+    void Main::GetShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode, const Preset* a_preset) const
     {
+		// Presets can't change the display mode settings, so only the values read here need to be overridden
+		auto getValue = [a_preset](const Setting& a_setting) {
+			const auto presetValue = a_preset ? a_preset->GetValue(a_setting.id) : std::nullopt;
+			return presetValue ? *presetValue : a_setting.GetAsDouble();
+		};
+
 		a_outShaderConstants.DisplayMode = GetActualDisplayMode(true);
 		// TODO: expose HDR screenshot normalization as a user (advanced/config only) setting
 		if (bRequestedHDRScreenshot) {
@@ -274,52 +475,119 @@ namespace Settings
 			a_outShaderConstants.PeakBrightness = 10000.f;
 		}
 		else {
-			a_outShaderConstants.PeakBrightness = static_cast<float>(PeakBrightness.value.get_data());
+			a_outShaderConstants.PeakBrightness = static_cast<float>(getValue(PeakBrightness));
 		}
-		a_outShaderConstants.GamePaperWhite = static_cast<float>(GamePaperWhite.value.get_data());
-		a_outShaderConstants.UIPaperWhite = static_cast<float>(UIPaperWhite.value.get_data());
-		a_outShaderConstants.ExtendGamut = static_cast<float>(ExtendGamut.value.get_data()) * 0.01f;                      // 0-100 to 0-1
-		a_outShaderConstants.bAutoHDRVideos = static_cast<uint32_t>(AutoHDRVideos.value.get_data());
+
+		// Members that directly map to a setting
+		for (const auto& field : shaderConstantFields) {
+			if (field.source) {
+				if (const auto setting = FindSetting(*field.source)) {
+					const float value = static_cast<float>(getValue(*setting)) * field.scale + field.bias;
+					auto* const data = reinterpret_cast<std::byte*>(&a_outShaderConstants) + field.offset;
+					switch (field.type) {
+					case ShaderConstantType::kInt:
+						*reinterpret_cast<int32_t*>(data) = static_cast<int32_t>(value);
+						break;
+					case ShaderConstantType::kUInt:
+						*reinterpret_cast<uint32_t*>(data) = static_cast<uint32_t>(value);
+						break;
+					case ShaderConstantType::kFloat:
+						*reinterpret_cast<float*>(data) = value;
+						break;
+					}
+				}
+			}
+		}
+
 		// There is no reason this wouldn't work in HDR, but for now it's disabled
-		a_outShaderConstants.SDRSecondaryBrightness = IsGameRenderingSetToHDR(true) ? 1.f : (static_cast<float>(SecondaryBrightness.value.get_data()) * 0.02f); // 0-100 to 0-2
+		a_outShaderConstants.SDRSecondaryBrightness = IsGameRenderingSetToHDR(true) ? 1.f : (static_cast<float>(getValue(SecondaryBrightness)) * 0.02f); // 0-100 to 0-2
 
-		a_outShaderConstants.ToneMapperType = static_cast<uint32_t>(ToneMapperType.value.get_data());
-		a_outShaderConstants.Saturation = Utils::linearNormalization(static_cast<float>(Saturation.value.get_data()), 0.f, 100.f, 0.5f, 1.5f); // 0-100 to 0.5 - 1.5
-		a_outShaderConstants.Contrast = Utils::linearNormalization(static_cast<float>(Contrast.value.get_data()), 0.f, 100.f, 0.5f, 1.5f);     // 0-100 to 0.5 - 1.5
-		a_outShaderConstants.Highlights = IsCustomToneMapper()
-			? static_cast<float>(Highlights.value.get_data()) * 0.01f // 0-100 to 0-1
+		const bool bIsCustomToneMapper = IsDisplayModeSetToHDR() || getValue(ToneMapperType) > 0.0;  // See "IsCustomToneMapper()"
+		a_outShaderConstants.Highlights = bIsCustomToneMapper
+			? static_cast<float>(getValue(Highlights)) * 0.01f // 0-100 to 0-1
 			: 0.5f;
-		a_outShaderConstants.Shadows = IsCustomToneMapper() 
-			? static_cast<float>(Shadows.value.get_data()) * 0.01f    // 0-100 to 0-1
+		a_outShaderConstants.Shadows = bIsCustomToneMapper
+			? static_cast<float>(getValue(Shadows)) * 0.01f    // 0-100 to 0-1
 			: 0.5f;
-		a_outShaderConstants.Bloom = static_cast<float>(Bloom.value.get_data() * 0.01f);                                    // 0-100 to 0-1
-
-		a_outShaderConstants.ColorGradingStrength = static_cast<float>(ColorGradingStrength.value.get_data()) * 0.01f;    // 0-100 to 0-1
-		a_outShaderConstants.LUTCorrectionStrength = static_cast<float>(LUTCorrectionStrength.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.StrictLUTApplication = static_cast<uint32_t>(StrictLUTApplication.value.get_data());
-
-		a_outShaderConstants.GammaCorrectionStrength = static_cast<float>(GammaCorrectionStrength.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.FilmGrainType = static_cast<uint32_t>(FilmGrainType.value.get_data());
-		a_outShaderConstants.FilmGrainFPSLimit = static_cast<float>(FilmGrainFPSLimit.value.get_data());
-		a_outShaderConstants.PostSharpen = static_cast<uint32_t>(PostSharpen.value.get_data());
 
 		a_outShaderConstants.bIsAtEndOfFrame = static_cast<uint32_t>(bIsAtEndOfFrame.load());
 		a_outShaderConstants.RuntimeMS = *Offsets::g_durationOfApplicationRunTimeMS;
-		a_outShaderConstants.DevSetting01 = static_cast<float>(DevSetting01.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.DevSetting02 = static_cast<float>(DevSetting02.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.DevSetting03 = static_cast<float>(DevSetting03.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.DevSetting04 = static_cast<float>(DevSetting04.value.get_data()) * 0.01f;  // 0-100 to 0-1
-		a_outShaderConstants.DevSetting05 = static_cast<float>(DevSetting05.value.get_data()) * 0.01f;  // 0-100 to 0-1
 
-		if (a_shaderConstantsMode == ShaderConstantsMode::kLUT && VanillaMenuLUTs.value.get_data() && !Utils::ShouldCorrectLUTs()) {
+		if (a_shaderConstantsMode == ShaderConstantsMode::kLUT && getValue(VanillaMenuLUTs) != 0.0 && !Utils::ShouldCorrectLUTs()) {
 			a_outShaderConstants.LUTCorrectionStrength = 0.f;
 			a_outShaderConstants.ColorGradingStrength = 1.f;
 		}
     }
 
+    void Main::GetCachedShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode)
+    {
+		// Note: this is called from multiple render threads concurrently, up to a few times per frame for every Luma technique.
+		// All the expensive work is done in "RefreshShaderConstants()", which only runs after an input has changed.
+		if (shaderConstantsPublishedEpoch.load(std::memory_order_acquire) != GetShaderConstantsInputsEpoch()) {
+			RefreshShaderConstants();
+		}
+
+		shaderConstantsSnapshots[static_cast<size_t>(a_shaderConstantsMode)].Read(a_outShaderConstants);
+
+		// These change every frame so there's no point in caching them
+		a_outShaderConstants.bIsAtEndOfFrame = static_cast<uint32_t>(bIsAtEndOfFrame.load());
+		a_outShaderConstants.RuntimeMS = *Offsets::g_durationOfApplicationRunTimeMS;
+    }
+
+    void Main::RefreshShaderConstants()
+    {
+		// If settings are being applied (or another thread is already rebuilding), keep using the last snapshot rather than waiting, the next read rebuilds it.
+		// Only the very first snapshot is waited for, there's nothing valid to use before it.
+		std::unique_lock<std::mutex> lock(shaderConstantsMutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			if (shaderConstantsPublishedEpoch.load(std::memory_order_acquire) != 0) {
+				return;
+			}
+			lock.lock();
+		}
+
+		// Read the epoch before the inputs, so that any change made while we rebuild triggers another refresh
+		const uint64_t inputsEpoch = GetShaderConstantsInputsEpoch();
+		if (shaderConstantsPublishedEpoch.load(std::memory_order_relaxed) == inputsEpoch) {
+			return;  // Another thread already did it
+		}
+
+		for (size_t i = 0; i < shaderConstantsSnapshots.size(); ++i) {
+			ShaderConstants shaderConstants;
+			GetShaderConstants(shaderConstants, static_cast<ShaderConstantsMode>(i));
+			shaderConstantsSnapshots[i].Publish(shaderConstants);
+		}
+
+		shaderConstantsPublishedEpoch.store(inputsEpoch, std::memory_order_release);
+    }
+
+    void Main::PrecomputePresetShaderConstants(Preset& a_preset) const
+    {
+		// Read the epoch before the inputs, so that any change made in the meantime invalidates them
+		auto& precomputed = a_preset.precomputedShaderConstants.emplace();
+		precomputed.inputsEpoch = GetShaderConstantsInputsEpoch();
+		for (size_t i = 0; i < precomputed.shaderConstants.size(); ++i) {
+			GetShaderConstants(precomputed.shaderConstants[i], static_cast<ShaderConstantsMode>(i), &a_preset);
+		}
+    }
+
+    void Main::CheckShaderConstantsInputs()
+    {
+		// Some inputs of the shader constants live in the game's memory and aren't changed through us, so poll them once per frame
+		const RE::FrameGenerationTech frameGenerationTech = *Offsets::uiFrameGenerationTech;
+		const bool bShouldCorrectLUTs = Utils::ShouldCorrectLUTs();
+		if (frameGenerationTech != lastFrameGenerationTech || bShouldCorrectLUTs != bLastShouldCorrectLUTs) {
+			lastFrameGenerationTech = frameGenerationTech;
+			bLastShouldCorrectLUTs = bShouldCorrectLUTs;
+			MarkShaderConstantsDirty();
+		}
+    }
+
     void Main::InitConfig(bool a_bIsSFSE)
 	{
 		config = a_bIsSFSE ? &sfseConfig : &asiConfig;
+		configPath = a_bIsSFSE ? "Data\\SFSE\\Plugins\\Luma.toml" : "Luma.toml";
+
 	}
 
     void Main::RegisterReshadeOverlay()
@@ -340,45 +608,9 @@ namespace Settings
 	{
 		static std::once_flag ConfigInit;
 		std::call_once(ConfigInit, [&]() {
-			// HDR
-			config->Bind(DisplayMode.value, DisplayMode.defaultValue);
-			config->Bind(EnforceUserDisplayMode.value, EnforceUserDisplayMode.defaultValue);
-			config->Bind(ForceSDROnHDR.value, ForceSDROnHDR.defaultValue);
-			config->Bind(PeakBrightness.value, PeakBrightness.defaultValue);
-			config->Bind(GamePaperWhite.value, GamePaperWhite.defaultValue);
-			config->Bind(UIPaperWhite.value, UIPaperWhite.defaultValue);
-			config->Bind(ExtendGamut.value, ExtendGamut.defaultValue);
-			config->Bind(AutoHDRVideos.value, AutoHDRVideos.defaultValue);
-
-			// SDR
-			config->Bind(SecondaryBrightness.value, SecondaryBrightness.defaultValue);
-
-			// Tone-mapper
-			config->Bind(ToneMapperType.value, ToneMapperType.defaultValue);
-			config->Bind(Saturation.value, Saturation.defaultValue);
-			config->Bind(Contrast.value, Contrast.defaultValue);
-			config->Bind(Highlights.value, Highlights.defaultValue);
-			config->Bind(Shadows.value, Shadows.defaultValue);
-			config->Bind(Bloom.value, Bloom.defaultValue);
-
-			// Color Grading
-			config->Bind(ColorGradingStrength.value, ColorGradingStrength.defaultValue);
-			config->Bind(LUTCorrectionStrength.value, LUTCorrectionStrength.defaultValue);
-			config->Bind(VanillaMenuLUTs.value, VanillaMenuLUTs.defaultValue);
-			config->Bind(StrictLUTApplication.value, StrictLUTApplication.defaultValue);
-
-			config->Bind(GammaCorrectionStrength.value, GammaCorrectionStrength.defaultValue);
-			config->Bind(FilmGrainType.value, FilmGrainType.defaultValue);
-			config->Bind(FilmGrainFPSLimit.value, FilmGrainFPSLimit.defaultValue);
-			config->Bind(PostSharpen.value, PostSharpen.defaultValue);
-			config->Bind(HDRScreenshots.value, HDRScreenshots.defaultValue);
-			config->Bind(HDRScreenshotsLossless.value, HDRScreenshotsLossless.defaultValue);
-			config->Bind(DLSSFGToFSRFGMod.value, DLSSFGToFSRFGMod.defaultValue);
-			config->Bind(DevSetting01.value, DevSetting01.defaultValue);
-			config->Bind(DevSetting02.value, DevSetting02.defaultValue);
-			config->Bind(DevSetting03.value, DevSetting03.defaultValue);
-			config->Bind(DevSetting04.value, DevSetting04.defaultValue);
-			config->Bind(DevSetting05.value, DevSetting05.defaultValue);
+			for (auto setting : settings) {
+				setting->Bind(*config);
+			}
 			config->Bind(RenderTargetsToUpgrade,
 				"ImageSpaceBuffer",
 				"ScaleformCompositeBuffer", // Not upgrading this could cause issues with FSR FG as the swapchain would be in a different format than the UI buffer (untested), and maybe it would break AutoHDR bink videos.
@@ -397,24 +629,279 @@ namespace Settings
 				"ColorBuffer01"  // issues on AMD
 			);
 			config->Bind(UpgradeExtraRenderTargets, false);
+			config->Bind(UseRenderTargetFormatPolicies, false);
+			config->Bind(RenderTargetsVRAMBudgetMB, 0);
 			config->Bind(PeakBrightnessAutoDetected, false);
+			config->Bind(ConfigSaveDebounceMS, 250);
 		});
 
-		config->Load();
+		{
+			std::lock_guard<std::mutex> lg(configMutex);
+			config->Load();
+			for (auto setting : settings) {
+				setting->LoadFromConfig();
+			}
+		}
 
 		INFO("Config loaded"sv)
 
+		const auto configSaveDebounce = std::chrono::milliseconds(std::clamp(static_cast<int64_t>(ConfigSaveDebounceMS.get_data()), int64_t(0), int64_t(10000)));
+		if (!configWriter) {
+			configWriter = std::make_unique<ConfigWriter>([this]() { WriteConfig(); }, configSaveDebounce);
+		} else {
+			configWriter->SetDebounce(configSaveDebounce);
+		}
+
+		// Watch the config for external edits, so values can be tuned with a text editor while the game is running
+		if (!configWatcher) {
+			configWatcher = std::make_unique<ConfigWatcher>(configPath, [this]() { ReloadConfig(); }, std::chrono::milliseconds(500));
+		}
+
 		// Default to the last value saved in the config, to avoid issues on startup if we detected the DLSS to FSR FG mod too late,
 		// which makes the display mode change in a non thread safe (?) manner that makes the game crash.
 		// This workaround avoids crashes all the times except once when adding or removing the mod.
-		bIsDLSSFGToFSRFGPresent = *DLSSFGToFSRFGMod.value;
+		bIsDLSSFGToFSRFGPresent = DLSSFGToFSRFGMod.Get();
+
+		LoadPresets();
+
+		MarkShaderConstantsDirty();
 	}
 
+    void Main::LoadPresets()
+    {
+		auto presetsPath = configPath;
+		presetsPath.replace_filename("Luma-Presets.toml");
+
+		std::ifstream file(presetsPath, std::ios::binary);
+		if (!file) {
+			return;  // Presets are optional
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+
+		auto parsedPresets = ParsePresets(buffer.str(), settings);
+		if (!parsedPresets) {
+			return;  // Keep the previous ones
+		}
+
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		presets = std::move(*parsedPresets);
+		pressedPresetHotkeys.clear();
+
+		INFO("Loaded {} presets", presets.size())
+    }
+
+    bool Main::ApplyPreset(std::string_view a_name)
+    {
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		const auto it = std::ranges::find(presets, a_name, &Preset::name);
+		if (it == presets.end()) {
+			WARN("Preset \"{}\" not found", a_name)
+			return false;
+		}
+
+		ApplyPresetValues(*it);
+		return true;
+    }
+
+    bool Main::ApplySettingValues(const SettingValues& a_values, Preset* a_preset)
+    {
+		// The render threads don't rebuild the snapshots while this is held, they keep reading the previous ones, so they never see half applied values
+		std::lock_guard<std::mutex> lg(shaderConstantsMutex);
+
+		if (a_preset && (!a_preset->precomputedShaderConstants || a_preset->precomputedShaderConstants->inputsEpoch != GetShaderConstantsInputsEpoch())) {
+			PrecomputePresetShaderConstants(*a_preset);
+		}
+
+		uint64_t changedCount = 0;
+		for (const auto& [id, value] : a_values) {
+			// The display mode settings are filtered out by the callers, changing them here wouldn't be safe (see "IsDisplayModeSetting()")
+			const auto setting = FindSetting(id);
+			if (setting && !IsDisplayModeSetting(id) && setting->GetAsDouble() != value) {
+				setting->SetFromDouble(value);
+				++changedCount;
+			}
+		}
+
+		if (a_preset && changedCount > 0) {
+			const auto& precomputed = *a_preset->precomputedShaderConstants;
+			for (size_t i = 0; i < shaderConstantsSnapshots.size(); ++i) {
+				shaderConstantsSnapshots[i].Publish(precomputed.shaderConstants[i]);
+			}
+
+			// Each change bumps the epoch once, if anything else changed in the meantime the snapshots are left to be rebuilt on the next read
+			const uint64_t inputsEpoch = precomputed.inputsEpoch + changedCount;
+			if (GetShaderConstantsInputsEpoch() == inputsEpoch) {
+				shaderConstantsPublishedEpoch.store(inputsEpoch, std::memory_order_release);
+			}
+		}
+
+		return changedCount > 0;
+    }
+
+    void Main::ApplyPresetValues(Preset& a_preset)
+    {
+		if (ApplySettingValues(a_preset.values, &a_preset)) {
+			INFO("Applied preset \"{}\"", a_preset.name)
+			Save();
+
+			// Have the presets ready for the next switch (e.g. toggling between two with hotkeys), so it's only a snapshot swap
+			for (auto& preset : presets) {
+				PrecomputePresetShaderConstants(preset);
+			}
+		}
+    }
+
+    void Main::ReloadConfig()
+    {
+		// Hold the config lock while reading, so our own writes can't be mistaken for external changes
+		std::string toml;
+		{
+			std::lock_guard<std::mutex> lg(configMutex);
+			if (configWatcher->IsCurrentVersionIgnored()) {
+				return;
+			}
+
+			std::ifstream file(configPath, std::ios::binary);
+			if (!file) {
+				return;
+			}
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			toml = buffer.str();
+		}
+
+		const auto values = ParseConfigValues(toml, settings);
+		if (!values) {
+			WARN("Ignoring the changes to the config, keeping the current settings")
+			return;
+		}
+
+		SettingValues deferredValues;
+		const auto    changedValues = DiffSettingValues(*values, settings, deferredValues);
+		{
+			std::lock_guard<std::mutex> lg(configMutex);
+			deferredConfigValues.clear();
+			for (const auto& [id, value] : deferredValues) {
+				deferredConfigValues.push_back({ id, value, FindSetting(id)->GetAsDouble() });
+			}
+		}
+
+		if (ApplySettingValues(changedValues)) {
+			INFO("Config reloaded, {} settings changed", changedValues.size())
+		}
+    }
+
+    bool Main::BindPresetHotkey(std::string_view a_name, uint32_t a_virtualKey)
+    {
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		const auto it = std::ranges::find(presets, a_name, &Preset::name);
+		if (it == presets.end()) {
+			return false;
+		}
+
+		std::erase(pressedPresetHotkeys, it->hotkey);
+		it->hotkey = a_virtualKey;
+		return true;
+    }
+
+    void Main::UpdatePresetHotkeys()
+    {
+		// Don't react to keys pressed in other windows
+		if (!swapChainObject || GetForegroundWindow() != swapChainObject->hwnd) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		for (auto& preset : presets) {
+			if (preset.hotkey == 0) {
+				continue;
+			}
+
+			const bool bPressed = (GetAsyncKeyState(static_cast<int>(preset.hotkey)) & 0x8000) != 0;
+			const auto pressedIt = std::ranges::find(pressedPresetHotkeys, preset.hotkey);
+			const bool bWasPressed = pressedIt != pressedPresetHotkeys.end();
+			if (bPressed && !bWasPressed) {
+				pressedPresetHotkeys.push_back(preset.hotkey);
+				ApplyPresetValues(preset);
+			} else if (!bPressed && bWasPressed) {
+				pressedPresetHotkeys.erase(pressedIt);
+			}
+		}
+    }
+
+    std::vector<std::string> Main::GetPresetNames() const
+    {
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		std::vector<std::string> names;
+		names.reserve(presets.size());
+		for (const auto& preset : presets) {
+			names.push_back(preset.name);
+		}
+		return names;
+    }
+
+    std::vector<PresetDifference> Main::DiffPresets(std::string_view a_from, std::string_view a_to) const
+    {
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		const auto from = std::ranges::find(presets, a_from, &Preset::name);
+		const auto to = std::ranges::find(presets, a_to, &Preset::name);
+		if (from == presets.end() || to == presets.end()) {
+			return {};
+		}
+		return Settings::DiffPresets(*from, *to);
+    }
+
     void Main::Save() noexcept
+    {
+		// This is called from the game and UI threads (e.g. every frame while dragging a slider), so the actual write is deferred and coalesced
+		if (configWriter) {
+			configWriter->RequestWrite();
+		} else {
+			WriteConfig();
+		}
+    }
+
+    void Main::Shutdown()
+    {
+		// The writer's last write tells the watcher to ignore it, so the watcher is stopped after
+		if (configWriter) {
+			configWriter->Shutdown();
+		}
+		if (configWatcher) {
+			configWatcher->Stop();
+		}
+    }
+
+    void Main::WriteConfig() noexcept
     {
 		std::lock_guard<std::mutex> lg(configMutex);
+		// Take a copy of the live values, they might keep changing on other threads while we write
+		for (auto setting : settings) {
+			setting->SaveToConfig();
+		}
+		std::erase_if(deferredConfigValues, [this](const DeferredConfigValue& a_deferred) {
+			return FindSetting(a_deferred.id)->GetAsDouble() != a_deferred.liveValue;
+		});
+		for (const auto& deferred : deferredConfigValues) {
+			FindSetting(deferred.id)->SaveValueToConfig(deferred.configValue);
+		}
 		config->Generate();
-		config->Write();
+
+		// Write to a temporary file and swap it in, so the config is never left half written if the game closes or crashes during the write
+		auto tempPath = configPath;
+		tempPath += ".tmp";
+		config->Write(tempPath.string());
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, configPath, ec);
+		if (ec) {
+			WARN("Failed to replace the config file: {}", ec.message())
+		}
+
+		if (configWatcher) {
+			configWatcher->IgnoreCurrentVersion();
+		}
     }
 
     void Main::DrawReshadeSettings(reshade::api::effect_runtime*)
@@ -437,18 +924,37 @@ namespace Settings
 		}
 	}
 
+    void Main::DrawReshadePresets()
+    {
+		std::lock_guard<std::mutex> lg(presetsMutex);
+		if (presets.empty()) {
+			return;
+		}
+
+		if (ImGui::BeginCombo("Preset", "Apply a preset...")) {
+			for (auto& preset : presets) {
+				if (ImGui::Selectable(preset.name.c_str())) {
+					ApplyPresetValues(preset);
+				}
+			}
+			ImGui::EndCombo();
+		}
+		DrawReshadeTooltip("Applies all the values of a preset from \"Luma-Presets.toml\". Settings that aren't part of the preset keep their current value.");
+		ImGui::Spacing();
+    }
+
     bool Main::DrawReshadeCheckbox(Checkbox& a_checkbox)
     {
 		bool result = false;
-		bool tempValue = *a_checkbox.value;
+		bool tempValue = a_checkbox.Get();
 		if (ImGui::Checkbox(a_checkbox.name.c_str(), &tempValue)) {
-			*a_checkbox.value = tempValue;
+			a_checkbox.Set(tempValue);
 			Save();
 			result = true;
 		}
 		DrawReshadeTooltip(a_checkbox.description.c_str());
 		if (DrawReshadeResetButton(a_checkbox)) {
-			*a_checkbox.value = a_checkbox.defaultValue;
+			a_checkbox.Set(a_checkbox.defaultValue);
 			Save();
 			result = true;
 		}
@@ -458,15 +964,15 @@ namespace Settings
     bool Main::DrawReshadeEnumStepper(EnumStepper& a_stepper)
     {
 		bool result = false;
-		int tempValue = *a_stepper.value;
+		int tempValue = a_stepper.Get();
 		if (ImGui::SliderInt(a_stepper.name.c_str(), &tempValue, 0, a_stepper.GetNumOptions() - 1, a_stepper.GetStepperText(tempValue).c_str(), ImGuiSliderFlags_NoInput)) {
-			*a_stepper.value = tempValue;
+			a_stepper.Set(tempValue);
 			Save();
 			result = true;
 		}
 		DrawReshadeTooltip(a_stepper.description.c_str());
 		if (DrawReshadeResetButton(a_stepper)) {
-			*a_stepper.value = a_stepper.defaultValue;
+			a_stepper.Set(a_stepper.defaultValue);
 			Save();
 			result = true;
 		}
@@ -476,15 +982,15 @@ namespace Settings
     bool Main::DrawReshadeValueStepper(ValueStepper& a_stepper)
 	{
 		bool result = false;
-		int tempValue = *a_stepper.value;
+		int tempValue = a_stepper.Get();
 		if (ImGui::SliderInt(a_stepper.name.c_str(), &tempValue, a_stepper.minValue, a_stepper.maxValue, std::to_string(tempValue).c_str())) {
-			*a_stepper.value = tempValue;
+			a_stepper.Set(tempValue);
 			Save();
 			result = true;
 		}
 		DrawReshadeTooltip(a_stepper.description.c_str());
 		if (DrawReshadeResetButton(a_stepper)) {
-			*a_stepper.value = a_stepper.defaultValue;
+			a_stepper.Set(a_stepper.defaultValue);
 			Save();
 			result = true;
 		}
@@ -494,15 +1000,15 @@ namespace Settings
     bool Main::DrawReshadeSlider(Slider& a_slider)
     {
 		bool result = false;
-		float tempValue = *a_slider.value;
+		float tempValue = a_slider.Get();
 		if (ImGui::SliderFloat(a_slider.name.c_str(), &tempValue, a_slider.sliderMin, a_slider.sliderMax, "%.0f")) {
-			*a_slider.value = tempValue;
+			a_slider.Set(tempValue);
 			Save();
 			result = true;
 		}
 		DrawReshadeTooltip(a_slider.description.c_str());
 		if (DrawReshadeResetButton(a_slider)) {
-			*a_slider.value = a_slider.defaultValue;
+			a_slider.Set(a_slider.defaultValue);
 			Save();
 			result = true;
 		}
@@ -534,10 +1040,11 @@ namespace Settings
 		const auto currentPos = ImGui::GetWindowPos();
 		ImGui::SetWindowPos(ImVec2(io.DisplaySize.x / 3, currentPos.y), ImGuiCond_FirstUseEver);
 
-		const bool isSDRForcedOnHDR = IsSDRForcedOnHDR();
-		const bool isGameRenderingSetToHDR = IsGameRenderingSetToHDR();
-		const bool isFSR3FGEnabled = IsFSR3FGEnabled();
-		const bool isCustomToneMapper = IsCustomToneMapper();
+		DrawReshadePresets();
+
+		reshadeEnableStates.Update(GetEnableInputs());
+		auto IsVisible = [this](const Setting& a_setting) { return reshadeEnableStates.IsEnabled(a_setting.id); };
+
 		if (IsHDRSupported()) {
 			// TODO: fix, these can often crash when changed during gameplay if FG is enabled (it doesn't seem to be a threading issue).
 			// FSR FG crashes all the times while DLSS FG crashes sometimes.
@@ -559,32 +1066,29 @@ namespace Settings
 #endif
 		}
 
-		if (isGameRenderingSetToHDR) {
+		if (IsVisible(PeakBrightness)) {
 			DrawReshadeValueStepper(PeakBrightness);
+		}
+		if (IsVisible(GamePaperWhite)) {
 			DrawReshadeValueStepper(GamePaperWhite);
-#if !FSR_3_FG_SUPPORTS_UI_PAPER_WHITE
-			if (!isFSR3FGEnabled)
-#endif
-			{
-				DrawReshadeValueStepper(UIPaperWhite);
-			}
 		}
-		else
-		{
-			if (isSDRForcedOnHDR) {
-				DrawReshadeValueStepper(GamePaperWhite);
-			}
+		if (IsVisible(UIPaperWhite)) {
+			DrawReshadeValueStepper(UIPaperWhite);
+		}
+		if (IsVisible(SecondaryBrightness)) {
 			DrawReshadeSlider(SecondaryBrightness);
 		}
 
 		DrawReshadeEnumStepper(ToneMapperType);
 		DrawReshadeSlider(Saturation);
 		DrawReshadeSlider(Contrast);
-		if (isCustomToneMapper) {
+		if (IsVisible(Highlights)) {
 			DrawReshadeSlider(Highlights);
+		}
+		if (IsVisible(Shadows)) {
 			DrawReshadeSlider(Shadows);
 		}
-		if (isGameRenderingSetToHDR) {
+		if (IsVisible(ExtendGamut)) {
 			DrawReshadeSlider(ExtendGamut);
 		}
 		DrawReshadeSlider(Bloom);
@@ -592,24 +1096,33 @@ namespace Settings
 		DrawReshadeSlider(ColorGradingStrength);
 		DrawReshadeSlider(LUTCorrectionStrength);
 		DrawReshadeCheckbox(VanillaMenuLUTs);
-		if (isGameRenderingSetToHDR) {
+		if (IsVisible(StrictLUTApplication)) {
 			DrawReshadeCheckbox(StrictLUTApplication);
+		}
+		if (IsVisible(AutoHDRVideos)) {
 			DrawReshadeCheckbox(AutoHDRVideos);
 		}
 
 		DrawReshadeSlider(GammaCorrectionStrength);
 		DrawReshadeEnumStepper(FilmGrainType);
-		if (IsFilmGrainTypeImproved()) {
+		if (IsVisible(FilmGrainFPSLimit)) {
 			DrawReshadeSlider(FilmGrainFPSLimit);
 		}
 		DrawReshadeCheckbox(PostSharpen);
 		ImGui::Spacing();
 		DrawReshadeCheckbox(HDRScreenshots);
-		if (HDRScreenshots.value) {
-			ImGui::SameLine();
-			DrawReshadeCheckbox(HDRScreenshotsLossless);
+		if (HDRScreenshots.Get()) {
+			DrawReshadeEnumStepper(HDRScreenshotsFormat);
+			if (HDRScreenshotsFormat.Get() == 0) {
+				ImGui::SameLine();
+				DrawReshadeCheckbox(HDRScreenshotsLossless);
+			}
 		}
 
+#if ENABLE_HOOK_STATISTICS
+		DrawReshadeHookStatistics();
+#endif
+
 #if DEVELOPMENT
 		DrawReshadeSlider(DevSetting01);
 		DrawReshadeSlider(DevSetting02);
@@ -618,4 +1131,47 @@ namespace Settings
 		DrawReshadeSlider(DevSetting05);
 #endif
     }
+
+#if ENABLE_HOOK_STATISTICS
+    void Main::DrawReshadeHookStatistics()
+    {
+		if (!ImGui::CollapsingHeader("Hook Statistics")) {
+			return;
+		}
+
+		Statistics::HookStatistics::GetSingleton()->ReadHistory([](const Statistics::History& a_history) {
+			const auto average = a_history.GetAverage();
+			const auto max = a_history.GetMax();
+
+			std::array<float, Statistics::historySize> callsPlot;
+			const size_t callsPlotCount = a_history.GetCallsPlot(callsPlot);
+			const std::string overlayText = std::format("avg {} max {}", average.calls, max.calls);
+			ImGui::PlotLines("Hook calls per frame", callsPlot.data(), static_cast<int>(callsPlotCount), 0, overlayText.c_str(), 0.f, FLT_MAX, ImVec2(0, 60));
+
+			std::array<float, Statistics::histogramBuckets> histogram;
+			std::ranges::copy(a_history.GetCallsHistogram(), histogram.begin());
+			ImGui::PlotHistogram("Hook calls histogram (log2)", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+
+			if (ImGui::BeginTable("Techniques", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("Technique");
+				ImGui::TableSetupColumn("Matches (avg)");
+				ImGui::TableSetupColumn("Matches (max)");
+				ImGui::TableSetupColumn("Upload bytes (avg)");
+				ImGui::TableHeadersRow();
+				for (size_t i = 0; i < Techniques::manifestSize; ++i) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s (%llx)", Techniques::manifest[i].name.data(), Techniques::manifest[i].id);
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", average.matches[i]);
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", max.matches[i]);
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", average.uploadBytes[i]);
+				}
+				ImGui::EndTable();
+			}
+		});
+    }
+#endif
 }
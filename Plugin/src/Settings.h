@@ -1,6 +1,10 @@
 #pragma once
+#include "ConfigWatcher.h"
+#include "ConfigWriter.h"
+#include "EnableStates.h"
 #include "Offsets.h"
 #include "RE/Buffers.h"
+#include "ShaderConstants.h"
 
 #include "reshade/reshade.hpp"
 
@@ -13,106 +17,117 @@
 // TODO: set to false in release builds (use the build configuation to automatically define it)
 #define DEVELOPMENT 0
 
-// FSR 3 FG uses its own shader to blend in the UI and at the moment we don't have code to override it (well, we do, but we can't inject buffers to scale the UI brightness dynamically)
-#define FSR_3_FG_SUPPORTS_UI_PAPER_WHITE 0
+// Counts the render pass hook calls and Luma technique matches, shown in the ReShade overlay and periodically logged.
+// When disabled, none of the counting code is compiled in.
+#define ENABLE_HOOK_STATISTICS DEVELOPMENT
 
 namespace Settings
 {
     using namespace DKUtil::Alias;
 
-    enum class SettingID : unsigned int
-    {
-		// Bethesda's settings (subject to change):
-		kUpscalingTechnique = 23,
-		kFrameGeneration = 25,
-
-		// Make sure our settings IDs are all after Bethesda's ones
-		kSTART = 600,
-
-		kDisplayMode,
-		kEnforceUserDisplayMode,
-		kForceSDROnHDR,
-		kHDR_PeakBrightness,
-		kHDR_GamePaperWhite,
-		kHDR_UIPaperWhite,
-		kHDR_ExtendGamut,
-		kHDR_AutoHDRVideos,
-
-		kSecondaryBrightness,
-
-		kToneMapperType,
-		kToneMapperSaturation,
-		kToneMapperContrast,
-		kToneMapperHighlights,
-		kToneMapperShadows,
-		kToneMapperBloom,
-
-		kColorGradingStrength,
-		kLUTCorrectionStrength,
-		kVanillaMenuLUTs,
-		kStrictLUTApplication,
-
-		kGammaCorrectionStrength,
-		kFilmGrainType,
-		kFilmGrainFPSLimit,
-		kPostSharpen,
-		kHDRScreenshots,
-		kHDRScreenshotsLossless,
-		kDLSSFGToFSRFGMod,
-
-		kEND,
-
-		kDevSetting01,
-		kDevSetting02,
-		kDevSetting03,
-		kDevSetting04,
-		kDevSetting05,
-    };
+
+	enum class SettingType
+	{
+		kCheckbox,
+		kStepper,
+		kSlider
+	};
 
 	class Setting
 	{
 	public:
 		SettingID id;
+		SettingType type;
 	    std::string name;
 		std::string description;
+		std::string key;  // Name in the config (and presets)
+		std::string section;
 
-		Setting(SettingID a_id, const std::string& a_name, const std::string& a_description) :
-			id(a_id), name(a_name), description(a_description)
+		Setting(SettingID a_id, SettingType a_type, const std::string& a_name, const std::string& a_description, const std::string& a_key, const std::string& a_section) :
+			id(a_id), type(a_type), name(a_name), description(a_description), key(a_key), section(a_section)
 		{}
 
 		virtual ~Setting() = default;
 		virtual bool IsDefault() const = 0;
-        
+		// Type erased value, for generic code (e.g. shader constants and presets)
+		virtual double GetAsDouble() const = 0;
+		virtual void SetFromDouble(double a_value) = 0;
+		virtual bool IsValidValue(double a_value) const = 0;
+
+		virtual void Bind(TomlConfig& a_config) = 0;
+
+		// The live values are atomics that any thread can read, the TOML config values are only a serialization view over them.
+		// These copy between the two, and should only be called while holding the config lock.
+		virtual void LoadFromConfig() = 0;
+		void SaveToConfig() { SaveValueToConfig(GetAsDouble()); }
+		// Writes a value other than the live one (e.g. a config edit that only takes effect after a restart)
+		virtual void SaveValueToConfig(double a_value) = 0;
+
+		// Bumped by every change to any setting value, anything derived from the settings can be cached against it
+		static uint64_t GetGeneration() { return generation.load(std::memory_order_acquire); }
+
+	protected:
+		static void OnValueChanged() { generation.fetch_add(1, std::memory_order_acq_rel); }
+
+	private:
+		static inline std::atomic_uint64_t generation = 0;
 	};
 
 	class Checkbox : public Setting
 	{
 	public:
-	    Boolean value;
+		static constexpr SettingType settingType = SettingType::kCheckbox;
+
+	    Boolean configValue;
 		bool defaultValue;
 
 		Checkbox(SettingID a_id, const std::string& a_name, const std::string& a_description, const std::string& a_key, const std::string& a_section, bool a_defaultValue) :
-			Setting{ a_id, a_name, a_description }, value{ a_key, a_section }, defaultValue(a_defaultValue) {}
+			Setting{ a_id, settingType, a_name, a_description, a_key, a_section }, configValue{ a_key, a_section }, defaultValue(a_defaultValue), value(a_defaultValue) {}
 
-		bool IsDefault() const override { return value.get_data() == defaultValue; }
+		bool IsDefault() const override { return Get() == defaultValue; }
+		double GetAsDouble() const override { return Get() ? 1.0 : 0.0; }
+		void SetFromDouble(double a_value) override { Set(a_value != 0.0); }
+		bool IsValidValue(double a_value) const override { return a_value == 0.0 || a_value == 1.0; }
+		void Bind(TomlConfig& a_config) override { a_config.Bind(configValue, defaultValue); }
+		void LoadFromConfig() override { Set(configValue.get_data()); }
+		void SaveValueToConfig(double a_value) override { *configValue = a_value != 0.0; }
+
+		bool Get() const { return value.load(std::memory_order_relaxed); }
+		void Set(bool a_value) { value.store(a_value, std::memory_order_relaxed); OnValueChanged(); }
+
+	private:
+		std::atomic_bool value;
 	};
 
 	class Stepper : public Setting
 	{
 	public:
-		Integer value;
+		static constexpr SettingType settingType = SettingType::kStepper;
+
+		Integer configValue;
 		int32_t defaultValue;
 
 		Stepper(SettingID a_id, const std::string& a_name, const std::string& a_description, const std::string& a_key, const std::string& a_section, int32_t a_defaultValue) :
-			Setting{ a_id, a_name, a_description }, value{ a_key, a_section }, defaultValue(a_defaultValue) {}
+			Setting{ a_id, settingType, a_name, a_description, a_key, a_section }, configValue{ a_key, a_section }, defaultValue(a_defaultValue), value(a_defaultValue) {}
 
-		bool IsDefault() const override { return value.get_data() == defaultValue; }
+		bool IsDefault() const override { return Get() == defaultValue; }
+		double GetAsDouble() const override { return static_cast<double>(Get()); }
+		void SetFromDouble(double a_value) override { Set(static_cast<int32_t>(std::lround(a_value))); }
+		void Bind(TomlConfig& a_config) override { a_config.Bind(configValue, defaultValue); }
+		void LoadFromConfig() override { Set(static_cast<int32_t>(configValue.get_data())); }
+		void SaveValueToConfig(double a_value) override { *configValue = static_cast<int32_t>(std::lround(a_value)); }
+
+		int32_t Get() const { return value.load(std::memory_order_relaxed); }
+		void Set(int32_t a_value) { value.store(a_value, std::memory_order_relaxed); OnValueChanged(); }
 
 		virtual std::string GetStepperText(int32_t a_value) const = 0;
 		virtual int32_t GetNumOptions() const = 0;
 		virtual int32_t GetValueFromStepper(int32_t a_value) const = 0;
 		virtual int32_t GetCurrentStepFromValue() const = 0;
 		virtual void SetValueFromStepper(int32_t a_value) = 0;
+
+	private:
+		std::atomic_int32_t value;
 	};
 
 	class EnumStepper : public Stepper
@@ -126,8 +141,9 @@ namespace Settings
 		std::string GetStepperText(int32_t a_value) const override;
 		int32_t GetNumOptions() const override{ return optionNames.size(); }
 		int32_t GetValueFromStepper(int32_t a_value) const override { return a_value; }
-		int32_t GetCurrentStepFromValue() const override { return value.get_data(); }
-		void SetValueFromStepper(int32_t a_value) override { *value = a_value; }
+		int32_t GetCurrentStepFromValue() const override { return Get(); }
+		void SetValueFromStepper(int32_t a_value) override { Set(a_value); }
+		bool IsValidValue(double a_value) const override { return a_value >= 0.0 && a_value < static_cast<double>(optionNames.size()); }
 	};
 
 	class ValueStepper : public Stepper
@@ -143,74 +159,100 @@ namespace Settings
 		std::string GetStepperText(int32_t a_value) const override;
 		int32_t GetNumOptions() const override { return (maxValue - minValue) / stepSize + 1; }
 		int32_t GetValueFromStepper(int32_t a_value) const override { return a_value * stepSize + minValue; }
-		int32_t GetCurrentStepFromValue() const override { return (value.get_data() - minValue) / stepSize; }
-		void SetValueFromStepper(int32_t a_value) override { *value = GetValueFromStepper(a_value); }
+		int32_t GetCurrentStepFromValue() const override { return (Get() - minValue) / stepSize; }
+		void SetValueFromStepper(int32_t a_value) override { Set(GetValueFromStepper(a_value)); }
+		bool IsValidValue(double a_value) const override { return a_value >= minValue && a_value <= maxValue; }
 	};
 
 	class Slider : public Setting
 	{
 	public:
-	    Double value;
+		static constexpr SettingType settingType = SettingType::kSlider;
+
+	    Double configValue;
 		float  defaultValue;
 		float sliderMin;
 		float sliderMax;
 		std::string suffix = "";
 
 		Slider(SettingID a_id, const std::string& a_name, const std::string& a_description, const std::string& a_key, const std::string& a_section, float a_defaultValue, float a_sliderMin, float a_sliderMax, std::string_view a_suffix = "") :
-			Setting{ a_id, a_name, a_description }, value{ a_key, a_section }, defaultValue(a_defaultValue), sliderMin(a_sliderMin), sliderMax(a_sliderMax), suffix(a_suffix) {}
+			Setting{ a_id, settingType, a_name, a_description, a_key, a_section }, configValue{ a_key, a_section }, defaultValue(a_defaultValue), sliderMin(a_sliderMin), sliderMax(a_sliderMax), suffix(a_suffix), value(a_defaultValue) {}
+
+		bool IsDefault() const override { return Get() == defaultValue; }
+		double GetAsDouble() const override { return Get(); }
+		void SetFromDouble(double a_value) override { Set(a_value); }
+		bool IsValidValue(double a_value) const override { return a_value >= sliderMin && a_value <= sliderMax; }
+		void Bind(TomlConfig& a_config) override { a_config.Bind(configValue, defaultValue); }
+		void LoadFromConfig() override { Set(configValue.get_data()); }
+		void SaveValueToConfig(double a_value) override { *configValue = a_value; }
 
-		bool IsDefault() const override { return value.get_data() == defaultValue; }
+		double Get() const { return value.load(std::memory_order_relaxed); }
+		void   Set(double a_value) { value.store(a_value, std::memory_order_relaxed); OnValueChanged(); }
 
 		float GetSliderPercentage() const;
 		std::string GetSliderText() const;
 		float GetValueFromSlider(float a_percentage) const;
 		void SetValueFromSlider(float a_percentage);
+
+	private:
+		std::atomic<double> value;
 	};
 
-	// Has to match StructHdrDllPluginConstants in HLSL.
-	// Bools are set as uint to avoid padding inconsistencies between c++ and hlsl.
-	struct ShaderConstants
+	// Precomputed shader constants, published by the settings and copied out by the render threads.
+	// Writes are serialized by the owner, reads never block and simply retry if they raced with a write (seqlock).
+	class alignas(64) ShaderConstantsSnapshot
 	{
-		int32_t  DisplayMode;
-		float    PeakBrightness;
-		float    GamePaperWhite;
-		float    UIPaperWhite;
-		float    ExtendGamut;
-		uint32_t bAutoHDRVideos;
-
-		float    SDRSecondaryBrightness;
-
-		uint32_t ToneMapperType;
-		float    Saturation;
-		float    Contrast;
-		float    Highlights;
-		float    Shadows;
-		float    Bloom;
-
-		float    ColorGradingStrength;
-		float    LUTCorrectionStrength;
-		uint32_t StrictLUTApplication;
-
-		float    GammaCorrectionStrength;
-		uint32_t FilmGrainType;
-		float    FilmGrainFPSLimit;
-		uint32_t PostSharpen;
-		uint32_t bIsAtEndOfFrame;
-		uint32_t RuntimeMS;
-		float    DevSetting01;
-		float    DevSetting02;
-		float    DevSetting03;
-		float    DevSetting04;
-		float    DevSetting05;
+	public:
+		void Publish(const ShaderConstants& a_shaderConstants) noexcept;
+		void Read(ShaderConstants& a_outShaderConstants) const noexcept;
+
+	private:
+		std::atomic_uint32_t sequence = 0;
+		ShaderConstants      shaderConstants = {};
 	};
-	constexpr static uint32_t shaderConstantsCount = sizeof(ShaderConstants) / sizeof(uint32_t); // Number of dwords
 
-	enum class ShaderConstantsMode
+	using SettingValues = std::vector<std::pair<SettingID, double>>;
+
+	// A named set of setting values, loaded from "Luma-Presets.toml" next to "Luma.toml".
+	// Each TOML table is a preset, its keys are the same as in the config. Settings that aren't listed keep their current value when it's applied.
+	struct Preset
+	{
+		std::string   name;
+		SettingValues values;  // Sorted by ID
+		uint32_t      hotkey = 0;  // Virtual key code, 0 if none
+
+		std::optional<double> GetValue(SettingID a_id) const;
+
+		// The shader constants this resolves to, with the live values of the settings it doesn't set.
+		// Valid as long as no input changed since (see "Main::GetShaderConstantsInputsEpoch()"), applying the preset then only needs to publish them.
+		struct PrecomputedShaderConstants
+		{
+			uint64_t                                                                       inputsEpoch = 0;
+			std::array<ShaderConstants, static_cast<size_t>(ShaderConstantsMode::kCount)> shaderConstants = {};
+		};
+		std::optional<PrecomputedShaderConstants> precomputedShaderConstants;
+	};
+
+	struct PresetDifference
 	{
-		kDefault,
-		kLUT,
+		SettingID             id;
+		std::optional<double> from;  // Empty if the setting isn't part of the preset
+		std::optional<double> to;
 	};
 
+	// Changing these recreates the swapchain, which can crash the game with frame generation on, so they are only changed from the settings UIs, which guard against it
+	bool IsDisplayModeSetting(SettingID a_id);
+
+	// Returns nothing if the TOML is malformed. Unknown keys and the display mode settings are skipped with a warning.
+	std::optional<std::vector<Preset>> ParsePresets(std::string_view a_toml, std::span<Setting* const> a_settings);
+	std::vector<PresetDifference>      DiffPresets(const Preset& a_from, const Preset& a_to);
+
+	// Reads the values of all the settings present in a config file (missing ones are skipped).
+	// Returns nothing if the TOML is malformed or if any value is invalid, so a broken file is rejected as a whole.
+	std::optional<SettingValues> ParseConfigValues(std::string_view a_toml, std::span<Setting* const> a_settings);
+	// Returns the values that differ from the live ones. Changes to the display mode settings are skipped with a warning, and returned in "a_outDeferredValues" instead.
+	SettingValues DiffSettingValues(const SettingValues& a_values, std::span<Setting* const> a_settings, SettingValues& a_outDeferredValues);
+
     class Main : public DKUtil::model::Singleton<Main>
     {
     public:
@@ -468,7 +510,8 @@ namespace Settings
 		Checkbox HDRScreenshots{
 			SettingID::kHDRScreenshots,
 			"HDR Screenshots",
-			"Capture an additional HDR screenshot (.jxr) when using Photo Mode while in HDR.",
+			"Capture an additional HDR screenshot (.jxr, .exr or .jpg) when using Photo Mode while in HDR."
+				"\nThe SDR screenshot is then tone mapped from the HDR one.",
 			"HDRScreenshots", "HDR",
 			true
 		};
@@ -479,6 +522,16 @@ namespace Settings
 			"HDRScreenshotsLossless", "HDR",
 			false
 		};
+		EnumStepper HDRScreenshotsFormat{
+			SettingID::kHDRScreenshotsFormat,
+			"HDR Screenshots Format",
+			"Sets the file format of the HDR screenshots."
+				"\nOpenEXR is lossless and supported by most image editors, at the cost of bigger files."
+				"\nUltra HDR JPEG is an SDR image with a gain map, shown in HDR by the viewers that support it, and in SDR by everything else.",
+			"HDRScreenshotsFormat", "HDR",
+			0,
+			{ "JPEG XR", "OpenEXR", "Ultra HDR JPEG" }
+		};
 		Checkbox DLSSFGToFSRFGMod{
 			SettingID::kDLSSFGToFSRFGMod,
 			"DLSS FG to FSR FG Mod",
@@ -495,9 +548,79 @@ namespace Settings
 		String RenderTargetsToUpgrade{ "RenderTargetsToUpgrade", "RenderTargets" };
 		String ExtraRenderTargetsToUpgrade{ "ExtraRenderTargetsToUpgrade", "RenderTargets" }; // Enabling these fixes banding, as they are the main color buffers
 		Boolean UpgradeExtraRenderTargets{ "UpgradeExtraRenderTargets", "RenderTargets" };
+		Boolean UseRenderTargetFormatPolicies{ "UseRenderTargetFormatPolicies", "RenderTargets" };  // Upgrade to the cheapest format that satisfies each buffer's requirements, instead of always using RGBA16F
+		Integer RenderTargetsVRAMBudgetMB{ "RenderTargetsVRAMBudgetMB", "RenderTargets" };  // How much extra VRAM the render target upgrades can use at the screen resolution, 0 is unlimited
 
 		Boolean PeakBrightnessAutoDetected{ "PeakBrightnessAutoDetected", "HDR" };
 
+		Integer ConfigSaveDebounceMS{ "ConfigSaveDebounceMS", "Main" };  // How long to wait for further changes before writing the config file
+		ValueStepper ScreenshotTexturePoolMB{
+			SettingID::kScreenshotTexturePoolMB,
+			"Screenshot Texture Pool",
+			"How much VRAM (in MB) the screenshot capture textures are kept in between screenshots, 0 creates them every time.",
+			"ScreenshotTexturePoolMB", "Main",
+			256,
+			0,
+			4096,
+			1
+		};
+		ValueStepper ScreenshotBurstFrames{
+			SettingID::kScreenshotBurstFrames,
+			"Screenshot Burst Frames",
+			"How many consecutive frames each Photo Mode screenshot captures, numbered from \"_0001\", 1 takes a single screenshot.",
+			"ScreenshotBurstFrames", "Main",
+			1,
+			1,
+			9999,
+			1
+		};
+		ValueStepper ScreenshotBurstInterval{
+			SettingID::kScreenshotBurstInterval,
+			"Screenshot Burst Interval",
+			"Capture one burst frame every this many rendered frames.",
+			"ScreenshotBurstInterval", "Main",
+			1,
+			1,
+			1000,
+			1
+		};
+		ValueStepper ScreenshotBurstRingSize{
+			SettingID::kScreenshotBurstRingSize,
+			"Screenshot Burst Ring Size",
+			"How many burst frames can be waiting on the GPU or the encoders, frames due while it's full are dropped (and reported in the log).",
+			"ScreenshotBurstRingSize", "Main",
+			4,
+			1,
+			16,
+			1
+		};
+
+		// All the settings whose live value is mirrored in the config
+		const std::array<Setting*, 36> settings = {
+			&DisplayMode, &EnforceUserDisplayMode, &ForceSDROnHDR, &PeakBrightness, &GamePaperWhite, &UIPaperWhite, &ExtendGamut, &AutoHDRVideos,
+			&SecondaryBrightness,
+			&ToneMapperType, &Saturation, &Contrast, &Highlights, &Shadows, &Bloom,
+			&ColorGradingStrength, &LUTCorrectionStrength, &VanillaMenuLUTs, &StrictLUTApplication,
+			&GammaCorrectionStrength, &FilmGrainType, &FilmGrainFPSLimit, &PostSharpen, &HDRScreenshots, &HDRScreenshotsLossless, &HDRScreenshotsFormat, &DLSSFGToFSRFGMod,
+			&DevSetting01, &DevSetting02, &DevSetting03, &DevSetting04, &DevSetting05,
+			&ScreenshotTexturePoolMB, &ScreenshotBurstFrames, &ScreenshotBurstInterval, &ScreenshotBurstRingSize
+		};
+
+		// Returns nullptr for IDs that aren't ours (e.g. Bethesda's ones)
+		Setting* FindSetting(SettingID a_id) const
+		{
+			const auto index = static_cast<size_t>(a_id) - static_cast<size_t>(SettingID::kSTART) - 1;  // Wraps around for IDs before ours
+			return index < settingsById.size() ? settingsById[index] : nullptr;
+		}
+		// Also returns nullptr if the setting isn't of the requested type
+		template <class T>
+		T* FindSetting(SettingID a_id) const
+		{
+			static_assert(std::is_same_v<T, Checkbox> || std::is_same_v<T, Stepper> || std::is_same_v<T, Slider>);
+			const auto setting = FindSetting(a_id);
+			return setting && setting->type == T::settingType ? static_cast<T*>(setting) : nullptr;
+		}
+
 		bool InitCompatibility(RE::BGSSwapChainObject* a_swapChainObject);
 		void RefreshHDRDisplaySupportState();
 		void RefreshHDRDisplayEnableState();
@@ -509,6 +632,8 @@ namespace Settings
 		bool IsFSR3FGEnabled() const;
 		bool IsCustomToneMapper() const;
 		bool IsFilmGrainTypeImproved() const;
+		// The current state of everything "enableRules" depend on, the frame generation tech can be overridden if it's about to change
+		EnableInputs GetEnableInputs(std::optional<RE::FrameGenerationTech> a_frameGenerationTech = std::nullopt) const;
 
 		void SetAtEndOfFrame(bool a_bIsAtEndOfFrame) { bIsAtEndOfFrame.store(a_bIsAtEndOfFrame); }
 
@@ -520,7 +645,14 @@ namespace Settings
 		void RefreshSwapchainFormat(std::optional<RE::FrameGenerationTech> a_frameGenerationTech = std::nullopt);
 		void OnDisplayModeChanged();
 
-		void GetShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode = ShaderConstantsMode::kDefault) const;
+		// The preset's values take precedence over the live ones, if there is one
+		void GetShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode = ShaderConstantsMode::kDefault, const Preset* a_preset = nullptr) const;
+		void GetCachedShaderConstants(ShaderConstants& a_outShaderConstants, ShaderConstantsMode a_shaderConstantsMode = ShaderConstantsMode::kDefault);
+
+		// Needs to be called whenever any input of "GetShaderConstants()" that isn't a setting changes, the snapshots are rebuilt lazily on the next read.
+		// Changing a setting value is tracked automatically.
+		void MarkShaderConstantsDirty() { shaderConstantsDirtyEpoch.fetch_add(1, std::memory_order_release); }
+		void CheckShaderConstantsInputs();
 
 		void InitConfig(bool a_bIsSFSE);
 
@@ -528,6 +660,18 @@ namespace Settings
 
         void Load() noexcept;
 		void Save() noexcept;
+		// Writes any pending config change and stops the config threads, needs to be called before the DLL is unloaded
+		void Shutdown();
+
+		void LoadPresets();
+		// Applies all the values of a preset at once, with a single save and a single swapchain refresh (if the display mode changed)
+		bool ApplyPreset(std::string_view a_name);
+		// Pass 0 to unbind. Returns false if there's no preset with that name.
+		bool BindPresetHotkey(std::string_view a_name, uint32_t a_virtualKey);
+		// Polls the preset hotkeys, meant to be called once per frame
+		void UpdatePresetHotkeys();
+		std::vector<std::string> GetPresetNames() const;
+		std::vector<PresetDifference> DiffPresets(std::string_view a_from, std::string_view a_to) const;
 
 		static void DrawReshadeSettings(reshade::api::effect_runtime*);
 
@@ -540,15 +684,50 @@ namespace Settings
 		TomlConfig sfseConfig = COMPILE_PROXY("Data\\SFSE\\Plugins\\Luma.toml");
 		TomlConfig asiConfig = COMPILE_PROXY("Luma.toml");
 		TomlConfig* config = nullptr;
+		std::filesystem::path configPath;
 		std::mutex configMutex;
+		std::unique_ptr<ConfigWatcher> configWatcher;
+		std::unique_ptr<ConfigWriter> configWriter;
+
+		// Display mode edits made to the config while the game runs, they only take effect after a restart, so writing the config keeps them instead of the live values.
+		// Dropped if the setting is changed in game since. Guarded by "configMutex".
+		struct DeferredConfigValue
+		{
+			SettingID id;
+			double    configValue;
+			double    liveValue;
+		};
+		std::vector<DeferredConfigValue> deferredConfigValues;
 
 		std::atomic_bool bIsAtEndOfFrame = false;
 		std::atomic_bool bIsHDRSupported = false;
 		std::atomic_bool bIsHDREnabled = false;
 
+		std::array<ShaderConstantsSnapshot, static_cast<size_t>(ShaderConstantsMode::kCount)> shaderConstantsSnapshots;
+		std::atomic_uint64_t    shaderConstantsDirtyEpoch = 1;
+		std::atomic_uint64_t    shaderConstantsPublishedEpoch = 0;
+		std::mutex              shaderConstantsMutex;  // Serializes the snapshot writes, the render threads never wait for it
+		RE::FrameGenerationTech lastFrameGenerationTech = RE::FrameGenerationTech::kNone;
+		bool                    bLastShouldCorrectLUTs = true;
+
+		std::vector<Preset>   presets;
+		mutable std::mutex    presetsMutex;
+		std::vector<uint32_t> pressedPresetHotkeys;
+
+		// Indexed by the setting ID, starting after "SettingID::kSTART"
+		using SettingsById = std::array<Setting*, static_cast<size_t>(SettingID::kLAST) - static_cast<size_t>(SettingID::kSTART)>;
+		const SettingsById settingsById = [this] {
+			SettingsById result = {};
+			for (auto setting : settings) {
+				result[static_cast<size_t>(setting->id) - static_cast<size_t>(SettingID::kSTART) - 1] = setting;
+			}
+			return result;
+		}();
+
 		RE::BGSSwapChainObject* swapChainObject = nullptr;
 
-		bool bReshadeSettingsOverlayRegistered = false;
+		bool             bReshadeSettingsOverlayRegistered = false;
+		EnableStateGraph reshadeEnableStates;  // Only accessed by the overlay
 		bool bIsDLSSFGToFSRFGPresent = false;
 		bool bIsDLSSFGToFSRFGPatched = false;
 
@@ -559,6 +738,19 @@ namespace Settings
 		bool DrawReshadeSlider(Slider& a_slider);
 		bool DrawReshadeResetButton(Setting& a_setting);
 		void DrawReshadeSettings();
+		void DrawReshadePresets();
+#if ENABLE_HOOK_STATISTICS
+		void DrawReshadeHookStatistics();
+#endif
+
+		uint64_t GetShaderConstantsInputsEpoch() const { return shaderConstantsDirtyEpoch.load(std::memory_order_acquire) + Setting::GetGeneration(); }
+		void RefreshShaderConstants();
+		void PrecomputePresetShaderConstants(Preset& a_preset) const;
+		// Applies all the values at once (see "ApplyPreset()"), the preset is optional and only used for its precomputed shader constants. Returns whether anything changed.
+		bool ApplySettingValues(const SettingValues& a_values, Preset* a_preset = nullptr);
+		void ApplyPresetValues(Preset& a_preset);  // Needs "presetsMutex" to be locked
+		void ReloadConfig();
+		void WriteConfig() noexcept;
     };
 
 	
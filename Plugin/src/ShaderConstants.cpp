@@ -0,0 +1,42 @@
+#include "ShaderConstants.h"
+
+namespace Settings
+{
+	std::string GenerateShaderConstantsHLSL()
+	{
+		std::string hlsl =
+			"#pragma once\n"
+			"\n"
+			"// Generated from \"Settings::shaderConstantFields\" by \"Settings::GenerateShaderConstantsHLSL()\", don't edit it by hand.\n"
+			"\n"
+			"// Custom push constants uploaded by the HDR DLL plugin code. Do note that register space comes at a premium when adding members. Bit/byte packing is advised.\n"
+			"// Bools are set as uint to avoid padding inconsistencies between c++ and hlsl.\n"
+			"struct StructHdrDllPluginConstants\n"
+			"{\n";
+		for (const auto& field : shaderConstantFields) {
+			std::string_view type;
+			switch (field.type) {
+			case ShaderConstantType::kInt:
+				type = "int";
+				break;
+			case ShaderConstantType::kUInt:
+				type = "uint";
+				break;
+			case ShaderConstantType::kFloat:
+				type = "float";
+				break;
+			}
+			hlsl += std::format("\t{} {};", type, field.name);
+			if (!field.comment.empty()) {
+				hlsl += std::format(" // {}", field.comment);
+			}
+			hlsl += "\n";
+		}
+		hlsl += std::format(
+			"}};\n"
+			"\n"
+			"#define HDR_PLUGIN_CONSTANTS_SIZE \"{}\"\n",
+			shaderConstantsCount);
+		return hlsl;
+	}
+}
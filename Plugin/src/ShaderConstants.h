@@ -0,0 +1,123 @@
+#pragma once
+#include "SettingID.h"
+
+// Only depends on the standard library, so "tools/GenerateShaderConstantsHLSL.cpp" can build it on its own.
+
+namespace Settings
+{
+	// StructHdrDllPluginConstants in HLSL is generated from this, through "shaderConstantFields" (every member needs an entry there).
+	// Bools are set as uint to avoid padding inconsistencies between c++ and hlsl.
+	struct ShaderConstants
+	{
+		int32_t  DisplayMode;
+		float    PeakBrightness;
+		float    GamePaperWhite;
+		float    UIPaperWhite;
+		float    ExtendGamut;
+		uint32_t bAutoHDRVideos;
+
+		float    SDRSecondaryBrightness;
+
+		uint32_t ToneMapperType;
+		float    Saturation;
+		float    Contrast;
+		float    Highlights;
+		float    Shadows;
+		float    Bloom;
+
+		float    ColorGradingStrength;
+		float    LUTCorrectionStrength;
+		uint32_t StrictLUTApplication;
+
+		float    GammaCorrectionStrength;
+		uint32_t FilmGrainType;
+		float    FilmGrainFPSLimit;
+		uint32_t PostSharpen;
+		uint32_t bIsAtEndOfFrame;
+		uint32_t RuntimeMS;
+		float    DevSetting01;
+		float    DevSetting02;
+		float    DevSetting03;
+		float    DevSetting04;
+		float    DevSetting05;
+	};
+	constexpr static uint32_t shaderConstantsCount = sizeof(ShaderConstants) / sizeof(uint32_t); // Number of dwords
+
+	enum class ShaderConstantType
+	{
+		kInt,
+		kUInt,
+		kFloat
+	};
+
+	// Describes a member of "ShaderConstants". This is the source of truth for the HLSL struct (see "GenerateShaderConstantsHLSL()").
+	// Members that are directly derived from a setting are filled in as "value * scale + bias", the others are computed by hand in "GetShaderConstants()".
+	struct ShaderConstantField
+	{
+		std::string_view         name;  // HLSL name
+		ShaderConstantType       type;
+		size_t                   offset;
+		std::string_view         comment;
+		std::optional<SettingID> source = std::nullopt;
+		float                    scale = 1.f;
+		float                    bias = 0.f;
+	};
+
+	inline constexpr ShaderConstantField shaderConstantFields[] = {
+		{ "DisplayMode", ShaderConstantType::kInt, offsetof(ShaderConstants, DisplayMode), "-1 SDR on scRGB HDR, 0 SDR (Rec.709 with 2.2 gamma, not sRGB), 1 HDR10 PQ BT.2020, 2 scRGB HDR" },
+		{ "HDRPeakBrightnessNits", ShaderConstantType::kFloat, offsetof(ShaderConstants, PeakBrightness), "Set equal to the max nits your display can output" },
+		{ "HDRGamePaperWhiteNits", ShaderConstantType::kFloat, offsetof(ShaderConstants, GamePaperWhite), "203 is the reference value (ReferenceWhiteNits_BT2408)", SettingID::kHDR_GamePaperWhite },
+		{ "HDRUIPaperWhiteNits", ShaderConstantType::kFloat, offsetof(ShaderConstants, UIPaperWhite), "203 is the reference value (ReferenceWhiteNits_BT2408)", SettingID::kHDR_UIPaperWhite },
+		{ "HDRExtendGamut", ShaderConstantType::kFloat, offsetof(ShaderConstants, ExtendGamut), "0-1. 0 is neutral", SettingID::kHDR_ExtendGamut, 0.01f },
+		{ "AutoHDRVideos", ShaderConstantType::kUInt, offsetof(ShaderConstants, bAutoHDRVideos), "", SettingID::kHDR_AutoHDRVideos },
+
+		{ "SDRSecondaryBrightness", ShaderConstantType::kFloat, offsetof(ShaderConstants, SDRSecondaryBrightness), "0-2. Only meant for SDR. 1 is neutral" },
+
+		{ "ToneMapperType", ShaderConstantType::kUInt, offsetof(ShaderConstants, ToneMapperType), "Overrides tonemapper type. 0 is default (not overridden)", SettingID::kToneMapperType },
+		{ "ToneMapperSaturation", ShaderConstantType::kFloat, offsetof(ShaderConstants, Saturation), "0.5-1.5. 1 is neutral", SettingID::kToneMapperSaturation, 0.01f, 0.5f },
+		{ "ToneMapperContrast", ShaderConstantType::kFloat, offsetof(ShaderConstants, Contrast), "0.5-1.5. 1 is neutral", SettingID::kToneMapperContrast, 0.01f, 0.5f },
+		{ "ToneMapperHighlights", ShaderConstantType::kFloat, offsetof(ShaderConstants, Highlights), "0-1. 0.5 is \"neutral\"" },
+		{ "ToneMapperShadows", ShaderConstantType::kFloat, offsetof(ShaderConstants, Shadows), "0-1. 0.5 is neutral" },
+		{ "ToneMapperBloom", ShaderConstantType::kFloat, offsetof(ShaderConstants, Bloom), "0-1. 0.5 is neutral", SettingID::kToneMapperBloom, 0.01f },
+
+		{ "ColorGradingStrength", ShaderConstantType::kFloat, offsetof(ShaderConstants, ColorGradingStrength), "1 is full strength", SettingID::kColorGradingStrength, 0.01f },
+		{ "LUTCorrectionStrength", ShaderConstantType::kFloat, offsetof(ShaderConstants, LUTCorrectionStrength), "1 is full strength", SettingID::kLUTCorrectionStrength, 0.01f },
+		{ "StrictLUTApplication", ShaderConstantType::kUInt, offsetof(ShaderConstants, StrictLUTApplication), "false is default (true looks more like vanilla SDR)", SettingID::kStrictLUTApplication },
+
+		{ "GammaCorrection", ShaderConstantType::kFloat, offsetof(ShaderConstants, GammaCorrectionStrength), "Application percentage of \"SDR_USE_GAMMA_2_2\" correction from LUTs. 0 to 1. 1 is \"neutral\"", SettingID::kGammaCorrectionStrength, 0.01f },
+		{ "FilmGrainType", ShaderConstantType::kUInt, offsetof(ShaderConstants, FilmGrainType), "1 is default", SettingID::kFilmGrainType },
+		{ "FilmGrainFPSLimit", ShaderConstantType::kFloat, offsetof(ShaderConstants, FilmGrainFPSLimit), "24 and 0 are common defaults", SettingID::kFilmGrainFPSLimit },
+		{ "PostSharpen", ShaderConstantType::kUInt, offsetof(ShaderConstants, PostSharpen), "true is default", SettingID::kPostSharpen },
+
+		{ "IsAtEndOfFrame", ShaderConstantType::kUInt, offsetof(ShaderConstants, bIsAtEndOfFrame), "" },
+		{ "RuntimeMS", ShaderConstantType::kUInt, offsetof(ShaderConstants, RuntimeMS), "" },
+		{ "DevSetting01", ShaderConstantType::kFloat, offsetof(ShaderConstants, DevSetting01), "0-1 variable for development. Default 0", SettingID::kDevSetting01, 0.01f },
+		{ "DevSetting02", ShaderConstantType::kFloat, offsetof(ShaderConstants, DevSetting02), "0-1 variable for development. Default 0", SettingID::kDevSetting02, 0.01f },
+		{ "DevSetting03", ShaderConstantType::kFloat, offsetof(ShaderConstants, DevSetting03), "0-1 variable for development. Default 0", SettingID::kDevSetting03, 0.01f },
+		{ "DevSetting04", ShaderConstantType::kFloat, offsetof(ShaderConstants, DevSetting04), "0-1 variable for development. Default 0.5", SettingID::kDevSetting04, 0.01f },
+		{ "DevSetting05", ShaderConstantType::kFloat, offsetof(ShaderConstants, DevSetting05), "0-1 variable for development. Default 0.5", SettingID::kDevSetting05, 0.01f },
+	};
+
+	// Root constants are uploaded as an array of dwords, so every member needs to be exactly one dword, with no padding and in the same order as in HLSL
+	static_assert(std::is_standard_layout_v<ShaderConstants> && std::is_trivially_copyable_v<ShaderConstants>);
+	static_assert(sizeof(ShaderConstants) == std::size(shaderConstantFields) * sizeof(uint32_t), "Every member of ShaderConstants needs an entry in shaderConstantFields");
+	static_assert([] {
+		for (size_t i = 0; i < std::size(shaderConstantFields); ++i) {
+			if (shaderConstantFields[i].offset != i * sizeof(uint32_t)) {
+				return false;
+			}
+		}
+		return true;
+	}(), "shaderConstantFields needs to be in the same order as ShaderConstants, which needs to be dword packed");
+
+	// Returns the HLSL declaration of "StructHdrDllPluginConstants" and its size, as found in "shaders/HdrDllPluginConstants.hlsl"
+	std::string GenerateShaderConstantsHLSL();
+
+	enum class ShaderConstantsMode
+	{
+		kDefault,
+		kLUT,
+
+		kCount
+	};
+}
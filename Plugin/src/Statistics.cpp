@@ -0,0 +1,129 @@
+#include "Statistics.h"
+
+namespace Statistics
+{
+	uint64_t FrameSample::GetTotalMatches() const
+	{
+		return std::accumulate(matches.begin(), matches.end(), uint64_t(0));
+	}
+
+	uint64_t FrameSample::GetTotalUploadBytes() const
+	{
+		return std::accumulate(uploadBytes.begin(), uploadBytes.end(), uint64_t(0));
+	}
+
+	void History::Push(const FrameSample& a_sample)
+	{
+		samples[next] = a_sample;
+		next = (next + 1) % historySize;
+		count = std::min(count + 1, historySize);
+	}
+
+	const FrameSample& History::GetSample(size_t a_age) const
+	{
+		return samples[(next + historySize - 1 - a_age) % historySize];
+	}
+
+	FrameSample History::GetAverage() const
+	{
+		FrameSample average;
+		if (count == 0) {
+			return average;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			const auto& sample = GetSample(i);
+			average.calls += sample.calls;
+			for (size_t j = 0; j < techniqueCount; ++j) {
+				average.matches[j] += sample.matches[j];
+				average.uploadBytes[j] += sample.uploadBytes[j];
+			}
+		}
+
+		average.calls /= count;
+		for (size_t j = 0; j < techniqueCount; ++j) {
+			average.matches[j] /= count;
+			average.uploadBytes[j] /= count;
+		}
+		return average;
+	}
+
+	FrameSample History::GetMax() const
+	{
+		FrameSample max;
+		for (size_t i = 0; i < count; ++i) {
+			const auto& sample = GetSample(i);
+			max.calls = std::max(max.calls, sample.calls);
+			for (size_t j = 0; j < techniqueCount; ++j) {
+				max.matches[j] = std::max(max.matches[j], sample.matches[j]);
+				max.uploadBytes[j] = std::max(max.uploadBytes[j], sample.uploadBytes[j]);
+			}
+		}
+		return max;
+	}
+
+	std::array<uint32_t, histogramBuckets> History::GetCallsHistogram() const
+	{
+		std::array<uint32_t, histogramBuckets> histogram = {};
+		for (size_t i = 0; i < count; ++i) {
+			const size_t bucket = std::min<size_t>(std::bit_width(GetSample(i).calls), histogramBuckets - 1);
+			histogram[bucket]++;
+		}
+		return histogram;
+	}
+
+	size_t History::GetCallsPlot(std::array<float, historySize>& a_outValues) const
+	{
+		for (size_t i = 0; i < count; ++i) {
+			a_outValues[i] = static_cast<float>(GetSample(count - 1 - i).calls);
+		}
+		return count;
+	}
+
+	HookStatistics* HookStatistics::GetSingleton()
+	{
+		static HookStatistics singleton;
+		return &singleton;
+	}
+
+	ThreadCounters& HookStatistics::GetThreadCounters()
+	{
+		thread_local ThreadCounters* counters = nullptr;
+		if (!counters) [[unlikely]] {
+			std::lock_guard<std::mutex> lg(mutex);
+			counters = threadCounters.emplace_back(std::make_unique<ThreadCounters>()).get();
+		}
+		return *counters;
+	}
+
+	void HookStatistics::Aggregate()
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+
+		FrameSample totals;
+		for (const auto& counters : threadCounters) {
+			totals.calls += counters->calls.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < techniqueCount; ++i) {
+				totals.matches[i] += counters->matches[i].load(std::memory_order_relaxed);
+				totals.uploadBytes[i] += counters->uploadBytes[i].load(std::memory_order_relaxed);
+			}
+		}
+
+		FrameSample frame;
+		frame.calls = totals.calls - lastTotals.calls;
+		for (size_t i = 0; i < techniqueCount; ++i) {
+			frame.matches[i] = totals.matches[i] - lastTotals.matches[i];
+			frame.uploadBytes[i] = totals.uploadBytes[i] - lastTotals.uploadBytes[i];
+		}
+
+		lastTotals = totals;
+		history.Push(frame);
+		aggregatedFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void HookStatistics::ReadHistory(const std::function<void(const History&)>& a_reader) const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		a_reader(history);
+	}
+}
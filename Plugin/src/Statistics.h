@@ -0,0 +1,84 @@
+#pragma once
+#include "Techniques.h"
+
+namespace Statistics
+{
+	constexpr size_t techniqueCount = Techniques::manifestSize;  // The counters are indexed by "Techniques::GetTechniqueIndex()", so there's one per manifest entry
+	constexpr size_t historySize = 256;  // Frames
+	constexpr size_t histogramBuckets = 24;  // Power of two buckets of calls per frame
+
+	// Counters of a single thread. Only the owning thread writes them (so no RMW is needed) and the aggregator reads them,
+	// relaxed ordering is fine as they are purely informative.
+	struct alignas(64) ThreadCounters
+	{
+		std::atomic_uint64_t                             calls = 0;
+		std::array<std::atomic_uint64_t, techniqueCount> matches = {};
+		std::array<std::atomic_uint64_t, techniqueCount> uploadBytes = {};
+
+		void AddCall() { Add(calls, 1); }
+		void AddMatch(size_t a_techniqueIndex, uint64_t a_uploadBytes)
+		{
+			Add(matches[a_techniqueIndex], 1);
+			Add(uploadBytes[a_techniqueIndex], a_uploadBytes);
+		}
+
+	private:
+		static void Add(std::atomic_uint64_t& a_counter, uint64_t a_value) { a_counter.store(a_counter.load(std::memory_order_relaxed) + a_value, std::memory_order_relaxed); }
+	};
+
+	struct FrameSample
+	{
+		uint64_t                            calls = 0;
+		std::array<uint64_t, techniqueCount> matches = {};
+		std::array<uint64_t, techniqueCount> uploadBytes = {};
+
+		uint64_t GetTotalMatches() const;
+		uint64_t GetTotalUploadBytes() const;
+	};
+
+	// Rolling window over the last "historySize" frames
+	class History
+	{
+	public:
+		void Push(const FrameSample& a_sample);
+
+		size_t             GetCount() const { return count; }
+		const FrameSample& GetSample(size_t a_age) const;  // 0 is the latest frame
+		FrameSample        GetAverage() const;
+		FrameSample        GetMax() const;
+
+		// Bucket "i" counts the frames with [2^(i-1), 2^i) hook calls, bucket 0 the ones with none
+		std::array<uint32_t, histogramBuckets> GetCallsHistogram() const;
+		// Hook calls per frame, oldest first, for plotting
+		size_t GetCallsPlot(std::array<float, historySize>& a_outValues) const;
+
+	private:
+		std::array<FrameSample, historySize> samples = {};
+		size_t                               next = 0;
+		size_t                               count = 0;
+	};
+
+	class HookStatistics
+	{
+	public:
+		static HookStatistics* GetSingleton();
+
+		// Registers the calling thread on first use, the returned counters live as long as the process
+		ThreadCounters& GetThreadCounters();
+
+		// Sums the counters of all threads and pushes the difference from the previous call into the history.
+		// Meant to be called once per frame.
+		void Aggregate();
+
+		uint64_t GetAggregatedFrames() const { return aggregatedFrames.load(std::memory_order_relaxed); }
+
+		void ReadHistory(const std::function<void(const History&)>& a_reader) const;
+
+	private:
+		mutable std::mutex                           mutex;
+		std::vector<std::unique_ptr<ThreadCounters>> threadCounters;
+		FrameSample                                  lastTotals;
+		History                                      history;
+		std::atomic_uint64_t                         aggregatedFrames = 0;
+	};
+}
@@ -0,0 +1,215 @@
+#include "StripReadback.h"
+
+#include <DirectXTex.h>
+
+namespace Utils
+{
+	ReadbackStripSource::ReadbackStripSource(ID3D12Device* a_device, ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state) :
+		device(a_device), queue(a_queue), resource(a_resource), state(a_state)
+	{
+		queue->AddRef();
+		resource->AddRef();
+	}
+
+	ReadbackStripSource::~ReadbackStripSource()
+	{
+		// The copies still in flight write to the buffers
+		if (fence) {
+			WaitForFence(lastFenceValue);
+		}
+
+		for (auto& slot : slots) {
+			if (slot.buffer) {
+				if (slot.mappedPixels) {
+					constexpr D3D12_RANGE writtenRange = { 0, 0 };
+					slot.buffer->Unmap(0, &writtenRange);
+				}
+				slot.buffer->Release();
+			}
+			if (slot.commandList) {
+				slot.commandList->Release();
+			}
+			if (slot.allocator) {
+				slot.allocator->Release();
+			}
+		}
+
+		if (fenceEvent) {
+			CloseHandle(fenceEvent);
+		}
+		if (fence) {
+			fence->Release();
+		}
+		resource->Release();
+		queue->Release();
+		device->Release();
+	}
+
+	std::unique_ptr<ReadbackStripSource> ReadbackStripSource::Create(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state)
+	{
+		if (!a_queue || !a_resource) {
+			return nullptr;
+		}
+
+		const D3D12_RESOURCE_DESC desc = a_resource->GetDesc();
+		if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || desc.DepthOrArraySize != 1 || desc.MipLevels != 1 || desc.SampleDesc.Count != 1 ||
+			DirectX::IsTypeless(desc.Format) || DirectX::IsCompressed(desc.Format) || DirectX::IsPlanar(desc.Format)) {
+			return nullptr;
+		}
+
+		ID3D12Device* device = nullptr;
+		if (FAILED(a_resource->GetDevice(IID_PPV_ARGS(&device)))) {
+			return nullptr;
+		}
+		auto source = std::unique_ptr<ReadbackStripSource>(new ReadbackStripSource(device, a_queue, a_resource, a_state));
+
+		source->info = { static_cast<size_t>(desc.Width), desc.Height, desc.Format };
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+		device->GetCopyableFootprints(&desc, 0, 1, 0, &footprint, nullptr, nullptr, nullptr);
+		source->rowPitch = footprint.Footprint.RowPitch;
+
+		if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&source->fence)))) {
+			return nullptr;
+		}
+		source->fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (!source->fenceEvent) {
+			return nullptr;
+		}
+
+		// Copy queues only take copy command lists
+		const D3D12_COMMAND_LIST_TYPE commandListType = a_queue->GetDesc().Type;
+		for (auto& slot : source->slots) {
+			if (FAILED(device->CreateCommandAllocator(commandListType, IID_PPV_ARGS(&slot.allocator))) ||
+				FAILED(device->CreateCommandList(0, commandListType, slot.allocator, nullptr, IID_PPV_ARGS(&slot.commandList))) ||
+				FAILED(slot.commandList->Close())) {
+				return nullptr;
+			}
+		}
+
+		return source;
+	}
+
+	bool ReadbackStripSource::Begin(size_t a_rowsPerStrip)
+	{
+		rowsPerStrip = std::min(a_rowsPerStrip, info.height);
+
+		const D3D12_HEAP_PROPERTIES heapProperties = { .Type = D3D12_HEAP_TYPE_READBACK };
+		const D3D12_RESOURCE_DESC   bufferDesc = {
+			  .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+			  .Width = rowPitch * rowsPerStrip,
+			  .Height = 1,
+			  .DepthOrArraySize = 1,
+			  .MipLevels = 1,
+			  .SampleDesc = { 1, 0 },
+			  .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR
+		};
+
+		for (auto& slot : slots) {
+			if (slot.buffer) {
+				return false;  // Sources are read once
+			}
+			if (FAILED(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&slot.buffer))) ||
+				FAILED(slot.buffer->Map(0, nullptr, reinterpret_cast<void**>(&slot.mappedPixels)))) {
+				return false;
+			}
+		}
+
+		// Start on the first strips straight away, the rest follow as they are read
+		for (size_t i = 0; i < slotCount && i * rowsPerStrip < info.height; ++i) {
+			if (!IssueCopy(slots[i], i * rowsPerStrip)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReadbackStripSource::ReadStrip(size_t a_firstRow, size_t a_rowCount, ImageStrip& a_outStrip)
+	{
+		if (rowsPerStrip == 0 || a_firstRow % rowsPerStrip != 0 || a_rowCount > rowsPerStrip || a_firstRow + a_rowCount > info.height) {
+			return false;
+		}
+
+		// The previous strip isn't used anymore, reuse its buffer for the next strip that isn't in flight yet
+		if (readSlot) {
+			const size_t nextRow = readSlot->firstRow + slotCount * rowsPerStrip;
+			Slot*        previousSlot = std::exchange(readSlot, nullptr);
+			if (nextRow < info.height && !IssueCopy(*previousSlot, nextRow)) {
+				return false;
+			}
+		}
+
+		Slot& slot = slots[(a_firstRow / rowsPerStrip) % slotCount];
+		if (slot.fenceValue == 0 || slot.firstRow != a_firstRow || !WaitForFence(slot.fenceValue)) {
+			return false;
+		}
+		readSlot = &slot;
+
+		a_outStrip.pixels = slot.mappedPixels;
+		a_outStrip.firstRow = a_firstRow;
+		a_outStrip.rowCount = a_rowCount;
+		a_outStrip.rowPitch = rowPitch;
+		return true;
+	}
+
+	bool ReadbackStripSource::IssueCopy(Slot& a_slot, size_t a_firstRow)
+	{
+		const size_t rowCount = std::min(rowsPerStrip, info.height - a_firstRow);
+
+		if (FAILED(a_slot.allocator->Reset()) || FAILED(a_slot.commandList->Reset(a_slot.allocator, nullptr))) {
+			return false;
+		}
+
+		const bool             bTransition = state != D3D12_RESOURCE_STATE_COPY_SOURCE;
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = resource;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = state;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+		if (bTransition) {
+			a_slot.commandList->ResourceBarrier(1, &barrier);
+		}
+
+		D3D12_TEXTURE_COPY_LOCATION destination = {};
+		destination.pResource = a_slot.buffer;
+		destination.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		destination.PlacedFootprint.Footprint = { info.format, static_cast<UINT>(info.width), static_cast<UINT>(rowCount), 1, static_cast<UINT>(rowPitch) };
+
+		D3D12_TEXTURE_COPY_LOCATION source = {};
+		source.pResource = resource;
+		source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		source.SubresourceIndex = 0;
+
+		const D3D12_BOX box = { 0, static_cast<UINT>(a_firstRow), 0, static_cast<UINT>(info.width), static_cast<UINT>(a_firstRow + rowCount), 1 };
+		a_slot.commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, &box);
+
+		if (bTransition) {
+			std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+			a_slot.commandList->ResourceBarrier(1, &barrier);
+		}
+
+		if (FAILED(a_slot.commandList->Close())) {
+			return false;
+		}
+
+		ID3D12CommandList* commandLists[] = { a_slot.commandList };
+		queue->ExecuteCommandLists(1, commandLists);
+		if (FAILED(queue->Signal(fence, lastFenceValue + 1))) {
+			return false;
+		}
+		a_slot.fenceValue = ++lastFenceValue;
+		a_slot.firstRow = a_firstRow;
+		return true;
+	}
+
+	bool ReadbackStripSource::WaitForFence(uint64_t a_value) const
+	{
+		if (fence->GetCompletedValue() >= a_value) {
+			return true;
+		}
+		if (FAILED(fence->SetEventOnCompletion(a_value, fenceEvent))) {
+			return false;
+		}
+		return WaitForSingleObject(fenceEvent, INFINITE) == WAIT_OBJECT_0;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "ImagePipeline.h"
+
+#include <d3d12.h>
+
+namespace Utils
+{
+	// Reads a texture back from the GPU a strip at a time, through a few small readback buffers that are reused, instead of one that holds the whole image.
+	// The copies of the next strips are in flight while the current one is processed, and the strips point straight into the mapped buffers.
+	// Blocks on the GPU, so it has to run on a worker thread.
+	class ReadbackStripSource : public ImageSource
+	{
+	public:
+		~ReadbackStripSource() override;
+
+		// The resource has to be in "a_state" whenever the queue executes, it's transitioned back to it after every copy.
+		// Returns nullptr for resources that can't be copied directly (multisampled, arrays, mips, typeless), "DirectX::CaptureTexture()" handles those.
+		static std::unique_ptr<ReadbackStripSource> Create(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state);
+
+		ImageInfo GetInfo() const override { return info; }
+		bool      Begin(size_t a_rowsPerStrip) override;
+		bool      ReadStrip(size_t a_firstRow, size_t a_rowCount, ImageStrip& a_outStrip) override;
+
+	private:
+		static constexpr size_t slotCount = 3;
+
+		struct Slot
+		{
+			ID3D12Resource*            buffer = nullptr;
+			ID3D12CommandAllocator*    allocator = nullptr;
+			ID3D12GraphicsCommandList* commandList = nullptr;
+			uint64_t                   fenceValue = 0;
+			size_t                     firstRow = 0;
+			uint8_t*                   mappedPixels = nullptr;  // Readback buffers can stay mapped while the GPU writes them
+		};
+
+		ReadbackStripSource(ID3D12Device* a_device, ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state);
+
+		bool IssueCopy(Slot& a_slot, size_t a_firstRow);
+		bool WaitForFence(uint64_t a_value) const;
+
+		ID3D12Device*               device;
+		ID3D12CommandQueue*         queue;
+		ID3D12Resource*             resource;
+		const D3D12_RESOURCE_STATES state;
+		ImageInfo                   info;
+		size_t                      rowPitch = 0;  // Aligned to "D3D12_TEXTURE_DATA_PITCH_ALIGNMENT"
+		size_t                      rowsPerStrip = 0;
+		ID3D12Fence*                fence = nullptr;
+		HANDLE                      fenceEvent = nullptr;
+		uint64_t                    lastFenceValue = 0;
+		std::array<Slot, slotCount> slots;
+		Slot*                       readSlot = nullptr;  // The slot of the last strip handed out, it's reused once the next one is read
+	};
+}
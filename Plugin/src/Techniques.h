@@ -0,0 +1,132 @@
+#pragma once
+#include "ShaderConstants.h"
+
+namespace Techniques
+{
+	struct TechniqueInfo
+	{
+		uint64_t                      id;
+		std::string_view              name;
+		uint32_t                      rootParameterIndex;  // Index of our custom RootConstants() entry in the root signature, from the RootSignature.hlsl file stored next to the technique
+		bool                          bCompute;
+		Settings::ShaderConstantsMode shaderConstantsMode;
+	};
+
+	// All the techniques (shader permutations) we upload our shader constants to.
+	// Adding a new permutation here is all that's needed for it to receive them.
+	inline constexpr TechniqueInfo manifest[] = {
+		{ 0x1FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+		{ 0xC01FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+		{ 0xE01FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+		{ 0x1001FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+		{ 0x1C01FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+		{ 0x1E01FE1A, "HDRComposite", 5, false, Settings::ShaderConstantsMode::kLUT },
+
+		{ 0x801FE57, "Copy", 2, false, Settings::ShaderConstantsMode::kDefault },
+		{ 0x4001FE57, "Copy", 2, false, Settings::ShaderConstantsMode::kDefault },
+
+		{ 0x1FE73, "FilmGrain", 2, false, Settings::ShaderConstantsMode::kDefault },
+
+		{ 0x1FE86, "ColorGradingMerge", 4, true, Settings::ShaderConstantsMode::kLUT },
+		{ 0x1FE87, "HDRColorGradingMerge", 4, true, Settings::ShaderConstantsMode::kLUT },
+
+		{ 0x1FE96, "ContrastAdaptiveSharpening", 4, true, Settings::ShaderConstantsMode::kDefault },
+		{ 0x201FE96, "ContrastAdaptiveSharpening", 4, true, Settings::ShaderConstantsMode::kDefault },
+		{ 0x401FE96, "ContrastAdaptiveSharpening", 4, true, Settings::ShaderConstantsMode::kDefault },
+		{ 0x601FE96, "ContrastAdaptiveSharpening", 4, true, Settings::ShaderConstantsMode::kDefault },
+
+		{ 0x1FE9C, "PostSharpen", 5, false, Settings::ShaderConstantsMode::kDefault },
+
+		{ 0x1FEAC, "ScaleformComposite", 2, false, Settings::ShaderConstantsMode::kDefault },
+
+		{ 0x1FEAD, "BinkMovie", 2, false, Settings::ShaderConstantsMode::kDefault },
+	};
+	inline constexpr size_t manifestSize = std::size(manifest);
+
+	// Multiplicative perfect hash over a set of technique IDs, built at compile time.
+	// Looking up an ID is one multiply, one shift and one compare, whether it's in the table or not.
+	template <size_t N>
+	class PerfectHashTable
+	{
+	public:
+		static constexpr uint32_t hashBits = std::bit_width(N * 2 - 1);  // Keep the table at most half full, so a multiplier is found quickly
+		static constexpr size_t   tableSize = size_t(1) << hashBits;
+
+		consteval PerfectHashTable(const TechniqueInfo (&a_techniques)[N])
+		{
+			uint64_t state = 0x4C756D61;  // Any seed works, this one is deterministic across builds
+			for (uint32_t attempt = 0; attempt < 100000; ++attempt) {
+				// splitmix64
+				state += 0x9E3779B97F4A7C15;
+				uint64_t candidate = state;
+				candidate = (candidate ^ (candidate >> 30)) * 0xBF58476D1CE4E5B9;
+				candidate = (candidate ^ (candidate >> 27)) * 0x94D049BB133111EB;
+				candidate = candidate ^ (candidate >> 31);
+				multiplier = candidate | 1;
+
+				if (TryBuild(a_techniques)) {
+					return;
+				}
+			}
+
+			throw "No perfect hash multiplier found, the technique IDs probably contain duplicates";
+		}
+
+		constexpr const TechniqueInfo* Find(uint64_t a_techniqueId) const
+		{
+			const Entry& entry = entries[Slot(a_techniqueId)];
+			return entry.id == a_techniqueId ? entry.info : nullptr;
+		}
+
+		constexpr uint64_t GetMultiplier() const { return multiplier; }
+
+	private:
+		struct Entry
+		{
+			uint64_t             id = emptyId;
+			const TechniqueInfo* info = nullptr;
+		};
+
+		static constexpr uint64_t emptyId = ~uint64_t(0);
+
+		constexpr size_t Slot(uint64_t a_techniqueId) const
+		{
+			return static_cast<size_t>((a_techniqueId * multiplier) >> (64 - hashBits));
+		}
+
+		consteval bool TryBuild(const TechniqueInfo (&a_techniques)[N])
+		{
+			for (auto& entry : entries) {
+				entry = Entry{};
+			}
+
+			for (const auto& technique : a_techniques) {
+				Entry& entry = entries[Slot(technique.id)];
+				if (entry.info || technique.id == emptyId) {
+					return false;
+				}
+				entry = { technique.id, &technique };
+			}
+
+			return true;
+		}
+
+		uint64_t                      multiplier = 1;
+		std::array<Entry, tableSize> entries = {};
+	};
+
+	inline constexpr PerfectHashTable<manifestSize> techniqueTable{ manifest };
+
+	constexpr const TechniqueInfo* FindTechnique(uint64_t a_techniqueId) { return techniqueTable.Find(a_techniqueId); }
+
+	constexpr size_t GetTechniqueIndex(const TechniqueInfo* a_technique) { return static_cast<size_t>(a_technique - manifest); }
+
+	static_assert([] {
+		for (const auto& technique : manifest) {
+			if (FindTechnique(technique.id) != &technique) {
+				return false;
+			}
+		}
+		return FindTechnique(0) == nullptr && FindTechnique(0x1FE1B) == nullptr;
+	}());
+}
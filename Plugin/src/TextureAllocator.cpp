@@ -0,0 +1,68 @@
+#include "TextureAllocator.h"
+
+namespace Utils
+{
+	namespace
+	{
+		D3D12_RESOURCE_DESC GetTextureDesc(const TextureKey& a_key)
+		{
+			return {
+				.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+				.Alignment = 0,
+				.Width = a_key.width,
+				.Height = a_key.height,
+				.DepthOrArraySize = 1,
+				.MipLevels = 1,
+				.Format = a_key.format,
+				.SampleDesc = { a_key.sampleCount, 0 },
+				.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+				.Flags = a_key.flags,
+			};
+		}
+	}
+
+	TextureAllocator::TextureAllocator(ID3D12Device* a_device) :
+		device(a_device)
+	{
+		device->AddRef();
+	}
+
+	TextureAllocator::~TextureAllocator()
+	{
+		device->Release();
+	}
+
+	ID3D12Resource* TextureAllocator::Create(const TextureKey& a_key)
+	{
+		const D3D12_HEAP_PROPERTIES heapProperties = {
+			.Type = D3D12_HEAP_TYPE_DEFAULT,
+			.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+			.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+		};
+		const auto textureDesc = GetTextureDesc(a_key);
+
+		ID3D12Resource* texture = nullptr;
+		if (FAILED(device->CreateCommittedResource(
+				&heapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&textureDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				nullptr,
+				IID_PPV_ARGS(&texture)))) {
+			return nullptr;
+		}
+		return texture;
+	}
+
+	void TextureAllocator::Destroy(ID3D12Resource* a_resource)
+	{
+		a_resource->Release();
+	}
+
+	uint64_t TextureAllocator::GetSize(const TextureKey& a_key) const
+	{
+		const auto textureDesc = GetTextureDesc(a_key);
+		const auto info = device->GetResourceAllocationInfo(0, 1, &textureDesc);
+		return info.SizeInBytes != UINT64_MAX ? info.SizeInBytes : 0;  // The description is invalid, creating it will fail anyway
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "ResourcePool.h"
+
+#include <d3d12.h>
+
+namespace Utils
+{
+	// What tells textures apart for reuse, the rest of the description is always the same (a single 2D mip without padding)
+	struct TextureKey
+	{
+		uint64_t             width = 0;
+		uint32_t             height = 0;
+		DXGI_FORMAT          format = DXGI_FORMAT_UNKNOWN;
+		uint32_t             sampleCount = 1;
+		D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+
+		bool operator==(const TextureKey&) const = default;
+	};
+
+	// Creates committed textures in the default heap, in the copy destination state
+	class TextureAllocator : public ResourceAllocator<ID3D12Resource, TextureKey>
+	{
+	public:
+		explicit TextureAllocator(ID3D12Device* a_device);
+		~TextureAllocator() override;
+
+		ID3D12Resource* Create(const TextureKey& a_key) override;
+		void            Destroy(ID3D12Resource* a_resource) override;
+		uint64_t        GetSize(const TextureKey& a_key) const override;
+
+	private:
+		ID3D12Device* device;
+	};
+
+	using TexturePool = ResourcePool<ID3D12Resource, TextureKey>;
+}
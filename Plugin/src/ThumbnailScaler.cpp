@@ -0,0 +1,319 @@
+#include "ThumbnailScaler.h"
+#include "CpuFeatures.h"
+#include "HalfFloat.h"
+#include "WorkerPool.h"
+
+#include <immintrin.h>
+
+namespace Utils
+{
+	namespace
+	{
+		float SRGBToLinear(float a_value)
+		{
+			return a_value <= 0.04045f ? a_value / 12.92f : std::pow((a_value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float LinearToSRGB(float a_value)
+		{
+			return a_value <= 0.0031308f ? a_value * 12.92f : 1.055f * std::pow(a_value, 1.f / 2.4f) - 0.055f;
+		}
+
+		template <size_t N>
+		const std::array<float, N>& GetSRGBToLinearTable()
+		{
+			static const std::array<float, N> table = []() {
+				std::array<float, N> result;
+				for (size_t i = 0; i < result.size(); ++i) {
+					result[i] = SRGBToLinear(static_cast<float>(i) / static_cast<float>(N - 1));
+				}
+				return result;
+			}();
+			return table;
+		}
+
+		// Converts the cropped part of a source row to linear RGBA floats
+		void LinearizeRow(const uint8_t* a_row, size_t a_width, ScalerFormat a_format, float* a_outRow)
+		{
+			switch (a_format) {
+			case ScalerFormat::kRGBA8:
+			case ScalerFormat::kBGRA8:
+				{
+					const auto&  table = GetSRGBToLinearTable<256>();
+					const size_t redOffset = a_format == ScalerFormat::kBGRA8 ? 2 : 0;
+					for (size_t x = 0; x < a_width; ++x) {
+						const uint8_t* pixel = a_row + x * 4;
+						a_outRow[x * 4 + 0] = table[pixel[redOffset]];
+						a_outRow[x * 4 + 1] = table[pixel[1]];
+						a_outRow[x * 4 + 2] = table[pixel[2 - redOffset]];
+						a_outRow[x * 4 + 3] = 0.f;
+					}
+					break;
+				}
+			case ScalerFormat::kRGB10A2:
+				{
+					const auto& table = GetSRGBToLinearTable<1024>();
+					for (size_t x = 0; x < a_width; ++x) {
+						uint32_t packed;
+						std::memcpy(&packed, a_row + x * 4, sizeof(packed));
+						a_outRow[x * 4 + 0] = table[packed & 0x3FF];
+						a_outRow[x * 4 + 1] = table[(packed >> 10) & 0x3FF];
+						a_outRow[x * 4 + 2] = table[(packed >> 20) & 0x3FF];
+						a_outRow[x * 4 + 3] = 0.f;
+					}
+					break;
+				}
+			case ScalerFormat::kRGBA16F:
+				{
+					const uint16_t* halfs = reinterpret_cast<const uint16_t*>(a_row);
+					for (size_t i = 0; i < a_width * 4; ++i) {
+						a_outRow[i] = HalfToFloat(halfs[i]);
+					}
+					break;
+				}
+			}
+		}
+
+		LUMA_TARGET_AVX2 void LinearizeHalfRowAVX2(const uint8_t* a_row, size_t a_width, float* a_outRow)
+		{
+			const size_t vectorWidth = a_width & ~size_t(1);
+			for (size_t x = 0; x < vectorWidth; x += 2) {
+				_mm256_storeu_ps(a_outRow + x * 4, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + x * 8))));
+			}
+			if (vectorWidth != a_width) {
+				LinearizeRow(a_row + vectorWidth * 8, a_width - vectorWidth, ScalerFormat::kRGBA16F, a_outRow + vectorWidth * 4);
+			}
+		}
+
+		void FilterRowHorizontalScalar(const float* a_row, size_t a_width, const size_t* a_first, const float* a_weights, size_t a_tapCount, float* a_outRow)
+		{
+			for (size_t x = 0; x < a_width; ++x) {
+				const float* source = a_row + a_first[x] * 4;
+				const float* weights = a_weights + x * a_tapCount * 4;
+				float        sum[4] = {};
+				for (size_t i = 0; i < a_tapCount * 4; ++i) {
+					sum[i % 4] += source[i] * weights[i];
+				}
+				std::memcpy(a_outRow + x * 4, sum, sizeof(sum));
+			}
+		}
+
+		// Two source pixels per register
+		LUMA_TARGET_AVX2 void FilterRowHorizontalAVX2(const float* a_row, size_t a_width, const size_t* a_first, const float* a_weights, size_t a_tapCount, float* a_outRow)
+		{
+			for (size_t x = 0; x < a_width; ++x) {
+				const float* source = a_row + a_first[x] * 4;
+				const float* weights = a_weights + x * a_tapCount * 4;
+				__m256       sum = _mm256_setzero_ps();
+				for (size_t i = 0; i < a_tapCount * 4; i += 8) {
+					sum = _mm256_fmadd_ps(_mm256_loadu_ps(source + i), _mm256_loadu_ps(weights + i), sum);
+				}
+				_mm_storeu_ps(a_outRow + x * 4, _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+			}
+		}
+
+		void AccumulateRowScalar(const float* a_row, size_t a_size, float a_weight, float* a_outRow)
+		{
+			for (size_t i = 0; i < a_size; ++i) {
+				a_outRow[i] += a_row[i] * a_weight;
+			}
+		}
+
+		LUMA_TARGET_AVX2 void AccumulateRowAVX2(const float* a_row, size_t a_size, float a_weight, float* a_outRow)
+		{
+			const __m256 weight = _mm256_set1_ps(a_weight);
+			const size_t vectorSize = a_size & ~size_t(7);
+			for (size_t i = 0; i < vectorSize; i += 8) {
+				_mm256_storeu_ps(a_outRow + i, _mm256_fmadd_ps(_mm256_loadu_ps(a_row + i), weight, _mm256_loadu_ps(a_outRow + i)));
+			}
+			AccumulateRowScalar(a_row + vectorSize, a_size - vectorSize, a_weight, a_outRow + vectorSize);
+		}
+	}
+
+	ScalerCrop GetCenterCrop(size_t a_sourceWidth, size_t a_sourceHeight, size_t a_width, size_t a_height)
+	{
+		ScalerCrop crop{ 0, 0, a_sourceWidth, a_sourceHeight };
+		if (a_width == 0 || a_height == 0) {
+			return crop;
+		}
+
+		// Compare a_sourceWidth / a_sourceHeight against a_width / a_height without dividing
+		if (a_sourceWidth * a_height > a_width * a_sourceHeight) {
+			crop.width = std::max<size_t>((a_sourceHeight * a_width + a_height / 2) / a_height, 1);
+			crop.x = (a_sourceWidth - crop.width) / 2;
+		} else if (a_sourceWidth * a_height < a_width * a_sourceHeight) {
+			crop.height = std::max<size_t>((a_sourceWidth * a_height + a_width / 2) / a_width, 1);
+			crop.y = (a_sourceHeight - crop.height) / 2;
+		}
+		return crop;
+	}
+
+	ThumbnailScaler::FilterTaps ThumbnailScaler::BuildTaps(size_t a_sourceSize, size_t a_size)
+	{
+		const double scale = static_cast<double>(a_sourceSize) / static_cast<double>(a_size);
+
+		// Each output pixel averages the source pixels it covers, weighted by how much of them it covers
+		std::vector<std::vector<float>> weights(a_size);
+		FilterTaps                      taps;
+		taps.first.resize(a_size);
+		for (size_t i = 0; i < a_size; ++i) {
+			const double start = static_cast<double>(i) * scale;
+			const double end = std::min(static_cast<double>(i + 1) * scale, static_cast<double>(a_sourceSize));
+			const size_t first = std::min(static_cast<size_t>(start), a_sourceSize - 1);
+			const size_t last = std::clamp(static_cast<size_t>(std::ceil(end)), first + 1, a_sourceSize);
+
+			taps.first[i] = first;
+			double sum = 0.0;
+			for (size_t source = first; source < last; ++source) {
+				const double coverage = std::max(std::min(end, static_cast<double>(source + 1)) - std::max(start, static_cast<double>(source)), 0.0);
+				weights[i].push_back(static_cast<float>(coverage));
+				sum += coverage;
+			}
+			for (float& weight : weights[i]) {
+				weight = sum > 0.0 ? static_cast<float>(weight / sum) : 1.f / static_cast<float>(weights[i].size());
+			}
+			taps.count = std::max(taps.count, weights[i].size());
+		}
+		taps.count += taps.count % 2;
+
+		taps.weights.resize(a_size * taps.count * 4, 0.f);
+		for (size_t i = 0; i < a_size; ++i) {
+			for (size_t tap = 0; tap < weights[i].size(); ++tap) {
+				std::fill_n(taps.weights.data() + (i * taps.count + tap) * 4, 4, weights[i][tap]);
+			}
+		}
+		return taps;
+	}
+
+	ThumbnailScaler::ThumbnailScaler(size_t a_sourceWidth, size_t a_sourceHeight, size_t a_width, size_t a_height) :
+		width(a_width), height(a_height), crop(GetCenterCrop(a_sourceWidth, a_sourceHeight, a_width, a_height))
+	{
+		if (width == 0 || height == 0 || crop.width == 0 || crop.height == 0) {
+			width = 0;
+			height = 0;
+			return;
+		}
+
+		horizontalTaps = BuildTaps(crop.width, width);
+
+		// Turned around, so each source row can be added to the output rows as soon as it comes in, instead of being kept until all of them did.
+		// The padding taps have a weight of 0 and are left out, they can be past the last row.
+		const FilterTaps verticalTaps = BuildTaps(crop.height, height);
+		std::vector<std::vector<RowTap>> tapsBySourceRow(crop.height);
+		for (size_t y = 0; y < height; ++y) {
+			for (size_t tap = 0; tap < verticalTaps.count; ++tap) {
+				const float weight = verticalTaps.weights[(y * verticalTaps.count + tap) * 4];
+				if (weight != 0.f) {
+					tapsBySourceRow[verticalTaps.first[y] + tap].push_back({ y, weight });
+				}
+			}
+		}
+		rowTapsBegin.reserve(crop.height + 1);
+		for (const auto& taps : tapsBySourceRow) {
+			rowTapsBegin.push_back(rowTaps.size());
+			rowTaps.insert(rowTaps.end(), taps.begin(), taps.end());
+		}
+		rowTapsBegin.push_back(rowTaps.size());
+
+		pixels.resize(width * height * 4, 0.f);
+		rowMutexes = std::vector<std::mutex>(height);
+	}
+
+	void ThumbnailScaler::AddSourceRow(size_t a_y, const uint8_t* a_row, ScalerFormat a_format)
+	{
+		if (width == 0 || a_y < crop.y || a_y >= crop.y + crop.height) {
+			return;
+		}
+
+		const bool     bAVX2 = IsAVX2Supported();
+		const size_t   bytesPerPixel = a_format == ScalerFormat::kRGBA16F ? 8 : 4;
+		const uint8_t* croppedRow = a_row + crop.x * bytesPerPixel;
+
+		// Padded like the filtered rows, so the taps with a weight of 0 past the end can be read
+		thread_local std::vector<float> linearRow;
+		linearRow.resize((crop.width + horizontalTaps.count) * 4);
+		std::fill(linearRow.begin() + crop.width * 4, linearRow.end(), 0.f);
+
+		if (bAVX2 && a_format == ScalerFormat::kRGBA16F) {
+			LinearizeHalfRowAVX2(croppedRow, crop.width, linearRow.data());
+		} else {
+			LinearizeRow(croppedRow, crop.width, a_format, linearRow.data());
+		}
+
+		const size_t                    rowSize = width * 4;
+		thread_local std::vector<float> filteredRow;
+		filteredRow.resize(rowSize);
+		if (bAVX2) {
+			FilterRowHorizontalAVX2(linearRow.data(), width, horizontalTaps.first.data(), horizontalTaps.weights.data(), horizontalTaps.count, filteredRow.data());
+		} else {
+			FilterRowHorizontalScalar(linearRow.data(), width, horizontalTaps.first.data(), horizontalTaps.weights.data(), horizontalTaps.count, filteredRow.data());
+		}
+
+		const auto   accumulateRow = bAVX2 ? &AccumulateRowAVX2 : &AccumulateRowScalar;
+		const size_t sourceRow = a_y - crop.y;
+		for (size_t i = rowTapsBegin[sourceRow]; i < rowTapsBegin[sourceRow + 1]; ++i) {
+			const RowTap&               tap = rowTaps[i];
+			std::lock_guard<std::mutex> lg(rowMutexes[tap.y]);
+			accumulateRow(filteredRow.data(), rowSize, tap.weight, pixels.data() + tap.y * rowSize);
+		}
+	}
+
+	void ThumbnailScaler::AddSourceImage(const uint8_t* a_pixels, size_t a_rowPitch, ScalerFormat a_format, WorkerPool* a_workers)
+	{
+		auto addRows = [&](size_t a_begin, size_t a_end) {
+			for (size_t y = crop.y + a_begin; y < crop.y + a_end; ++y) {
+				AddSourceRow(y, a_pixels + y * a_rowPitch, a_format);
+			}
+		};
+
+		if (a_workers) {
+			a_workers->ParallelFor(crop.height, addRows);
+		} else {
+			addRows(0, crop.height);
+		}
+	}
+
+	void ThumbnailScaler::GetPixels(ScalerFormat a_format, uint8_t* a_outPixels, size_t a_rowPitch) const
+	{
+		for (size_t y = 0; y < height; ++y) {
+			const float* row = pixels.data() + y * width * 4;
+			uint8_t*     outRow = a_outPixels + y * a_rowPitch;
+			for (size_t x = 0; x < width; ++x) {
+				const float* pixel = row + x * 4;
+				switch (a_format) {
+				case ScalerFormat::kRGBA8:
+				case ScalerFormat::kBGRA8:
+					{
+						const size_t redOffset = a_format == ScalerFormat::kBGRA8 ? 2 : 0;
+						auto         encode = [](float a_value) {
+							return static_cast<uint8_t>(std::lround(LinearToSRGB(std::clamp(a_value, 0.f, 1.f)) * 255.f));
+						};
+						outRow[x * 4 + redOffset] = encode(pixel[0]);
+						outRow[x * 4 + 1] = encode(pixel[1]);
+						outRow[x * 4 + 2 - redOffset] = encode(pixel[2]);
+						outRow[x * 4 + 3] = 255;
+						break;
+					}
+				case ScalerFormat::kRGB10A2:
+					{
+						auto encode = [](float a_value) {
+							return static_cast<uint32_t>(std::lround(LinearToSRGB(std::clamp(a_value, 0.f, 1.f)) * 1023.f));
+						};
+						const uint32_t packed = encode(pixel[0]) | (encode(pixel[1]) << 10) | (encode(pixel[2]) << 20) | (3u << 30);
+						std::memcpy(outRow + x * 4, &packed, sizeof(packed));
+						break;
+					}
+				case ScalerFormat::kRGBA16F:
+					{
+						uint16_t* outPixel = reinterpret_cast<uint16_t*>(outRow) + x * 4;
+						for (int channel = 0; channel < 3; ++channel) {
+							outPixel[channel] = FloatToHalf(pixel[channel]);
+						}
+						outPixel[3] = 0x3C00;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
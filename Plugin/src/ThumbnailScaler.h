@@ -0,0 +1,75 @@
+#pragma once
+
+namespace Utils
+{
+	class WorkerPool;
+
+	// 8 and 10 bit formats are sRGB encoded, half float is linear
+	enum class ScalerFormat
+	{
+		kRGBA8,
+		kBGRA8,
+		kRGB10A2,
+		kRGBA16F
+	};
+
+	struct ScalerCrop
+	{
+		size_t x = 0;
+		size_t y = 0;
+		size_t width = 0;
+		size_t height = 0;
+	};
+
+	// The largest centered part of the source with the aspect ratio of the target
+	ScalerCrop GetCenterCrop(size_t a_sourceWidth, size_t a_sourceHeight, size_t a_width, size_t a_height);
+
+	// Downscales with an area (box) filter in linear light, after center cropping the source to the target aspect ratio.
+	// Source rows go through both passes as they are added, so it can run alongside another pass over the same rows (e.g. the PNG encode of the full image),
+	// and nothing larger than the thumbnail is kept.
+	class ThumbnailScaler
+	{
+	public:
+		ThumbnailScaler(size_t a_sourceWidth, size_t a_sourceHeight, size_t a_width, size_t a_height);
+
+		// Rows outside of the crop are ignored. Different rows can be added from different threads at the same time, in any order.
+		void AddSourceRow(size_t a_y, const uint8_t* a_row, ScalerFormat a_format);
+		// Adds all the rows of an image, split between the workers if any are passed in
+		void AddSourceImage(const uint8_t* a_pixels, size_t a_rowPitch, ScalerFormat a_format, WorkerPool* a_workers = nullptr);
+		// Writes the pixels with an opaque alpha, once every row of the crop was added
+		void GetPixels(ScalerFormat a_format, uint8_t* a_outPixels, size_t a_rowPitch) const;
+
+		size_t            GetWidth() const { return width; }
+		size_t            GetHeight() const { return height; }
+		const ScalerCrop& GetCrop() const { return crop; }
+
+	private:
+		// The weights of each output pixel are padded to the same even count, each repeated for the 4 channels, so two source pixels can be weighted at once
+		struct FilterTaps
+		{
+			std::vector<size_t> first;
+			std::vector<float>  weights;
+			size_t              count = 0;
+		};
+
+		// An output row that a cropped source row is a vertical tap of
+		struct RowTap
+		{
+			size_t y;
+			float  weight;
+		};
+
+		static FilterTaps BuildTaps(size_t a_sourceSize, size_t a_size);
+
+		size_t     width;
+		size_t     height;
+		ScalerCrop crop;
+		FilterTaps horizontalTaps;
+
+		std::vector<RowTap> rowTaps;       // Grouped by source row
+		std::vector<size_t> rowTapsBegin;  // Into "rowTaps", for each cropped source row and one past the last
+
+		std::vector<float>      pixels;      // Linear RGBA, the source rows are added to it with their vertical weights
+		std::vector<std::mutex> rowMutexes;  // Of "pixels", source rows added at the same time can share output rows
+	};
+}
@@ -0,0 +1,55 @@
+#include "UpgradePlanner.h"
+
+namespace Utils
+{
+	float GetBufferResolutionScale(std::string_view a_bufferName)
+	{
+		if (a_bufferName.find("QuarterRes") != std::string_view::npos) {
+			return 0.25f;
+		}
+		if (a_bufferName.find("HalfRes") != std::string_view::npos) {
+			return 0.5f;
+		}
+		return 1.f;
+	}
+
+	RenderTargetUpgradePlan PlanRenderTargetUpgrades(std::span<const RenderTargetUpgradeRequest> a_requests, const BufferNameIndex& a_buffers, const RenderTargetUpgradePlanParams& a_params)
+	{
+		RenderTargetUpgradePlan plan;
+		plan.budgetBytes = a_params.budgetBytes;
+		plan.upgrades.reserve(a_requests.size());
+
+		for (const auto& request : a_requests) {
+			// The same buffer can be listed more than once (e.g. in both the main and extra lists), the first one has the highest priority
+			if (std::ranges::any_of(plan.upgrades, [&](const RenderTargetUpgrade& a_upgrade) { return a_upgrade.name == request.name; })) {
+				continue;
+			}
+
+			auto& upgrade = plan.upgrades.emplace_back();
+			upgrade.name = request.name;
+			upgrade.toFormat = request.format;
+			upgrade.buffer = a_buffers.Find(request.name);
+			if (!upgrade.buffer) {
+				continue;
+			}
+
+			upgrade.fromFormat = upgrade.buffer->format;
+			upgrade.resolutionScale = GetBufferResolutionScale(request.name);
+
+			const auto pixels = static_cast<int64_t>(static_cast<double>(a_params.width) * upgrade.resolutionScale) * static_cast<int64_t>(static_cast<double>(a_params.height) * upgrade.resolutionScale);
+			const auto fromBytesPerPixel = static_cast<int64_t>(a_params.getBytesPerPixel(upgrade.fromFormat));
+			const auto toBytesPerPixel = static_cast<int64_t>(a_params.getBytesPerPixel(upgrade.toFormat));
+			upgrade.bytesDelta = pixels * (toBytesPerPixel - fromBytesPerPixel);
+			upgrade.bandwidthDelta = upgrade.bytesDelta * a_params.accessesPerFrame;
+
+			const bool bFitsInBudget = a_params.budgetBytes == 0 || upgrade.bytesDelta <= 0 || plan.selectedBytesDelta + upgrade.bytesDelta <= static_cast<int64_t>(a_params.budgetBytes);
+			if (bFitsInBudget) {
+				upgrade.bSelected = true;
+				plan.selectedBytesDelta += upgrade.bytesDelta;
+				plan.selectedBandwidthDelta += upgrade.bandwidthDelta;
+			}
+		}
+
+		return plan;
+	}
+}
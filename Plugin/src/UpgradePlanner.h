@@ -0,0 +1,48 @@
+#pragma once
+#include "BufferIndex.h"
+
+namespace Utils
+{
+	struct RenderTargetUpgradeRequest
+	{
+		std::string_view   name;
+		RE::BS_DXGI_FORMAT format;
+	};
+
+	struct RenderTargetUpgrade
+	{
+		std::string_view      name;
+		RE::BufferDefinition* buffer = nullptr;  // nullptr if the game has no buffer with this name
+		RE::BS_DXGI_FORMAT    fromFormat = RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_UNKNOWN_0;
+		RE::BS_DXGI_FORMAT    toFormat = RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_UNKNOWN_0;
+		float                 resolutionScale = 1.f;  // Per axis, relative to the output resolution
+		int64_t               bytesDelta = 0;
+		int64_t               bandwidthDelta = 0;  // Per frame
+		bool                  bSelected = false;
+	};
+
+	struct RenderTargetUpgradePlan
+	{
+		std::vector<RenderTargetUpgrade> upgrades;  // In priority order
+		uint64_t                         budgetBytes = 0;  // 0 means unlimited
+		int64_t                          selectedBytesDelta = 0;
+		int64_t                          selectedBandwidthDelta = 0;
+	};
+
+	struct RenderTargetUpgradePlanParams
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint64_t budgetBytes = 0;  // 0 means unlimited
+		// Rough estimate of how many times each render target is fully written or read in a frame
+		uint32_t accessesPerFrame = 2;
+		std::function<uint32_t(RE::BS_DXGI_FORMAT)> getBytesPerPixel;
+	};
+
+	// Guesses the resolution scale of a buffer from its name, as the buffer definitions don't expose it (that we know of)
+	float GetBufferResolutionScale(std::string_view a_bufferName);
+
+	// Computes the memory and bandwidth cost of each requested upgrade and, going through the requests in priority order (first is highest),
+	// selects the ones that fit in the VRAM budget. Upgrades that don't increase the memory usage are always selected.
+	RenderTargetUpgradePlan PlanRenderTargetUpgrades(std::span<const RenderTargetUpgradeRequest> a_requests, const BufferNameIndex& a_buffers, const RenderTargetUpgradePlanParams& a_params);
+}
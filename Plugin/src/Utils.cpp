@@ -8,159 +8,56 @@
 
 namespace Utils
 {
-    std::unordered_map<DXGI_FORMAT, std::string> GetDXGIFormatNameMap()
+    const BufferNameIndex& GetBufferIndex()
     {
-		std::unordered_map<DXGI_FORMAT, std::string> formatNames;
-
-		formatNames[DXGI_FORMAT_UNKNOWN] = "DXGI_FORMAT_UNKNOWN";
-		formatNames[DXGI_FORMAT_R32G32B32A32_TYPELESS] = "DXGI_FORMAT_R32G32B32A32_TYPELESS";
-		formatNames[DXGI_FORMAT_R32G32B32A32_FLOAT] = "DXGI_FORMAT_R32G32B32A32_FLOAT";
-		formatNames[DXGI_FORMAT_R32G32B32A32_UINT] = "DXGI_FORMAT_R32G32B32A32_UINT";
-		formatNames[DXGI_FORMAT_R32G32B32A32_SINT] = "DXGI_FORMAT_R32G32B32A32_SINT";
-		formatNames[DXGI_FORMAT_R32G32B32_TYPELESS] = "DXGI_FORMAT_R32G32B32_TYPELESS";
-		formatNames[DXGI_FORMAT_R32G32B32_FLOAT] = "DXGI_FORMAT_R32G32B32_FLOAT";
-		formatNames[DXGI_FORMAT_R32G32B32_UINT] = "DXGI_FORMAT_R32G32B32_UINT";
-		formatNames[DXGI_FORMAT_R32G32B32_SINT] = "DXGI_FORMAT_R32G32B32_SINT";
-		formatNames[DXGI_FORMAT_R16G16B16A16_TYPELESS] = "DXGI_FORMAT_R16G16B16A16_TYPELESS";
-		formatNames[DXGI_FORMAT_R16G16B16A16_FLOAT] = "DXGI_FORMAT_R16G16B16A16_FLOAT";
-		formatNames[DXGI_FORMAT_R16G16B16A16_UNORM] = "DXGI_FORMAT_R16G16B16A16_UNORM";
-		formatNames[DXGI_FORMAT_R16G16B16A16_UINT] = "DXGI_FORMAT_R16G16B16A16_UINT";
-		formatNames[DXGI_FORMAT_R16G16B16A16_SNORM] = "DXGI_FORMAT_R16G16B16A16_SNORM";
-		formatNames[DXGI_FORMAT_R16G16B16A16_SINT] = "DXGI_FORMAT_R16G16B16A16_SINT";
-		formatNames[DXGI_FORMAT_R32G32_TYPELESS] = "DXGI_FORMAT_R32G32_TYPELESS";
-		formatNames[DXGI_FORMAT_R32G32_FLOAT] = "DXGI_FORMAT_R32G32_FLOAT";
-		formatNames[DXGI_FORMAT_R32G32_UINT] = "DXGI_FORMAT_R32G32_UINT";
-		formatNames[DXGI_FORMAT_R32G32_SINT] = "DXGI_FORMAT_R32G32_SINT";
-		formatNames[DXGI_FORMAT_R32G8X24_TYPELESS] = "DXGI_FORMAT_R32G8X24_TYPELESS";
-		formatNames[DXGI_FORMAT_D32_FLOAT_S8X24_UINT] = "DXGI_FORMAT_D32_FLOAT_S8X24_UINT";
-		formatNames[DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS] = "DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS";
-		formatNames[DXGI_FORMAT_X32_TYPELESS_G8X24_UINT] = "DXGI_FORMAT_X32_TYPELESS_G8X24_UINT";
-		formatNames[DXGI_FORMAT_R10G10B10A2_TYPELESS] = "DXGI_FORMAT_R10G10B10A2_TYPELESS";
-		formatNames[DXGI_FORMAT_R10G10B10A2_UNORM] = "DXGI_FORMAT_R10G10B10A2_UNORM";
-		formatNames[DXGI_FORMAT_R10G10B10A2_UINT] = "DXGI_FORMAT_R10G10B10A2_UINT";
-		formatNames[DXGI_FORMAT_R11G11B10_FLOAT] = "DXGI_FORMAT_R11G11B10_FLOAT";
-		formatNames[DXGI_FORMAT_R8G8B8A8_TYPELESS] = "DXGI_FORMAT_R8G8B8A8_TYPELESS";
-		formatNames[DXGI_FORMAT_R8G8B8A8_UNORM] = "DXGI_FORMAT_R8G8B8A8_UNORM";
-		formatNames[DXGI_FORMAT_R8G8B8A8_UNORM_SRGB] = "DXGI_FORMAT_R8G8B8A8_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_R8G8B8A8_UINT] = "DXGI_FORMAT_R8G8B8A8_UINT";
-		formatNames[DXGI_FORMAT_R8G8B8A8_SNORM] = "DXGI_FORMAT_R8G8B8A8_SNORM";
-		formatNames[DXGI_FORMAT_R8G8B8A8_SINT] = "DXGI_FORMAT_R8G8B8A8_SINT";
-		formatNames[DXGI_FORMAT_R16G16_TYPELESS] = "DXGI_FORMAT_R16G16_TYPELESS";
-		formatNames[DXGI_FORMAT_R16G16_FLOAT] = "DXGI_FORMAT_R16G16_FLOAT";
-		formatNames[DXGI_FORMAT_R16G16_UNORM] = "DXGI_FORMAT_R16G16_UNORM";
-		formatNames[DXGI_FORMAT_R16G16_UINT] = "DXGI_FORMAT_R16G16_UINT";
-		formatNames[DXGI_FORMAT_R16G16_SNORM] = "DXGI_FORMAT_R16G16_SNORM";
-		formatNames[DXGI_FORMAT_R16G16_SINT] = "DXGI_FORMAT_R16G16_SINT";
-		formatNames[DXGI_FORMAT_R32_TYPELESS] = "DXGI_FORMAT_R32_TYPELESS";
-		formatNames[DXGI_FORMAT_D32_FLOAT] = "DXGI_FORMAT_D32_FLOAT";
-		formatNames[DXGI_FORMAT_R32_FLOAT] = "DXGI_FORMAT_R32_FLOAT";
-		formatNames[DXGI_FORMAT_R32_UINT] = "DXGI_FORMAT_R32_UINT";
-		formatNames[DXGI_FORMAT_R32_SINT] = "DXGI_FORMAT_R32_SINT";
-		formatNames[DXGI_FORMAT_R24G8_TYPELESS] = "DXGI_FORMAT_R24G8_TYPELESS";
-		formatNames[DXGI_FORMAT_D24_UNORM_S8_UINT] = "DXGI_FORMAT_D24_UNORM_S8_UINT";
-		formatNames[DXGI_FORMAT_R24_UNORM_X8_TYPELESS] = "DXGI_FORMAT_R24_UNORM_X8_TYPELESS";
-		formatNames[DXGI_FORMAT_X24_TYPELESS_G8_UINT] = "DXGI_FORMAT_X24_TYPELESS_G8_UINT";
-		formatNames[DXGI_FORMAT_R8G8_TYPELESS] = "DXGI_FORMAT_R8G8_TYPELESS";
-		formatNames[DXGI_FORMAT_R8G8_UNORM] = "DXGI_FORMAT_R8G8_UNORM";
-		formatNames[DXGI_FORMAT_R8G8_UINT] = "DXGI_FORMAT_R8G8_UINT";
-		formatNames[DXGI_FORMAT_R8G8_SNORM] = "DXGI_FORMAT_R8G8_SNORM";
-		formatNames[DXGI_FORMAT_R8G8_SINT] = "DXGI_FORMAT_R8G8_SINT";
-		formatNames[DXGI_FORMAT_R16_TYPELESS] = "DXGI_FORMAT_R16_TYPELESS";
-		formatNames[DXGI_FORMAT_R16_FLOAT] = "DXGI_FORMAT_R16_FLOAT";
-		formatNames[DXGI_FORMAT_D16_UNORM] = "DXGI_FORMAT_D16_UNORM";
-		formatNames[DXGI_FORMAT_R16_UNORM] = "DXGI_FORMAT_R16_UNORM";
-		formatNames[DXGI_FORMAT_R16_UINT] = "DXGI_FORMAT_R16_UINT";
-		formatNames[DXGI_FORMAT_R16_SNORM] = "DXGI_FORMAT_R16_SNORM";
-		formatNames[DXGI_FORMAT_R16_SINT] = "DXGI_FORMAT_R16_SINT";
-		formatNames[DXGI_FORMAT_R8_TYPELESS] = "DXGI_FORMAT_R8_TYPELESS";
-		formatNames[DXGI_FORMAT_R8_UNORM] = "DXGI_FORMAT_R8_UNORM";
-		formatNames[DXGI_FORMAT_R8_UINT] = "DXGI_FORMAT_R8_UINT";
-		formatNames[DXGI_FORMAT_R8_SNORM] = "DXGI_FORMAT_R8_SNORM";
-		formatNames[DXGI_FORMAT_R8_SINT] = "DXGI_FORMAT_R8_SINT";
-		formatNames[DXGI_FORMAT_A8_UNORM] = "DXGI_FORMAT_A8_UNORM";
-		formatNames[DXGI_FORMAT_R1_UNORM] = "DXGI_FORMAT_R1_UNORM";
-		formatNames[DXGI_FORMAT_R9G9B9E5_SHAREDEXP] = "DXGI_FORMAT_R9G9B9E5_SHAREDEXP";
-		formatNames[DXGI_FORMAT_R8G8_B8G8_UNORM] = "DXGI_FORMAT_R8G8_B8G8_UNORM";
-		formatNames[DXGI_FORMAT_G8R8_G8B8_UNORM] = "DXGI_FORMAT_G8R8_G8B8_UNORM";
-		formatNames[DXGI_FORMAT_BC1_TYPELESS] = "DXGI_FORMAT_BC1_TYPELESS";
-		formatNames[DXGI_FORMAT_BC1_UNORM] = "DXGI_FORMAT_BC1_UNORM";
-		formatNames[DXGI_FORMAT_BC1_UNORM_SRGB] = "DXGI_FORMAT_BC1_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_BC2_TYPELESS] = "DXGI_FORMAT_BC2_TYPELESS";
-		formatNames[DXGI_FORMAT_BC2_UNORM] = "DXGI_FORMAT_BC2_UNORM";
-		formatNames[DXGI_FORMAT_BC2_UNORM_SRGB] = "DXGI_FORMAT_BC2_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_BC3_TYPELESS] = "DXGI_FORMAT_BC3_TYPELESS";
-		formatNames[DXGI_FORMAT_BC3_UNORM] = "DXGI_FORMAT_BC3_UNORM";
-		formatNames[DXGI_FORMAT_BC3_UNORM_SRGB] = "DXGI_FORMAT_BC3_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_BC4_TYPELESS] = "DXGI_FORMAT_BC4_TYPELESS";
-		formatNames[DXGI_FORMAT_BC4_UNORM] = "DXGI_FORMAT_BC4_UNORM";
-		formatNames[DXGI_FORMAT_BC4_SNORM] = "DXGI_FORMAT_BC4_SNORM";
-		formatNames[DXGI_FORMAT_BC5_TYPELESS] = "DXGI_FORMAT_BC5_TYPELESS";
-		formatNames[DXGI_FORMAT_BC5_UNORM] = "DXGI_FORMAT_BC5_UNORM";
-		formatNames[DXGI_FORMAT_BC5_SNORM] = "DXGI_FORMAT_BC5_SNORM";
-		formatNames[DXGI_FORMAT_B5G6R5_UNORM] = "DXGI_FORMAT_B5G6R5_UNORM";
-		formatNames[DXGI_FORMAT_B5G5R5A1_UNORM] = "DXGI_FORMAT_B5G5R5A1_UNORM";
-		formatNames[DXGI_FORMAT_B8G8R8A8_UNORM] = "DXGI_FORMAT_B8G8R8A8_UNORM";
-		formatNames[DXGI_FORMAT_B8G8R8X8_UNORM] = "DXGI_FORMAT_B8G8R8X8_UNORM";
-		formatNames[DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM] = "DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM";
-		formatNames[DXGI_FORMAT_B8G8R8A8_TYPELESS] = "DXGI_FORMAT_B8G8R8A8_TYPELESS";
-		formatNames[DXGI_FORMAT_B8G8R8A8_UNORM_SRGB] = "DXGI_FORMAT_B8G8R8A8_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_B8G8R8X8_TYPELESS] = "DXGI_FORMAT_B8G8R8X8_TYPELESS";
-		formatNames[DXGI_FORMAT_B8G8R8X8_UNORM_SRGB] = "DXGI_FORMAT_B8G8R8X8_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_BC6H_TYPELESS] = "DXGI_FORMAT_BC6H_TYPELESS";
-		formatNames[DXGI_FORMAT_BC6H_UF16] = "DXGI_FORMAT_BC6H_UF16";
-		formatNames[DXGI_FORMAT_BC6H_SF16] = "DXGI_FORMAT_BC6H_SF16";
-		formatNames[DXGI_FORMAT_BC7_TYPELESS] = "DXGI_FORMAT_BC7_TYPELESS";
-		formatNames[DXGI_FORMAT_BC7_UNORM] = "DXGI_FORMAT_BC7_UNORM";
-		formatNames[DXGI_FORMAT_BC7_UNORM_SRGB] = "DXGI_FORMAT_BC7_UNORM_SRGB";
-		formatNames[DXGI_FORMAT_AYUV] = "DXGI_FORMAT_AYUV";
-		formatNames[DXGI_FORMAT_Y410] = "DXGI_FORMAT_Y410";
-		formatNames[DXGI_FORMAT_Y416] = "DXGI_FORMAT_Y416";
-		formatNames[DXGI_FORMAT_NV12] = "DXGI_FORMAT_NV12";
-		formatNames[DXGI_FORMAT_P010] = "DXGI_FORMAT_P010";
-		formatNames[DXGI_FORMAT_P016] = "DXGI_FORMAT_P016";
-		formatNames[DXGI_FORMAT_420_OPAQUE] = "DXGI_FORMAT_420_OPAQUE";
-		formatNames[DXGI_FORMAT_YUY2] = "DXGI_FORMAT_YUY2";
-		formatNames[DXGI_FORMAT_Y210] = "DXGI_FORMAT_Y210";
-		formatNames[DXGI_FORMAT_Y216] = "DXGI_FORMAT_Y216";
-		formatNames[DXGI_FORMAT_NV11] = "DXGI_FORMAT_NV11";
-		formatNames[DXGI_FORMAT_AI44] = "DXGI_FORMAT_AI44";
-		formatNames[DXGI_FORMAT_IA44] = "DXGI_FORMAT_IA44";
-		formatNames[DXGI_FORMAT_P8] = "DXGI_FORMAT_P8";
-		formatNames[DXGI_FORMAT_A8P8] = "DXGI_FORMAT_A8P8";
-		formatNames[DXGI_FORMAT_B4G4R4A4_UNORM] = "DXGI_FORMAT_B4G4R4A4_UNORM";
-		formatNames[DXGI_FORMAT_P208] = "DXGI_FORMAT_P208";
-		formatNames[DXGI_FORMAT_V208] = "DXGI_FORMAT_V208";
-		formatNames[DXGI_FORMAT_V408] = "DXGI_FORMAT_V408";
-		formatNames[DXGI_FORMAT_SAMPLER_FEEDBACK_MIN_MIP_OPAQUE] = "DXGI_FORMAT_SAMPLER_FEEDBACK_MIN_MIP_OPAQUE";
-		formatNames[DXGI_FORMAT_SAMPLER_FEEDBACK_MIP_REGION_USED_OPAQUE] = "DXGI_FORMAT_SAMPLER_FEEDBACK_MIP_REGION_USED_OPAQUE";
-
-		return formatNames;
+		// Built on first use, as the buffer array is only valid after the offsets were loaded
+		static const BufferNameIndex bufferIndex(*Offsets::bufferArray);
+		return bufferIndex;
     }
 
-    void LogFormats()
+    RE::BufferDefinition* FindBuffer(std::string_view a_bufferName)
     {
-		auto formatNames = GetDXGIFormatNameMap();
+		return GetBufferIndex().Find(a_bufferName);
+    }
 
+    void LogFormats()
+    {
 		for (int i = 0; i < 128; ++i) {
 			const auto format = Offsets::GetDXGIFormat(static_cast<RE::BS_DXGI_FORMAT>(i));
-			INFO("{} - {}", i, formatNames[format])
+			INFO("{} - {}", i, GetDXGIFormatName(format))
 		}
     }
 
-    void LogBuffers()
+    void LogBuffers(const RenderTargetUpgradePlan* a_upgradePlan)
     {
 		INFO("===LOGGING BUFFERS===")
 
 		std::string logString = "Index, Buffer name, DXGI_FORMAT\n";
 
-		auto formatNames = GetDXGIFormatNameMap();
 		for (int i = 0; i < Offsets::bufferArray->size(); ++i) {
 		    const auto& bufferDefinition = (*Offsets::bufferArray)[i];
 			const auto dxgiFormat = Offsets::GetDXGIFormat(bufferDefinition->format);
-			logString.append(fmt::format("{:3}, {}, {}\n", i, bufferDefinition->bufferName, formatNames[dxgiFormat]));
+			logString.append(fmt::format("{:3}, {}, {}\n", i, bufferDefinition->bufferName, GetDXGIFormatName(dxgiFormat)));
 		}
 
 		INFO(logString)
+
+		if (a_upgradePlan) {
+			constexpr double bytesPerMB = 1024.0 * 1024.0;
+			std::string upgradesString = "Buffer name, From, To, Resolution scale, VRAM delta (MB), Bandwidth delta per frame (MB), Upgraded\n";
+			for (const auto& upgrade : a_upgradePlan->upgrades) {
+				if (!upgrade.buffer) {
+					upgradesString.append(fmt::format("{}, not found\n", upgrade.name));
+					continue;
+				}
+				upgradesString.append(fmt::format("{}, {}, {}, {}, {:.2f}, {:.2f}, {}\n", upgrade.name, GetDXGIFormatName(Offsets::GetDXGIFormat(upgrade.fromFormat)), GetDXGIFormatName(Offsets::GetDXGIFormat(upgrade.toFormat)),
+					upgrade.resolutionScale, upgrade.bytesDelta / bytesPerMB, upgrade.bandwidthDelta / bytesPerMB, upgrade.bSelected));
+			}
+			upgradesString.append(fmt::format("Total: {:.2f} MB VRAM, {:.2f} MB bandwidth per frame, budget: {}", a_upgradePlan->selectedBytesDelta / bytesPerMB, a_upgradePlan->selectedBandwidthDelta / bytesPerMB,
+				a_upgradePlan->budgetBytes > 0 ? fmt::format("{:.2f} MB", a_upgradePlan->budgetBytes / bytesPerMB) : "unlimited"));
+			INFO(upgradesString)
+		}
+
 		INFO("===END LOGGING BUFFERS===")
     }
 
@@ -170,8 +67,7 @@ namespace Utils
 			return;
 		}
 
-		auto formatNames = Utils::GetDXGIFormatNameMap();
-		INFO("{} - changing from format {} to {}", a_buffer->bufferName, formatNames[Offsets::GetDXGIFormat(a_buffer->format)], formatNames[Offsets::GetDXGIFormat(a_format)])
+		INFO("{} - changing from format {} to {}", a_buffer->bufferName, GetDXGIFormatName(Offsets::GetDXGIFormat(a_buffer->format)), GetDXGIFormatName(Offsets::GetDXGIFormat(a_format)))
 		a_buffer->format = a_format;
     }
 
@@ -187,53 +83,50 @@ namespace Utils
 		return buffer->format;
     }
 
-	bool ShouldCorrectLUTs()
+	// Queries the game UI directly, this is slow-ish so it should only be done once per frame
+	class GameMenuSource : public MenuState::IMenuSource
 	{
-		const auto ui = *Offsets::uiPtr;
-
-		// make sure we don't correct luts in inventory/container menus
-		if (Offsets::UI_IsMenuOpen(ui, "InventoryMenu")) {
-			return false;
-		}
-		if (Offsets::UI_IsMenuOpen(ui, "ContainerMenu")) {
-			return false;
-		}
-		if (Offsets::UI_IsMenuOpen(ui, "BarterMenu")) {
-			return false;
+	public:
+		bool IsMenuOpen(MenuState::Menu a_menu) const override
+		{
+			// Constructing a "BSFixedString" goes through the game string pool, so only do it once
+			static const RE::BSFixedString menuNames[] = {
+				"InventoryMenu",
+				"ContainerMenu",
+				"BarterMenu",
+				"GalaxyStarMapMenu",
+				"SpaceshipEditorMenu",
+				"DataMenu",
+				"PauseMenu",
+				"MainMenu",
+			};
+			static_assert(std::size(menuNames) == static_cast<size_t>(MenuState::Menu::kCount));
+
+			return Offsets::UI_IsMenuOpen(*Offsets::uiPtr, menuNames[static_cast<size_t>(a_menu)]);
 		}
+	};
 
-		// make sure we do correct luts in galaxy and spaceship/starship menus (they both look ok, or better, with correction), even though DataMenu is in the menu stack
-		if (Offsets::UI_IsMenuOpen(ui, "GalaxyStarMapMenu")) {
-			return true;
-		}
-		if (Offsets::UI_IsMenuOpen(ui, "SpaceshipEditorMenu")) {
-			return true;
-		}
+	static MenuState::Tracker menuStateTracker;
 
-		// fallback to not correcting luts generally while data menu is in the stack
-		if (Offsets::UI_IsMenuOpen(ui, "DataMenu")) {
-			return false;
-		}
+	bool UpdateMenuState()
+	{
+		const GameMenuSource gameMenuSource;
+		return menuStateTracker.Update(gameMenuSource);
+	}
 
-		return true;
+	bool ShouldCorrectLUTs()
+	{
+		return menuStateTracker.ShouldCorrectLUTs();
 	}
 
 	bool IsInPauseMenu()
 	{
-		const auto ui = *Offsets::uiPtr;
-		if (Offsets::UI_IsMenuOpen(ui, "PauseMenu")) {
-			return true;
-		}
-		return false;
+		return menuStateTracker.IsInPauseMenu();
 	}
 
 	bool IsInMainMenu()
 	{
-		const auto ui = *Offsets::uiPtr;
-		if (Offsets::UI_IsMenuOpen(ui, "MainMenu")) {
-			return true;
-		}
-		return false;
+		return menuStateTracker.IsInMainMenu();
 	}
 
 	// Only works if HDR is enaged on the monitor that contains the swapchain
@@ -352,6 +245,32 @@ namespace Utils
 		return false;
     }
 
+	WorkerPool& GetScreenshotWorkers()
+	{
+		// Two workers, so an SDR and an HDR capture of the same photo can be encoded at the same time
+		static WorkerPool screenshotWorkers(2, 4, []() {
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+		});
+		return screenshotWorkers;
+	}
+
+	WorkerPool& GetImageWorkers()
+	{
+		// The thread that splits the work runs a part of it too
+		static const size_t threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		static WorkerPool imageWorkers(threadCount, threadCount, []() {
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+		});
+		return imageWorkers;
+	}
+
+	void ShutdownWorkerPools()
+	{
+		// The screenshot jobs split their work on the image workers
+		GetScreenshotWorkers().Shutdown();
+		GetImageWorkers().Shutdown();
+	}
+
 	std::filesystem::path GetPhotoModeScreenshotDirectory()
 	{
 		return std::format("{}{}", Offsets::documentsPath, *Offsets::photosPath);
@@ -364,86 +283,287 @@ namespace Utils
 		return std::format("Photo_{}-{:02d}-{:02d}-{:02d}{:02d}{:02d}", systemTime.wYear, systemTime.wMonth, systemTime.wDay, systemTime.wHour, systemTime.wMinute, systemTime.wSecond);
     }
 
-    void TransformColor_HDR(DirectX::XMVECTOR* a_outPixels, const DirectX::XMVECTOR* a_inPixels, size_t a_width, size_t a_y)
+	// Enough rows per strip to keep every image worker busy, while the readback buffers stay a few MBs even for 4K HDR
+	constexpr size_t photoModeRowsPerStrip = 128;
+
+	std::unique_ptr<MemoryImageSource> MakeImageSource(const DirectX::ScratchImage& a_image)
 	{
-		const DirectX::XMMATRIX c_fromBT709toBT2020 = {
-			   0.62722527980804443359375f,      0.0690418779850006103515625f, 0.01639117114245891571044921875f, 0.f,
-			  0.329476892948150634765625f,       0.919605672359466552734375f,        0.0880887508392333984375f, 0.f,
-			0.04329781234264373779296875f, 0.011352437548339366912841796875f,       0.89552009105682373046875f, 0.f,
-			                          0.f,                               0.f,                              0.f, 1.f
-		};
+		const auto* image = a_image.GetImage(0, 0, 0);
+		if (!image) {
+			return nullptr;
+		}
+		return std::make_unique<MemoryImageSource>(ImageInfo{ image->width, image->height, image->format }, image->pixels, image->rowPitch);
+	}
 
-		const DirectX::XMMATRIX c_fromBT2020toBT709 = {
-			1.6609637737274169921875f, -0.124477200210094451904296875f, -0.0181571580469608306884765625f, 0.f,
-			-0.58811271190643310546875f, 1.1328194141387939453125f, -0.10066641867160797119140625f, 0.f,
-			-0.072851054370403289794921875f, -0.00834227167069911956787109375f, 1.118823528289794921875f, 0.f,
-			0.f, 0.f, 0.f, 1.f
-		};
+	// Reads the texture back a strip at a time, so the whole image never has to be in memory at once.
+	// Falls back to capturing the whole texture if it can't be streamed (e.g. it's multisampled), "a_outImage" then owns the pixels.
+	std::unique_ptr<ImageSource> CreatePhotoModeImageSource(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state, DirectX::ScratchImage& a_outImage)
+	{
+		if (auto source = ReadbackStripSource::Create(a_queue, a_resource, a_state)) {
+			return source;
+		}
+		if (FAILED(DirectX::CaptureTexture(a_queue, a_resource, false, a_outImage, a_state, a_state))) {
+			return nullptr;
+		}
+		return MakeImageSource(a_outImage);
+	}
 
-#if 0
-		const auto  settings = Settings::Main::GetSingleton();
-		const float peakBrightness = settings->PeakBrightness.value.get_data();
-		const auto  peakBrightnessThreshold = DirectX::XMVectorReplicate(peakBrightness * (1.05f / 80.f));
-#endif
+	namespace
+	{
+		// Saves the full size PNG and its thumbnail, encoding the strips as they come in and feeding their rows to the thumbnail too, so the image is only read once.
+		// HDR images have to be tone mapped to SDR in front of it (e.g. with "SDRToneMapSink").
+		class PhotoModePngSink : public ImageSink
+		{
+		public:
+			explicit PhotoModePngSink(const std::string& a_name) :
+				fullPath(GetPhotoModeScreenshotDirectory() / std::format("{}.png", a_name)),
+				thumbnailPath(GetPhotoModeScreenshotDirectory() / std::format("{}-thumbnail.png", a_name))
+			{}
+
+			bool Begin(const ImageInfo& a_info) override
+			{
+				const auto layout = GetPngSourceLayout(a_info.format);
+				if (!layout) {
+					return false;
+				}
 
-		for (size_t i = 0; i < a_width; ++i) {
-			// color.rgb = BT709_To_BT2020(color.rgb);
-			auto color = DirectX::XMVector4Transform(a_inPixels[i], c_fromBT709toBT2020);
+				std::filesystem::create_directories(fullPath.parent_path());
+				file.open(fullPath, std::ios::binary | std::ios::trunc);
+				if (!file) {
+					return false;
+				}
 
-#if 0 // Replicate the same peak brightness clamping we have in the copy shader. This has been disabled as it's not necessary.
-			color = DirectX::XMVectorClamp(color, DirectX::XMVectorZero(), peakBrightnessThreshold);
-#endif
+				// The thumbnail is center cropped to 16:9, so it isn't stretched
+				thumbnail.emplace(a_info.width, a_info.height, thumbnailWidth, thumbnailHeight);
+
+				PngWriteParams     params;
+				const ScalerFormat thumbnailFormat = *layout == PngSourceLayout::kBGRA8 ? ScalerFormat::kBGRA8 : *layout == PngSourceLayout::kRGB10A2 ? ScalerFormat::kRGB10A2 : ScalerFormat::kRGBA8;
+				params.onRowRead = [this, thumbnailFormat](size_t a_y, const uint8_t* a_row) {
+					thumbnail->AddSourceRow(a_y, a_row, thumbnailFormat);
+				};
+				pngWriter.emplace(file, params);
+				return pngWriter->Begin(a_info);
+			}
 
-			// color.rgb = BT2020_To_BT709(color.rgb);
-			color = DirectX::XMVector4Transform(color, c_fromBT2020toBT709);
+			bool WriteStrip(const ImageStrip& a_strip, WorkerPool* a_workers) override
+			{
+				return pngWriter->WriteStrip(a_strip, a_workers);
+			}
+
+			bool End() override
+			{
+				if (!pngWriter->End()) {
+					return false;
+				}
 
-			// color.a = 1.0f;
-			color = DirectX::XMVectorSetW(color, 1.0f);
+				std::vector<uint8_t> thumbnailPixels(thumbnailWidth * thumbnailHeight * 4);
+				thumbnail->GetPixels(ScalerFormat::kRGBA8, thumbnailPixels.data(), thumbnailWidth * 4);
 
-			a_outPixels[i] = color;
-		}
+				const PngSourceImage thumbnailImage{ thumbnailPixels.data(), thumbnailWidth, thumbnailHeight, thumbnailWidth * 4, PngSourceLayout::kRGBA8 };
+				if (!WritePng(thumbnailPath, thumbnailImage, {})) {
+					WARN("Failed to save screenshot thumbnail {}", thumbnailPath.string())
+				}
+				return true;
+			}
+
+			const std::filesystem::path& GetPath() const { return fullPath; }
+
+		private:
+			static constexpr size_t thumbnailWidth = 640;
+			static constexpr size_t thumbnailHeight = 360;
+
+			std::filesystem::path          fullPath;
+			std::filesystem::path          thumbnailPath;
+			std::ofstream                  file;
+			std::optional<ThumbnailScaler> thumbnail;
+			std::optional<PngStreamWriter> pngWriter;
+		};
+	}
+
+	// Reads the image once, a strip at a time, on the image workers, as this already runs on a screenshot worker, which can't wait on its own pool
+	bool RunPhotoModePipeline(ImageSource& a_source, std::span<ImageStage* const> a_stages, ImageSink& a_sink)
+	{
+		return RunImagePipeline(a_source, a_stages, a_sink, { .rowsPerStrip = photoModeRowsPerStrip, .workers = &GetImageWorkers() });
 	}
 
 	void TakeSDRPhotoModeScreenshot(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state, std::string a_name)
 	{
-		const auto fullPath = GetPhotoModeScreenshotDirectory() / std::format("{}.png", a_name);
-		const auto thumbnailPath = GetPhotoModeScreenshotDirectory() / std::format("{}-thumbnail.png", a_name);
+		DirectX::ScratchImage        capturedImage;
+		std::unique_ptr<ImageSource> source = CreatePhotoModeImageSource(a_queue, a_resource, a_state, capturedImage);
+
+		// PNG takes 8 bit RGBA, BGRA and 10 bit RGB as they are, anything else is captured whole and converted
+		DirectX::ScratchImage convertedImage;
+		if (source && !GetPngSourceLayout(source->GetInfo().format)) {
+			source.reset();
+			if (capturedImage.GetImageCount() || SUCCEEDED(DirectX::CaptureTexture(a_queue, a_resource, false, capturedImage, a_state, a_state))) {
+				if (SUCCEEDED(DirectX::Convert(*capturedImage.GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, convertedImage))) {
+					source = MakeImageSource(convertedImage);
+				}
+			}
+			capturedImage.Release();
+		}
 
-		std::filesystem::create_directories(fullPath.parent_path());
-		std::filesystem::create_directories(thumbnailPath.parent_path());
+		// The strip source holds its own reference to the resource
+		a_resource->Release();
 
-		DirectX::ScratchImage scratchImage;
-		DirectX::CaptureTexture(a_queue, a_resource, false, scratchImage, a_state, a_state);
+		if (!source) {
+			WARN("Failed to capture screenshot {}", a_name)
+			return;
+		}
 
 		// full photo.
 		// We save it with the sRGB gamma as that's what PNG and other formats would expect on PC.
 		// LUMA might interpret any UI buffer as gamma 2.2 though, so this isn't entirely correct, but it's good enough.
-		DirectX::SaveToWICFile(scratchImage.GetImages(), scratchImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatPng, fullPath.c_str(), &GUID_WICPixelFormat32bppBGRA, nullptr);
+		PhotoModePngSink pngSink(a_name);
+		if (!RunPhotoModePipeline(*source, {}, pngSink)) {
+			WARN("Failed to save screenshot {}", pngSink.GetPath().string())
+		}
+	}
 
-		// thumbnail
-		DirectX::ScratchImage resizedImage;
-		// TODO: for ideal results, we could crop out the non 16:9 central part, so the screenshot isn't stretched
-		DirectX::Resize(scratchImage.GetImages(), scratchImage.GetImageCount(), scratchImage.GetMetadata(), 640, 360, DirectX::TEX_FILTER_DEFAULT, resizedImage);
-		DirectX::SaveToWICFile(resizedImage.GetImages(), resizedImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatPng, thumbnailPath.c_str(), &GUID_WICPixelFormat32bppBGRA, nullptr);
+	// The base image was encoded as it was tone mapped, the gain map is small enough to encode at once, and the gain map metadata is added to them after
+	bool SaveGainMapJpeg(const GainMapSink& a_gainMap, std::span<const uint8_t> a_baseJpeg, const std::filesystem::path& a_path)
+	{
+		std::vector<uint8_t> gainMapJpeg;
+		const ImageInfo      gainMapInfo = { a_gainMap.GetGainMapWidth(), a_gainMap.GetGainMapHeight(), DXGI_FORMAT_R8_UNORM };
+		if (!EncodeJpeg(gainMapInfo, const_cast<uint8_t*>(a_gainMap.GetGainMap().data()), gainMapInfo.width, {}, gainMapJpeg)) {
+			return false;
+		}
 
-		a_resource->Release();
+		std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+		return WriteGainMapJpeg(file, a_baseJpeg, gainMapJpeg, a_gainMap.GetMetadata());
 	}
 
+	// Logs the light levels of an HDR screenshot, and saves them next to it as JSON
+	void SavePhotoModeStatistics(const SceneStatistics& a_statistics, std::filesystem::path a_path)
+	{
+		if (a_statistics.pixelCount == 0) {
+			return;
+		}
+
+		INFO("HDR screenshot {}: MaxCLL {:.0f} nits, MaxFALL {:.1f} nits, {:.3f}% of the pixels above the peak brightness ({:.0f} nits)", a_path.filename().string(),
+			a_statistics.maxCLL, a_statistics.GetMaxFALL(), 100.0 * static_cast<double>(a_statistics.pixelsAbovePeak) / static_cast<double>(a_statistics.pixelCount), a_statistics.peakNits)
+
+		a_path.replace_extension(".json");
+		std::ofstream file(a_path, std::ios::trunc);
+		if (!(file << a_statistics.ToJson())) {
+			WARN("Failed to save screenshot statistics {}", a_path.string())
+		}
+	}
+
+#if DEVELOPMENT
+	// Quantizes the image through the render target format candidates and logs the errors, to help picking the buffer format policies
+	void LogFormatPrecision(const DirectX::Image& a_image)
+	{
+		DirectX::ScratchImage floatImage;
+		if (FAILED(DirectX::Convert(a_image, DXGI_FORMAT_R32G32B32A32_FLOAT, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, floatImage))) {
+			return;
+		}
+
+		std::vector<DXGI_FORMAT> formats;
+		for (const auto& candidate : bufferFormatCandidates) {
+			formats.push_back(candidate.dxgiFormat);
+		}
+		formats.push_back(DXGI_FORMAT_R10G10B10A2_UNORM);
+
+		const auto pixels = std::span(reinterpret_cast<const float*>(floatImage.GetPixels()), floatImage.GetPixelsSize() / sizeof(float));
+		std::string reportString = "Format, Max absolute error, Max relative error, Mean relative error, Clipped samples, Lost alpha samples\n";
+		for (const auto& report : AnalyzeFormatPrecision(pixels, formats)) {
+			reportString.append(fmt::format("{}, {}, {}, {}, {}, {}\n", GetDXGIFormatName(report.format), report.maxAbsoluteError, report.maxRelativeError, report.meanRelativeError, report.clippedSamples, report.lostAlphaSamples));
+		}
+		INFO("Screenshot format precision:\n{}", reportString)
+	}
+#endif
+
 	void TakeHDRPhotoModeScreenshot(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state, std::string a_name)
 	{
-		const auto fullPath = GetPhotoModeScreenshotDirectory() / "HDR" / std::format("{}.jxr", a_name);
+		const auto settings = Settings::Main::GetSingleton();
+		const bool bExr = settings->HDRScreenshotsFormat.Get() == 1;
+		const bool bGainMap = settings->HDRScreenshotsFormat.Get() == 2;
+
+		const auto fullPath = GetPhotoModeScreenshotDirectory() / "HDR" / std::format("{}.{}", a_name, bExr ? "exr" : bGainMap ? "jpg" : "jxr");
 		std::filesystem::create_directories(fullPath.parent_path());
 
+		std::optional<float> peakBrightnessClamp;
+#if 0 // Replicate the same peak brightness clamping we have in the copy shader. This has been disabled as it's not necessary.
+		peakBrightnessClamp = static_cast<float>(settings->PeakBrightness.Get()) * (1.05f / 80.f);
+#endif
+
+		// The back buffer is RGBA16F in HDR, so the image can be transformed in place, with the matrices folded together
+		const auto transform = GetHDRScreenshotTransform(peakBrightnessClamp);
+
+		// The SDR screenshot is tone mapped from the HDR one, instead of rendering another frame in SDR.
+		// The HDR screenshot frame is rendered with the peak brightness forced to 10000 nits (see "GetShaderConstants()").
+		const SDRToneMapper toneMapper({ .paperWhite = static_cast<float>(settings->GamePaperWhite.Get()) / 80.f, .peakWhite = 10000.f / 80.f });
+
+		// Gathered as the image is transformed, to see how much of it goes beyond the user peak brightness
+		SceneStatistics statistics{ .peakNits = static_cast<float>(settings->PeakBrightness.Get()) };
+
+		if (bExr || bGainMap) {
+			// Both files are written from a single read back of the image
+			DirectX::ScratchImage capturedImage;
+			const auto            source = CreatePhotoModeImageSource(a_queue, a_resource, a_state, capturedImage);
+			a_resource->Release();
+
+			if (!source || source->GetInfo().format != DXGI_FORMAT_R16G16B16A16_FLOAT) {
+				WARN("Failed to capture HDR screenshot {}", a_name)
+				return;
+			}
+
+			ColorTransformStage transformStage(transform, &statistics);
+			ImageStage* const   stages[] = { &transformStage };
+
+			PhotoModePngSink pngSink(a_name);
+			if (bGainMap) {
+				// The SDR screenshot is the gain map's base image, so it's only tone mapped once, and the base JPEG is encoded from the same strips
+				JpegStreamWriter baseJpegWriter({});
+				ImageTeeSink     baseImageSink({ &pngSink, &baseJpegWriter });
+				GainMapSink      gainMapSink(toneMapper, {}, baseImageSink);
+				if (!RunPhotoModePipeline(*source, stages, gainMapSink) || !SaveGainMapJpeg(gainMapSink, baseJpegWriter.GetData(), fullPath)) {
+					WARN("Failed to save HDR screenshot {}", fullPath.string())
+				}
+				SavePhotoModeStatistics(statistics, fullPath);
+				return;
+			}
+
+			std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				WARN("Failed to save HDR screenshot {}", fullPath.string())
+				return;
+			}
+
+			ExrStreamWriter exrWriter(file, {});
+			SDRToneMapSink  toneMapSink(toneMapper, pngSink);
+			ImageTeeSink    teeSink({ &exrWriter, &toneMapSink });
+			if (!RunPhotoModePipeline(*source, stages, teeSink)) {
+				WARN("Failed to save HDR screenshot {}", fullPath.string())
+			}
+			SavePhotoModeStatistics(statistics, fullPath);
+			return;
+		}
+
+		// WIC needs the whole image
 		DirectX::ScratchImage scratchImage;
 		DirectX::CaptureTexture(a_queue, a_resource, false, scratchImage, a_state, a_state);
+		a_resource->Release();
 
-		DirectX::ScratchImage transformedImage;
-		DirectX::TransformImage(scratchImage.GetImages(), scratchImage.GetImageCount(), scratchImage.GetMetadata(), &TransformColor_HDR, transformedImage);
+		for (size_t i = 0; i < scratchImage.GetImageCount(); ++i) {
+			const auto& image = scratchImage.GetImages()[i];
+			if (image.format == DXGI_FORMAT_R16G16B16A16_FLOAT) {
+				TransformHalfImage(image.pixels, image.width, image.height, image.rowPitch, transform, &GetImageWorkers(), &statistics);
+			} else {
+				WARN("HDR screenshot has unexpected format {}, the colors weren't transformed", GetDXGIFormatName(image.format))
+			}
+		}
 
-		const auto settings = Settings::Main::GetSingleton();
+#if DEVELOPMENT
+		LogFormatPrecision(*scratchImage.GetImage(0, 0, 0));
+#endif
 
-		if (settings->HDRScreenshotsLossless.value) {
-			DirectX::SaveToWICFile(transformedImage.GetImages(), transformedImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatWmp, fullPath.c_str(), &GUID_WICPixelFormat64bppRGBHalf, [&](IPropertyBag2* props) {
+		if (settings->HDRScreenshotsLossless.Get()) {
+			DirectX::SaveToWICFile(scratchImage.GetImages(), scratchImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatWmp, fullPath.c_str(), &GUID_WICPixelFormat64bppRGBHalf, [&](IPropertyBag2* props) {
 				PROPBAG2 options[1] = {};
 				options[0].pstrName = const_cast<wchar_t*>(L"Lossless");
 
@@ -454,10 +574,22 @@ namespace Utils
 				std::ignore = props->Write(1, options, varValues);
 			});
 		} else {
-			DirectX::SaveToWICFile(transformedImage.GetImages(), transformedImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatWmp, fullPath.c_str(), &GUID_WICPixelFormat64bppRGBHalf, nullptr);
+			DirectX::SaveToWICFile(scratchImage.GetImages(), scratchImage.GetImageCount(), DirectX::WIC_FLAGS_FORCE_SRGB, GUID_ContainerFormatWmp, fullPath.c_str(), &GUID_WICPixelFormat64bppRGBHalf, nullptr);
 		}
 
-		a_resource->Release();
+		SavePhotoModeStatistics(statistics, fullPath);
+
+		// The SDR screenshot is tone mapped from the pixels already in memory
+		const auto source = MakeImageSource(scratchImage);
+		if (!source || source->GetInfo().format != DXGI_FORMAT_R16G16B16A16_FLOAT) {
+			WARN("Failed to tone map screenshot {}", a_name)
+			return;
+		}
+		PhotoModePngSink pngSink(a_name);
+		SDRToneMapSink   toneMapSink(toneMapper, pngSink);
+		if (!RunPhotoModePipeline(*source, {}, toneMapSink)) {
+			WARN("Failed to save screenshot {}", pngSink.GetPath().string())
+		}
 	}
 
 	float linearNormalization(float input, float min, float max, float newMin, float newMax)
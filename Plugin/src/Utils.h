@@ -1,18 +1,43 @@
 #pragma once
+#include "BufferIndex.h"
+#include "BurstCapture.h"
+#include "ColorTransform.h"
+#include "ExrWriter.h"
+#include "FormatAnalyzer.h"
+#include "FormatPolicy.h"
+#include "Formats.h"
+#include "GainMap.h"
+#include "JpegWriter.h"
+#include "MenuState.h"
+#include "PngWriter.h"
+#include "ReadbackFence.h"
+#include "SDRToneMapper.h"
+#include "SceneStatistics.h"
+#include "StripReadback.h"
+#include "TextureAllocator.h"
+#include "ThumbnailScaler.h"
+#include "UpgradePlanner.h"
+#include "WorkerPool.h"
 #include "RE/Buffers.h"
 
 namespace Utils
 {
-	std::unordered_map<DXGI_FORMAT, std::string> GetDXGIFormatNameMap();
+	// The index is built on first use
+	const BufferNameIndex& GetBufferIndex();
+	// Looks up the game buffer with the given name through a hashed index
+	RE::BufferDefinition* FindBuffer(std::string_view a_bufferName);
 
 	void LogFormats();
 
-	void LogBuffers();
+	// Also logs the cost table of the render target upgrades, if a plan is passed in
+	void LogBuffers(const RenderTargetUpgradePlan* a_upgradePlan = nullptr);
 
 	void SetBufferFormat(RE::BufferDefinition* a_buffer, RE::BS_DXGI_FORMAT a_format);
 	void SetBufferFormat(RE::Buffers a_buffer, RE::BS_DXGI_FORMAT a_format);
 	RE::BS_DXGI_FORMAT GetBufferFormat(RE::Buffers a_buffer);
 
+	// Refreshes the cached menu states from the game UI, returns whether any changed
+	bool UpdateMenuState();
 	bool ShouldCorrectLUTs();
 	bool IsInPauseMenu();
 	bool IsInMainMenu();
@@ -24,6 +49,12 @@ namespace Utils
 	bool IsHDREnabled(HWND a_hwnd);
 	bool SetHDREnabled(HWND a_hwnd);
 
+	// Encodes the screenshots off the render thread, created on first use
+	WorkerPool& GetScreenshotWorkers();
+	// Splits image processing between cores, separate from the screenshot workers as those wait on it
+	WorkerPool& GetImageWorkers();
+	// Finishes the queued screenshots and stops the pools above, needs to be called before the DLL is unloaded
+	void ShutdownWorkerPools();
 	std::filesystem::path GetPhotoModeScreenshotDirectory();
 	std::string GetPhotoModeScreenshotName();
 	void TakeSDRPhotoModeScreenshot(ID3D12CommandQueue* a_queue, ID3D12Resource* a_resource, D3D12_RESOURCE_STATES a_state, std::string a_name);
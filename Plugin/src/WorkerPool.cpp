@@ -0,0 +1,165 @@
+#include "WorkerPool.h"
+
+namespace Utils
+{
+	WorkerPool::WorkerPool(size_t a_threadCount, size_t a_maxQueuedJobs, std::function<void()> a_threadInit) :
+		maxQueuedJobs(std::max(a_maxQueuedJobs, size_t(1))), threadInit(std::move(a_threadInit))
+	{
+		a_threadCount = std::max(a_threadCount, size_t(1));
+		threads.reserve(a_threadCount);
+		for (size_t i = 0; i < a_threadCount; ++i) {
+			threads.emplace_back(&WorkerPool::Run, this);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		Shutdown();
+	}
+
+	void WorkerPool::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			bStop = true;
+		}
+		jobAvailable.notify_all();
+		queueNotFull.notify_all();
+		for (auto& thread : threads) {
+			if (thread.joinable()) {
+				thread.join();
+			}
+		}
+	}
+
+	bool WorkerPool::Submit(Job a_job)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			queueNotFull.wait(lock, [this] { return jobs.size() < maxQueuedJobs || bStop; });
+			if (bStop) {
+				return false;
+			}
+			jobs.push_back(std::move(a_job));
+			metrics.queueDepth = jobs.size();
+			metrics.maxQueueDepth = std::max(metrics.maxQueueDepth, metrics.queueDepth);
+		}
+		jobAvailable.notify_one();
+		return true;
+	}
+
+	bool WorkerPool::TrySubmit(Job& a_job)
+	{
+		{
+			std::lock_guard<std::mutex> lg(mutex);
+			if (jobs.size() >= maxQueuedJobs || bStop) {
+				return false;
+			}
+			jobs.push_back(std::move(a_job));
+			metrics.queueDepth = jobs.size();
+			metrics.maxQueueDepth = std::max(metrics.maxQueueDepth, metrics.queueDepth);
+		}
+		jobAvailable.notify_one();
+		return true;
+	}
+
+	void WorkerPool::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return jobs.empty() && metrics.runningJobs == 0; });
+	}
+
+	void WorkerPool::ParallelFor(size_t a_count, const std::function<void(size_t a_begin, size_t a_end)>& a_function)
+	{
+		if (a_count == 0) {
+			return;
+		}
+
+		const size_t rangeCount = std::min(a_count, threads.size() + 1);
+		const size_t rangeSize = (a_count + rangeCount - 1) / rangeCount;
+
+		// The ranges reference this stack frame, so they all need to be done before returning, even if one of them threw
+		std::exception_ptr exception;
+		std::mutex         exceptionMutex;
+		auto RunRange = [&](size_t a_begin, size_t a_end) {
+			try {
+				a_function(a_begin, a_end);
+			} catch (...) {
+				std::lock_guard<std::mutex> lg(exceptionMutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+			}
+		};
+
+		std::latch done(static_cast<std::ptrdiff_t>(rangeCount - 1));
+		for (size_t range = 1; range < rangeCount; ++range) {
+			const size_t begin = std::min(range * rangeSize, a_count);
+			const size_t end = std::min(begin + rangeSize, a_count);
+			auto job = [&RunRange, &done, begin, end]() {
+				RunRange(begin, end);
+				done.count_down();
+			};
+			if (!Submit(job)) {
+				job();
+			}
+		}
+
+		RunRange(0, std::min(rangeSize, a_count));
+		done.wait();
+
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+	WorkerPool::Metrics WorkerPool::GetMetrics() const
+	{
+		std::lock_guard<std::mutex> lg(mutex);
+		return metrics;
+	}
+
+	void WorkerPool::Run()
+	{
+		if (threadInit) {
+			threadInit();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			// When stopping, the queued jobs are still run, so nothing that was accepted gets lost
+			jobAvailable.wait(lock, [this] { return !jobs.empty() || bStop; });
+			if (jobs.empty()) {
+				return;
+			}
+
+			Job job = std::move(jobs.front());
+			jobs.pop_front();
+			metrics.queueDepth = jobs.size();
+			++metrics.runningJobs;
+			lock.unlock();
+			queueNotFull.notify_one();
+
+			const auto startTime = std::chrono::steady_clock::now();
+			try {
+				job();
+			} catch (const std::exception& e) {
+				WARN("A worker job failed: {}", e.what())
+			} catch (...) {
+				WARN("A worker job failed with an unknown exception"sv)
+			}
+			const double jobMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+			lock.lock();
+			--metrics.runningJobs;
+			++metrics.completedJobs;
+			metrics.lastJobMS = jobMS;
+			metrics.maxJobMS = std::max(metrics.maxJobMS, jobMS);
+			totalJobMS += jobMS;
+			metrics.averageJobMS = totalJobMS / static_cast<double>(metrics.completedJobs);
+			if (jobs.empty() && metrics.runningJobs == 0) {
+				idle.notify_all();
+			}
+		}
+	}
+}
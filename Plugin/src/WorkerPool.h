@@ -0,0 +1,65 @@
+#pragma once
+
+namespace Utils
+{
+	// A fixed number of threads running jobs from a bounded queue, for work that shouldn't run on the render thread (e.g. encoding screenshots).
+	// Submitting blocks while the queue is full, "TrySubmit()" can be used where blocking isn't acceptable.
+	// Exceptions thrown by a job are logged and don't stop the worker.
+	class WorkerPool
+	{
+	public:
+		using Job = std::function<void()>;
+
+		struct Metrics
+		{
+			size_t   queueDepth = 0;
+			size_t   maxQueueDepth = 0;  // Highest seen since the pool was created
+			size_t   runningJobs = 0;
+			uint64_t completedJobs = 0;
+			double   lastJobMS = 0.0;
+			double   averageJobMS = 0.0;
+			double   maxJobMS = 0.0;
+		};
+
+		// "a_threadInit" runs on each worker thread before it starts taking jobs, e.g. to lower its priority
+		WorkerPool(size_t a_threadCount, size_t a_maxQueuedJobs, std::function<void()> a_threadInit = nullptr);
+		~WorkerPool();  // Calls "Shutdown()"
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// Returns false if the pool is shutting down, in which case the job won't run
+		bool Submit(Job a_job);
+		// Returns false, leaving the job untouched, if the queue is full
+		bool TrySubmit(Job& a_job);
+		// Waits until the queue is empty and no job is running
+		void WaitIdle();
+		// Runs all the queued jobs and joins the threads. Jobs submitted afterwards are refused.
+		// Pools with static lifetime need this to be called before the DLL is unloaded, as joining threads under the loader lock can deadlock.
+		void Shutdown();
+
+		// Splits [0, a_count) in ranges and runs them on the workers and the calling thread, returning once all of them are done.
+		// Don't call it from a job of the same pool, as the job would wait on the pool it's occupying.
+		// If any range throws, the first exception is rethrown once all the ranges are done.
+		void ParallelFor(size_t a_count, const std::function<void(size_t a_begin, size_t a_end)>& a_function);
+
+		size_t GetThreadCount() const { return threads.size(); }
+
+		Metrics GetMetrics() const;
+
+	private:
+		void Run();
+
+		const size_t            maxQueuedJobs;
+		std::function<void()>   threadInit;
+		std::deque<Job>         jobs;
+		mutable std::mutex      mutex;
+		std::condition_variable jobAvailable;
+		std::condition_variable queueNotFull;
+		std::condition_variable idle;
+		Metrics                 metrics;
+		double                  totalJobMS = 0.0;
+		bool                    bStop = false;
+		std::vector<std::thread> threads;
+	};
+}
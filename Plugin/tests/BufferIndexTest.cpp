@@ -0,0 +1,71 @@
+#include "BufferIndex.h"
+
+#include "Test.h"
+
+namespace
+{
+	RE::BufferDefinition MakeBuffer(const char* a_name, RE::BS_DXGI_FORMAT a_format = RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		RE::BufferDefinition buffer{};
+		buffer.bufferName = a_name;
+		buffer.format = a_format;
+		return buffer;
+	}
+}
+
+TEST_CASE(FindsEveryBuffer)
+{
+	std::vector<RE::BufferDefinition> buffers = { MakeBuffer("SF_ColorBuffer"), MakeBuffer("ImageSpaceBuffer"), MakeBuffer("EnvBRDF") };
+	std::vector<RE::BufferDefinition*> pointers;
+	for (auto& buffer : buffers) {
+		pointers.push_back(&buffer);
+	}
+
+	const Utils::BufferNameIndex index(pointers);
+	CHECK_EQ(index.Size(), buffers.size());
+	for (auto& buffer : buffers) {
+		CHECK(index.Find(buffer.bufferName) == &buffer);
+	}
+}
+
+TEST_CASE(UnknownNamesAreNotFound)
+{
+	auto                        buffer = MakeBuffer("ImageSpaceBuffer");
+	RE::BufferDefinition* const pointers[] = { &buffer };
+	const Utils::BufferNameIndex index(pointers);
+
+	CHECK(index.Find("") == nullptr);
+	CHECK(index.Find("ImageSpace") == nullptr);
+	CHECK(index.Find("ImageSpaceBufferR10G10B10A2") == nullptr);
+	CHECK(index.Find("imagespacebuffer") == nullptr);
+
+	// Lookups compare the whole view, not up to a null terminator
+	constexpr std::string_view longerName = "ImageSpaceBufferB10G11R11";
+	CHECK(index.Find(longerName.substr(0, 16)) == &buffer);
+}
+
+// The linear search this replaced returned the first match, which is kept for buffers that share a name
+TEST_CASE(FirstDuplicateWins)
+{
+	auto first = MakeBuffer("SF_ColorBuffer", RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM);
+	auto second = MakeBuffer("SF_ColorBuffer", RE::BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+	RE::BufferDefinition* const pointers[] = { &first, &second };
+	const Utils::BufferNameIndex index(pointers);
+
+	CHECK_EQ(index.Size(), size_t(1));
+	CHECK(index.Find("SF_ColorBuffer") == &first);
+}
+
+TEST_CASE(NullEntriesAreSkipped)
+{
+	auto                        buffer = MakeBuffer("EnvBRDF");
+	auto                        unnamed = MakeBuffer(nullptr);
+	RE::BufferDefinition* const pointers[] = { nullptr, &unnamed, &buffer };
+	const Utils::BufferNameIndex index(pointers);
+
+	CHECK_EQ(index.Size(), size_t(1));
+	CHECK(index.Find("EnvBRDF") == &buffer);
+
+	const Utils::BufferNameIndex empty;
+	CHECK(empty.Find("EnvBRDF") == nullptr);
+}
@@ -0,0 +1,103 @@
+#include "BurstCapture.h"
+
+#include "Test.h"
+
+namespace
+{
+	// Runs the frames of a burst like the render thread does, returns the frames captured on each rendered frame (-1 if none).
+	// Captures are encoded "a_encodeFrames" rendered frames after they were taken.
+	std::vector<int> RunBurst(Utils::BurstCapture& a_burstCapture, size_t a_renderedFrames, size_t a_encodeFrames, std::vector<bool>* a_outDueFrames = nullptr)
+	{
+		std::vector<int>                        captured;
+		std::deque<std::pair<size_t, uint32_t>> encoding;
+		for (size_t frame = 0; frame < a_renderedFrames; ++frame) {
+			while (!encoding.empty() && encoding.front().first <= frame) {
+				a_burstCapture.OnFrameEncoded(encoding.front().second);
+				encoding.pop_front();
+			}
+			if (a_outDueFrames) {
+				a_outDueFrames->push_back(a_burstCapture.IsNextFrameDue());
+			}
+			const auto index = a_burstCapture.OnFrame();
+			captured.push_back(index ? static_cast<int>(*index) : -1);
+			if (index) {
+				encoding.emplace_back(frame + a_encodeFrames, *index);
+			}
+		}
+		for (const auto& [frame, index] : encoding) {
+			a_burstCapture.OnFrameEncoded(index);
+		}
+		return captured;
+	}
+}
+
+TEST_CASE(CapturesEveryIntervalFrames)
+{
+	Utils::BurstCapture burstCapture;
+	REQUIRE(burstCapture.Start({ .frameCount = 3, .frameInterval = 2, .ringSize = 4 }));
+	CHECK(!burstCapture.Start({}));
+
+	CHECK(RunBurst(burstCapture, 7, 1) == std::vector<int>({ 0, -1, 1, -1, 2, -1, -1 }));
+	CHECK(burstCapture.IsCaptureDone());
+
+	const auto report = burstCapture.TakeReport();
+	REQUIRE(report);
+	CHECK_EQ(report->frameCount, uint32_t(3));
+	CHECK_EQ(report->capturedCount, uint32_t(3));
+	CHECK(report->droppedFrames.empty());
+	CHECK(!burstCapture.IsActive());
+}
+
+// The screenshot request is only set on the frames this predicts, so it has to match the captures exactly
+TEST_CASE(PredictsTheCapturedFrames)
+{
+	for (const uint32_t interval : { 1u, 2u, 5u }) {
+		Utils::BurstCapture burstCapture;
+		burstCapture.Start({ .frameCount = 4, .frameInterval = interval, .ringSize = 8 });
+		std::vector<bool> dueFrames;
+		const auto        captured = RunBurst(burstCapture, 4 * interval + 3, 1, &dueFrames);
+		for (size_t frame = 0; frame < captured.size(); ++frame) {
+			CHECK_EQ(dueFrames[frame], captured[frame] >= 0);
+		}
+		CHECK(!burstCapture.IsNextFrameDue());
+	}
+
+	Utils::BurstCapture idle;
+	CHECK(!idle.IsNextFrameDue());
+}
+
+// Frames due while the ring is full are dropped, the later ones keep their timing and numbering
+TEST_CASE(DropsFramesWhileTheRingIsFull)
+{
+	Utils::BurstCapture burstCapture;
+	burstCapture.Start({ .frameCount = 6, .frameInterval = 1, .ringSize = 2 });
+	CHECK(RunBurst(burstCapture, 6, 3) == std::vector<int>({ 0, 1, -1, 3, 4, -1 }));
+
+	const auto report = burstCapture.TakeReport();
+	REQUIRE(report);
+	CHECK_EQ(report->capturedCount, uint32_t(4));
+	CHECK(report->droppedFrames == std::vector<uint32_t>({ 2, 5 }));
+}
+
+TEST_CASE(ReportsWaitForTheEncodes)
+{
+	Utils::BurstCapture burstCapture;
+	burstCapture.Start({ .frameCount = 4, .frameInterval = 1, .ringSize = 2 });
+	CHECK_EQ(burstCapture.OnFrame().value_or(99), uint32_t(0));
+	CHECK_EQ(burstCapture.OnFrame().value_or(99), uint32_t(1));
+	burstCapture.DropFrame(1);  // Its copy couldn't be started, which frees its slot
+	CHECK_EQ(burstCapture.OnFrame().value_or(99), uint32_t(2));
+	CHECK(!burstCapture.OnFrame());  // Ring full
+	CHECK_EQ(burstCapture.GetInFlightCount(), size_t(2));
+	CHECK(burstCapture.IsCaptureDone());
+
+	burstCapture.OnFrameEncoded(0);
+	CHECK(!burstCapture.TakeReport());
+	burstCapture.OnFrameEncoded(2);
+	const auto report = burstCapture.TakeReport();
+	REQUIRE(report);
+	CHECK_EQ(report->capturedCount, uint32_t(2));
+	CHECK(report->droppedFrames == std::vector<uint32_t>({ 1, 3 }));
+	CHECK(!burstCapture.TakeReport());
+	CHECK(!burstCapture.IsActive());
+}
@@ -0,0 +1,68 @@
+#include "ConfigWriter.h"
+
+#include "Test.h"
+
+TEST_CASE(RequestsWithinTheDebounceAreCoalesced)
+{
+	std::atomic_uint32_t   writes = 0;
+	Settings::ConfigWriter writer([&writes]() { ++writes; }, std::chrono::milliseconds(50));
+	for (uint32_t i = 0; i < 20; ++i) {
+		writer.RequestWrite();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	CHECK_EQ(writes.load(), 1u);
+
+	writer.Shutdown();
+	CHECK_EQ(writes.load(), 1u);  // Nothing was pending
+}
+
+TEST_CASE(ShutdownWritesThePendingChange)
+{
+	std::atomic_uint32_t   writes = 0;
+	Settings::ConfigWriter writer([&writes]() { ++writes; }, std::chrono::milliseconds(10000));
+	writer.RequestWrite();
+	writer.Shutdown();
+	CHECK_EQ(writes.load(), 1u);
+	CHECK_EQ(writer.GetWriteCount(), uint64_t(1));
+}
+
+TEST_CASE(RequestsAfterShutdownAreWrittenImmediately)
+{
+	std::atomic_uint32_t   writes = 0;
+	Settings::ConfigWriter writer([&writes]() { ++writes; }, std::chrono::milliseconds(10000));
+	writer.Shutdown();
+	CHECK_EQ(writes.load(), 0u);
+
+	writer.RequestWrite();
+	CHECK_EQ(writes.load(), 1u);
+	writer.Shutdown();  // Again, nothing pending
+	CHECK_EQ(writes.load(), 1u);
+}
+
+TEST_CASE(FlushWritesSynchronously)
+{
+	std::atomic_uint32_t   writes = 0;
+	Settings::ConfigWriter writer([&writes]() { ++writes; }, std::chrono::milliseconds(10000));
+	writer.Flush();
+	CHECK_EQ(writes.load(), 0u);
+	writer.RequestWrite();
+	writer.Flush();
+	CHECK_EQ(writes.load(), 1u);
+	writer.Shutdown();
+	CHECK_EQ(writes.load(), 1u);
+}
+
+// Shutting down happens while the game window is being destroyed, it shouldn't wait for the debounce time
+TEST_CASE(ShutdownCutsTheDebounceShort)
+{
+	std::atomic_uint32_t   writes = 0;
+	Settings::ConfigWriter writer([&writes]() { ++writes; }, std::chrono::milliseconds(10000));
+	writer.RequestWrite();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Let the thread start waiting
+
+	const auto startTime = std::chrono::steady_clock::now();
+	writer.Shutdown();
+	CHECK(std::chrono::steady_clock::now() - startTime < std::chrono::seconds(1));
+	CHECK_EQ(writes.load(), 1u);
+}
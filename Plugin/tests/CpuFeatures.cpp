@@ -0,0 +1,19 @@
+// Test double of "src/CpuFeatures.cpp", which lets the tests switch to the scalar fallbacks on CPUs that have AVX2
+#define IsAVX2Supported DetectAVX2Support
+#include "../src/CpuFeatures.cpp"
+#undef IsAVX2Supported
+
+#include "Test.h"
+
+namespace Tests
+{
+	bool bForceScalar = false;
+}
+
+namespace Utils
+{
+	bool IsAVX2Supported()
+	{
+		return !Tests::bForceScalar && DetectAVX2Support();
+	}
+}
@@ -0,0 +1,298 @@
+#include "ExrWriter.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+#include <zlib.h>
+
+// OpenEXR isn't available everywhere the tests build, so the files are read back by a minimal decoder written from the file format spec.
+// It only supports what a reader of our files needs (single part scanline, half channels, NONE/ZIPS/ZIP), but it checks everything it reads.
+namespace
+{
+	struct ExrImage
+	{
+		int32_t               width = 0;
+		int32_t               height = 0;
+		uint8_t               compression = 0;
+		std::vector<char>     channels;  // Names, in file order
+		std::vector<uint16_t> pixels;    // RGBA, alpha is 0x3C00 (1) if missing
+		bool                  bChromaticities = false;
+		float                 chromaticities[8] = {};
+	};
+
+	class Reader
+	{
+	public:
+		explicit Reader(std::span<const uint8_t> a_data) :
+			data(a_data) {}
+
+		template <class T>
+		T Read()
+		{
+			if (position + sizeof(T) > data.size()) {
+				bError = true;
+				return T{};
+			}
+			std::array<uint8_t, sizeof(T)> bytes;
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				bytes[i] = data[position + i];  // Little endian
+			}
+			position += sizeof(T);
+			return std::bit_cast<T>(bytes);
+		}
+
+		std::string ReadString()
+		{
+			std::string result;
+			while (position < data.size() && data[position] != 0) {
+				result.push_back(static_cast<char>(data[position++]));
+			}
+			bError |= position >= data.size();
+			++position;
+			return result;
+		}
+
+		std::span<const uint8_t> ReadBytes(size_t a_size)
+		{
+			if (position + a_size > data.size()) {
+				bError = true;
+				return {};
+			}
+			position += a_size;
+			return data.subspan(position - a_size, a_size);
+		}
+
+		size_t position = 0;
+		bool   bError = false;
+
+	private:
+		std::span<const uint8_t> data;
+	};
+
+	std::optional<ExrImage> DecodeExr(std::span<const uint8_t> a_data)
+	{
+		Reader reader(a_data);
+		if (reader.Read<uint32_t>() != 20000630 || reader.Read<uint32_t>() != 2) {
+			return std::nullopt;
+		}
+
+		ExrImage image;
+		bool     bDataWindow = false;
+		while (true) {
+			const std::string name = reader.ReadString();
+			if (name.empty() || reader.bError) {
+				break;
+			}
+			const std::string type = reader.ReadString();
+			const uint32_t    size = reader.Read<uint32_t>();
+			const size_t      valueStart = reader.position;
+
+			if (name == "channels" && type == "chlist") {
+				while (true) {
+					const std::string channelName = reader.ReadString();
+					if (channelName.empty()) {
+						break;
+					}
+					if (channelName.size() != 1 || reader.Read<int32_t>() != 1) {  // Only single letter half channels
+						return std::nullopt;
+					}
+					reader.ReadBytes(4);
+					if (reader.Read<int32_t>() != 1 || reader.Read<int32_t>() != 1) {
+						return std::nullopt;
+					}
+					image.channels.push_back(channelName[0]);
+				}
+			} else if (name == "compression" && type == "compression") {
+				image.compression = reader.Read<uint8_t>();
+			} else if (name == "dataWindow" && type == "box2i") {
+				const int32_t minX = reader.Read<int32_t>();
+				const int32_t minY = reader.Read<int32_t>();
+				image.width = reader.Read<int32_t>() - minX + 1;
+				image.height = reader.Read<int32_t>() - minY + 1;
+				bDataWindow = minX == 0 && minY == 0;
+			} else if (name == "lineOrder" && type == "lineOrder") {
+				if (reader.Read<uint8_t>() != 0) {
+					return std::nullopt;
+				}
+			} else if (name == "chromaticities" && type == "chromaticities") {
+				image.bChromaticities = true;
+				for (float& value : image.chromaticities) {
+					value = reader.Read<float>();
+				}
+			} else {
+				reader.ReadBytes(size);
+			}
+
+			if (reader.position != valueStart + size) {
+				return std::nullopt;
+			}
+		}
+		if (reader.bError || !bDataWindow || image.width <= 0 || image.height <= 0 || !std::ranges::is_sorted(image.channels)) {
+			return std::nullopt;
+		}
+
+		const size_t scanlinesPerBlock = image.compression == 3 ? 16 : 1;
+		const size_t blockCount = (image.height + scanlinesPerBlock - 1) / scanlinesPerBlock;
+		std::vector<uint64_t> offsets(blockCount);
+		for (auto& offset : offsets) {
+			offset = reader.Read<uint64_t>();
+		}
+
+		image.pixels.assign(size_t(image.width) * image.height * 4, 0x3C00);
+		for (size_t block = 0; block < blockCount; ++block) {
+			reader.position = offsets[block];
+			const int32_t  y = reader.Read<int32_t>();
+			const uint32_t size = reader.Read<uint32_t>();
+			const auto     blockData = reader.ReadBytes(size);
+			if (reader.bError || y != static_cast<int32_t>(block * scanlinesPerBlock)) {
+				return std::nullopt;
+			}
+			if (block + 1 == blockCount && reader.position != a_data.size()) {
+				return std::nullopt;  // Trailing data
+			}
+
+			const size_t rowCount = std::min(scanlinesPerBlock, static_cast<size_t>(image.height - y));
+			const size_t rawSize = rowCount * image.channels.size() * image.width * sizeof(uint16_t);
+			std::vector<uint8_t> raw(rawSize);
+			if (size == rawSize) {
+				std::ranges::copy(blockData, raw.begin());
+			} else if (image.compression == 2 || image.compression == 3) {
+				std::vector<uint8_t> predicted(rawSize);
+				uLongf               uncompressedSize = static_cast<uLongf>(rawSize);
+				if (uncompress(predicted.data(), &uncompressedSize, blockData.data(), static_cast<uLong>(blockData.size())) != Z_OK || uncompressedSize != rawSize) {
+					return std::nullopt;
+				}
+				for (size_t i = 1; i < predicted.size(); ++i) {
+					predicted[i] = static_cast<uint8_t>(predicted[i - 1] + predicted[i] - 128);
+				}
+				const size_t half = (rawSize + 1) / 2;
+				for (size_t i = 0; i < rawSize; ++i) {
+					raw[i] = predicted[(i % 2 == 0) ? i / 2 : half + i / 2];
+				}
+			} else {
+				return std::nullopt;
+			}
+
+			Reader rawReader(raw);
+			for (size_t row = 0; row < rowCount; ++row) {
+				for (const char channel : image.channels) {
+					const size_t component = channel == 'R' ? 0 : channel == 'G' ? 1 : channel == 'B' ? 2 : 3;
+					for (int32_t x = 0; x < image.width; ++x) {
+						image.pixels[((y + row) * image.width + x) * 4 + component] = rawReader.Read<uint16_t>();
+					}
+				}
+			}
+		}
+		return image;
+	}
+
+	std::vector<uint16_t> MakeImage(size_t a_width, size_t a_height, bool a_bNoise)
+	{
+		std::vector<uint16_t>                   pixels(a_width * a_height * 4);
+		std::mt19937                            random(static_cast<uint32_t>(a_width * 31 + a_height));
+		std::uniform_int_distribution<uint32_t> noise(0, 0xFFFF);
+		for (size_t y = 0; y < a_height; ++y) {
+			for (size_t x = 0; x < a_width; ++x) {
+				for (size_t c = 0; c < 4; ++c) {
+					// A smooth gradient compresses, noise (including NaNs and infinities) doesn't and has to be stored raw
+					pixels[(y * a_width + x) * 4 + c] = a_bNoise ? static_cast<uint16_t>(noise(random)) : static_cast<uint16_t>(0x3000 + x * 7 + y * 3 + c * 100);
+				}
+			}
+		}
+		return pixels;
+	}
+
+	void CheckRoundTrip(size_t a_width, size_t a_height, Utils::ExrCompression a_compression, bool a_bWriteAlpha, bool a_bNoise, size_t a_rowsPerStrip, Utils::WorkerPool* a_workers)
+	{
+		const auto pixels = MakeImage(a_width, a_height, a_bNoise);
+		const Utils::ExrSourceImage source{ reinterpret_cast<const uint8_t*>(pixels.data()), a_width, a_height, a_width * 8 };
+
+		std::vector<uint8_t> data;
+		REQUIRE(Utils::EncodeExr(source, { .compression = a_compression, .bWriteAlpha = a_bWriteAlpha, .rowsPerStrip = a_rowsPerStrip, .workers = a_workers }, data));
+		const auto image = DecodeExr(data);
+		REQUIRE(image);
+
+		CHECK_EQ(image->width, static_cast<int32_t>(a_width));
+		CHECK_EQ(image->height, static_cast<int32_t>(a_height));
+		CHECK_EQ(image->compression, static_cast<uint8_t>(a_compression));
+		CHECK(image->channels == (a_bWriteAlpha ? std::vector<char>{ 'A', 'B', 'G', 'R' } : std::vector<char>{ 'B', 'G', 'R' }));
+		CHECK(image->bChromaticities && image->chromaticities[0] == 0.64f && image->chromaticities[7] == 0.3290f);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < pixels.size(); ++i) {
+			const bool bAlpha = i % 4 == 3;
+			mismatches += (bAlpha && !a_bWriteAlpha) ? image->pixels[i] != 0x3C00 : image->pixels[i] != pixels[i];
+		}
+		CHECK_EQ(mismatches, size_t(0));
+	}
+}
+
+TEST_CASE(RoundTripsEveryCompression)
+{
+	for (const auto compression : { Utils::ExrCompression::kNone, Utils::ExrCompression::kZIPS, Utils::ExrCompression::kZIP }) {
+		for (const bool bWriteAlpha : { false, true }) {
+			for (const bool bNoise : { false, true }) {
+				CheckRoundTrip(67, 45, compression, bWriteAlpha, bNoise, 20, nullptr);
+			}
+		}
+	}
+}
+
+TEST_CASE(RoundTripsOddSizes)
+{
+	for (const auto [width, height] : { std::pair<size_t, size_t>{ 1, 1 }, { 1, 17 }, { 17, 1 }, { 3, 16 }, { 5, 33 }, { 129, 257 } }) {
+		for (const size_t rowsPerStrip : { size_t(1), size_t(16), size_t(100), size_t(1000) }) {
+			CheckRoundTrip(width, height, Utils::ExrCompression::kZIP, false, false, rowsPerStrip, nullptr);
+			CheckRoundTrip(width, height, Utils::ExrCompression::kZIPS, true, false, rowsPerStrip, nullptr);
+		}
+	}
+}
+
+TEST_CASE(WorkersWriteTheSameFile)
+{
+	Utils::WorkerPool workers(3, 3);
+	CheckRoundTrip(300, 200, Utils::ExrCompression::kZIP, true, false, 64, &workers);
+
+	const auto                  pixels = MakeImage(300, 200, false);
+	const Utils::ExrSourceImage source{ reinterpret_cast<const uint8_t*>(pixels.data()), 300, 200, 300 * 8 };
+	std::vector<uint8_t>        serial;
+	std::vector<uint8_t>        parallel;
+	REQUIRE(Utils::EncodeExr(source, { .rowsPerStrip = 64 }, serial));
+	REQUIRE(Utils::EncodeExr(source, { .rowsPerStrip = 64, .workers = &workers }, parallel));
+	CHECK(serial == parallel);
+}
+
+// The offset table is sized from the image height, writing more blocks than that would overwrite the first block
+TEST_CASE(RejectsBlocksPastTheImage)
+{
+	const auto           pixels = MakeImage(4, 32, false);
+	std::ostringstream   stream(std::ios::binary);
+	Utils::ExrStreamWriter writer(stream, {});
+	REQUIRE(writer.Begin({ 4, 16, DXGI_FORMAT_R16G16B16A16_FLOAT }));
+
+	Utils::ImageStrip strip{ reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(pixels.data())), 0, 16, 4 * 8 };
+	CHECK(writer.WriteStrip(strip, nullptr));
+	strip.firstRow = 16;
+	CHECK(!writer.WriteStrip(strip, nullptr));
+	CHECK(writer.End());
+}
+
+TEST_CASE(RejectsMissingBlocks)
+{
+	const auto             pixels = MakeImage(4, 32, false);
+	std::ostringstream     stream(std::ios::binary);
+	Utils::ExrStreamWriter writer(stream, {});
+	REQUIRE(writer.Begin({ 4, 32, DXGI_FORMAT_R16G16B16A16_FLOAT }));
+
+	const Utils::ImageStrip strip{ reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(pixels.data())), 0, 16, 4 * 8 };
+	CHECK(writer.WriteStrip(strip, nullptr));
+	CHECK(!writer.End());
+}
+
+TEST_CASE(RejectsOtherFormats)
+{
+	std::ostringstream     stream(std::ios::binary);
+	Utils::ExrStreamWriter writer(stream, {});
+	CHECK(!writer.Begin({ 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM }));
+	CHECK(!writer.Begin({ 0, 4, DXGI_FORMAT_R16G16B16A16_FLOAT }));
+}
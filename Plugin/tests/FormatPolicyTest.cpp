@@ -0,0 +1,70 @@
+#include "FormatPolicy.h"
+
+#include "Test.h"
+
+namespace
+{
+	using RE::BS_DXGI_FORMAT;
+
+	// What "Hooks::Patches::Patch()" upgrades a buffer to with "UseRenderTargetFormatPolicies" on
+	BS_DXGI_FORMAT GetUpgradeFormat(std::string_view a_bufferName, BS_DXGI_FORMAT a_currentFormat)
+	{
+		if (const auto candidate = Utils::ResolveBufferFormat(Utils::GetBufferFormatRequirements(a_bufferName), a_currentFormat)) {
+			return candidate->format;
+		}
+		return BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT;
+	}
+}
+
+TEST_CASE(CandidatesAreSortedByCost)
+{
+	for (size_t i = 1; i < std::size(Utils::bufferFormatCandidates); ++i) {
+		CHECK(Utils::bufferFormatCandidates[i - 1].bytesPerPixel <= Utils::bufferFormatCandidates[i].bytesPerPixel);
+	}
+}
+
+TEST_CASE(RelaxedPolicyPicksACheaperFormat)
+{
+	CHECK(GetUpgradeFormat("ImageSpaceHalfResBuffer", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT);
+	CHECK(GetUpgradeFormat("ImageSpaceHalfResBuffer", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R10G10B10A2_UNORM) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT);
+}
+
+// Every policy needs to be able to resolve to something other than RGBA16F, or it's dead weight
+TEST_CASE(EveryPolicyCanPickACheaperFormat)
+{
+	for (const auto& policy : Utils::bufferFormatPolicies) {
+		const auto candidate = Utils::ResolveBufferFormat(policy.requirements, BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM);
+		REQUIRE(candidate);
+		CHECK(candidate->bytesPerPixel < 8);
+		CHECK(candidate->bRenderTarget);
+	}
+}
+
+// Resolving to the format the buffer already has wouldn't fix anything, the caller falls back to RGBA16F
+TEST_CASE(CurrentFormatIsNotAnUpgrade)
+{
+	CHECK(Utils::ResolveBufferFormat(Utils::GetBufferFormatRequirements("ImageSpaceHalfResBuffer"), BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT) == nullptr);
+	CHECK(GetUpgradeFormat("ImageSpaceHalfResBuffer", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+	CHECK(GetUpgradeFormat("ImageSpaceBufferB10G11R11", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R11G11B10_FLOAT) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+	CHECK(GetUpgradeFormat("ImageSpaceBufferE5B9G9R9", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R9G9B9E5_SHAREDEXP) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+}
+
+// A buffer that is already RGBA16F stays that way, instead of going up to RGBA32F
+TEST_CASE(DefaultRequirementsPickRGBA16F)
+{
+	CHECK(GetUpgradeFormat("SF_ColorBuffer", BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM) == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT);
+	CHECK(Utils::ResolveBufferFormat({}, BS_DXGI_FORMAT::BS_DXGI_FORMAT_R16G16B16A16_FLOAT) == nullptr);
+}
+
+TEST_CASE(RequirementsAreHonoured)
+{
+	const auto nonRenderTarget = Utils::ResolveBufferFormat({ .bAlpha = false, .bNegativeValues = false, .bRenderTarget = false, .minMantissaBits = 9 }, BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM);
+	REQUIRE(nonRenderTarget);
+	CHECK(nonRenderTarget->format == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R9G9B9E5_SHAREDEXP);
+
+	const auto precise = Utils::ResolveBufferFormat({ .minMantissaBits = 16 }, BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM);
+	REQUIRE(precise);
+	CHECK(precise->format == BS_DXGI_FORMAT::BS_DXGI_FORMAT_R32G32B32A32_FLOAT);
+
+	CHECK(Utils::ResolveBufferFormat({ .minMantissaBits = 32 }, BS_DXGI_FORMAT::BS_DXGI_FORMAT_R8G8B8A8_UNORM) == nullptr);
+}
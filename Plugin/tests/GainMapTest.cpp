@@ -0,0 +1,232 @@
+#include "GainMap.h"
+#include "HalfFloat.h"
+#include "SDRToneMapper.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+namespace
+{
+	constexpr float luminanceWeights[3] = { 0.2126390039920806884765625f, 0.715168654918670654296875f, 0.072192318737506866455078125f };
+
+	// Keeps the base image strips it's passed, and checks they come in order
+	class BaseImageSink : public Utils::ImageSink
+	{
+	public:
+		explicit BaseImageSink(size_t a_rowAlignment = 1) :
+			rowAlignment(a_rowAlignment) {}
+
+		size_t GetRowAlignment() const override { return rowAlignment; }
+
+		bool Begin(const Utils::ImageInfo& a_info) override
+		{
+			info = a_info;
+			pixels.assign(a_info.width * a_info.height * 4, 0);
+			return true;
+		}
+
+		bool WriteStrip(const Utils::ImageStrip& a_strip, [[maybe_unused]] Utils::WorkerPool* a_workers) override
+		{
+			bInOrder &= a_strip.firstRow == nextRow;
+			nextRow = a_strip.firstRow + a_strip.rowCount;
+			for (size_t y = a_strip.firstRow; y < nextRow; ++y) {
+				std::memcpy(pixels.data() + y * info.width * 4, a_strip.GetRow(y), info.width * 4);
+			}
+			return !bFailWrite;
+		}
+
+		bool End() override
+		{
+			++endCount;
+			return nextRow == info.height;
+		}
+
+		Utils::ImageInfo     info;
+		std::vector<uint8_t> pixels;
+		size_t               nextRow = 0;
+		size_t               endCount = 0;
+		bool                 bInOrder = true;
+		bool                 bFailWrite = false;
+
+	private:
+		size_t rowAlignment;
+	};
+
+	// Every "a_blockSize" square has a single color, so a gain map of the same scale can restore it exactly, up to its quantization
+	std::vector<uint16_t> MakeImage(size_t a_width, size_t a_height, size_t a_blockSize)
+	{
+		std::vector<uint16_t>                 pixels(a_width * a_height * 4);
+		std::mt19937                          random(static_cast<uint32_t>(a_width + a_height * 3));
+		std::uniform_real_distribution<float> logValue(std::log(1e-3f), std::log(100.f));
+		const size_t                          blocksWide = (a_width + a_blockSize - 1) / a_blockSize;
+		std::vector<std::array<uint16_t, 3>>  blockColors(blocksWide * ((a_height + a_blockSize - 1) / a_blockSize));
+		for (auto& color : blockColors) {
+			for (auto& channel : color) {
+				channel = Utils::FloatToHalf(std::exp(logValue(random)));
+			}
+		}
+		for (size_t y = 0; y < a_height; ++y) {
+			for (size_t x = 0; x < a_width; ++x) {
+				const auto& color = blockColors[(y / a_blockSize) * blocksWide + x / a_blockSize];
+				std::copy(color.begin(), color.end(), pixels.begin() + (y * a_width + x) * 4);
+				pixels[(y * a_width + x) * 4 + 3] = 0x3C00;
+			}
+		}
+		return pixels;
+	}
+
+	struct GainMapResult
+	{
+		std::vector<uint8_t>   baseImage;
+		std::vector<uint8_t>   gainMap;
+		Utils::GainMapMetadata metadata;
+		size_t                 mapWidth = 0;
+		size_t                 mapHeight = 0;
+	};
+
+	std::optional<GainMapResult> RunGainMap(const std::vector<uint16_t>& a_pixels, size_t a_width, size_t a_height, const Utils::SDRToneMapper& a_toneMapper, const Utils::GainMapParams& a_params, Utils::WorkerPool* a_workers)
+	{
+		Utils::MemoryImageSource source({ a_width, a_height, DXGI_FORMAT_R16G16B16A16_FLOAT }, reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(a_pixels.data())), a_width * 8);
+		BaseImageSink            baseImageSink;
+		Utils::GainMapSink       gainMapSink(a_toneMapper, a_params, baseImageSink);
+		if (!Utils::RunImagePipeline(source, {}, gainMapSink, { .rowsPerStrip = 10, .workers = a_workers }) || !baseImageSink.bInOrder || baseImageSink.endCount != 1) {
+			return std::nullopt;
+		}
+		return GainMapResult{ baseImageSink.pixels, gainMapSink.GetGainMap(), gainMapSink.GetMetadata(), gainMapSink.GetGainMapWidth(), gainMapSink.GetGainMapHeight() };
+	}
+
+	double DecodeSRGB(uint8_t a_value)
+	{
+		const double value = a_value / 255.0;
+		return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+	}
+
+	// Applies the gain map to the base image the way viewers do, and returns the worst relative error of the restored HDR luminances
+	double GetReconstructionError(const std::vector<uint16_t>& a_pixels, size_t a_width, size_t a_height, const GainMapResult& a_result, size_t a_scale, float a_paperWhite)
+	{
+		const auto& metadata = a_result.metadata;
+		double      maxError = 0.0;
+		for (size_t y = 0; y < a_height; ++y) {
+			for (size_t x = 0; x < a_width; ++x) {
+				double hdr = 0.0;
+				double sdr = 0.0;
+				for (size_t c = 0; c < 3; ++c) {
+					hdr += Utils::HalfToFloat(a_pixels[(y * a_width + x) * 4 + c]) / a_paperWhite * luminanceWeights[c];
+					sdr += DecodeSRGB(a_result.baseImage[(y * a_width + x) * 4 + c]) * luminanceWeights[c];
+				}
+				const double recovery = std::pow(a_result.gainMap[(y / a_scale) * a_result.mapWidth + x / a_scale] / 255.0, 1.0 / metadata.gamma);
+				const double gain = metadata.gainMapMin + recovery * (metadata.gainMapMax - metadata.gainMapMin);
+				const double restored = (sdr + metadata.offsetSDR) * std::exp2(gain) - metadata.offsetHDR;
+				maxError = std::max(maxError, std::abs(restored + metadata.offsetHDR - (hdr + metadata.offsetHDR)) / (hdr + metadata.offsetHDR));
+			}
+		}
+		return maxError;
+	}
+}
+
+TEST_CASE(PassesOnTheToneMappedBaseImage)
+{
+	constexpr size_t           width = 37;
+	constexpr size_t           height = 23;
+	const auto                 pixels = MakeImage(width, height, 1);
+	const Utils::SDRToneMapper toneMapper({ .peakWhite = 1000.f / 80.f });
+	Utils::WorkerPool          workers(3, 3);
+
+	const auto result = RunGainMap(pixels, width, height, toneMapper, {}, &workers);
+	REQUIRE(result);
+
+	std::vector<uint8_t> expected(width * height * 4);
+	toneMapper.ToneMapImage(reinterpret_cast<const uint8_t*>(pixels.data()), width * 8, width, height, expected.data(), width * 4);
+	CHECK(result->baseImage == expected);
+	CHECK_EQ(result->mapWidth, size_t(10));
+	CHECK_EQ(result->mapHeight, size_t(6));
+}
+
+// With a single color under each gain map pixel, only the 8 bit quantization of the log2 gains is lost: half a step of the range at most
+TEST_CASE(RestoresTheHDRLuminance)
+{
+	for (const size_t scale : { size_t(1), size_t(4) }) {
+		for (const bool bForceScalar : { false, true }) {
+			Tests::bForceScalar = bForceScalar;
+			constexpr size_t           width = 203;
+			constexpr size_t           height = 61;
+			const auto                 pixels = MakeImage(width, height, scale);
+			const Utils::SDRToneMapper toneMapper({});
+			const auto                 result = RunGainMap(pixels, width, height, toneMapper, { .scale = scale }, nullptr);
+			REQUIRE(result);
+
+			const double quantizationError = std::exp2((result->metadata.gainMapMax - result->metadata.gainMapMin) / 255.0 / 2.0) - 1.0;
+			const double error = GetReconstructionError(pixels, width, height, *result, scale, toneMapper.GetParams().paperWhite);
+			INFO("Scale {}{}: max relative luminance error {:.5f}, quantization allows {:.5f}", scale, bForceScalar ? " (scalar)" : "", error, quantizationError)
+			CHECK(error <= quantizationError * 1.01 + 1e-4);  // The AVX2 log2 is approximated
+			CHECK(result->metadata.gainMapMax > 0.f);
+		}
+	}
+	Tests::bForceScalar = false;
+}
+
+TEST_CASE(AlignsStripsForTheBaseImageSink)
+{
+	const Utils::SDRToneMapper toneMapper({});
+	BaseImageSink              baseImageSink(6);
+	Utils::GainMapSink         gainMapSink(toneMapper, { .scale = 4 }, baseImageSink);
+	CHECK_EQ(gainMapSink.GetRowAlignment(), size_t(12));
+}
+
+TEST_CASE(StopsWhenTheBaseImageSinkFails)
+{
+	const auto                 pixels = MakeImage(8, 8, 1);
+	Utils::MemoryImageSource   source({ 8, 8, DXGI_FORMAT_R16G16B16A16_FLOAT }, reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(pixels.data())), 64);
+	const Utils::SDRToneMapper toneMapper({});
+	BaseImageSink              baseImageSink;
+	baseImageSink.bFailWrite = true;
+	Utils::GainMapSink gainMapSink(toneMapper, {}, baseImageSink);
+	CHECK(!Utils::RunImagePipeline(source, {}, gainMapSink, {}));
+
+	Utils::MemoryImageSource sdrSource({ 8, 8, DXGI_FORMAT_R8G8B8A8_UNORM }, reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(pixels.data())), 32);
+	CHECK(!Utils::RunImagePipeline(sdrSource, {}, gainMapSink, {}));
+}
+
+// The file is the base JPEG with the container directory and MPF index inserted after its JFIF segment, followed by the gain map JPEG with its metadata
+TEST_CASE(WritesTheUltraHDRContainer)
+{
+	const std::vector<uint8_t> baseJpeg = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x04, 'J', 'F', 0xFF, 0xD9 };
+	const std::vector<uint8_t> gainMapJpeg = { 0xFF, 0xD8, 0xFF, 0xD9 };
+	std::ostringstream         stream(std::ios::binary);
+	REQUIRE(Utils::WriteGainMapJpeg(stream, baseJpeg, gainMapJpeg, { .gainMapMax = 2.5f, .hdrCapacityMax = 2.5f }));
+	const std::string file = stream.str();
+
+	// Walks the marker segments of the base image up to its end
+	std::vector<uint8_t> markers;
+	size_t               position = 2;
+	while (position + 4 <= file.size() && static_cast<uint8_t>(file[position + 1]) != 0xD9) {
+		markers.push_back(static_cast<uint8_t>(file[position + 1]));
+		position += 2 + ((size_t(uint8_t(file[position + 2])) << 8) | uint8_t(file[position + 3]));
+	}
+	CHECK(markers == std::vector<uint8_t>({ 0xE0, 0xE1, 0xE2 }));
+	const size_t baseSize = position + 2;
+	REQUIRE(baseSize < file.size());
+	CHECK(file.compare(baseSize, 2, "\xFF\xD8") == 0);
+
+	const size_t gainMapSize = file.size() - baseSize;
+	CHECK(file.find(std::format("Item:Length=\"{}\"", gainMapSize)) < baseSize);
+	CHECK(file.find("hdrgm:GainMapMax=\"2.5\"", baseSize) != std::string::npos);
+
+	// The MPF entries hold the sizes, and the gain map offset relative to the TIFF header after "MPF\0"
+	const size_t mpf = file.find("MPF");
+	REQUIRE(mpf != std::string::npos);
+	auto readBigEndian32 = [&](size_t a_offset) {
+		uint32_t value = 0;
+		for (size_t i = 0; i < 4; ++i) {
+			value = (value << 8) | static_cast<uint8_t>(file[a_offset + i]);
+		}
+		return value;
+	};
+	const size_t tiffHeader = mpf + 4;
+	const size_t entries = tiffHeader + 8 + 2 + 3 * 12 + 4;
+	CHECK_EQ(readBigEndian32(entries + 4), static_cast<uint32_t>(baseSize));
+	CHECK_EQ(readBigEndian32(entries + 16 + 4), static_cast<uint32_t>(gainMapSize));
+	CHECK_EQ(tiffHeader + readBigEndian32(entries + 16 + 8), baseSize);
+
+	CHECK(!Utils::WriteGainMapJpeg(stream, std::vector<uint8_t>{ 0x00, 0x01 }, gainMapJpeg, {}));
+}
@@ -0,0 +1,325 @@
+#include "ColorTransform.h"
+#include "ExrWriter.h"
+#include "HalfFloat.h"
+#include "ImagePipeline.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+#ifdef _WIN32
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+namespace
+{
+	// In bytes, the most memory the process ever had resident
+	uint64_t GetPeakResidentMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters{};
+		K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PeakWorkingSetSize;
+#else
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+#	ifdef __APPLE__
+		return static_cast<uint64_t>(usage.ru_maxrss);
+#	else
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#	endif
+#endif
+	}
+
+	// A seekable stream buffer that only keeps the size of what was written, so the files don't take memory either
+	class DiscardingBuffer : public std::streambuf
+	{
+	public:
+		std::streamsize GetSize() const { return size; }
+
+	protected:
+		int_type overflow(int_type a_char) override
+		{
+			Advance(1);
+			return traits_type::not_eof(a_char);
+		}
+
+		std::streamsize xsputn([[maybe_unused]] const char* a_data, std::streamsize a_count) override
+		{
+			Advance(a_count);
+			return a_count;
+		}
+
+		pos_type seekoff(off_type a_offset, std::ios::seekdir a_direction, [[maybe_unused]] std::ios::openmode a_mode) override
+		{
+			const off_type base = a_direction == std::ios::beg ? 0 : a_direction == std::ios::cur ? position : size;
+			return seekpos(base + a_offset, a_mode);
+		}
+
+		pos_type seekpos(pos_type a_position, [[maybe_unused]] std::ios::openmode a_mode) override
+		{
+			if (a_position < 0) {
+				return pos_type(off_type(-1));
+			}
+			position = a_position;
+			return a_position;
+		}
+
+	private:
+		void Advance(std::streamsize a_count)
+		{
+			position += a_count;
+			size = std::max(size, position);
+		}
+
+		std::streamsize position = 0;
+		std::streamsize size = 0;
+	};
+
+	// Generates RGBA16F rows into a buffer the size of one strip, like the readback arena does.
+	// "GetPixel()" gives the same values, to check what the sinks get.
+	class GeneratedImageSource : public Utils::ImageSource
+	{
+	public:
+		GeneratedImageSource(size_t a_width, size_t a_height) :
+			info{ a_width, a_height, DXGI_FORMAT_R16G16B16A16_FLOAT } {}
+
+		static uint16_t GetPixel(size_t a_x, size_t a_y, size_t a_channel)
+		{
+			return Utils::FloatToHalf(static_cast<float>((a_x * 3 + a_y * 5 + a_channel * 7) % 1000) / 100.f);
+		}
+
+		Utils::ImageInfo GetInfo() const override { return info; }
+
+		bool Begin(size_t a_rowsPerStrip) override
+		{
+			strip.resize(a_rowsPerStrip * info.width * 4);
+			++beginCount;
+			return true;
+		}
+
+		bool ReadStrip(size_t a_firstRow, size_t a_rowCount, Utils::ImageStrip& a_outStrip) override
+		{
+			if (a_firstRow != nextRow || a_rowCount * info.width * 4 > strip.size()) {
+				return false;
+			}
+			for (size_t y = 0; y < a_rowCount; ++y) {
+				for (size_t x = 0; x < info.width; ++x) {
+					for (size_t c = 0; c < 4; ++c) {
+						strip[(y * info.width + x) * 4 + c] = GetPixel(x, a_firstRow + y, c);
+					}
+				}
+			}
+			nextRow += a_rowCount;
+			a_outStrip = { reinterpret_cast<uint8_t*>(strip.data()), a_firstRow, a_rowCount, info.width * 8 };
+			return true;
+		}
+
+		size_t beginCount = 0;
+
+	private:
+		Utils::ImageInfo      info;
+		std::vector<uint16_t> strip;
+		size_t                nextRow = 0;
+	};
+
+	// Records the strips it gets, and can be told to fail
+	class RecordingSink : public Utils::ImageSink
+	{
+	public:
+		explicit RecordingSink(size_t a_rowAlignment = 1) :
+			rowAlignment(a_rowAlignment) {}
+
+		size_t GetRowAlignment() const override { return rowAlignment; }
+
+		bool Begin(const Utils::ImageInfo& a_info) override
+		{
+			info = a_info;
+			++beginCount;
+			return !bFailBegin;
+		}
+
+		bool WriteStrip(const Utils::ImageStrip& a_strip, [[maybe_unused]] Utils::WorkerPool* a_workers) override
+		{
+			strips.emplace_back(a_strip.firstRow, a_strip.rowCount);
+			for (size_t y = a_strip.firstRow; y < a_strip.firstRow + a_strip.rowCount; ++y) {
+				const uint16_t* row = reinterpret_cast<const uint16_t*>(a_strip.GetRow(y));
+				for (size_t x = 0; x < info.width; ++x) {
+					for (size_t c = 0; c < 4; ++c) {
+						mismatches += row[x * 4 + c] != expectedPixel(x, y, c);
+					}
+				}
+			}
+			return strips.size() != failedStrip;
+		}
+
+		bool End() override
+		{
+			++endCount;
+			return !bFailEnd;
+		}
+
+		// The rows must cover the image in order, all but the last strip a multiple of the alignment
+		bool HasCoveredImage() const
+		{
+			size_t nextRow = 0;
+			for (size_t i = 0; i < strips.size(); ++i) {
+				if (strips[i].first != nextRow || (i + 1 < strips.size() && strips[i].second % rowAlignment != 0)) {
+					return false;
+				}
+				nextRow += strips[i].second;
+			}
+			return nextRow == info.height;
+		}
+
+		std::function<uint16_t(size_t, size_t, size_t)> expectedPixel = &GeneratedImageSource::GetPixel;
+		std::vector<std::pair<size_t, size_t>>           strips;  // First row and row count
+		size_t                                           mismatches = 0;
+		size_t                                           beginCount = 0;
+		size_t                                           endCount = 0;
+		size_t                                           failedStrip = 0;  // 1 based, 0 to never fail
+		bool                                             bFailBegin = false;
+		bool                                             bFailEnd = false;
+
+	private:
+		size_t           rowAlignment;
+		Utils::ImageInfo info;
+	};
+
+	// Doubles every value, to check the stages run before the sink
+	class DoublingStage : public Utils::ImageStage
+	{
+	public:
+		void ProcessStrip(const Utils::ImageInfo& a_info, Utils::ImageStrip& a_strip, [[maybe_unused]] Utils::WorkerPool* a_workers) override
+		{
+			for (size_t y = a_strip.firstRow; y < a_strip.firstRow + a_strip.rowCount; ++y) {
+				uint16_t* row = reinterpret_cast<uint16_t*>(a_strip.GetRow(y));
+				for (size_t i = 0; i < a_info.width * 4; ++i) {
+					row[i] = Utils::FloatToHalf(Utils::HalfToFloat(row[i]) * 2.f);
+				}
+			}
+		}
+	};
+}
+
+// First, so nothing else has raised the peak yet. A 4K RGBA16F image is 63 MiB, going through the pipeline should only ever take a few strips of it.
+TEST_CASE(StreamsWithoutHoldingTheImage)
+{
+	constexpr size_t width = 3840;
+	constexpr size_t height = 2160;
+	constexpr size_t rowsPerStrip = 64;
+	constexpr size_t imageSize = width * height * 8;
+
+	Utils::WorkerPool workers(4, 4);
+	const uint64_t    peakBefore = GetPeakResidentMemory();
+
+	GeneratedImageSource       source(width, height);
+	Utils::ColorTransformStage transform(Utils::GetHDRScreenshotTransform(std::nullopt));
+	Utils::ImageStage* const   stages[] = { &transform };
+	DiscardingBuffer           exrBuffer;
+	std::ostream               exrStream(&exrBuffer);
+	Utils::ExrStreamWriter     exrWriter(exrStream, { .bWriteAlpha = true });
+	RecordingSink              recordingSink;
+	recordingSink.expectedPixel = [](size_t a_x, size_t a_y, size_t a_channel) {
+		return a_channel == 3 ? uint16_t(0x3C00) : GeneratedImageSource::GetPixel(a_x, a_y, a_channel);  // Without a clamp, only the alpha changes
+	};
+	Utils::ImageTeeSink teeSink({ &exrWriter, &recordingSink });
+
+	CHECK(Utils::RunImagePipeline(source, stages, teeSink, { .rowsPerStrip = rowsPerStrip, .workers = &workers }));
+	CHECK(recordingSink.HasCoveredImage());
+	CHECK_EQ(recordingSink.mismatches, size_t(0));
+	CHECK(exrBuffer.GetSize() > 0);
+
+	const uint64_t peakIncrease = GetPeakResidentMemory() - peakBefore;
+	INFO("Peak resident memory grew by {:.1f} MiB for a {:.1f} MiB image", peakIncrease / 1048576.0, imageSize / 1048576.0)
+	CHECK(peakIncrease < imageSize / 4);
+}
+
+TEST_CASE(RoundsStripsUpToTheRowAlignment)
+{
+	GeneratedImageSource source(7, 100);
+	RecordingSink        sink(16);
+	CHECK(Utils::RunImagePipeline(source, {}, sink, { .rowsPerStrip = 20 }));
+	CHECK(sink.HasCoveredImage());
+	CHECK_EQ(sink.strips.front().second, size_t(32));
+	CHECK_EQ(sink.strips.back().second, size_t(4));
+	CHECK_EQ(sink.mismatches, size_t(0));
+	CHECK(source.beginCount == 1 && sink.beginCount == 1 && sink.endCount == 1);
+}
+
+TEST_CASE(RunsTheStagesBeforeTheSink)
+{
+	GeneratedImageSource     source(5, 9);
+	DoublingStage            doubling;
+	Utils::ImageStage* const stages[] = { &doubling, &doubling };
+	RecordingSink            sink;
+	sink.expectedPixel = [](size_t a_x, size_t a_y, size_t a_channel) {
+		return Utils::FloatToHalf(Utils::HalfToFloat(GeneratedImageSource::GetPixel(a_x, a_y, a_channel)) * 4.f);
+	};
+	CHECK(Utils::RunImagePipeline(source, stages, sink, { .rowsPerStrip = 2 }));
+	CHECK(sink.HasCoveredImage());
+	CHECK_EQ(sink.mismatches, size_t(0));
+}
+
+TEST_CASE(TeeSinkWritesTheSameStrips)
+{
+	GeneratedImageSource source(3, 50);
+	RecordingSink        first(3);
+	RecordingSink        second(4);
+	Utils::ImageTeeSink  teeSink({ &first, &second });
+	CHECK_EQ(teeSink.GetRowAlignment(), size_t(12));
+
+	CHECK(Utils::RunImagePipeline(source, {}, teeSink, { .rowsPerStrip = 1 }));
+	CHECK(first.HasCoveredImage() && second.HasCoveredImage());
+	CHECK(first.strips == second.strips);
+	CHECK_EQ(first.strips.size(), size_t(5));
+	CHECK(first.mismatches == 0 && second.mismatches == 0);
+}
+
+TEST_CASE(TeeSinkEndsEverySink)
+{
+	GeneratedImageSource source(3, 10);
+	RecordingSink        first;
+	RecordingSink        second;
+	first.bFailEnd = true;
+	Utils::ImageTeeSink teeSink({ &first, &second });
+	CHECK(!Utils::RunImagePipeline(source, {}, teeSink, {}));
+	CHECK(first.endCount == 1 && second.endCount == 1);
+}
+
+TEST_CASE(StopsOnFailure)
+{
+	{
+		GeneratedImageSource source(3, 10);
+		RecordingSink        sink;
+		sink.bFailBegin = true;
+		CHECK(!Utils::RunImagePipeline(source, {}, sink, {}));
+		CHECK(sink.strips.empty());
+	}
+	{
+		GeneratedImageSource source(3, 10);
+		RecordingSink        sink;
+		sink.failedStrip = 2;
+		CHECK(!Utils::RunImagePipeline(source, {}, sink, { .rowsPerStrip = 3 }));
+		CHECK_EQ(sink.strips.size(), size_t(2));
+	}
+	{
+		GeneratedImageSource source(0, 10);
+		RecordingSink        sink;
+		CHECK(!Utils::RunImagePipeline(source, {}, sink, {}));
+		CHECK_EQ(sink.beginCount, size_t(0));
+	}
+}
+
+TEST_CASE(MemorySourceReadsInPlace)
+{
+	std::vector<uint8_t>     pixels(16 * 10);
+	Utils::MemoryImageSource source({ 4, 10, DXGI_FORMAT_R8G8B8A8_UNORM }, pixels.data(), 16);
+	Utils::ImageStrip        strip;
+	REQUIRE(source.ReadStrip(4, 6, strip));
+	CHECK(strip.pixels == pixels.data() + 4 * 16);
+	CHECK(strip.GetRow(9) == pixels.data() + 9 * 16);
+	CHECK(!source.ReadStrip(8, 3, strip));
+}
@@ -0,0 +1,167 @@
+#include "PngWriter.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+#include <png.h>
+
+namespace
+{
+	struct SourceImage
+	{
+		std::vector<uint8_t> pixels;
+		size_t               width;
+		size_t               height;
+	};
+
+	// Noise defeats every filter, the gradients make each of them win somewhere
+	SourceImage MakeImage(size_t a_width, size_t a_height)
+	{
+		SourceImage                             image{ std::vector<uint8_t>(a_width * a_height * 4), a_width, a_height };
+		std::mt19937                            random(static_cast<uint32_t>(a_width * 131 + a_height));
+		std::uniform_int_distribution<uint32_t> noise(0, 255);
+		for (size_t y = 0; y < a_height; ++y) {
+			for (size_t x = 0; x < a_width; ++x) {
+				for (size_t c = 0; c < 4; ++c) {
+					uint8_t value;
+					switch ((x / 13 + y / 7) % 3) {
+					case 0:
+						value = static_cast<uint8_t>(noise(random));
+						break;
+					case 1:
+						value = static_cast<uint8_t>(x * (c + 1) + y);
+						break;
+					default:
+						value = static_cast<uint8_t>(y * 5 + c * 40);
+						break;
+					}
+					image.pixels[(y * a_width + x) * 4 + c] = value;
+				}
+			}
+		}
+		return image;
+	}
+
+	// What the PNG should hold for a source pixel
+	std::array<uint8_t, 3> GetExpectedRGB(const uint8_t* a_pixel, Utils::PngSourceLayout a_layout)
+	{
+		switch (a_layout) {
+		case Utils::PngSourceLayout::kBGRA8:
+			return { a_pixel[2], a_pixel[1], a_pixel[0] };
+		case Utils::PngSourceLayout::kRGB10A2:
+			{
+				uint32_t packed;
+				std::memcpy(&packed, a_pixel, sizeof(packed));
+				std::array<uint8_t, 3> rgb;
+				for (size_t c = 0; c < 3; ++c) {
+					rgb[c] = static_cast<uint8_t>(std::lround(((packed >> (c * 10)) & 0x3FF) / 1023.0 * 255.0));
+				}
+				return rgb;
+			}
+		default:
+			return { a_pixel[0], a_pixel[1], a_pixel[2] };
+		}
+	}
+
+	void CheckRoundTrip(const SourceImage& a_image, Utils::PngSourceLayout a_layout, const Utils::PngWriteParams& a_params)
+	{
+		const Utils::PngSourceImage source{ a_image.pixels.data(), a_image.width, a_image.height, a_image.width * 4, a_layout };
+		std::vector<uint8_t>        data;
+		REQUIRE(Utils::EncodePng(source, a_params, data));
+
+		// libpng checks the chunk CRCs and the zlib stream's Adler-32 on the way
+		png_image decoded{};
+		decoded.version = PNG_IMAGE_VERSION;
+		REQUIRE(png_image_begin_read_from_memory(&decoded, data.data(), data.size()));
+		CHECK_EQ(decoded.width, static_cast<png_uint_32>(a_image.width));
+		CHECK_EQ(decoded.height, static_cast<png_uint_32>(a_image.height));
+		CHECK_EQ(decoded.format, static_cast<png_uint_32>(PNG_FORMAT_RGB));
+		// libpng treats a file without color space chunks as sRGB too, so look for the chunk itself
+		const std::string_view sRGBChunk("sRGB", 4);
+		CHECK_EQ(std::ranges::search(data, sRGBChunk).empty(), !a_params.bSRGB);
+
+		std::vector<uint8_t> rgb(PNG_IMAGE_SIZE(decoded));
+		const bool           bFinished = png_image_finish_read(&decoded, nullptr, rgb.data(), 0, nullptr);
+		CHECK(bFinished);
+		if (!bFinished) {
+			INFO("libpng: {}", decoded.message)
+			return;
+		}
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < a_image.width * a_image.height; ++i) {
+			const auto expected = GetExpectedRGB(a_image.pixels.data() + i * 4, a_layout);
+			mismatches += !std::ranges::equal(expected, std::span(rgb).subspan(i * 3, 3));
+		}
+		CHECK_EQ(mismatches, size_t(0));
+	}
+}
+
+TEST_CASE(RoundTripsEveryLayout)
+{
+	const auto image = MakeImage(101, 67);
+	for (const auto layout : { Utils::PngSourceLayout::kRGBA8, Utils::PngSourceLayout::kBGRA8, Utils::PngSourceLayout::kRGB10A2 }) {
+		CheckRoundTrip(image, layout, {});
+		CheckRoundTrip(image, layout, { .bSRGB = false });
+	}
+}
+
+// Band and strip edges are where the rows above come from somewhere else, and odd widths leave a scalar tail after the vectors
+TEST_CASE(RoundTripsOddSizesAndBands)
+{
+	for (const auto [width, height] : { std::pair<size_t, size_t>{ 1, 1 }, { 1, 40 }, { 5, 1 }, { 6, 9 }, { 21, 33 }, { 259, 130 } }) {
+		const auto image = MakeImage(width, height);
+		for (const size_t rowsPerStrip : { size_t(1), size_t(7), size_t(256) }) {
+			for (const size_t rowsPerBlock : { size_t(0), size_t(1), size_t(3) }) {
+				CheckRoundTrip(image, Utils::PngSourceLayout::kRGBA8, { .rowsPerBlock = rowsPerBlock, .rowsPerStrip = rowsPerStrip });
+			}
+		}
+	}
+	for (const int compressionLevel : { 1, 9 }) {
+		CheckRoundTrip(MakeImage(64, 64), Utils::PngSourceLayout::kRGBA8, { .compressionLevel = compressionLevel });
+	}
+}
+
+TEST_CASE(WorkersWriteTheSameFile)
+{
+	Utils::WorkerPool workers(3, 3);
+	const auto        image = MakeImage(500, 300);
+	CheckRoundTrip(image, Utils::PngSourceLayout::kBGRA8, { .rowsPerStrip = 64, .workers = &workers });
+
+	const Utils::PngSourceImage source{ image.pixels.data(), image.width, image.height, image.width * 4, Utils::PngSourceLayout::kBGRA8 };
+	std::vector<uint8_t>        serial;
+	std::vector<uint8_t>        parallel;
+	REQUIRE(Utils::EncodePng(source, { .rowsPerBlock = 16, .rowsPerStrip = 64 }, serial));
+	REQUIRE(Utils::EncodePng(source, { .rowsPerBlock = 16, .rowsPerStrip = 64, .workers = &workers }, parallel));
+	CHECK(serial == parallel);
+}
+
+TEST_CASE(ReadsEveryRowOnce)
+{
+	Utils::WorkerPool   workers(2, 2);
+	const auto          image = MakeImage(40, 100);
+	std::mutex          mutex;
+	std::vector<size_t> readCounts(image.height);
+	bool                bRowsMatch = true;
+
+	Utils::PngWriteParams params{ .rowsPerBlock = 5, .rowsPerStrip = 32, .workers = &workers };
+	params.onRowRead = [&](size_t a_y, const uint8_t* a_row) {
+		std::lock_guard<std::mutex> lg(mutex);
+		++readCounts[a_y];
+		bRowsMatch &= std::memcmp(a_row, image.pixels.data() + a_y * image.width * 4, image.width * 4) == 0;
+	};
+	CheckRoundTrip(image, Utils::PngSourceLayout::kRGBA8, params);
+
+	CHECK(std::ranges::all_of(readCounts, [](size_t a_count) { return a_count == 1; }));
+	CHECK(bRowsMatch);
+}
+
+TEST_CASE(RejectsOtherFormats)
+{
+	CHECK(!Utils::GetPngSourceLayout(DXGI_FORMAT_R16G16B16A16_FLOAT));
+	CHECK(Utils::GetPngSourceLayout(DXGI_FORMAT_B8G8R8X8_UNORM_SRGB) == Utils::PngSourceLayout::kBGRA8);
+
+	std::ostringstream     stream(std::ios::binary);
+	Utils::PngStreamWriter writer(stream, {});
+	CHECK(!writer.Begin({ 4, 4, DXGI_FORMAT_R16G16B16A16_FLOAT }));
+}
@@ -0,0 +1,107 @@
+#include "ReadbackScheduler.h"
+
+#include "Test.h"
+
+namespace
+{
+	// Completes the tokens when the test says so, like a fence the GPU signals
+	class ManualCompletionSource : public Utils::ReadbackCompletionSource
+	{
+	public:
+		explicit ManualCompletionSource(uint64_t& a_completedValue) :
+			completedValue(a_completedValue) {}
+
+		uint64_t Signal() override { return ++lastSignaledValue; }
+		bool IsComplete(uint64_t a_token) const override { return completedValue >= a_token; }
+
+	private:
+		uint64_t& completedValue;
+		uint64_t  lastSignaledValue = 0;
+	};
+
+	std::vector<int> ProcessAll(Utils::ReadbackScheduler<int>& a_scheduler)
+	{
+		std::vector<int> processed;
+		a_scheduler.ProcessCompleted([&processed](int a_readback) {
+			processed.push_back(a_readback);
+			return true;
+		});
+		return processed;
+	}
+}
+
+TEST_CASE(ReadbacksWaitForTheirToken)
+{
+	uint64_t                      completedValue = 0;
+	Utils::ReadbackScheduler<int> scheduler(std::make_unique<ManualCompletionSource>(completedValue));
+	scheduler.OnFrame();
+	scheduler.Submit(1);
+	CHECK(ProcessAll(scheduler).empty());  // Not signaled until the next frame
+
+	scheduler.OnFrame();
+	CHECK(ProcessAll(scheduler).empty());
+
+	completedValue = 1;
+	CHECK(ProcessAll(scheduler) == std::vector<int>{ 1 });
+	CHECK_EQ(scheduler.Size(), size_t(0));
+}
+
+// The fence alone relies on the copies having been submitted by the next frame, the floor holds them for the old fixed delay regardless
+TEST_CASE(MinFrameDelayIsALowerBound)
+{
+	uint64_t                      completedValue = ~uint64_t(0);  // The GPU is always done
+	Utils::ReadbackScheduler<int> scheduler(std::make_unique<ManualCompletionSource>(completedValue), 8);
+	scheduler.Submit(1);
+	for (uint32_t frame = 1; frame < 8; ++frame) {
+		scheduler.OnFrame();
+		CHECK(ProcessAll(scheduler).empty());
+	}
+	scheduler.OnFrame();
+	CHECK(ProcessAll(scheduler) == std::vector<int>{ 1 });
+}
+
+TEST_CASE(MinFrameDelayDoesntSkipTheFence)
+{
+	uint64_t                      completedValue = 0;
+	Utils::ReadbackScheduler<int> scheduler(std::make_unique<ManualCompletionSource>(completedValue), 2);
+	scheduler.Submit(1);
+	for (uint32_t frame = 0; frame < 10; ++frame) {
+		scheduler.OnFrame();
+	}
+	CHECK(ProcessAll(scheduler).empty());
+	completedValue = 1;
+	CHECK(ProcessAll(scheduler) == std::vector<int>{ 1 });
+}
+
+TEST_CASE(ReadbacksAreProcessedInOrder)
+{
+	uint64_t                      completedValue = 0;
+	Utils::ReadbackScheduler<int> scheduler(std::make_unique<ManualCompletionSource>(completedValue));
+	scheduler.Submit(1);
+	scheduler.OnFrame();
+	scheduler.Submit(2);
+	scheduler.OnFrame();
+
+	completedValue = 2;
+	CHECK(ProcessAll(scheduler) == (std::vector<int>{ 1, 2 }));
+
+	// A refused readback stays at the front
+	scheduler.Submit(3);
+	scheduler.Submit(4);
+	scheduler.OnFrame();
+	completedValue = 4;
+	CHECK_EQ(scheduler.ProcessCompleted([](int) { return false; }), size_t(0));
+	CHECK(ProcessAll(scheduler) == (std::vector<int>{ 3, 4 }));
+}
+
+TEST_CASE(FrameCountFallback)
+{
+	Utils::ReadbackScheduler<int> scheduler(std::make_unique<Utils::FrameCountCompletionSource>(3));
+	scheduler.Submit(1);
+	scheduler.OnFrame();  // Signaled, completes 3 frames later
+	for (uint32_t frame = 0; frame < 3; ++frame) {
+		CHECK(ProcessAll(scheduler).empty());
+		scheduler.OnFrame();
+	}
+	CHECK(ProcessAll(scheduler) == std::vector<int>{ 1 });
+}
@@ -0,0 +1,223 @@
+#include "ResourcePool.h"
+
+#include "Test.h"
+
+namespace
+{
+	struct FakeResource
+	{
+		int key;
+	};
+
+	// Resources are as many bytes as their key, and the allocator keeps count of what is alive
+	class FakeAllocator : public Utils::ResourceAllocator<FakeResource, int>
+	{
+	public:
+		struct Counters
+		{
+			std::atomic_int created = 0;
+			std::atomic_int destroyed = 0;
+			bool            bFailCreate = false;
+		};
+
+		explicit FakeAllocator(Counters& a_counters) :
+			counters(a_counters) {}
+
+		FakeResource* Create(const int& a_key) override
+		{
+			if (counters.bFailCreate) {
+				return nullptr;
+			}
+			++counters.created;
+			return new FakeResource{ a_key };
+		}
+
+		void Destroy(FakeResource* a_resource) override
+		{
+			++counters.destroyed;
+			delete a_resource;
+		}
+
+		uint64_t GetSize(const int& a_key) const override { return static_cast<uint64_t>(a_key); }
+
+	private:
+		Counters& counters;
+	};
+
+	using FakePool = Utils::ResourcePool<FakeResource, int>;
+
+	std::unique_ptr<FakePool> MakePool(FakeAllocator::Counters& a_counters, uint64_t a_maxBytes)
+	{
+		return std::make_unique<FakePool>(std::make_unique<FakeAllocator>(a_counters), a_maxBytes);
+	}
+}
+
+TEST_CASE(ReusesResourcesWithTheSameKey)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 100);
+
+	const auto first = pool->Acquire(10);
+	REQUIRE(first);
+	pool->Release(first);
+	CHECK(pool->Acquire(10) == first);
+	CHECK_EQ(counters.created.load(), 1);
+
+	// In use, so a second one is created
+	const auto second = pool->Acquire(10);
+	CHECK(second != first);
+	pool->Release(first);
+	pool->Release(second);
+
+	// The most recently returned one is reused first
+	CHECK(pool->Acquire(10) == second);
+	CHECK(pool->Acquire(20) != first);
+
+	const auto stats = pool->GetStats();
+	CHECK_EQ(stats.resourceCount, size_t(3));
+	CHECK_EQ(stats.freeCount, size_t(1));
+	CHECK_EQ(stats.totalBytes, uint64_t(40));
+	CHECK_EQ(stats.createCount, uint64_t(3));
+	CHECK_EQ(stats.reuseCount, uint64_t(2));
+}
+
+TEST_CASE(EvictsTheLeastRecentlyUsedToMakeRoom)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 30);
+
+	const auto a = pool->Acquire(10);
+	const auto b = pool->Acquire(11);
+	pool->Release(a);
+	pool->Release(b);
+
+	// 21 bytes are free, making room for 12 more only needs "a" to go
+	const auto c = pool->Acquire(12);
+	REQUIRE(c);
+	CHECK_EQ(counters.destroyed.load(), 1);
+	CHECK(pool->Acquire(11) == b);
+	CHECK_EQ(pool->GetStats().totalBytes, uint64_t(23));
+}
+
+// The cap only limits what the pool keeps, captures are never refused because of it
+TEST_CASE(CreatesOverTheCapAndDestroysOnReturn)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 15);
+
+	const auto a = pool->Acquire(10);
+	const auto b = pool->Acquire(10);
+	REQUIRE(a && b);
+	CHECK_EQ(pool->GetStats().totalBytes, uint64_t(20));
+
+	pool->Release(a);  // Over the cap
+	CHECK_EQ(counters.destroyed.load(), 1);
+	pool->Release(b);  // Fits
+	CHECK_EQ(counters.destroyed.load(), 1);
+	CHECK_EQ(pool->GetStats().freeCount, size_t(1));
+
+	// With no cap nothing is kept
+	auto uncapped = MakePool(counters, 0);
+	uncapped->Release(uncapped->Acquire(1));
+	CHECK_EQ(uncapped->GetStats().resourceCount, size_t(0));
+}
+
+TEST_CASE(ClearDestroysResourcesInUseOnceReturned)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 100);
+
+	const auto inUse = pool->Acquire(10);
+	pool->Release(pool->Acquire(20));
+	pool->Clear();
+	CHECK_EQ(counters.destroyed.load(), 1);
+	CHECK_EQ(pool->GetStats().resourceCount, size_t(1));
+
+	pool->Release(inUse);
+	CHECK_EQ(counters.destroyed.load(), 2);
+	CHECK_EQ(pool->GetStats().totalBytes, uint64_t(0));
+
+	// Resources created after the clear are pooled again
+	const auto next = pool->Acquire(10);
+	pool->Release(next);
+	CHECK(pool->Acquire(10) == next);
+}
+
+TEST_CASE(SetMaxBytesTrimsTheFreeResources)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 100);
+
+	const auto a = pool->Acquire(10);
+	const auto b = pool->Acquire(20);
+	const auto c = pool->Acquire(30);
+	pool->Release(a);
+	pool->Release(c);
+	pool->Release(b);
+
+	pool->SetMaxBytes(50);  // Drops "a", then fits
+	CHECK_EQ(pool->GetStats().totalBytes, uint64_t(50));
+	pool->SetMaxBytes(0);
+	CHECK_EQ(pool->GetStats().resourceCount, size_t(0));
+	CHECK_EQ(counters.destroyed.load(), 3);
+}
+
+TEST_CASE(IgnoresUnknownAndDoubleReleases)
+{
+	FakeAllocator::Counters counters;
+	auto                    pool = MakePool(counters, 100);
+
+	FakeResource unknown{ 1 };
+	pool->Release(&unknown);
+
+	const auto a = pool->Acquire(10);
+	pool->Release(a);
+	pool->Release(a);
+	CHECK_EQ(pool->GetStats().freeCount, size_t(1));
+	CHECK_EQ(counters.destroyed.load(), 0);
+
+	counters.bFailCreate = true;
+	CHECK(pool->Acquire(20) == nullptr);
+	CHECK_EQ(pool->GetStats().resourceCount, size_t(1));
+}
+
+TEST_CASE(DestroysEverythingWhenDestroyed)
+{
+	FakeAllocator::Counters counters;
+	{
+		auto pool = MakePool(counters, 100);
+		pool->Acquire(10);
+		pool->Release(pool->Acquire(20));
+	}
+	CHECK_EQ(counters.destroyed.load(), counters.created.load());
+}
+
+// Resources are returned from the encoder threads while the render thread acquires new ones
+TEST_CASE(IsThreadSafe)
+{
+	FakeAllocator::Counters counters;
+	{
+		auto                     pool = MakePool(counters, 64);
+		std::vector<std::thread> threads;
+		std::atomic_int          failures = 0;
+		for (int t = 0; t < 8; ++t) {
+			threads.emplace_back([&, t] {
+				for (int i = 0; i < 5000; ++i) {
+					const int  key = 1 + (t + i) % 4;
+					const auto resource = pool->Acquire(key);
+					if (!resource || resource->key != key) {
+						++failures;
+					}
+					pool->Release(resource);
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		CHECK_EQ(failures.load(), 0);
+		CHECK(pool->GetStats().totalBytes <= 64);
+		CHECK_EQ(pool->GetStats().freeCount, pool->GetStats().resourceCount);
+	}
+	CHECK_EQ(counters.destroyed.load(), counters.created.load());
+}
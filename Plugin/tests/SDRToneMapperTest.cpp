@@ -0,0 +1,253 @@
+#include "HalfFloat.h"
+#include "SDRToneMapper.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+namespace
+{
+	using Color = std::array<double, 3>;
+
+	// "rangeCompress()" and "luminanceCompress()" from "shaders/math.hlsl", in double and with every parameter the screenshot path uses
+	double RangeCompress(double a_x, double a_max)
+	{
+		return (1.0 - std::exp(-a_x)) / (1.0 - std::exp(-a_max));
+	}
+
+	double LuminanceCompress(double a_value, double a_outMaxValue, double a_shoulderStart, double a_inMaxValue)
+	{
+		const double compressedRange = std::max(a_outMaxValue - a_shoulderStart, DBL_MIN);
+		if (a_value <= a_shoulderStart) {
+			return a_value;
+		}
+		return a_shoulderStart + compressedRange * RangeCompress((a_value - a_shoulderStart) / compressedRange, (a_inMaxValue - a_shoulderStart) / compressedRange);
+	}
+
+	// The whole tone mapper without the half float lookup table or 8 bit output, gamma encoded
+	Color ToneMapReference(Color a_color, const Utils::SDRToneMapParams& a_params)
+	{
+		const double minHighlightsColor = std::pow(2.0 / 3.0, 2.2);
+		const double maxValue = a_params.peakWhite / a_params.paperWhite;
+
+		for (double& channel : a_color) {
+			channel = std::isnan(channel) ? 0.0 : std::clamp(channel, -65504.0, 65504.0) / a_params.paperWhite;
+		}
+		const double minChannel = std::min({ a_color[0], a_color[1], a_color[2] });
+		if (minChannel < 0.0) {
+			const double luminance = a_color[0] * 0.2126390039920806884765625 + a_color[1] * 0.715168654918670654296875 + a_color[2] * 0.072192318737506866455078125;
+			for (double& channel : a_color) {
+				channel = luminance > 0.0 ? luminance + (channel - luminance) * luminance / (luminance - minChannel) : 0.0;
+			}
+		}
+
+		for (double& channel : a_color) {
+			const double value = std::clamp(channel, 0.0, std::max(maxValue, 0.0));
+			const double mapped = maxValue <= 1.0 ? value : LuminanceCompress(value, 1.0, minHighlightsColor, maxValue);
+			channel = std::pow(std::clamp(mapped, 0.0, 1.0), 1.0 / a_params.gamma);
+		}
+		return a_color;
+	}
+
+	// Gamma encoded BT.709 to CIELAB, with a D65 white
+	Color ToLab(const Color& a_color, double a_gamma)
+	{
+		Color linear;
+		for (size_t c = 0; c < 3; ++c) {
+			linear[c] = std::pow(a_color[c], a_gamma);
+		}
+		const double xyz[3] = {
+			(0.4123907992659595 * linear[0] + 0.3575843393838780 * linear[1] + 0.1804807884018343 * linear[2]) / 0.95045592705167,
+			0.2126390058715104 * linear[0] + 0.7151686787677559 * linear[1] + 0.0721923153607337 * linear[2],
+			(0.0193308187155918 * linear[0] + 0.1191947797946259 * linear[1] + 0.9505321522496608 * linear[2]) / 1.08905775075988
+		};
+		auto f = [](double a_t) {
+			return a_t > 216.0 / 24389.0 ? std::cbrt(a_t) : (24389.0 / 27.0 * a_t + 16.0) / 116.0;
+		};
+		return { 116.0 * f(xyz[1]) - 16.0, 500.0 * (f(xyz[0]) - f(xyz[1])), 200.0 * (f(xyz[1]) - f(xyz[2])) };
+	}
+
+	// CIEDE2000
+	double DeltaE(const Color& a_lab1, const Color& a_lab2)
+	{
+		constexpr double pi = 3.14159265358979323846;
+		auto             degrees = [](double a_radians) { return a_radians * 180.0 / pi; };
+		auto             radians = [](double a_degrees) { return a_degrees * pi / 180.0; };
+
+		const double c1 = std::hypot(a_lab1[1], a_lab1[2]);
+		const double c2 = std::hypot(a_lab2[1], a_lab2[2]);
+		const double c7 = std::pow((c1 + c2) / 2.0, 7.0);
+		const double g = 0.5 * (1.0 - std::sqrt(c7 / (c7 + std::pow(25.0, 7.0))));
+		const double a1 = a_lab1[1] * (1.0 + g);
+		const double a2 = a_lab2[1] * (1.0 + g);
+		const double cPrime1 = std::hypot(a1, a_lab1[2]);
+		const double cPrime2 = std::hypot(a2, a_lab2[2]);
+		auto         hue = [&](double a_b, double a_a) {
+			const double h = a_a == 0.0 && a_b == 0.0 ? 0.0 : degrees(std::atan2(a_b, a_a));
+			return h < 0.0 ? h + 360.0 : h;
+		};
+		const double h1 = hue(a_lab1[2], a1);
+		const double h2 = hue(a_lab2[2], a2);
+
+		const double deltaL = a_lab2[0] - a_lab1[0];
+		const double deltaC = cPrime2 - cPrime1;
+		double       deltah = 0.0;
+		if (cPrime1 * cPrime2 != 0.0) {
+			deltah = h2 - h1;
+			deltah += deltah > 180.0 ? -360.0 : deltah < -180.0 ? 360.0 : 0.0;
+		}
+		const double deltaH = 2.0 * std::sqrt(cPrime1 * cPrime2) * std::sin(radians(deltah / 2.0));
+
+		const double meanL = (a_lab1[0] + a_lab2[0]) / 2.0;
+		const double meanC = (cPrime1 + cPrime2) / 2.0;
+		double       meanH = h1 + h2;
+		if (cPrime1 * cPrime2 != 0.0 && std::abs(h1 - h2) > 180.0) {
+			meanH += meanH < 360.0 ? 360.0 : -360.0;
+		}
+		meanH /= cPrime1 * cPrime2 != 0.0 ? 2.0 : 1.0;
+
+		const double t = 1.0 - 0.17 * std::cos(radians(meanH - 30.0)) + 0.24 * std::cos(radians(2.0 * meanH)) + 0.32 * std::cos(radians(3.0 * meanH + 6.0)) - 0.20 * std::cos(radians(4.0 * meanH - 63.0));
+		const double deltaTheta = 30.0 * std::exp(-std::pow((meanH - 275.0) / 25.0, 2.0));
+		const double meanC7 = std::pow(meanC, 7.0);
+		const double rC = 2.0 * std::sqrt(meanC7 / (meanC7 + std::pow(25.0, 7.0)));
+		const double sL = 1.0 + 0.015 * std::pow(meanL - 50.0, 2.0) / std::sqrt(20.0 + std::pow(meanL - 50.0, 2.0));
+		const double sC = 1.0 + 0.045 * meanC;
+		const double sH = 1.0 + 0.015 * meanC * t;
+		const double rT = -std::sin(radians(2.0 * deltaTheta)) * rC;
+
+		return std::sqrt(std::pow(deltaL / sL, 2.0) + std::pow(deltaC / sC, 2.0) + std::pow(deltaH / sH, 2.0) + rT * (deltaC / sC) * (deltaH / sH));
+	}
+
+	// Bright and dark values alike, with some colors outside of BT.709 and some values beyond the half range
+	std::vector<uint16_t> MakeImage(size_t a_pixelCount, float a_peakWhite)
+	{
+		std::vector<uint16_t>                 pixels(a_pixelCount * 4);
+		std::mt19937                          random(static_cast<uint32_t>(a_pixelCount));
+		std::uniform_real_distribution<float> logValue(std::log(1e-4f), std::log(a_peakWhite * 1.5f));
+		std::uniform_real_distribution<float> chance(0.f, 1.f);
+		for (size_t i = 0; i < a_pixelCount; ++i) {
+			for (size_t c = 0; c < 3; ++c) {
+				const float value = std::exp(logValue(random));
+				pixels[i * 4 + c] = Utils::FloatToHalf(chance(random) < 0.05f ? -value * 0.1f : value);
+			}
+			pixels[i * 4 + 3] = Utils::FloatToHalf(chance(random));
+		}
+		return pixels;
+	}
+
+	struct DeltaEStats
+	{
+		double max = 0.0;
+		double mean = 0.0;
+		double maxRounded = 0.0;  // Of the reference rounded to 8 bit, the closest the output could be
+		size_t offByMoreThanOne = 0;
+	};
+
+	DeltaEStats MeasureDeltaE(const Utils::SDRToneMapParams& a_params, size_t a_pixelCount)
+	{
+		const auto           pixels = MakeImage(a_pixelCount, a_params.peakWhite);
+		Utils::SDRToneMapper toneMapper(a_params);
+		std::vector<uint8_t> output(a_pixelCount * 4);
+		toneMapper.ToneMapRow(reinterpret_cast<const uint8_t*>(pixels.data()), a_pixelCount, output.data());
+
+		DeltaEStats stats;
+		for (size_t i = 0; i < a_pixelCount; ++i) {
+			Color source;
+			Color actual;
+			for (size_t c = 0; c < 3; ++c) {
+				source[c] = Utils::HalfToFloat(pixels[i * 4 + c]);
+				actual[c] = output[i * 4 + c] / 255.0;
+			}
+			const Color reference = ToneMapReference(source, a_params);
+			Color       rounded;
+			for (size_t c = 0; c < 3; ++c) {
+				rounded[c] = std::round(reference[c] * 255.0) / 255.0;
+				stats.offByMoreThanOne += std::abs(rounded[c] - actual[c]) * 255.0 > 1.001;
+			}
+
+			const Color  referenceLab = ToLab(reference, a_params.gamma);
+			const double deltaE = DeltaE(referenceLab, ToLab(actual, a_params.gamma));
+			stats.max = std::max(stats.max, deltaE);
+			stats.mean += deltaE / static_cast<double>(a_pixelCount);
+			stats.maxRounded = std::max(stats.maxRounded, DeltaE(referenceLab, ToLab(rounded, a_params.gamma)));
+			if (output[i * 4 + 3] != 255) {
+				stats.max = INFINITY;
+			}
+		}
+		return stats;
+	}
+
+	void CheckDeltaE(const Utils::SDRToneMapParams& a_params)
+	{
+		for (const bool bForceScalar : { false, true }) {
+			Tests::bForceScalar = bForceScalar;
+			const auto stats = MeasureDeltaE(a_params, 100000);
+			INFO("Paper white {}, peak {}, gamma {}{}: deltaE 2000 max {:.3f} (8 bit rounding alone {:.3f}), mean {:.3f}", a_params.paperWhite * 80.f, a_params.peakWhite * 80.f, a_params.gamma, bForceScalar ? " (scalar)" : "", stats.max, stats.maxRounded, stats.mean)
+			CHECK_EQ(stats.offByMoreThanOne, size_t(0));
+			CHECK(stats.max < 1.5);
+			CHECK(stats.mean < 0.15);
+		}
+		Tests::bForceScalar = false;
+	}
+}
+
+// The 8 bit output can't be closer than half a step, which is already up to a deltaE 2000 of about 1 (barely noticeable) in the darks.
+// Rounding the scaled colors to half floats for the lookup can move a channel by one more step, but never further.
+TEST_CASE(MatchesTheReferenceWithinDeltaE)
+{
+	CheckDeltaE({});
+	CheckDeltaE({ .paperWhite = 203.f / 80.f, .peakWhite = 1000.f / 80.f });
+	CheckDeltaE({ .paperWhite = 400.f / 80.f, .peakWhite = 400.f / 80.f });  // Nothing to compress
+	CheckDeltaE({ .paperWhite = 100.f / 80.f, .peakWhite = 4000.f / 80.f, .gamma = 2.4f });
+}
+
+TEST_CASE(ScalarAndAVX2Match)
+{
+	constexpr size_t     pixelCount = 4097;  // Odd, so the AVX2 path has a tail
+	auto                 pixels = MakeImage(pixelCount, 1000.f / 80.f);
+	const uint16_t       specialValues[] = { 0x7E00, 0xFE00, 0x7C00, 0xFC00, 0x8000, 0x0001, 0x7BFF, 0xFBFF };
+	for (size_t i = 0; i < std::size(specialValues); ++i) {
+		pixels[i * 4 + i % 3] = specialValues[i];
+	}
+
+	Utils::SDRToneMapper toneMapper({ .peakWhite = 1000.f / 80.f });
+	std::vector<uint8_t> vector(pixelCount * 4);
+	std::vector<uint8_t> scalar(pixelCount * 4);
+	toneMapper.ToneMapRow(reinterpret_cast<const uint8_t*>(pixels.data()), pixelCount, vector.data());
+	Tests::bForceScalar = true;
+	toneMapper.ToneMapRow(reinterpret_cast<const uint8_t*>(pixels.data()), pixelCount, scalar.data());
+	Tests::bForceScalar = false;
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < vector.size(); ++i) {
+		mismatches += vector[i] != scalar[i];
+	}
+	CHECK_EQ(mismatches, size_t(0));
+}
+
+TEST_CASE(MapsThePeakToWhite)
+{
+	const Utils::SDRToneMapper toneMapper({ .paperWhite = 2.f, .peakWhite = 20.f });
+	CHECK_EQ(toneMapper.ToneMapChannel(10.f), 1.f);
+	CHECK_EQ(toneMapper.ToneMapChannel(100.f), 1.f);
+	CHECK_EQ(toneMapper.ToneMapChannel(0.25f), 0.25f);  // Below the highlights
+	CHECK(toneMapper.ToneMapChannel(5.f) < 1.f);
+
+	const uint16_t pixel[4] = { Utils::FloatToHalf(20.f), Utils::FloatToHalf(2.f), 0, 0 };
+	uint8_t        output[4];
+	toneMapper.ToneMapRow(reinterpret_cast<const uint8_t*>(pixel), 1, output);
+	CHECK(output[0] == 255 && output[1] < 255 && output[2] == 0 && output[3] == 255);
+}
+
+TEST_CASE(WorkersToneMapTheSameImage)
+{
+	constexpr size_t     width = 300;
+	constexpr size_t     height = 50;
+	const auto           pixels = MakeImage(width * height, 1000.f / 80.f);
+	Utils::SDRToneMapper toneMapper({ .peakWhite = 1000.f / 80.f });
+	Utils::WorkerPool    workers(3, 3);
+	std::vector<uint8_t> serial(width * height * 4);
+	std::vector<uint8_t> parallel(width * height * 4);
+	toneMapper.ToneMapImage(reinterpret_cast<const uint8_t*>(pixels.data()), width * 8, width, height, serial.data(), width * 4);
+	toneMapper.ToneMapImage(reinterpret_cast<const uint8_t*>(pixels.data()), width * 8, width, height, parallel.data(), width * 4, &workers);
+	CHECK(serial == parallel);
+}
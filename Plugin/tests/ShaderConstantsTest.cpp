@@ -0,0 +1,22 @@
+#include "ShaderConstants.h"
+
+#include "Test.h"
+
+// The plugin build runs the same check through "tools/GenerateShaderConstantsHLSL.cpp", this catches it on platforms that can't build the plugin
+TEST_CASE(HLSLHeaderIsUpToDate)
+{
+	std::ifstream file(Tests::GetRepoPath("shaders/HdrDllPluginConstants.hlsl"), std::ios::binary);
+	REQUIRE(file);
+	std::string hlsl((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::erase(hlsl, '\r');
+	CHECK(hlsl == Settings::GenerateShaderConstantsHLSL());
+}
+
+TEST_CASE(HLSLHeaderDeclaresEveryField)
+{
+	const std::string hlsl = Settings::GenerateShaderConstantsHLSL();
+	for (const auto& field : Settings::shaderConstantFields) {
+		CHECK(hlsl.find(std::format(" {};", field.name)) != std::string::npos);
+	}
+	CHECK(hlsl.find(std::format("#define HDR_PLUGIN_CONSTANTS_SIZE \"{}\"", Settings::shaderConstantsCount)) != std::string::npos);
+}
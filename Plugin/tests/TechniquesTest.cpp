@@ -0,0 +1,85 @@
+#include "Techniques.h"
+
+#include "Test.h"
+
+namespace
+{
+	bool IsInManifest(uint64_t a_techniqueId)
+	{
+		return std::ranges::find(Techniques::manifest, a_techniqueId, &Techniques::TechniqueInfo::id) != std::end(Techniques::manifest);
+	}
+
+	// Built the same way as the manifest, from the ID layout the game uses: a base technique in the low bits and permutation flags above
+	struct SyntheticManifest
+	{
+		Techniques::TechniqueInfo techniques[32];
+	};
+
+	constexpr SyntheticManifest syntheticManifest = [] {
+		SyntheticManifest result{};
+		for (uint64_t i = 0; i < std::size(result.techniques); ++i) {
+			result.techniques[i] = { (0x1FE00 + i % 8) | ((i / 8) << 25), "Synthetic", 0, false, Settings::ShaderConstantsMode::kDefault };
+		}
+		return result;
+	}();
+
+	constexpr Techniques::PerfectHashTable<std::size(syntheticManifest.techniques)> syntheticTable{ syntheticManifest.techniques };
+}
+
+TEST_CASE(EveryManifestEntryIsFound)
+{
+	for (size_t i = 0; i < Techniques::manifestSize; ++i) {
+		const auto technique = Techniques::FindTechnique(Techniques::manifest[i].id);
+		CHECK(technique == &Techniques::manifest[i]);
+		CHECK_EQ(Techniques::GetTechniqueIndex(technique), i);
+	}
+}
+
+TEST_CASE(ManifestHasNoDuplicates)
+{
+	for (size_t i = 0; i < Techniques::manifestSize; ++i) {
+		for (size_t j = i + 1; j < Techniques::manifestSize; ++j) {
+			CHECK(Techniques::manifest[i].id != Techniques::manifest[j].id);
+		}
+	}
+}
+
+// IDs that differ from a manifest entry by a single bit land on the same kind of slots, they must not be mistaken for it
+TEST_CASE(NeighboursOfManifestEntriesAreNotFound)
+{
+	for (const auto& technique : Techniques::manifest) {
+		for (uint32_t bit = 0; bit < 64; ++bit) {
+			const uint64_t id = technique.id ^ (uint64_t(1) << bit);
+			if (!IsInManifest(id)) {
+				CHECK(Techniques::FindTechnique(id) == nullptr);
+			}
+		}
+		CHECK(IsInManifest(technique.id + 1) || Techniques::FindTechnique(technique.id + 1) == nullptr);
+		CHECK(IsInManifest(technique.id - 1) || Techniques::FindTechnique(technique.id - 1) == nullptr);
+	}
+}
+
+TEST_CASE(RandomIdsAreNotFound)
+{
+	std::mt19937_64 random(1234);
+	size_t          falsePositives = 0;
+	for (uint32_t i = 0; i < 1000000; ++i) {
+		const uint64_t id = random();
+		if (!IsInManifest(id) && Techniques::FindTechnique(id)) {
+			++falsePositives;
+		}
+	}
+	CHECK_EQ(falsePositives, size_t(0));
+	CHECK(Techniques::FindTechnique(~uint64_t(0)) == nullptr);  // The marker of empty slots
+}
+
+TEST_CASE(SyntheticManifestHasNoCollisions)
+{
+	for (const auto& technique : syntheticManifest.techniques) {
+		CHECK(syntheticTable.Find(technique.id) == &technique);
+	}
+	for (uint64_t id = 0; id < 0x100000; ++id) {
+		const bool bListed = std::ranges::find(syntheticManifest.techniques, id, &Techniques::TechniqueInfo::id) != std::end(syntheticManifest.techniques);
+		CHECK(bListed || syntheticTable.Find(id) == nullptr);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// A minimal test runner, each test executable links "TestMain.cpp" and registers its cases with "TEST_CASE".
+// Failed checks are reported and counted, but don't stop the test case.
+namespace Tests
+{
+	using TestFunction = void (*)();
+
+	struct TestCase
+	{
+		std::string_view name;
+		TestFunction     function;
+	};
+
+	std::vector<TestCase>& GetTestCases();
+	void                   ReportFailure(std::string_view a_expression, std::string_view a_file, int a_line, const std::string& a_message = {});
+
+	struct TestRegistrar
+	{
+		TestRegistrar(std::string_view a_name, TestFunction a_function) { GetTestCases().push_back({ a_name, a_function }); }
+	};
+
+	// Of a file in the repository, e.g. "shaders/HdrDllPluginConstants.hlsl"
+	std::filesystem::path GetRepoPath(std::string_view a_relativePath);
+
+	// Makes "Utils::IsAVX2Supported()" return false, to test the scalar fallbacks (see "CpuFeatures.cpp")
+	extern bool bForceScalar;
+}
+
+#define TEST_CASE(a_name)                                                        \
+	static void                 a_name();                                        \
+	static Tests::TestRegistrar a_name##Registrar(#a_name, a_name);              \
+	static void                 a_name()
+
+#define CHECK(a_condition)                                                       \
+	do {                                                                         \
+		if (!(a_condition)) {                                                    \
+			Tests::ReportFailure(#a_condition, __FILE__, __LINE__);              \
+		}                                                                        \
+	} while (false)
+
+#define CHECK_EQ(a_actual, a_expected)                                                                                          \
+	do {                                                                                                                        \
+		const auto& actualValue = (a_actual);                                                                                  \
+		const auto& expectedValue = (a_expected);                                                                              \
+		if (!(actualValue == expectedValue)) {                                                                                  \
+			Tests::ReportFailure(#a_actual " == " #a_expected, __FILE__, __LINE__, std::format("{} != {}", actualValue, expectedValue)); \
+		}                                                                                                                       \
+	} while (false)
+
+// Stops the test case, for when the rest of it can't run (e.g. a null pointer)
+#define REQUIRE(a_condition)                                                     \
+	do {                                                                         \
+		if (!(a_condition)) {                                                    \
+			Tests::ReportFailure(#a_condition, __FILE__, __LINE__);              \
+			return;                                                              \
+		}                                                                        \
+	} while (false)
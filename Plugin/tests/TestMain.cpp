@@ -0,0 +1,40 @@
+#include "Test.h"
+
+namespace Tests
+{
+	namespace
+	{
+		int failureCount = 0;
+	}
+
+	std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	void ReportFailure(std::string_view a_expression, std::string_view a_file, int a_line, const std::string& a_message)
+	{
+		++failureCount;
+		std::cerr << std::format("{}({}): CHECK({}) failed", a_file, a_line, a_expression);
+		if (!a_message.empty()) {
+			std::cerr << std::format(": {}", a_message);
+		}
+		std::cerr << '\n';
+	}
+
+	std::filesystem::path GetRepoPath(std::string_view a_relativePath)
+	{
+		return std::filesystem::path(LUMA_REPO_DIR) / a_relativePath;
+	}
+}
+
+int main()
+{
+	for (const auto& testCase : Tests::GetTestCases()) {
+		const int failuresBefore = Tests::failureCount;
+		testCase.function();
+		std::cout << std::format("[{}] {}\n", Tests::failureCount == failuresBefore ? "PASS" : "FAIL", testCase.name);
+	}
+	return Tests::failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Force included in every test source, in place of "src/PCH.h" (which pulls in the game, DKUtil and ReShade)
+
+// c
+#include <cassert>
+#include <cfloat>
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// cxx
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Older standard libraries (e.g. GCC 12) don't have <format> yet, fmt is the same API
+#if __has_include(<format>)
+#	include <format>
+#else
+#	include <fmt/format.h>
+namespace std
+{
+	using fmt::format;
+	using fmt::format_to;
+}
+#endif
+
+using namespace std::literals;
+
+// DKUtil logging
+#define INFO(...) std::cout << std::format(__VA_ARGS__) << '\n';
+#define WARN(...) std::cerr << std::format(__VA_ARGS__) << '\n';
@@ -0,0 +1,189 @@
+#include "HalfFloat.h"
+#include "ThumbnailScaler.h"
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+namespace
+{
+	double SRGBToLinear(double a_value)
+	{
+		return a_value <= 0.04045 ? a_value / 12.92 : std::pow((a_value + 0.055) / 1.055, 2.4);
+	}
+
+	double LinearToSRGB(double a_value)
+	{
+		return a_value <= 0.0031308 ? a_value * 12.92 : 1.055 * std::pow(a_value, 1.0 / 2.4) - 0.055;
+	}
+
+	struct SourceImage
+	{
+		std::vector<uint8_t> pixels;
+		size_t               width;
+		size_t               height;
+		Utils::ScalerFormat  format;
+
+		size_t GetRowPitch() const { return width * (format == Utils::ScalerFormat::kRGBA16F ? 8 : 4); }
+
+		double GetLinear(size_t a_x, size_t a_y, size_t a_channel) const
+		{
+			if (format == Utils::ScalerFormat::kRGBA16F) {
+				uint16_t half;
+				std::memcpy(&half, pixels.data() + a_y * GetRowPitch() + (a_x * 4 + a_channel) * 2, sizeof(half));
+				return Utils::HalfToFloat(half);
+			}
+			const size_t byte = format == Utils::ScalerFormat::kBGRA8 && a_channel != 1 ? 2 - a_channel : a_channel;
+			return SRGBToLinear(pixels[a_y * GetRowPitch() + a_x * 4 + byte] / 255.0);
+		}
+	};
+
+	SourceImage MakeImage(size_t a_width, size_t a_height, Utils::ScalerFormat a_format)
+	{
+		SourceImage                           image{ {}, a_width, a_height, a_format };
+		std::mt19937                          random(static_cast<uint32_t>(a_width * 7 + a_height));
+		std::uniform_real_distribution<float> hdr(0.f, 4.f);
+		std::uniform_int_distribution<int>    sdr(0, 255);
+		image.pixels.resize(image.GetRowPitch() * a_height);
+		for (size_t i = 0; i < a_width * a_height * 4; ++i) {
+			if (a_format == Utils::ScalerFormat::kRGBA16F) {
+				const uint16_t half = Utils::FloatToHalf(hdr(random));
+				std::memcpy(image.pixels.data() + i * 2, &half, sizeof(half));
+			} else {
+				image.pixels[i] = static_cast<uint8_t>(sdr(random));
+			}
+		}
+		return image;
+	}
+
+	// Each output pixel is the average of the cropped source area it covers, weighted by coverage
+	std::vector<double> ScaleReference(const SourceImage& a_image, size_t a_width, size_t a_height)
+	{
+		const Utils::ScalerCrop crop = Utils::GetCenterCrop(a_image.width, a_image.height, a_width, a_height);
+		const double            scaleX = static_cast<double>(crop.width) / static_cast<double>(a_width);
+		const double            scaleY = static_cast<double>(crop.height) / static_cast<double>(a_height);
+		auto                    coverage = [](double a_start, double a_end, size_t a_pixel) {
+			return std::max(std::min(a_end, a_pixel + 1.0) - std::max(a_start, static_cast<double>(a_pixel)), 0.0);
+		};
+
+		std::vector<double> result(a_width * a_height * 3);
+		for (size_t y = 0; y < a_height; ++y) {
+			for (size_t x = 0; x < a_width; ++x) {
+				double sum[3] = {};
+				double totalWeight = 0.0;
+				for (size_t sourceY = 0; sourceY < crop.height; ++sourceY) {
+					const double weightY = coverage(y * scaleY, (y + 1) * scaleY, sourceY);
+					for (size_t sourceX = 0; weightY > 0.0 && sourceX < crop.width; ++sourceX) {
+						const double weight = weightY * coverage(x * scaleX, (x + 1) * scaleX, sourceX);
+						for (size_t c = 0; c < 3 && weight > 0.0; ++c) {
+							sum[c] += weight * a_image.GetLinear(crop.x + sourceX, crop.y + sourceY, c);
+						}
+						totalWeight += weight;
+					}
+				}
+				for (size_t c = 0; c < 3; ++c) {
+					result[(y * a_width + x) * 3 + c] = sum[c] / totalWeight;
+				}
+			}
+		}
+		return result;
+	}
+
+	// Compares the half float output within its precision, and the 8 bit output within one step of the sRGB encoded reference
+	void CheckScaled(Utils::ThumbnailScaler& a_scaler, const std::vector<double>& a_reference)
+	{
+		const size_t          width = a_scaler.GetWidth();
+		const size_t          height = a_scaler.GetHeight();
+		std::vector<uint16_t> halfs(width * height * 4);
+		std::vector<uint8_t>  bytes(width * height * 4);
+		a_scaler.GetPixels(Utils::ScalerFormat::kRGBA16F, reinterpret_cast<uint8_t*>(halfs.data()), width * 8);
+		a_scaler.GetPixels(Utils::ScalerFormat::kBGRA8, bytes.data(), width * 4);
+
+		size_t halfMismatches = 0;
+		size_t byteMismatches = 0;
+		for (size_t i = 0; i < width * height; ++i) {
+			for (size_t c = 0; c < 3; ++c) {
+				const double expected = a_reference[i * 3 + c];
+				halfMismatches += std::abs(Utils::HalfToFloat(halfs[i * 4 + c]) - expected) > expected * 1e-3 + 1e-6;
+				const double expectedByte = LinearToSRGB(std::clamp(expected, 0.0, 1.0)) * 255.0;
+				byteMismatches += std::abs(bytes[i * 4 + 2 - c] - expectedByte) > 0.51;
+			}
+			halfMismatches += halfs[i * 4 + 3] != 0x3C00;
+			byteMismatches += bytes[i * 4 + 3] != 255;
+		}
+		CHECK_EQ(halfMismatches, size_t(0));
+		CHECK_EQ(byteMismatches, size_t(0));
+	}
+
+	void CheckAgainstReference(size_t a_sourceWidth, size_t a_sourceHeight, size_t a_width, size_t a_height, Utils::ScalerFormat a_format)
+	{
+		const SourceImage image = MakeImage(a_sourceWidth, a_sourceHeight, a_format);
+		const auto        reference = ScaleReference(image, a_width, a_height);
+		for (const bool bForceScalar : { false, true }) {
+			Tests::bForceScalar = bForceScalar;
+			Utils::ThumbnailScaler scaler(a_sourceWidth, a_sourceHeight, a_width, a_height);
+			scaler.AddSourceImage(image.pixels.data(), image.GetRowPitch(), a_format);
+			CheckScaled(scaler, reference);
+		}
+		Tests::bForceScalar = false;
+	}
+}
+
+TEST_CASE(CropsToTheTargetAspectRatio)
+{
+	const auto wide = Utils::GetCenterCrop(2560, 1080, 640, 360);
+	CHECK_EQ(wide.x, size_t(320));
+	CHECK_EQ(wide.width, size_t(1920));
+	CHECK_EQ(wide.height, size_t(1080));
+
+	const auto tall = Utils::GetCenterCrop(1920, 1200, 640, 360);
+	CHECK_EQ(tall.y, size_t(60));
+	CHECK_EQ(tall.height, size_t(1080));
+
+	const auto same = Utils::GetCenterCrop(1920, 1080, 640, 360);
+	CHECK(same.x == 0 && same.y == 0 && same.width == 1920 && same.height == 1080);
+}
+
+TEST_CASE(MatchesTheReferenceBoxFilter)
+{
+	CheckAgainstReference(203, 117, 40, 30, Utils::ScalerFormat::kRGBA16F);
+	CheckAgainstReference(203, 117, 40, 30, Utils::ScalerFormat::kRGBA8);
+	CheckAgainstReference(160, 90, 64, 36, Utils::ScalerFormat::kBGRA8);  // Fractional scale
+	CheckAgainstReference(37, 301, 9, 16, Utils::ScalerFormat::kRGBA16F);
+	CheckAgainstReference(3, 2, 7, 5, Utils::ScalerFormat::kRGBA16F);    // Upscaled
+	CheckAgainstReference(1, 1, 1, 1, Utils::ScalerFormat::kRGBA8);
+}
+
+// Rows are added from whichever thread compresses them, so they come in out of order and at the same time
+TEST_CASE(AddsRowsInAnyOrder)
+{
+	const SourceImage image = MakeImage(640, 480, Utils::ScalerFormat::kRGBA16F);
+	const auto        reference = ScaleReference(image, 48, 27);
+
+	Utils::WorkerPool      workers(4, 4);
+	Utils::ThumbnailScaler parallel(image.width, image.height, 48, 27);
+	parallel.AddSourceImage(image.pixels.data(), image.GetRowPitch(), image.format, &workers);
+	CheckScaled(parallel, reference);
+
+	std::vector<size_t> rows(image.height);
+	std::iota(rows.begin(), rows.end(), size_t(0));
+	std::ranges::shuffle(rows, std::mt19937(1));
+	Utils::ThumbnailScaler shuffled(image.width, image.height, 48, 27);
+	for (const size_t y : rows) {
+		shuffled.AddSourceRow(y, image.pixels.data() + y * image.GetRowPitch(), image.format);
+	}
+	CheckScaled(shuffled, reference);
+}
+
+TEST_CASE(IgnoresRowsOutsideOfTheCrop)
+{
+	SourceImage image = MakeImage(64, 100, Utils::ScalerFormat::kRGBA8);
+	const auto  reference = ScaleReference(image, 16, 9);
+
+	Utils::ThumbnailScaler scaler(image.width, image.height, 16, 9);
+	scaler.AddSourceImage(image.pixels.data(), image.GetRowPitch(), image.format);
+	std::vector<uint8_t> white(image.GetRowPitch(), 255);
+	scaler.AddSourceRow(0, white.data(), image.format);
+	scaler.AddSourceRow(image.height - 1, white.data(), image.format);
+	scaler.AddSourceRow(image.height, white.data(), image.format);
+	CheckScaled(scaler, reference);
+}
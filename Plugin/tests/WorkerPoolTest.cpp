@@ -0,0 +1,108 @@
+#include "WorkerPool.h"
+
+#include "Test.h"
+
+TEST_CASE(RunsEverySubmittedJob)
+{
+	Utils::WorkerPool    workers(3, 2);
+	std::atomic_uint32_t count = 0;
+	for (uint32_t i = 0; i < 100; ++i) {
+		CHECK(workers.Submit([&count]() { ++count; }));
+	}
+	workers.WaitIdle();
+	CHECK_EQ(count.load(), 100u);
+	CHECK_EQ(workers.GetMetrics().completedJobs, uint64_t(100));
+	CHECK(workers.GetMetrics().maxQueueDepth <= 2);
+}
+
+TEST_CASE(TrySubmitFailsWhenTheQueueIsFull)
+{
+	Utils::WorkerPool workers(1, 1);
+	std::latch        release(1);
+	std::latch        started(1);
+	CHECK(workers.Submit([&]() { started.count_down(); release.wait(); }));
+	started.wait();
+	CHECK(workers.Submit([]() {}));  // Fills the queue
+
+	Utils::WorkerPool::Job job = []() {};
+	CHECK(!workers.TrySubmit(job));
+	CHECK(job != nullptr);  // Left untouched
+
+	release.count_down();
+	workers.WaitIdle();
+	CHECK(workers.TrySubmit(job));
+}
+
+TEST_CASE(ThrowingJobsDontStopTheWorkers)
+{
+	Utils::WorkerPool    workers(1, 4);
+	std::atomic_uint32_t count = 0;
+	workers.Submit([]() { throw std::runtime_error("test"); });
+	workers.Submit([]() { throw 42; });
+	workers.Submit([&count]() { ++count; });
+	workers.WaitIdle();
+	CHECK_EQ(count.load(), 1u);
+	CHECK_EQ(workers.GetMetrics().completedJobs, uint64_t(3));
+}
+
+TEST_CASE(ParallelForCoversTheWholeRange)
+{
+	Utils::WorkerPool     workers(3, 3);
+	std::vector<uint32_t> visits(1001, 0);
+	workers.ParallelFor(visits.size(), [&visits](size_t a_begin, size_t a_end) {
+		for (size_t i = a_begin; i < a_end; ++i) {
+			++visits[i];
+		}
+	});
+	CHECK(std::ranges::all_of(visits, [](uint32_t a_visits) { return a_visits == 1; }));
+
+	bool bCalled = false;
+	workers.ParallelFor(0, [&bCalled](size_t, size_t) { bCalled = true; });
+	CHECK(!bCalled);
+}
+
+TEST_CASE(ParallelForRethrowsAfterAllRangesAreDone)
+{
+	Utils::WorkerPool    workers(3, 3);
+	std::atomic_uint32_t finishedRanges = 0;
+	bool                 bThrown = false;
+	try {
+		workers.ParallelFor(4, [&finishedRanges](size_t a_begin, size_t) {
+			if (a_begin == 1) {
+				throw std::runtime_error("test");
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			++finishedRanges;
+		});
+	} catch (const std::runtime_error&) {
+		bThrown = true;
+	}
+	CHECK(bThrown);
+	CHECK_EQ(finishedRanges.load(), 3u);
+}
+
+TEST_CASE(ShutdownRunsTheQueuedJobs)
+{
+	Utils::WorkerPool    workers(1, 8);
+	std::atomic_uint32_t count = 0;
+	for (uint32_t i = 0; i < 8; ++i) {
+		workers.Submit([&count]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			++count;
+		});
+	}
+	workers.Shutdown();
+	CHECK_EQ(count.load(), 8u);
+
+	CHECK(!workers.Submit([&count]() { ++count; }));
+	Utils::WorkerPool::Job job = [&count]() { ++count; };
+	CHECK(!workers.TrySubmit(job));
+	CHECK_EQ(count.load(), 8u);
+
+	// Runs everything on the calling thread once the workers are gone
+	std::atomic_uint32_t ranges = 0;
+	workers.ParallelFor(10, [&ranges](size_t, size_t) { ++ranges; });
+	CHECK_EQ(ranges.load(), 2u);
+
+	workers.Shutdown();  // Again, from the destructor too
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "dxgiformat.h"
+
+// Stand-in for the Windows SDK header on other platforms. The tested code only passes these around as opaque handles.
+typedef void* HWND;
+typedef void* HANDLE;
+
+struct ID3D12Resource;
@@ -0,0 +1,5 @@
+#pragma once
+#include "dxgiformat.h"
+
+// Stand-in for the Windows SDK header on other platforms. The tested code only passes these around as opaque handles.
+struct IDXGISwapChain3;
@@ -0,0 +1,30 @@
+// Writes "shaders/HdrDllPluginConstants.hlsl" from "Settings::shaderConstantFields", or with "--check", fails if the file is out of date.
+// Built and run by CMake, so the shaders can't silently go out of sync with "Settings::ShaderConstants".
+#include "ShaderConstants.h"
+
+int main(int argc, char* argv[])
+{
+	const bool bCheck = argc == 3 && std::string_view(argv[2]) == "--check";
+	if (argc != 2 && !bCheck) {
+		std::cerr << "Usage: GenerateShaderConstantsHLSL <HdrDllPluginConstants.hlsl> [--check]\n";
+		return 2;
+	}
+
+	const std::filesystem::path path = argv[1];
+	const std::string           hlsl = Settings::GenerateShaderConstantsHLSL();
+
+	if (bCheck) {
+		std::ifstream file(path, std::ios::binary);
+		std::string   current((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		std::erase(current, '\r');  // Git might have checked it out with CRLF line endings
+		if (current != hlsl) {
+			std::cerr << path.string() << " is out of date with Settings::shaderConstantFields, build the UpdateShaderConstantsHLSL target to regenerate it\n";
+			return 1;
+		}
+		return 0;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << hlsl;
+	return file ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Generated from "Settings::shaderConstantFields" by "Settings::GenerateShaderConstantsHLSL()", don't edit it by hand.
+
+// Custom push constants uploaded by the HDR DLL plugin code. Do note that register space comes at a premium when adding members. Bit/byte packing is advised.
+// Bools are set as uint to avoid padding inconsistencies between c++ and hlsl.
+struct StructHdrDllPluginConstants
+{
+	int DisplayMode; // -1 SDR on scRGB HDR, 0 SDR (Rec.709 with 2.2 gamma, not sRGB), 1 HDR10 PQ BT.2020, 2 scRGB HDR
+	float HDRPeakBrightnessNits; // Set equal to the max nits your display can output
+	float HDRGamePaperWhiteNits; // 203 is the reference value (ReferenceWhiteNits_BT2408)
+	float HDRUIPaperWhiteNits; // 203 is the reference value (ReferenceWhiteNits_BT2408)
+	float HDRExtendGamut; // 0-1. 0 is neutral
+	uint AutoHDRVideos;
+	float SDRSecondaryBrightness; // 0-2. Only meant for SDR. 1 is neutral
+	uint ToneMapperType; // Overrides tonemapper type. 0 is default (not overridden)
+	float ToneMapperSaturation; // 0.5-1.5. 1 is neutral
+	float ToneMapperContrast; // 0.5-1.5. 1 is neutral
+	float ToneMapperHighlights; // 0-1. 0.5 is "neutral"
+	float ToneMapperShadows; // 0-1. 0.5 is neutral
+	float ToneMapperBloom; // 0-1. 0.5 is neutral
+	float ColorGradingStrength; // 1 is full strength
+	float LUTCorrectionStrength; // 1 is full strength
+	uint StrictLUTApplication; // false is default (true looks more like vanilla SDR)
+	float GammaCorrection; // Application percentage of "SDR_USE_GAMMA_2_2" correction from LUTs. 0 to 1. 1 is "neutral"
+	uint FilmGrainType; // 1 is default
+	float FilmGrainFPSLimit; // 24 and 0 are common defaults
+	uint PostSharpen; // true is default
+	uint IsAtEndOfFrame;
+	uint RuntimeMS;
+	float DevSetting01; // 0-1 variable for development. Default 0
+	float DevSetting02; // 0-1 variable for development. Default 0
+	float DevSetting03; // 0-1 variable for development. Default 0
+	float DevSetting04; // 0-1 variable for development. Default 0.5
+	float DevSetting05; // 0-1 variable for development. Default 0.5
+};
+
+#define HDR_PLUGIN_CONSTANTS_SIZE "27"